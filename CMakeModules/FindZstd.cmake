@@ -0,0 +1,38 @@
+# Tries to find Zstd.
+#
+# Usage of this module as follows:
+#
+#     find_package(Zstd)
+#
+# Variables used by this module, they can change the default behaviour and need
+# to be set before calling find_package:
+#
+#  Zstd_ROOT_DIR  Set this variable to the root installation of
+#                 Zstd if the module has problems finding
+#                 the proper installation path.
+#
+# Variables defined by this module:
+#
+#  ZSTD_FOUND              System has Zstd libs/headers
+#  ZSTD_LIBRARIES          The Zstd library
+#  ZSTD_INCLUDE_DIR        The location of Zstd headers (zstd.h and zdict.h)
+
+find_library(ZSTD_LIBRARIES
+  NAMES zstd
+  HINTS ${Zstd_ROOT_DIR}/lib)
+
+find_path(ZSTD_INCLUDE_DIR
+  NAMES zdict.h zstd.h
+  HINTS ${Zstd_ROOT_DIR}/include)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(
+  Zstd
+  DEFAULT_MSG
+  ZSTD_LIBRARIES
+  ZSTD_INCLUDE_DIR)
+
+mark_as_advanced(
+  Zstd_ROOT_DIR
+  ZSTD_LIBRARIES
+  ZSTD_INCLUDE_DIR)
@@ -24,9 +24,22 @@ namespace eosio { namespace chain {
       permission_link_index
    >;
 
+   /**
+    * Entries are added as permissions are created and modified, and never removed: undo restores
+    * permissions without going through authorization_manager, so a key or account a permission
+    * no longer has may be back after a fork switch. Lookups check each permission against its
+    * current authority instead.
+    */
+   struct authorization_manager::authorizer_index {
+      std::map<public_key_type, std::set<permission_id_type>> by_key;
+      std::map<account_name, std::set<permission_id_type>>    by_account;
+   };
+
    authorization_manager::authorization_manager(controller& c, database& d)
    :_control(c),_db(d){}
 
+   authorization_manager::~authorization_manager() = default;
+
    void authorization_manager::add_indices() {
       authorization_index_set::add_indices(_db);
    }
@@ -157,6 +170,7 @@ namespace eosio { namespace chain {
          p.last_updated = creation_time;
          p.auth         = auth;
       });
+      index_authorizers( perm );
       return perm;
    }
 
@@ -184,6 +198,7 @@ namespace eosio { namespace chain {
          p.last_updated = creation_time;
          p.auth         = std::move(auth);
       });
+      index_authorizers( perm );
       return perm;
    }
 
@@ -192,6 +207,7 @@ namespace eosio { namespace chain {
          po.auth = auth;
          po.last_updated = _control.pending_block_time();
       });
+      index_authorizers( permission );
    }
 
    void authorization_manager::remove_permission( const permission_object& permission ) {
@@ -215,6 +231,51 @@ namespace eosio { namespace chain {
       return _db.get<permission_usage_object, by_id>( permission.usage_id ).last_used;
    }
 
+   void authorization_manager::enable_authorizer_index() {
+      _authorizer_index = std::make_unique<authorizer_index>();
+      const auto& permissions = _db.get_index<permission_index>();
+      for( const auto& p : permissions ) {
+         index_authorizers( p );
+      }
+   }
+
+   void authorization_manager::index_authorizers( const permission_object& permission ) {
+      if( !_authorizer_index ) return;
+      for( const auto& k : permission.auth.keys ) {
+         _authorizer_index->by_key[k.key].insert( permission.id );
+      }
+      for( const auto& a : permission.auth.accounts ) {
+         _authorizer_index->by_account[a.permission.actor].insert( permission.id );
+      }
+   }
+
+   vector<const permission_object*> authorization_manager::find_permissions_by_key( const public_key_type& key )const {
+      EOS_ASSERT( _authorizer_index, unsupported_feature, "The authorizer index is not enabled" );
+      vector<const permission_object*> result;
+      auto itr = _authorizer_index->by_key.find( key );
+      if( itr == _authorizer_index->by_key.end() ) return result;
+      for( const auto& id : itr->second ) {
+         const auto* p = _db.find<permission_object, by_id>( id );
+         if( p && std::any_of( p->auth.keys.begin(), p->auth.keys.end(), [&]( const auto& k ) { return k.key == key; } ) )
+            result.push_back( p );
+      }
+      return result;
+   }
+
+   vector<const permission_object*> authorization_manager::find_permissions_by_account( account_name account )const {
+      EOS_ASSERT( _authorizer_index, unsupported_feature, "The authorizer index is not enabled" );
+      vector<const permission_object*> result;
+      auto itr = _authorizer_index->by_account.find( account );
+      if( itr == _authorizer_index->by_account.end() ) return result;
+      for( const auto& id : itr->second ) {
+         const auto* p = _db.find<permission_object, by_id>( id );
+         if( p && std::any_of( p->auth.accounts.begin(), p->auth.accounts.end(),
+                               [&]( const auto& a ) { return a.permission.actor == account; } ) )
+            result.push_back( p );
+      }
+      return result;
+   }
+
    const permission_object*  authorization_manager::find_permission( const permission_level& level )const
    { try {
       EOS_ASSERT( !level.actor.empty() && !level.permission.empty(), invalid_permission, "Invalid permission" );
@@ -36,6 +36,12 @@ namespace eosio { namespace chain {
             bool                     genesis_written_to_block_log = false;
             uint32_t                 version = 0;
             uint32_t                 first_block_num = 0;
+            fc::path                 data_dir;
+            log_split_config         split_config;
+            log_catalog              catalog;
+            std::fstream             retained_block_stream;
+            std::fstream             retained_index_stream;
+            uint32_t                 retained_first_block_num = 0; ///< first block of the segment open in the retained streams
 
             inline void check_open_files() {
                if( !open_files ) {
@@ -51,6 +57,48 @@ namespace eosio { namespace chain {
                   index_stream.close();
                open_files = false;
             }
+
+            void close_retained() {
+               if( retained_block_stream.is_open() )
+                  retained_block_stream.close();
+               if( retained_index_stream.is_open() )
+                  retained_index_stream.close();
+               retained_first_block_num = 0;
+            }
+
+            /// opens the retained segment which contains block_num in the retained streams, if there is one
+            fc::optional<log_catalog::segment> open_retained( uint32_t block_num ) {
+               auto segment = catalog.find(block_num);
+               if( segment && (!retained_block_stream.is_open() || retained_first_block_num != segment->first_block_num) ) {
+                  close_retained();
+                  retained_block_stream.open(segment->log_file.generic_string().c_str(), LOG_READ);
+                  retained_index_stream.open(segment->index_file.generic_string().c_str(), LOG_READ);
+                  retained_first_block_num = segment->first_block_num;
+               }
+               return segment;
+            }
+
+            /**
+             * The bytes of the block at entry i of an index, last if it is the final block of the log. A block
+             * is followed by its 8 byte position, so it ends 8 bytes before the next block or the end of the log.
+             */
+            static vector<char> read_serialized_block( std::fstream& blocks, std::fstream& index, uint64_t i, bool last ) {
+               uint64_t pos, end;
+               index.seekg(sizeof(uint64_t) * i);
+               index.read((char*)&pos, sizeof(pos));
+               if( last ) {
+                  blocks.seekg(0, std::ios::end);
+                  end = blocks.tellg();
+               } else {
+                  index.read((char*)&end, sizeof(end));
+               }
+               EOS_ASSERT(end >= pos + sizeof(uint64_t), block_log_exception,
+                          "Invalid block position in block log index.", ("pos", pos)("end", end));
+               vector<char> bytes(end - pos - sizeof(uint64_t));
+               blocks.seekg(pos);
+               blocks.read(bytes.data(), bytes.size());
+               return bytes;
+            }
       };
 
       void block_log_impl::reopen() {
@@ -70,10 +118,13 @@ namespace eosio { namespace chain {
       }
    }
 
-   block_log::block_log(const fc::path& data_dir)
+   block_log::block_log(const fc::path& data_dir, const log_split_config& split_config)
    :my(new detail::block_log_impl()) {
       my->block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
       my->index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->retained_block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->retained_index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->split_config = split_config;
       open(data_dir);
    }
 
@@ -85,6 +136,7 @@ namespace eosio { namespace chain {
       if (my) {
          flush();
          my->close();
+         my->close_retained();
          my.reset();
       }
    }
@@ -95,6 +147,7 @@ namespace eosio { namespace chain {
       if (!fc::is_directory(data_dir))
          fc::create_directories(data_dir);
 
+      my->data_dir = data_dir;
       my->block_file = data_dir / "blocks.log";
       my->index_file = data_dir / "blocks.index";
 
@@ -175,6 +228,20 @@ namespace eosio { namespace chain {
          fc::remove_all(my->index_file);
          my->reopen();
       }
+
+      if (my->split_config.stride) {
+         my->catalog.open(data_dir, my->split_config, "blocks");
+         if (!my->catalog.empty() && my->catalog.last_block_num() + 1 != my->first_block_num) {
+            wlog("Retained block log segments end at block ${n} but blocks.log starts at block ${f}; ignoring them",
+                 ("n", my->catalog.last_block_num())("f", my->first_block_num));
+            my->catalog.clear();
+         }
+         // blocks.log is empty right after a split; the head is the last block of the newest segment
+         if (!my->head && !my->catalog.empty()) {
+            my->head = read_retained_block_by_num(my->catalog.last_block_num());
+            my->head_id = my->head->id();
+         }
+      }
    }
 
    uint64_t block_log::append(const signed_block_ptr& b) {
@@ -200,6 +267,9 @@ namespace eosio { namespace chain {
 
          flush();
 
+         if (my->split_config.stride && b->block_num() % my->split_config.stride == 0)
+            split();
+
          return pos;
       }
       FC_LOG_AND_RETHROW()
@@ -210,9 +280,28 @@ namespace eosio { namespace chain {
       my->index_stream.flush();
    }
 
+   void block_log::split() {
+      auto gs = extract_genesis_state(my->data_dir);
+      auto head = my->head;
+      flush();
+      my->close();
+      my->catalog.add(my->first_block_num, head->block_num(), my->block_file, my->index_file);
+      ilog("Split block log at block ${n}", ("n", head->block_num()));
+
+      reset(gs, signed_block_ptr(), head->block_num() + 1);
+      my->head = head;
+      my->head_id = head->id();
+   }
+
    void block_log::reset( const genesis_state& gs, const signed_block_ptr& first_block, uint32_t first_block_num ) {
       my->close();
 
+      if( !my->catalog.empty() && my->catalog.last_block_num() + 1 != first_block_num ) {
+         wlog( "Retained block log segments end at block ${n} but the block log is reset to start at block ${f}; ignoring them",
+               ("n", my->catalog.last_block_num())("f", first_block_num) );
+         my->catalog.clear();
+      }
+
       fc::remove_all(my->block_file);
       fc::remove_all(my->index_file);
 
@@ -261,6 +350,9 @@ namespace eosio { namespace chain {
 
    signed_block_ptr block_log::read_block_by_num(uint32_t block_num)const {
       try {
+         if (block_num < my->first_block_num && !my->catalog.empty())
+            return read_retained_block_by_num(block_num);
+
          signed_block_ptr b;
          uint64_t pos = get_block_pos(block_num);
          if (pos != npos) {
@@ -272,6 +364,50 @@ namespace eosio { namespace chain {
       } FC_LOG_AND_RETHROW()
    }
 
+   signed_block_ptr block_log::read_retained_block_by_num(uint32_t block_num)const {
+      auto segment = my->open_retained(block_num);
+      if (!segment)
+         return {};
+
+      uint64_t pos;
+      my->retained_index_stream.seekg(sizeof(uint64_t) * (block_num - segment->first_block_num));
+      my->retained_index_stream.read((char*)&pos, sizeof(pos));
+      my->retained_block_stream.seekg(pos);
+      auto b = std::make_shared<signed_block>();
+      fc::raw::unpack(my->retained_block_stream, *b);
+      EOS_ASSERT(b->block_num() == block_num, reversible_blocks_exception,
+                 "Wrong block was read from retained block log segment.", ("returned", b->block_num())("expected", block_num));
+      return b;
+   }
+
+   vector<char> block_log::read_serialized_block_by_num(uint32_t block_num)const {
+      try {
+         vector<char> bytes;
+         if (block_num < my->first_block_num && !my->catalog.empty()) {
+            auto segment = my->open_retained(block_num);
+            if (segment) {
+               bytes = detail::block_log_impl::read_serialized_block(my->retained_block_stream, my->retained_index_stream,
+                                                                     block_num - segment->first_block_num,
+                                                                     block_num == segment->last_block_num);
+            }
+         } else if (get_block_pos(block_num) != npos) {
+            bytes = detail::block_log_impl::read_serialized_block(my->block_stream, my->index_stream,
+                                                                  block_num - my->first_block_num,
+                                                                  block_num == block_header::num_from_id(my->head_id));
+         }
+
+         if (!bytes.empty()) {
+            // a block starts with its header
+            fc::datastream<const char*> ds(bytes.data(), bytes.size());
+            signed_block_header header;
+            fc::raw::unpack(ds, header);
+            EOS_ASSERT(header.block_num() == block_num, reversible_blocks_exception,
+                       "Wrong block was read from block log.", ("returned", header.block_num())("expected", block_num));
+         }
+         return bytes;
+      } FC_LOG_AND_RETHROW()
+   }
+
    uint64_t block_log::get_block_pos(uint32_t block_num) const {
       my->check_open_files();
       if (!(my->head && block_num <= block_header::num_from_id(my->head_id) && block_num >= my->first_block_num))
@@ -306,6 +442,8 @@ namespace eosio { namespace chain {
    }
 
    uint32_t block_log::first_block_num() const {
+      if (!my->catalog.empty())
+         return my->catalog.first_block_num();
       return my->first_block_num;
    }
 
@@ -30,6 +30,19 @@
 #include <fc/scoped_exit.hpp>
 #include <fc/variant_object.hpp>
 
+namespace eosio { namespace chain {
+   /// a table_id_object as written to snapshots, read before the table is created
+   struct snapshot_table_id_row {
+      account_name   code;
+      scope_name     scope;
+      table_name     table;
+      account_name   payer;
+      uint32_t       count = 0;
+   };
+} }
+
+FC_REFLECT( eosio::chain::snapshot_table_id_row, (code)(scope)(table)(payer)(count) )
+
 namespace eosio { namespace chain {
 
 using resource_limits::resource_limits_manager;
@@ -227,6 +240,7 @@ struct controller_impl {
    bool                           trusted_producer_light_validation = false;
    uint32_t                       snapshot_head_block = 0;
    named_thread_pool              thread_pool;
+   mutable writer_priority_shared_mutex state_mutex; ///< held exclusively while the state changes, see controller::read_lock
 
    typedef pair<scope_name,action_name>                   handler_key;
    map< account_name, map<handler_key, apply_handler> >   apply_handlers;
@@ -291,7 +305,7 @@ struct controller_impl {
     reversible_blocks( cfg.blocks_dir/config::reversible_blocks_dir_name,
         cfg.read_only ? database::read_only : database::read_write,
         cfg.reversible_cache_size, false, cfg.db_map_mode, cfg.db_hugepage_paths ),
-    blog( cfg.blocks_dir ),
+    blog( cfg.blocks_dir, cfg.blocks_log_split ),
     fork_db( cfg.state_dir ),
     wasmif( cfg.wasm_runtime, db ),
     resource_limits( db ),
@@ -711,42 +725,121 @@ struct controller_impl {
                   */
    }
 
-   void add_contract_tables_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
-      snapshot->write_section("contract_tables", [this]( auto& section ) {
-         index_utils<table_id_multi_index>::walk(db, [this, &section]( const table_id_object& table_row ){
-            // add a row for the table
-            section.add_row(table_row, db);
+   static std::string contract_tables_chunk_name( uint32_t chunk ) {
+      return "contract_tables." + std::to_string(chunk);
+   }
 
-            // followed by a size row and then N data rows for each type of table
-            contract_database_index_set::walk_indices([this, &section, &table_row]( auto utils ) {
-               using utils_t = decltype(utils);
-               using value_t = typename decltype(utils)::index_t::value_type;
-               using by_table_id = object_to_table_id_tag_t<value_t>;
+   /// the rows of a table, of every type, with a primary key from lower up to but not including upper
+   struct contract_table_piece {
+      table_id_object::id_type t_id;
+      uint64_t                 lower = 0;
+      optional<uint64_t>       upper; ///< to the end of the table if not set
+   };
 
-               auto tid_key = boost::make_tuple(table_row.id);
-               auto next_tid_key = boost::make_tuple(table_id_object::id_type(table_row.id._id + 1));
+   template<typename Section>
+   void add_contract_table_to_snapshot( Section& section, const table_id_object& table_row,
+                                        uint64_t lower = 0, const optional<uint64_t>& upper = optional<uint64_t>() ) const {
+      // add a row for the table
+      section.add_row(table_row, db);
 
-               unsigned_int size = utils_t::template size_range<by_table_id>(db, tid_key, next_tid_key);
-               section.add_row(size, db);
+      // followed by a size row and then N data rows for each type of table
+      contract_database_index_set::walk_indices([this, &section, &table_row, lower, &upper]( auto utils ) {
+         using utils_t = decltype(utils);
+         using value_t = typename decltype(utils)::index_t::value_type;
+         using by_table_id = object_to_table_id_tag_t<value_t>;
 
-               utils_t::template walk_range<by_table_id>(db, tid_key, next_tid_key, [this, &section]( const auto &row ) {
-                  section.add_row(row, db);
-               });
+         auto tid_key = boost::make_tuple(table_row.id, lower);
+         auto next_tid_key = upper ? boost::make_tuple(table_row.id, *upper)
+                                   : boost::make_tuple(table_id_object::id_type(table_row.id._id + 1), uint64_t(0));
+
+         unsigned_int size = utils_t::template size_range<by_table_id>(db, tid_key, next_tid_key);
+         section.add_row(size, db);
+
+         utils_t::template walk_range<by_table_id>(db, tid_key, next_tid_key, [this, &section]( const auto &row ) {
+            section.add_row(row, db);
+         });
+      });
+   }
+
+   void add_contract_tables_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
+      const auto rows_per_chunk = snapshot->rows_per_chunk();
+      if( rows_per_chunk == 0 ) {
+         snapshot->write_section("contract_tables", [this]( auto& section ) {
+            index_utils<table_id_multi_index>::walk(db, [this, &section]( const table_id_object& table_row ){
+               add_contract_table_to_snapshot(section, table_row);
             });
          });
+         return;
+      }
+
+      // split into chunks named contract_tables.<n> of roughly rows_per_chunk rows each. A table with more rows
+      // is split into pieces at every rows_per_chunk-th primary key; a piece holds the rows of every type in its
+      // primary key range, so with secondary indices it can hold a multiple of rows_per_chunk rows.
+      vector<vector<contract_table_piece>> chunks(1);
+      uint64_t chunk_rows = 0;
+      auto add_piece = [&]( contract_table_piece piece, uint64_t rows ) {
+         chunks.back().push_back( piece );
+         chunk_rows += rows;
+         if( chunk_rows >= rows_per_chunk ) {
+            chunks.emplace_back();
+            chunk_rows = 0;
+         }
+      };
+
+      const auto& kv_idx = db.get_index<key_value_index, by_scope_primary>();
+      index_utils<table_id_multi_index>::walk(db, [&]( const table_id_object& table_row ){
+         if( table_row.count < rows_per_chunk ) {
+            add_piece( { table_row.id }, table_row.count + 1 );
+            return;
+         }
+
+         uint64_t lower = 0;
+         uint64_t rows = 0;
+         auto end = kv_idx.lower_bound( boost::make_tuple( table_id_object::id_type(table_row.id._id + 1) ) );
+         for( auto itr = kv_idx.lower_bound( boost::make_tuple( table_row.id ) ); itr != end; ++itr ) {
+            if( rows == rows_per_chunk ) {
+               add_piece( { table_row.id, lower, itr->primary_key }, rows );
+               lower = itr->primary_key;
+               rows = 0;
+            }
+            ++rows;
+         }
+         add_piece( { table_row.id, lower }, rows + 1 );
       });
+      if( chunks.back().empty() )
+         chunks.pop_back();
+
+      for( uint32_t chunk = 0; chunk < chunks.size(); ++chunk ) {
+         snapshot->write_section(contract_tables_chunk_name(chunk), [this, pieces = std::move(chunks[chunk])]( auto& section ) {
+            for( const auto& piece : pieces ) {
+               add_contract_table_to_snapshot(section, db.get<table_id_object>(piece.t_id), piece.lower, piece.upper);
+            }
+         });
+      }
    }
 
    void read_contract_tables_from_snapshot( const snapshot_reader_ptr& snapshot ) {
-      snapshot->read_section("contract_tables", [this]( auto& section ) {
+      // a table split across chunks repeats its table row before each piece, only the first one creates it
+      optional<std::tuple<account_name, scope_name, table_name>> last_table;
+      table_id_object::id_type t_id;
+      auto read_tables = [this, &last_table, &t_id]( auto& section ) {
          bool more = !section.empty();
          while (more) {
             // read the row for the table
-            table_id_object::id_type t_id;
-            index_utils<table_id_multi_index>::create(db, [this, &section, &t_id](auto& row) {
-               section.read_row(row, db);
-               t_id = row.id;
-            });
+            snapshot_table_id_row table_row;
+            section.read_row(table_row, db);
+            auto key = std::make_tuple(table_row.code, table_row.scope, table_row.table);
+            if( !last_table || *last_table != key ) {
+               index_utils<table_id_multi_index>::create(db, [&table_row, &t_id](auto& row) {
+                  row.code  = table_row.code;
+                  row.scope = table_row.scope;
+                  row.table = table_row.table;
+                  row.payer = table_row.payer;
+                  row.count = table_row.count;
+                  t_id = row.id;
+               });
+               last_table = key;
+            }
 
             // read the size and data rows for each type of table
             contract_database_index_set::walk_indices([this, &section, &t_id, &more](auto utils) {
@@ -763,7 +856,17 @@ struct controller_impl {
                }
             });
          }
-      });
+      };
+
+      if( snapshot->has_section("contract_tables") ) {
+         snapshot->read_section("contract_tables", read_tables);
+         return;
+      }
+
+      // sectioned snapshots may split the contract tables into chunks, read back in order
+      for( uint32_t chunk = 0; snapshot->has_section(contract_tables_chunk_name(chunk)); ++chunk ) {
+         snapshot->read_section(contract_tables_chunk_name(chunk), read_tables);
+      }
    }
 
    void add_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
@@ -1989,6 +2092,7 @@ struct controller_impl {
             db.modify(permission, [&]( auto& po ) {
                po.auth = auth;
             });
+            authorization.index_authorizers( permission );
          }
       };
 
@@ -2268,6 +2372,10 @@ void controller::startup( std::function<bool()> shutdown, const snapshot_reader_
 
 const chainbase::database& controller::db()const { return my->db; }
 
+std::shared_lock<writer_priority_shared_mutex> controller::read_lock()const {
+   return std::shared_lock<writer_priority_shared_mutex>( my->state_mutex );
+}
+
 chainbase::database& controller::mutable_db()const { return my->db; }
 
 const fork_database& controller::fork_db()const { return my->fork_db; }
@@ -2396,6 +2504,7 @@ void controller::validate_protocol_features( const vector<digest_type>& features
 
 void controller::start_block( block_timestamp_type when, uint16_t confirm_block_count )
 {
+   std::unique_lock<writer_priority_shared_mutex> g( my->state_mutex );
    validate_db_available_size();
 
    EOS_ASSERT( !my->pending, block_validate_exception, "pending block already exists" );
@@ -2421,6 +2530,7 @@ void controller::start_block( block_timestamp_type when,
                               uint16_t confirm_block_count,
                               const vector<digest_type>& new_protocol_feature_activations )
 {
+   std::unique_lock<writer_priority_shared_mutex> g( my->state_mutex );
    validate_db_available_size();
 
    if( new_protocol_feature_activations.size() > 0 ) {
@@ -2432,6 +2542,7 @@ void controller::start_block( block_timestamp_type when,
 }
 
 block_state_ptr controller::finalize_block( const std::function<signature_type( const digest_type& )>& signer_callback ) {
+   std::unique_lock<writer_priority_shared_mutex> g( my->state_mutex );
    validate_db_available_size();
 
    my->finalize_block();
@@ -2455,12 +2566,14 @@ block_state_ptr controller::finalize_block( const std::function<signature_type(
 }
 
 void controller::commit_block() {
+   std::unique_lock<writer_priority_shared_mutex> g( my->state_mutex );
    validate_db_available_size();
    validate_reversible_available_size();
    my->commit_block(true);
 }
 
 void controller::abort_block() {
+   std::unique_lock<writer_priority_shared_mutex> g( my->state_mutex );
    my->abort_block();
 }
 
@@ -2473,12 +2586,14 @@ std::future<block_state_ptr> controller::create_block_state_future( const signed
 }
 
 void controller::push_block( std::future<block_state_ptr>& block_state_future ) {
+   std::unique_lock<writer_priority_shared_mutex> g( my->state_mutex );
    validate_db_available_size();
    validate_reversible_available_size();
    my->push_block( block_state_future );
 }
 
 transaction_trace_ptr controller::push_transaction( const transaction_metadata_ptr& trx, fc::time_point deadline, uint32_t billed_cpu_time_us ) {
+   std::unique_lock<writer_priority_shared_mutex> g( my->state_mutex );
    validate_db_available_size();
    EOS_ASSERT( get_read_mode() != chain::db_read_mode::READ_ONLY, transaction_type_exception, "push transaction not allowed in read-only mode" );
    EOS_ASSERT( trx && !trx->implicit && !trx->scheduled, transaction_type_exception, "Implicit/Scheduled transaction not allowed" );
@@ -2487,6 +2602,7 @@ transaction_trace_ptr controller::push_transaction( const transaction_metadata_p
 
 transaction_trace_ptr controller::push_scheduled_transaction( const transaction_id_type& trxid, fc::time_point deadline, uint32_t billed_cpu_time_us )
 {
+   std::unique_lock<writer_priority_shared_mutex> g( my->state_mutex );
    validate_db_available_size();
    return my->push_scheduled_transaction( trxid, deadline, billed_cpu_time_us, billed_cpu_time_us > 0 );
 }
@@ -2664,6 +2780,15 @@ signed_block_ptr controller::fetch_block_by_number( uint32_t block_num )const  {
    return my->blog.read_block_by_num(block_num);
 } FC_CAPTURE_AND_RETHROW( (block_num) ) }
 
+vector<char> controller::fetch_serialized_block_by_number( uint32_t block_num )const  { try {
+   auto blk_state = fetch_block_state_by_number( block_num );
+   if( blk_state ) {
+      return fc::raw::pack( *blk_state->block );
+   }
+
+   return my->blog.read_serialized_block_by_num(block_num);
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
 block_state_ptr controller::fetch_block_state_by_id( block_id_type id )const {
    auto state = my->fork_db.get_block(id);
    return state;
@@ -2721,6 +2846,7 @@ void controller::write_snapshot( const snapshot_writer_ptr& snapshot ) const {
 }
 
 void controller::pop_block() {
+   std::unique_lock<writer_priority_shared_mutex> g( my->state_mutex );
    my->pop_block();
 }
 
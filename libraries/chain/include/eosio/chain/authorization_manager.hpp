@@ -10,6 +10,7 @@
 
 #include <utility>
 #include <functional>
+#include <memory>
 
 namespace eosio { namespace chain {
 
@@ -25,6 +26,7 @@ namespace eosio { namespace chain {
          using permission_id_type = permission_object::id_type;
 
          explicit authorization_manager(controller& c, chainbase::database& d);
+         ~authorization_manager();
 
          void add_indices();
          void initialize_database();
@@ -56,6 +58,21 @@ namespace eosio { namespace chain {
          const permission_object*  find_permission( const permission_level& level )const;
          const permission_object&  get_permission( const permission_level& level )const;
 
+         /**
+          * Builds an in memory index of the permissions by the keys and accounts in their
+          * authorities from the permission index, and keeps it up to date from then on. It is not
+          * part of the chain state.
+          */
+         void enable_authorizer_index();
+         bool has_authorizer_index()const { return bool(_authorizer_index); }
+
+         /// the permissions whose authority has key, needs enable_authorizer_index
+         vector<const permission_object*> find_permissions_by_key( const public_key_type& key )const;
+         /// the permissions whose authority has a permission of account, needs enable_authorizer_index
+         vector<const permission_object*> find_permissions_by_account( account_name account )const;
+         /// adds the keys and accounts of a permission changed other than by modify_permission to the authorizer index
+         void index_authorizers( const permission_object& permission );
+
          /**
           * @brief Find the lowest authority level required for @ref authorizer_account to authorize a message of the
           * specified type
@@ -119,8 +136,11 @@ namespace eosio { namespace chain {
          static std::function<void()> _noop_checktime;
 
       private:
+         struct authorizer_index;
+
          const controller&    _control;
          chainbase::database& _db;
+         std::unique_ptr<authorizer_index> _authorizer_index;
 
          void             check_updateauth_authorization( const updateauth& update, const vector<permission_level>& auths )const;
          void             check_deleteauth_authorization( const deleteauth& del, const vector<permission_level>& auths )const;
@@ -6,6 +6,7 @@
 #include <fc/filesystem.hpp>
 #include <eosio/chain/block.hpp>
 #include <eosio/chain/genesis_state.hpp>
+#include <eosio/chain/log_catalog.hpp>
 
 namespace eosio { namespace chain {
 
@@ -34,11 +35,18 @@ namespace eosio { namespace chain {
     *
     * The main file is the only file that needs to persist. The index file can be reconstructed during a
     * linear scan of the main file.
+    *
+    * If log_split_config::stride is set, the log is rotated whenever a block number that is a multiple of the
+    * stride is appended: blocks.log and blocks.index are moved to blocks-<first>-<last>.log/.index in the retained
+    * directory (see log_catalog) and a new partial (version 2) blocks.log is started with the next block. Only the
+    * rename within the blocks directory is done by append(); the move to the retained directory and the archiving of
+    * old segments happen on a background thread. Retained segments are opened on demand when a block below first
+    * block of blocks.log is read.
     */
 
    class block_log {
       public:
-         block_log(const fc::path& data_dir);
+         block_log(const fc::path& data_dir, const log_split_config& split_config = log_split_config());
          block_log(block_log&& other);
          ~block_log();
 
@@ -52,12 +60,16 @@ namespace eosio { namespace chain {
             return read_block_by_num(block_header::num_from_id(id));
          }
 
+         /// the packed block, read without unpacking it; empty if block_num is not in the log
+         vector<char> read_serialized_block_by_num(uint32_t block_num)const;
+
          /**
           * Return offset of block in file, or block_log::npos if it does not exist.
           */
          uint64_t get_block_pos(uint32_t block_num) const;
          signed_block_ptr        read_head()const;
          const signed_block_ptr& head()const;
+         /// first block available in the log, including retained segments
          uint32_t                first_block_num() const;
 
          static const uint64_t npos = std::numeric_limits<uint64_t>::max();
@@ -72,6 +84,8 @@ namespace eosio { namespace chain {
       private:
          void open(const fc::path& data_dir);
          void construct_index();
+         void split();
+         signed_block_ptr read_retained_block_by_num(uint32_t block_num)const;
 
          std::unique_ptr<detail::block_log_impl> my;
    };
@@ -2,9 +2,13 @@
 #include <eosio/chain/block_state.hpp>
 #include <eosio/chain/trace.hpp>
 #include <eosio/chain/genesis_state.hpp>
+#include <eosio/chain/log_catalog.hpp>
+#include <eosio/chain/thread_utils.hpp>
 #include <chainbase/pinnable_mapped_file.hpp>
 #include <boost/signals2/signal.hpp>
 
+#include <shared_mutex>
+
 #include <eosio/chain/abi_serializer.hpp>
 #include <eosio/chain/account_object.hpp>
 #include <eosio/chain/snapshot.hpp>
@@ -64,6 +68,7 @@ namespace eosio { namespace chain {
             flat_set< pair<account_name, action_name> > action_blacklist;
             flat_set<public_key_type> key_blacklist;
             path                     blocks_dir             =  chain::config::default_blocks_dir_name;
+            log_split_config         blocks_log_split;
             path                     state_dir              =  chain::config::default_state_dir_name;
             uint64_t                 state_size             =  chain::config::default_state_size;
             uint64_t                 state_guard_size       =  chain::config::default_state_guard_size;
@@ -163,6 +168,13 @@ namespace eosio { namespace chain {
 
          const chainbase::database& db()const;
 
+         /**
+          *  Shared lock for reading the state from a thread other than the main thread. The
+          *  controller holds it exclusively while it changes the state: while starting, finalizing,
+          *  committing and aborting blocks, and while applying blocks and transactions.
+          */
+         std::shared_lock<writer_priority_shared_mutex> read_lock()const;
+
          const fork_database& fork_db()const;
 
          const account_object&                 get_account( account_name n )const;
@@ -221,6 +233,8 @@ namespace eosio { namespace chain {
 
          signed_block_ptr fetch_block_by_number( uint32_t block_num )const;
          signed_block_ptr fetch_block_by_id( block_id_type id )const;
+         /// fetch_block_by_number in packed form, blocks in the block log are not unpacked
+         vector<char>     fetch_serialized_block_by_number( uint32_t block_num )const;
 
          block_state_ptr fetch_block_state_by_number( uint32_t block_num )const;
          block_state_ptr fetch_block_state_by_id( block_id_type id )const;
@@ -0,0 +1,98 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/thread_utils.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/optional.hpp>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace eosio { namespace chain {
+
+   struct log_split_config {
+      uint32_t stride             = 0;  ///< number of blocks per segment; 0 keeps a single ever-growing log
+      uint32_t max_retained_files = 10; ///< segments beyond this count are moved to archive_dir or deleted
+      fc::path retained_dir;            ///< where finished segments are kept; relative to the log directory, empty means the log directory
+      fc::path archive_dir;             ///< where segments beyond max_retained_files are moved; relative to the log directory, empty deletes them
+   };
+
+   /**
+    * Tracks the finished, read-only segments of a log which is split every log_split_config::stride blocks.
+    *
+    * Each segment is a pair of files named <name>-<first block>-<last block>.log and .index, in the same format as
+    * the head log they were rotated out of, and optionally a <name>-<first block>-<last block>.dict file which holds
+    * whatever else is needed to read the segment on its own (the compression dictionaries of state history logs).
+    * Segments can be moved to cheaper storage or deleted from the oldest end without touching the rest of the log;
+    * only the newest contiguous run of segments is used.
+    *
+    * add() only renames the head log within the log directory. Moving it to the retained directory and archiving or
+    * deleting the oldest segments, which copies whole segments when the directories are on other file systems, is
+    * done on a background thread. A segment is read from the log directory until its move is complete, and segments
+    * left there by a crash are moved again by open().
+    */
+   class log_catalog {
+      public:
+         struct segment {
+            uint32_t first_block_num = 0;
+            uint32_t last_block_num  = 0;
+            fc::path log_file;
+            fc::path index_file;
+            fc::path dict_file; ///< empty if the segment has none
+         };
+
+         log_catalog() = default;
+         ~log_catalog();
+
+         log_catalog( const log_catalog& ) = delete;
+         log_catalog& operator=( const log_catalog& ) = delete;
+
+         void open( const fc::path& log_dir, const log_split_config& cfg, const std::string& name );
+
+         bool     empty()const;
+         size_t   size()const;
+         uint32_t first_block_num()const;
+         uint32_t last_block_num()const;
+
+         /// returns the segment which contains block_num, if there is one
+         fc::optional<segment> find( uint32_t block_num )const;
+         segment back()const;
+
+         /**
+          * renames a finished head log, and dict_file if there is one, into place as a segment, then moves, archives or
+          * deletes segments in the background
+          */
+         void add( uint32_t first_block_num, uint32_t last_block_num, const fc::path& log_file, const fc::path& index_file,
+                   const fc::path& dict_file = fc::path() );
+
+         /// removes the newest segment from the catalog and moves its files back to log_file and index_file; its
+         /// dict_file is deleted since it only duplicates what the head log keeps
+         void pop_back( const fc::path& log_file, const fc::path& index_file );
+
+         /// waits for the moves, archiving and deletions started so far
+         void wait();
+
+         void clear();
+
+      private:
+         fc::path segment_file( const fc::path& dir, uint32_t first_block_num, uint32_t last_block_num, const char* ext )const;
+         static std::vector<fc::path> segment_files( const segment& s );
+         /// moves a segment renamed into the log directory to the retained directory on the background thread
+         void schedule_retain( const segment& s );
+         /// archives or deletes the oldest segments beyond max_retained_files; requires _mtx
+         void schedule_prune();
+
+         fc::path                     log_dir;
+         fc::path                     retained_dir;
+         fc::path                     archive_dir;
+         bool                         separate_retained_dir = false; ///< segments are renamed into log_dir, then moved to retained_dir
+         uint32_t                     max_retained_files = 0;
+         std::string                  name;
+         mutable std::mutex           _mtx;     ///< guards segments, whose paths change once a background move is done
+         std::map<uint32_t, segment>  segments; ///< keyed by first_block_num
+         fc::optional<named_thread_pool> mover;
+   };
+
+} } /// eosio::chain
@@ -6,16 +6,24 @@
 
 #include <eosio/chain/database_utils.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/thread_utils.hpp>
 #include <fc/variant_object.hpp>
 #include <boost/core/demangle.hpp>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <ostream>
 
 namespace eosio { namespace chain {
    /**
     * History:
     * Version 1: initial version with string identified sections and rows
+    * Version 2: sectioned binary layout, sections are independently addressable through a trailing offset table
+    *            and large sections may be split into chunks (sectioned_snapshot_writer/sectioned_snapshot_reader)
     */
    static const uint32_t current_snapshot_version = 1;
+   static const uint32_t sectioned_snapshot_version = 2;
 
    namespace detail {
       template<typename T>
@@ -137,10 +145,10 @@ namespace eosio { namespace chain {
 
          template<typename F>
          void write_section(const std::string section_name, F f) {
-            write_start_section(section_name);
-            auto section = section_writer(*this);
-            f(section);
-            write_end_section();
+            write_section_impl(section_name, [f](snapshot_writer& writer) mutable {
+               auto section = section_writer(writer);
+               f(section);
+            });
          }
 
          template<typename T, typename F>
@@ -148,9 +156,27 @@ namespace eosio { namespace chain {
             write_section(detail::snapshot_section_traits<T>::section_name(), f);
          }
 
+         /**
+          * Number of rows after which a large logical section (contract tables) should be split into separately
+          * named chunks, 0 if the writer expects it as a single section
+          */
+         virtual uint64_t rows_per_chunk() const { return 0; }
+
       virtual ~snapshot_writer(){};
 
       protected:
+         using section_function = std::function<void(snapshot_writer&)>;
+
+         /**
+          * Writers may override this to run section functions elsewhere, e.g. concurrently.  The default writes the
+          * section in place.
+          */
+         virtual void write_section_impl( const std::string& section_name, section_function f ) {
+            write_start_section(section_name);
+            f(*this);
+            write_end_section();
+         }
+
          virtual void write_start_section( const std::string& section_name ) = 0;
          virtual void write_row( const detail::abstract_snapshot_row_writer& row_writer ) = 0;
          virtual void write_end_section() = 0;
@@ -161,6 +187,7 @@ namespace eosio { namespace chain {
    namespace detail {
       struct abstract_snapshot_row_reader {
          virtual void provide(std::istream& in) const = 0;
+         virtual void provide(fc::datastream<const char*>& in) const = 0;
          virtual void provide(const fc::variant&) const = 0;
          virtual std::string row_type_name() const = 0;
       };
@@ -206,6 +233,12 @@ namespace eosio { namespace chain {
             });
          }
 
+         void provide(fc::datastream<const char*>& in) const override {
+            row_validation_helper::apply(data, [&in,this](){
+               fc::raw::unpack(in, data);
+            });
+         }
+
          void provide(const fc::variant& var) const override {
             row_validation_helper::apply(data, [&var,this]() {
                fc::from_variant(var, data);
@@ -281,12 +314,13 @@ namespace eosio { namespace chain {
          return has_section(suffix + detail::snapshot_section_traits<T>::section_name());
       }
 
+      virtual bool has_section( const std::string& section_name ) = 0;
+
       virtual void validate() const = 0;
 
       virtual ~snapshot_reader(){};
 
       protected:
-         virtual bool has_section( const std::string& section_name ) = 0;
          virtual void set_section( const std::string& section_name ) = 0;
          virtual bool read_row( detail::abstract_snapshot_row_reader& row_reader ) = 0;
          virtual bool empty( ) = 0;
@@ -380,4 +414,93 @@ namespace eosio { namespace chain {
 
    };
 
+   namespace detail {
+      struct sectioned_snapshot_entry {
+         std::string  name;
+         uint64_t     offset    = 0;
+         uint64_t     size      = 0;
+         uint64_t     row_count = 0;
+         fc::sha256   checksum;
+      };
+   }
+
+   /**
+    * Binary snapshot writer that serializes each section into its own buffer on a thread pool and writes the
+    * buffers out as they complete.  Sections are located through an offset table written by finalize().
+    *
+    * Section functions run after write_section returns and until finalize(); they must only read state that is
+    * left untouched until then.
+    */
+   class sectioned_snapshot_writer : public snapshot_writer {
+      public:
+         sectioned_snapshot_writer(std::ostream& snapshot, size_t num_threads, uint64_t rows_per_chunk = default_rows_per_chunk);
+
+         uint64_t rows_per_chunk() const override { return chunk_rows; }
+         void finalize();
+
+         static const uint64_t default_rows_per_chunk = 100000;
+
+      protected:
+         void write_section_impl( const std::string& section_name, section_function f ) override;
+         void write_start_section( const std::string& section_name ) override;
+         void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
+         void write_end_section( ) override;
+
+      private:
+         struct section_buffer {
+            detail::sectioned_snapshot_entry entry;
+            std::string                      data;
+         };
+
+         void write_completed_sections( size_t max_pending );
+
+         detail::ostream_wrapper                        snapshot;
+         std::streampos                                 header_pos;
+         uint64_t                                       chunk_rows;
+         size_t                                         max_pending;
+         std::vector<detail::sectioned_snapshot_entry>  sections;
+         std::deque<std::future<section_buffer>>        pending;
+         named_thread_pool                              thread_pool;
+   };
+
+   /**
+    * Reader for snapshots written by sectioned_snapshot_writer.  Sections following the one being read are loaded
+    * and checksummed ahead of time on a thread pool; rows are then unpacked from memory.
+    */
+   class sectioned_snapshot_reader : public snapshot_reader {
+      public:
+         sectioned_snapshot_reader(std::istream& snapshot, size_t num_threads);
+
+         void validate() const override;
+         bool has_section( const string& section_name ) override;
+         void set_section( const string& section_name ) override;
+         bool read_row( detail::abstract_snapshot_row_reader& row_reader ) override;
+         bool empty ( ) override;
+         void clear_section() override;
+
+         /// true if the stream at its current position holds a sectioned snapshot, the position is left unchanged
+         static bool is_sectioned_snapshot( std::istream& snapshot );
+
+      private:
+         std::vector<char> load_section( size_t index );
+         void prefetch();
+
+         std::istream&                                   snapshot;
+         std::mutex                                      snapshot_mtx;
+         std::streampos                                  header_pos;
+         uint64_t                                        table_pos;
+         std::vector<detail::sectioned_snapshot_entry>   sections;
+         std::map<std::string, size_t>                   section_index;
+         size_t                                          window;
+         size_t                                          next_prefetch;
+         std::map<size_t, std::future<std::vector<char>>> prefetched;
+         std::vector<char>                               cur_data;
+         fc::optional<fc::datastream<const char*>>       cur_stream;
+         uint64_t                                        num_rows;
+         uint64_t                                        cur_row;
+         named_thread_pool                               thread_pool;
+   };
+
 }}
+
+FC_REFLECT( eosio::chain::detail::sectioned_snapshot_entry, (name)(offset)(size)(row_count)(checksum) )
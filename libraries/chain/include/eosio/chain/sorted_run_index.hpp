@@ -0,0 +1,512 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+
+#include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/name.hpp>
+
+#include <fc/log/logger.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <type_traits>
+#include <vector>
+
+namespace eosio { namespace chain {
+
+   /*
+    *   <name>-<id>.run:
+    *   +-------------------+---------+---------+-----+---------+---------+-----+---------+
+    *   | sorted_run_header | Entry 0 | Entry 1 | ... | Entry n | Fence 0 | ... | Fence m |
+    *   +-------------------+---------+---------+-----+---------+---------+-----+---------+
+    *
+    * Entries are written as their raw bytes in the order given by Less. Fence i is a copy of the first entry
+    * of page i, a page being the entries that fit in page_size bytes.
+    */
+   struct sorted_run_header {
+      uint64_t magic = 0;
+      uint32_t version = 1;
+      uint32_t entry_size = 0;
+      uint64_t count = 0;
+      uint64_t covered_position = 0; ///< everything the index was given for positions below this is in runs
+   };
+
+   /**
+    * Ordered on disk index of fixed size entries, written as immutable sorted runs.
+    *
+    * New entries are collected in memory. Once there are memtable_entries of them they are sorted
+    * into a new run file, and whenever fanout runs of about the same size exist they are merged into
+    * one, so the number of runs grows with the log of the index size. The fences of every run are
+    * kept in memory, so finding a key reads one page of each run.
+    *
+    * The index does not know where its entries come from. The owner reports the position in its
+    * source up to which it has inserted entries (set_covered_position); that position is stored
+    * with each run so that after a crash the owner replays its source from covered_position() to
+    * restore the entries that were still in memory.
+    *
+    * Entry must be trivially copyable and Less must order entries by their keys; keys are unique.
+    * Thread safe, lookups may run concurrently with inserts and with flush() on another thread.
+    */
+   template<typename Entry, typename Less>
+   class sorted_run_index {
+      static_assert( std::is_trivially_copyable<Entry>::value, "entries are written as raw bytes" );
+
+   public:
+      static constexpr size_t page_size    = 4096;
+      static constexpr size_t page_entries = sizeof(Entry) < page_size ? page_size / sizeof(Entry) : 1;
+
+      sorted_run_index( boost::filesystem::path dir, std::string name, size_t memtable_entries = 1 << 18, size_t fanout = 8 )
+      : _dir( std::move( dir ) ), _name( std::move( name ) ), _memtable_entries( memtable_entries ), _fanout( fanout ) {
+         EOS_ASSERT( _memtable_entries > 0 && _fanout > 1, plugin_config_exception, "invalid ${name} index configuration", ("name", _name) );
+         open();
+      }
+
+      ~sorted_run_index() = default;
+
+      sorted_run_index( const sorted_run_index& ) = delete;
+      sorted_run_index& operator=( const sorted_run_index& ) = delete;
+
+      /// delete the run files of index name in dir
+      static void remove_files( const boost::filesystem::path& dir, const std::string& name ) {
+         if( !boost::filesystem::exists( dir ) ) return;
+         const std::string prefix = name + "-";
+         std::vector<boost::filesystem::path> files;
+         for( boost::filesystem::directory_iterator itr( dir ), end; itr != end; ++itr ) {
+            const auto file = itr->path().filename().generic_string();
+            const auto ext = itr->path().extension();
+            if( file.compare( 0, prefix.size(), prefix ) == 0 && (ext == ".run" || ext == ".tmp") ) files.push_back( itr->path() );
+         }
+         for( const auto& f : files ) boost::filesystem::remove( f );
+      }
+
+      void insert( const Entry& e ) {
+         std::lock_guard<std::mutex> g( _mtx );
+         _memtable->insert( e );
+      }
+
+      /// all entries for source positions below pos have been inserted
+      void set_covered_position( uint64_t pos ) {
+         std::lock_guard<std::mutex> g( _mtx );
+         _memtable_covered = pos;
+      }
+
+      /// source position to replay from after a restart
+      uint64_t covered_position() const {
+         std::lock_guard<std::mutex> g( _mtx );
+         return _runs_covered;
+      }
+
+      /// source position up to which entries have been inserted
+      uint64_t inserted_position() const {
+         std::lock_guard<std::mutex> g( _mtx );
+         return _memtable_covered;
+      }
+
+      bool memtable_full() const {
+         std::lock_guard<std::mutex> g( _mtx );
+         return _memtable->size() >= _memtable_entries;
+      }
+
+      /// write the memtable to a run once it is full; slow, call it off the main thread
+      void flush_if_full() {
+         if( memtable_full() ) flush();
+      }
+
+      /// write the memtable to a run, then merge runs as needed
+      void flush() {
+         std::shared_ptr<const memtable> frozen;
+         uint64_t covered = 0;
+         {
+            std::lock_guard<std::mutex> g( _mtx );
+            if( _memtable->empty() ) {
+               return;
+            }
+            frozen = _memtable;
+            covered = _memtable_covered;
+            _frozen.push_back( frozen );
+            _memtable = std::make_shared<memtable>();
+         }
+
+         // the frozen memtable stays searchable until its run replaces it
+         auto itr = frozen->begin();
+         auto r = write_run( [&]( Entry& e ) {
+            if( itr == frozen->end() ) return false;
+            e = *itr++;
+            return true;
+         }, frozen->size(), covered );
+         {
+            std::lock_guard<std::mutex> g( _mtx );
+            _frozen.erase( std::find( _frozen.begin(), _frozen.end(), frozen ) );
+            _runs.push_back( r );
+            _runs_covered = std::max( _runs_covered, covered );
+         }
+         merge();
+      }
+
+      /// the greatest entry not after key
+      boost::optional<Entry> last_at_or_below( const Entry& key ) const {
+         std::lock_guard<std::mutex> g( _mtx );
+         boost::optional<Entry> result;
+         auto consider = [&]( const Entry& e ) {
+            if( !result || _less( *result, e ) ) result = e;
+         };
+         for_each_memtable( [&]( const memtable& m ) {
+            auto itr = m.upper_bound( key );
+            if( itr != m.begin() ) consider( *std::prev( itr ) );
+         } );
+         for( const auto& r : _runs ) {
+            Entry e;
+            if( r->last_at_or_below( key, _less, e ) ) consider( e );
+         }
+         return result;
+      }
+
+      /// the least entry not before key
+      boost::optional<Entry> first_at_or_above( const Entry& key ) const {
+         std::lock_guard<std::mutex> g( _mtx );
+         boost::optional<Entry> result;
+         auto consider = [&]( const Entry& e ) {
+            if( !result || _less( e, *result ) ) result = e;
+         };
+         for_each_memtable( [&]( const memtable& m ) {
+            auto itr = m.lower_bound( key );
+            if( itr != m.end() ) consider( *itr );
+         } );
+         for( const auto& r : _runs ) {
+            Entry e;
+            if( r->first_at_or_above( key, _less, e ) ) consider( e );
+         }
+         return result;
+      }
+
+      /// up to max_entries entries from lo to hi inclusive, in order
+      std::vector<Entry> range( const Entry& lo, const Entry& hi, size_t max_entries ) const {
+         std::lock_guard<std::mutex> g( _mtx );
+         std::vector<Entry> result;
+         // every source contributes at most max_entries, the smallest of those are the answer
+         for_each_memtable( [&]( const memtable& m ) {
+            size_t n = 0;
+            for( auto itr = m.lower_bound( lo ); itr != m.end() && !_less( hi, *itr ) && n < max_entries; ++itr, ++n ) {
+               result.push_back( *itr );
+            }
+         } );
+         for( const auto& r : _runs ) {
+            r->range( lo, hi, max_entries, _less, result );
+         }
+         std::sort( result.begin(), result.end(), _less );
+         // an entry may be seen twice while its memtable is being replaced by a run
+         result.erase( std::unique( result.begin(), result.end(), [this]( const Entry& a, const Entry& b ) {
+                          return !_less( a, b ) && !_less( b, a );
+                       } ), result.end() );
+         if( result.size() > max_entries ) result.resize( max_entries );
+         return result;
+      }
+
+      /// entries in memory and in runs
+      uint64_t size() const {
+         std::lock_guard<std::mutex> g( _mtx );
+         uint64_t n = _memtable->size();
+         for( const auto& m : _frozen ) n += m->size();
+         for( const auto& r : _runs ) n += r->count();
+         return n;
+      }
+
+      size_t run_count() const {
+         std::lock_guard<std::mutex> g( _mtx );
+         return _runs.size();
+      }
+
+   private:
+      using memtable = std::set<Entry, Less>;
+
+      static constexpr uint64_t run_magic = N(sortedrun);
+      static constexpr size_t   header_size = sizeof(sorted_run_header);
+
+      static uint64_t fence_count( uint64_t count ) { return (count + page_entries - 1) / page_entries; }
+
+      /// an immutable run file
+      class run {
+      public:
+         run( boost::filesystem::path path, uint64_t id, const sorted_run_header& header, std::vector<Entry> fences )
+         : _path( std::move( path ) ), _id( id ), _header( header ), _fences( std::move( fences ) ) {
+            _stream.exceptions( std::fstream::failbit | std::fstream::badbit );
+            _stream.open( _path.generic_string(), std::ios::in | std::ios::binary );
+            if( _fences.empty() && count() > 0 ) {
+               _fences.resize( fence_count( count() ) );
+               _stream.seekg( header_size + count() * sizeof(Entry) );
+               _stream.read( reinterpret_cast<char*>( _fences.data() ), _fences.size() * sizeof(Entry) );
+            }
+         }
+
+         ~run() {
+            if( _remove ) {
+               _stream.close();
+               boost::system::error_code ec;
+               boost::filesystem::remove( _path, ec );
+            }
+         }
+
+         const boost::filesystem::path& path() const { return _path; }
+         uint64_t id() const { return _id; }
+         uint64_t count() const { return _header.count; }
+         uint64_t covered_position() const { return _header.covered_position; }
+         /// delete the file once the run is no longer used
+         void remove_when_unused() { _remove = true; }
+
+         /// read entries first to first + n, through the stream shared by lookups, so only under the index mutex
+         void read( uint64_t first, uint64_t n, Entry* out ) const {
+            _stream.seekg( header_size + first * sizeof(Entry) );
+            _stream.read( reinterpret_cast<char*>( out ), n * sizeof(Entry) );
+         }
+
+         bool first_at_or_above( const Entry& key, const Less& less, Entry& out ) const {
+            std::vector<Entry> page;
+            // the first page whose fence is not before key starts after the answer, unless the answer is its fence
+            const uint64_t f = std::lower_bound( _fences.begin(), _fences.end(), key, less ) - _fences.begin();
+            if( f > 0 ) {
+               read_page( f - 1, page );
+               auto itr = std::lower_bound( page.begin(), page.end(), key, less );
+               if( itr != page.end() ) {
+                  out = *itr;
+                  return true;
+               }
+            }
+            if( f == _fences.size() ) return false;
+            out = _fences[f];
+            return true;
+         }
+
+         bool last_at_or_below( const Entry& key, const Less& less, Entry& out ) const {
+            std::vector<Entry> page;
+            const uint64_t f = std::upper_bound( _fences.begin(), _fences.end(), key, less ) - _fences.begin();
+            if( f == 0 ) return false;
+            read_page( f - 1, page );
+            out = *std::prev( std::upper_bound( page.begin(), page.end(), key, less ) );
+            return true;
+         }
+
+         void range( const Entry& lo, const Entry& hi, size_t max_entries, const Less& less, std::vector<Entry>& out ) const {
+            std::vector<Entry> page;
+            uint64_t f = std::lower_bound( _fences.begin(), _fences.end(), lo, less ) - _fences.begin();
+            if( f > 0 ) --f;
+            for( size_t n = 0; f < _fences.size() && n < max_entries && !less( hi, _fences[f] ); ++f ) {
+               read_page( f, page );
+               for( auto itr = std::lower_bound( page.begin(), page.end(), lo, less );
+                    itr != page.end() && n < max_entries && !less( hi, *itr ); ++itr, ++n ) {
+                  out.push_back( *itr );
+               }
+            }
+         }
+
+      private:
+         void read_page( uint64_t p, std::vector<Entry>& page ) const {
+            const uint64_t first = p * page_entries;
+            page.resize( std::min<uint64_t>( page_entries, count() - first ) );
+            read( first, page.size(), page.data() );
+         }
+
+         boost::filesystem::path _path;
+         uint64_t                _id = 0;
+         sorted_run_header       _header;
+         std::vector<Entry>      _fences;
+         mutable std::fstream    _stream;
+         bool                    _remove = false;
+      };
+      using run_ptr = std::shared_ptr<run>;
+
+      /// reads a run sequentially in large chunks through its own stream, so merges need no lock
+      class run_cursor {
+      public:
+         explicit run_cursor( run_ptr r ) : _run( std::move( r ) ) {
+            _stream.exceptions( std::fstream::failbit | std::fstream::badbit );
+            _stream.open( _run->path().generic_string(), std::ios::in | std::ios::binary );
+            _stream.seekg( header_size );
+            fill();
+         }
+
+         bool valid() const { return _pos < _buffer.size(); }
+         const Entry& get() const { return _buffer[_pos]; }
+         void next() {
+            if( ++_pos == _buffer.size() ) fill();
+         }
+
+      private:
+         void fill() {
+            const uint64_t n = std::min<uint64_t>( page_entries * 64, _run->count() - _next );
+            _buffer.resize( n );
+            if( n > 0 ) _stream.read( reinterpret_cast<char*>( _buffer.data() ), n * sizeof(Entry) );
+            _next += n;
+            _pos = 0;
+         }
+
+         run_ptr            _run;
+         std::ifstream      _stream;
+         std::vector<Entry> _buffer;
+         size_t             _pos = 0;
+         uint64_t           _next = 0;
+      };
+
+      boost::filesystem::path run_path( uint64_t id ) const {
+         return _dir / (_name + "-" + std::to_string( id ) + ".run");
+      }
+
+      template<typename F>
+      void for_each_memtable( F&& f ) const {
+         f( *_memtable );
+         for( const auto& m : _frozen ) f( *m );
+      }
+
+      void open() {
+         boost::filesystem::create_directories( _dir );
+         const std::string prefix = _name + "-";
+         for( boost::filesystem::directory_iterator itr( _dir ), end; itr != end; ++itr ) {
+            const auto file = itr->path().filename().generic_string();
+            if( file.compare( 0, prefix.size(), prefix ) != 0 ) continue;
+            if( itr->path().extension() == ".tmp" ) {
+               boost::filesystem::remove( itr->path() ); // interrupted write or merge
+               continue;
+            }
+            if( itr->path().extension() != ".run" ) continue;
+            uint64_t id = 0;
+            try {
+               id = std::stoull( file.substr( prefix.size() ) );
+            } catch( ... ) {
+               continue;
+            }
+            sorted_run_header header;
+            {
+               std::ifstream in( itr->path().generic_string(), std::ios::in | std::ios::binary );
+               in.read( reinterpret_cast<char*>( &header ), sizeof(header) );
+               EOS_ASSERT( in && header.magic == run_magic && header.entry_size == sizeof(Entry) &&
+                           boost::filesystem::file_size( itr->path() ) == header_size + (header.count + fence_count( header.count )) * sizeof(Entry),
+                           plugin_exception, "corrupt ${f}", ("f", itr->path().generic_string()) );
+            }
+            _runs.push_back( std::make_shared<run>( itr->path(), id, header, std::vector<Entry>() ) );
+            _next_run_id = std::max( _next_run_id, id + 1 );
+            _runs_covered = std::max( _runs_covered, header.covered_position );
+         }
+         std::sort( _runs.begin(), _runs.end(), []( const run_ptr& a, const run_ptr& b ) { return a->id() < b->id(); } );
+         _memtable = std::make_shared<memtable>();
+         _memtable_covered = _runs_covered;
+      }
+
+      /// write count entries produced in order by next to a new run file; the file only gets its final name once complete
+      run_ptr write_run( const std::function<bool(Entry&)>& next, uint64_t count, uint64_t covered ) {
+         uint64_t id = 0;
+         {
+            std::lock_guard<std::mutex> g( _mtx );
+            id = _next_run_id++;
+         }
+         const auto path = run_path( id );
+         auto tmp = path;
+         tmp += ".tmp";
+
+         sorted_run_header header;
+         header.magic = run_magic;
+         header.entry_size = sizeof(Entry);
+         header.count = count;
+         header.covered_position = covered;
+         std::vector<Entry> fences;
+         fences.reserve( fence_count( count ) );
+         {
+            std::ofstream out;
+            out.exceptions( std::fstream::failbit | std::fstream::badbit );
+            out.open( tmp.generic_string(), std::ios::out | std::ios::binary | std::ios::trunc );
+            out.write( reinterpret_cast<const char*>( &header ), sizeof(header) );
+            Entry e;
+            for( uint64_t i = 0; i < count; ++i ) {
+               EOS_ASSERT( next( e ), plugin_exception, "${name} index run shorter than expected", ("name", _name) );
+               if( i % page_entries == 0 ) fences.push_back( e );
+               out.write( reinterpret_cast<const char*>( &e ), sizeof(Entry) );
+            }
+            out.write( reinterpret_cast<const char*>( fences.data() ), fences.size() * sizeof(Entry) );
+            out.flush();
+         }
+         boost::filesystem::rename( tmp, path );
+         return std::make_shared<run>( path, id, header, std::move( fences ) );
+      }
+
+      /// size tier of a run, runs of the same tier are merged once there are fanout of them
+      size_t tier( uint64_t count ) const {
+         size_t t = 0;
+         for( uint64_t n = count / _memtable_entries; n >= _fanout; n /= _fanout ) ++t;
+         return t;
+      }
+
+      void merge() {
+         while( true ) {
+            std::vector<run_ptr> inputs;
+            {
+               std::lock_guard<std::mutex> g( _mtx );
+               std::map<size_t, std::vector<run_ptr>> tiers;
+               for( const auto& r : _runs ) tiers[tier( r->count() )].push_back( r );
+               for( auto& t : tiers ) {
+                  if( t.second.size() >= _fanout ) {
+                     inputs = std::move( t.second );
+                     break;
+                  }
+               }
+            }
+            if( inputs.empty() ) return;
+
+            // the inputs stay in _runs while they are merged: lookups read them through each run's stream
+            // under _mtx, the cursors through streams of their own without it
+            std::vector<run_cursor> cursors;
+            cursors.reserve( inputs.size() );
+            uint64_t count = 0, covered = 0;
+            for( const auto& r : inputs ) {
+               cursors.emplace_back( r );
+               count += r->count();
+               covered = std::max( covered, r->covered_position() );
+            }
+            auto greater = [this, &cursors]( size_t a, size_t b ) { return _less( cursors[b].get(), cursors[a].get() ); };
+            std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heads( greater );
+            for( size_t i = 0; i < cursors.size(); ++i ) {
+               if( cursors[i].valid() ) heads.push( i );
+            }
+            auto out = write_run( [&]( Entry& e ) {
+               if( heads.empty() ) return false;
+               const size_t i = heads.top();
+               heads.pop();
+               e = cursors[i].get();
+               cursors[i].next();
+               if( cursors[i].valid() ) heads.push( i );
+               return true;
+            }, count, covered );
+
+            std::lock_guard<std::mutex> g( _mtx );
+            for( const auto& r : inputs ) {
+               r->remove_when_unused();
+               _runs.erase( std::find( _runs.begin(), _runs.end(), r ) );
+            }
+            _runs.push_back( out );
+            ilog( "merged ${n} ${name} index runs into one of ${c} entries", ("n", inputs.size())("name", _name)("c", out->count()) );
+         }
+      }
+
+      const boost::filesystem::path       _dir;
+      const std::string                   _name;
+      const size_t                        _memtable_entries;
+      const size_t                        _fanout;
+      Less                                _less;
+      mutable std::mutex                  _mtx;
+      std::shared_ptr<memtable>           _memtable;
+      uint64_t                            _memtable_covered = 0;
+      std::vector<std::shared_ptr<const memtable>> _frozen; ///< being written to runs
+      std::vector<run_ptr>                _runs;
+      uint64_t                            _runs_covered = 0;
+      uint64_t                            _next_run_id = 0;
+   };
+
+} } // namespace eosio::chain
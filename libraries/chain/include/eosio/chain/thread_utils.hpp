@@ -8,8 +8,11 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <boost/asio/post.hpp>
+#include <condition_variable>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace eosio { namespace chain {
 
@@ -48,6 +51,63 @@ namespace eosio { namespace chain {
       return task->get_future();
    }
 
+   /**
+    * Reader/writer mutex for use with std::shared_lock and std::unique_lock.
+    *
+    * A waiting writer keeps new readers out, so a steady stream of readers cannot starve it.
+    * The exclusive lock may be taken again by the thread holding it, the shared lock may not be
+    * taken by a thread holding either lock.
+    */
+   class writer_priority_shared_mutex {
+   public:
+      void lock() {
+         std::unique_lock<std::mutex> g( _mtx );
+         if( _writer_depth > 0 && _writer == std::this_thread::get_id() ) {
+            ++_writer_depth;
+            return;
+         }
+         ++_writers_waiting;
+         _writer_cv.wait( g, [this]() { return _writer_depth == 0 && _readers == 0; } );
+         --_writers_waiting;
+         _writer = std::this_thread::get_id();
+         _writer_depth = 1;
+      }
+
+      void unlock() {
+         {
+            std::lock_guard<std::mutex> g( _mtx );
+            if( --_writer_depth > 0 ) return;
+            _writer = std::thread::id();
+         }
+         _writer_cv.notify_one();
+         _reader_cv.notify_all();
+      }
+
+      void lock_shared() {
+         std::unique_lock<std::mutex> g( _mtx );
+         _reader_cv.wait( g, [this]() { return _writer_depth == 0 && _writers_waiting == 0; } );
+         ++_readers;
+      }
+
+      void unlock_shared() {
+         bool notify = false;
+         {
+            std::lock_guard<std::mutex> g( _mtx );
+            notify = --_readers == 0 && _writers_waiting > 0;
+         }
+         if( notify ) _writer_cv.notify_one();
+      }
+
+   private:
+      std::mutex              _mtx;
+      std::condition_variable _reader_cv;
+      std::condition_variable _writer_cv;
+      uint32_t                _readers = 0;
+      uint32_t                _writers_waiting = 0;
+      uint32_t                _writer_depth = 0;
+      std::thread::id         _writer;
+   };
+
 } } // eosio::chain
 
 
@@ -0,0 +1,72 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/block.hpp>
+#include <eosio/chain/sorted_run_index.hpp>
+#include <eosio/chain/thread_utils.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <atomic>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Index from transaction id to the number of the block containing it, kept as trx-index-<n>.run files next to
+    * blocks.log and maintained as blocks become irreversible.
+    *
+    * Only the first 8 bytes of an id are indexed, so a lookup returns candidate blocks which the caller checks by
+    * reading them. Entries are 16 bytes, a page holds 256 of them, and finding an id reads one page of each run.
+    * Runs are written and merged on a thread of the index; a restart re-adds the blocks from next_block_num() on.
+    */
+   class trx_block_index {
+      public:
+         static constexpr const char* file_name = "trx-index";
+
+         explicit trx_block_index( const fc::path& blocks_dir );
+         ~trx_block_index();
+
+         trx_block_index( const trx_block_index& ) = delete;
+         trx_block_index& operator=( const trx_block_index& ) = delete;
+
+         /// blocks must be added in order, a block below next_block_num() is ignored
+         void add_block( const signed_block& b );
+
+         /// the block after the last one added
+         uint32_t next_block_num()const;
+
+         /**
+          * Blocks which may contain a transaction whose id starts with the first prefix_size bytes of id, in
+          * ascending order, at most max_blocks of them.
+          */
+         vector<uint32_t> find( const transaction_id_type& id, size_t prefix_size = 32, size_t max_blocks = 16 )const;
+
+         /// write everything added so far to disk and stop the index thread
+         void close();
+
+         /// delete the index files in blocks_dir
+         static void remove( const fc::path& blocks_dir );
+
+      private:
+         struct entry {
+            uint64_t id_prefix = 0; ///< first 8 bytes of the id, big-endian so entries sort like ids
+            uint32_t block_num = 0;
+            uint32_t pad = 0;
+         };
+         struct entry_less {
+            bool operator()( const entry& a, const entry& b )const {
+               return std::tie( a.id_prefix, a.block_num ) < std::tie( b.id_prefix, b.block_num );
+            }
+         };
+         using index_type = sorted_run_index<entry, entry_less>;
+
+         static uint64_t id_prefix( const transaction_id_type& id );
+
+         index_type                      index;
+         fc::optional<named_thread_pool> thread_pool;
+         std::atomic<bool>               flushing{false};
+   };
+
+} } /// eosio::chain
@@ -0,0 +1,293 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/chain/log_catalog.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <fc/log/logger.hpp>
+#include <regex>
+
+namespace eosio { namespace chain {
+
+   namespace {
+      // rename() fails across file systems, which is the common case for cold storage
+      void move_file( const fc::path& from, const fc::path& to ) {
+         try {
+            fc::rename( from, to );
+         } catch( const fc::exception& ) {
+            fc::copy( from, to );
+            fc::remove( from );
+         }
+      }
+
+      /// copies from to a temporary file next to to and renames that, so that to is never partially written
+      void copy_file( const fc::path& from, const fc::path& to ) {
+         fc::path tmp = to;
+         tmp += ".tmp";
+         fc::remove_all( tmp );
+         fc::copy( from, tmp );
+         fc::rename( tmp, to );
+      }
+   }
+
+   log_catalog::~log_catalog() {
+      wait();
+   }
+
+   void log_catalog::open( const fc::path& log_dir, const log_split_config& cfg, const std::string& name ) {
+      wait();
+      this->name = name;
+      this->log_dir = log_dir;
+      max_retained_files = cfg.max_retained_files;
+      clear();
+
+      retained_dir = cfg.retained_dir.is_relative() ? log_dir / cfg.retained_dir : cfg.retained_dir;
+      if( cfg.archive_dir != fc::path() )
+         archive_dir = cfg.archive_dir.is_relative() ? log_dir / cfg.archive_dir : cfg.archive_dir;
+      else
+         archive_dir = fc::path();
+
+      if( !fc::is_directory(retained_dir) )
+         fc::create_directories(retained_dir);
+      if( archive_dir != fc::path() && !fc::is_directory(archive_dir) )
+         fc::create_directories(archive_dir);
+      if( !mover )
+         mover.emplace( "logcat", 1 );
+
+      const std::regex pattern( name + "-([0-9]+)-([0-9]+)\\.log" );
+      std::map<uint32_t, segment> found;
+      std::vector<segment> staged; ///< renamed into the log directory, but not moved to the retained directory yet
+      auto scan = [&]( const fc::path& dir, bool in_log_dir ) {
+         for( fc::directory_iterator itr(dir), end; itr != end; ++itr ) {
+            auto        file     = *itr;
+            std::string filename = file.filename().generic_string();
+            std::smatch m;
+            if( !std::regex_match( filename, m, pattern ) )
+               continue;
+            segment s;
+            s.first_block_num = std::stoul( m[1].str() );
+            s.last_block_num  = std::stoul( m[2].str() );
+            s.log_file        = file;
+            s.index_file      = segment_file( dir, s.first_block_num, s.last_block_num, "index" );
+            if( s.first_block_num > s.last_block_num || !fc::exists( s.index_file ) ) {
+               wlog( "ignoring retained ${name} segment ${f} without a usable index", ("name", name)("f", filename) );
+               continue;
+            }
+            auto dict_file = segment_file( dir, s.first_block_num, s.last_block_num, "dict" );
+            if( fc::exists( dict_file ) )
+               s.dict_file = dict_file;
+            if( in_log_dir ) {
+               // a move interrupted after the copy is complete leaves the segment in both places
+               if( found.count( s.first_block_num ) ) {
+                  for( const auto& f : segment_files( s ) )
+                     fc::remove( f );
+                  continue;
+               }
+               staged.push_back( s );
+            }
+            found[s.first_block_num] = std::move(s);
+         }
+      };
+      separate_retained_dir = fc::canonical( retained_dir ) != fc::canonical( log_dir );
+      scan( retained_dir, false );
+      if( separate_retained_dir )
+         scan( log_dir, true );
+
+      std::unique_lock<std::mutex> g( _mtx );
+      // only the newest contiguous run of segments is usable
+      for( auto itr = found.rbegin(); itr != found.rend(); ++itr ) {
+         if( !segments.empty() && itr->second.last_block_num + 1 != segments.begin()->second.first_block_num ) {
+            wlog( "ignoring ${name} segments before block ${n} since block ${g} is missing",
+                  ("name", name)("n", segments.begin()->second.first_block_num)("g", itr->second.last_block_num + 1) );
+            break;
+         }
+         segments.insert( *itr );
+      }
+
+      if( !segments.empty() )
+         ilog( "${name} has ${c} retained segments covering blocks ${b}-${e}",
+               ("name", name)("c", segments.size())("b", segments.begin()->second.first_block_num)
+               ("e", segments.rbegin()->second.last_block_num) );
+      g.unlock();
+
+      for( const auto& s : staged )
+         schedule_retain( s );
+   }
+
+   bool log_catalog::empty()const {
+      std::lock_guard<std::mutex> g( _mtx );
+      return segments.empty();
+   }
+
+   size_t log_catalog::size()const {
+      std::lock_guard<std::mutex> g( _mtx );
+      return segments.size();
+   }
+
+   uint32_t log_catalog::first_block_num()const {
+      std::lock_guard<std::mutex> g( _mtx );
+      EOS_ASSERT( !segments.empty(), block_log_exception, "no retained ${name} segments", ("name", name) );
+      return segments.begin()->second.first_block_num;
+   }
+
+   uint32_t log_catalog::last_block_num()const {
+      return back().last_block_num;
+   }
+
+   log_catalog::segment log_catalog::back()const {
+      std::lock_guard<std::mutex> g( _mtx );
+      EOS_ASSERT( !segments.empty(), block_log_exception, "no retained ${name} segments", ("name", name) );
+      return segments.rbegin()->second;
+   }
+
+   fc::optional<log_catalog::segment> log_catalog::find( uint32_t block_num )const {
+      std::lock_guard<std::mutex> g( _mtx );
+      auto itr = segments.upper_bound( block_num );
+      if( itr == segments.begin() )
+         return {};
+      --itr;
+      if( block_num > itr->second.last_block_num )
+         return {};
+      return itr->second;
+   }
+
+   void log_catalog::clear() {
+      std::lock_guard<std::mutex> g( _mtx );
+      segments.clear();
+   }
+
+   void log_catalog::wait() {
+      if( mover )
+         async_thread_pool( mover->get_executor(), []() {} ).wait();
+   }
+
+   fc::path log_catalog::segment_file( const fc::path& dir, uint32_t first_block_num, uint32_t last_block_num, const char* ext )const {
+      return dir / ( name + "-" + std::to_string(first_block_num) + "-" + std::to_string(last_block_num) + "." + ext );
+   }
+
+   void log_catalog::add( uint32_t first_block_num, uint32_t last_block_num, const fc::path& log_file, const fc::path& index_file,
+                          const fc::path& dict_file ) {
+      segment s;
+      s.first_block_num = first_block_num;
+      s.last_block_num  = last_block_num;
+      s.log_file        = segment_file( log_dir, first_block_num, last_block_num, "log" );
+      s.index_file      = segment_file( log_dir, first_block_num, last_block_num, "index" );
+      if( dict_file != fc::path() )
+         s.dict_file    = segment_file( log_dir, first_block_num, last_block_num, "dict" );
+
+      std::unique_lock<std::mutex> g( _mtx );
+      EOS_ASSERT( segments.empty() || segments.rbegin()->second.last_block_num + 1 == first_block_num, block_log_exception,
+                  "${name} segment starting at block ${n} does not follow the retained segments", ("name", name)("n", first_block_num) );
+      // within the log directory, so this is never a copy
+      fc::rename( log_file, s.log_file );
+      fc::rename( index_file, s.index_file );
+      if( dict_file != fc::path() )
+         fc::rename( dict_file, s.dict_file );
+      segments[first_block_num] = s;
+      g.unlock();
+
+      if( separate_retained_dir )
+         schedule_retain( s );
+
+      g.lock();
+      schedule_prune();
+   }
+
+   std::vector<fc::path> log_catalog::segment_files( const segment& s ) {
+      // the log last, since open() only finds a segment by its log
+      std::vector<fc::path> files{ s.index_file };
+      if( s.dict_file != fc::path() )
+         files.push_back( s.dict_file );
+      files.push_back( s.log_file );
+      return files;
+   }
+
+   void log_catalog::schedule_retain( const segment& s ) {
+      boost::asio::post( mover->get_executor(), [this, s]() {
+         try {
+            segment retained = s;
+            retained.log_file   = segment_file( retained_dir, s.first_block_num, s.last_block_num, "log" );
+            retained.index_file = segment_file( retained_dir, s.first_block_num, s.last_block_num, "index" );
+            if( s.dict_file != fc::path() )
+               retained.dict_file = segment_file( retained_dir, s.first_block_num, s.last_block_num, "dict" );
+            const auto from = segment_files( s );
+            const auto to   = segment_files( retained );
+            auto is_staged = [&]() {
+               auto itr = segments.find( s.first_block_num );
+               return itr != segments.end() && itr->second.log_file == s.log_file;
+            };
+
+            {
+               // a rename keeps readers of the segment working only if the paths change with it
+               std::lock_guard<std::mutex> g( _mtx );
+               if( !is_staged() ) return;
+               size_t i = 0;
+               try {
+                  for( ; i < from.size(); ++i )
+                     fc::rename( from[i], to[i] );
+                  segments[s.first_block_num] = retained;
+                  return;
+               } catch( const fc::exception& ) {
+                  // another file system
+                  while( i-- > 0 )
+                     fc::rename( to[i], from[i] );
+               }
+            }
+
+            for( size_t i = 0; i < from.size(); ++i )
+               copy_file( from[i], to[i] );
+            {
+               std::lock_guard<std::mutex> g( _mtx );
+               if( is_staged() ) segments[s.first_block_num] = retained;
+            }
+            // a reader which opened the files before keeps reading them
+            for( const auto& f : from )
+               fc::remove( f );
+            ilog( "moved ${f} to ${d}", ("f", retained.log_file.filename().generic_string())("d", retained_dir.generic_string()) );
+         } FC_LOG_AND_DROP()
+      } );
+   }
+
+   void log_catalog::schedule_prune() {
+      while( segments.size() > max_retained_files ) {
+         const auto oldest = segments.begin()->second;
+         segments.erase( segments.begin() );
+
+         boost::asio::post( mover->get_executor(), [this, oldest]() {
+            try {
+               // the segment is in the retained directory unless it was still to be moved there
+               bool in_retained_dir = fc::exists( segment_file( retained_dir, oldest.first_block_num, oldest.last_block_num, "log" ) );
+               auto files = segment_files( oldest );
+               for( auto& f : files )
+                  f = ( in_retained_dir ? retained_dir : log_dir ) / f.filename();
+               for( const auto& f : files ) {
+                  if( archive_dir != fc::path() )
+                     move_file( f, archive_dir / f.filename() );
+                  else
+                     fc::remove( f );
+               }
+               if( archive_dir != fc::path() )
+                  ilog( "archived ${f} to ${d}", ("f", files.back().filename().generic_string())("d", archive_dir.generic_string()) );
+               else
+                  ilog( "removed ${f}", ("f", files.back().filename().generic_string()) );
+            } FC_LOG_AND_DROP()
+         } );
+      }
+   }
+
+   void log_catalog::pop_back( const fc::path& log_file, const fc::path& index_file ) {
+      wait();
+      auto s = back();
+      {
+         std::lock_guard<std::mutex> g( _mtx );
+         segments.erase( s.first_block_num );
+      }
+      fc::remove_all( log_file );
+      fc::remove_all( index_file );
+      move_file( s.log_file, log_file );
+      move_file( s.index_file, index_file );
+      if( s.dict_file != fc::path() )
+         fc::remove( s.dict_file );
+   }
+
+} } /// eosio::chain
@@ -1,6 +1,7 @@
 #include <eosio/chain/snapshot.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <fc/scoped_exit.hpp>
+#include <sstream>
 
 namespace eosio { namespace chain {
 
@@ -358,4 +359,254 @@ void integrity_hash_snapshot_writer::finalize() {
    // no-op for structural details
 }
 
-}}
\ No newline at end of file
+namespace {
+   /**
+    * Collects the rows of a single section of a sectioned snapshot into a buffer
+    */
+   class buffered_section_writer : public snapshot_writer {
+      public:
+         explicit buffered_section_writer(std::ostream& out)
+         :out(out)
+         {
+         }
+
+         uint64_t row_count = 0;
+
+      protected:
+         void write_start_section( const std::string& ) override {}
+
+         void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override {
+            row_writer.write(out);
+            row_count++;
+         }
+
+         void write_end_section( ) override {}
+
+      private:
+         detail::ostream_wrapper out;
+   };
+
+   // magic number, version and position of the offset table
+   const uint64_t sectioned_header_size = sizeof(ostream_snapshot_writer::magic_number) + sizeof(sectioned_snapshot_version) + sizeof(uint64_t);
+}
+
+sectioned_snapshot_writer::sectioned_snapshot_writer(std::ostream& snapshot, size_t num_threads, uint64_t rows_per_chunk)
+:snapshot(snapshot)
+,header_pos(snapshot.tellp())
+,chunk_rows(rows_per_chunk)
+,max_pending(std::max<size_t>(num_threads, 1) * 2)
+,thread_pool("snapw", std::max<size_t>(num_threads, 1))
+{
+   // write magic number
+   auto totem = ostream_snapshot_writer::magic_number;
+   snapshot.write((char*)&totem, sizeof(totem));
+
+   // write version
+   auto version = sectioned_snapshot_version;
+   snapshot.write((char*)&version, sizeof(version));
+
+   // write a placeholder for the offset table position
+   uint64_t placeholder = std::numeric_limits<uint64_t>::max();
+   snapshot.write((char*)&placeholder, sizeof(placeholder));
+}
+
+void sectioned_snapshot_writer::write_section_impl( const std::string& section_name, section_function f ) {
+   pending.emplace_back(async_thread_pool(thread_pool.get_executor(), [section_name, f{std::move(f)}]() mutable {
+      std::ostringstream out;
+      buffered_section_writer writer(out);
+      f(writer);
+
+      section_buffer result;
+      result.data = out.str();
+      result.entry.name = section_name;
+      result.entry.size = result.data.size();
+      result.entry.row_count = writer.row_count;
+      result.entry.checksum = fc::sha256::hash(result.data.data(), result.data.size());
+      return result;
+   }));
+
+   // bound the number of serialized sections held in memory
+   write_completed_sections(max_pending);
+}
+
+void sectioned_snapshot_writer::write_completed_sections( size_t max_pending ) {
+   while (!pending.empty()) {
+      auto& next = pending.front();
+      if (pending.size() <= max_pending && next.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+         break;
+      }
+
+      auto buffer = next.get();
+      pending.pop_front();
+
+      buffer.entry.offset = snapshot.tellp() - header_pos;
+      snapshot.write(buffer.data.data(), buffer.data.size());
+      sections.emplace_back(std::move(buffer.entry));
+   }
+}
+
+void sectioned_snapshot_writer::write_start_section( const std::string& ) {
+   EOS_THROW(snapshot_exception, "Sectioned snapshot rows must be written through write_section");
+}
+
+void sectioned_snapshot_writer::write_row( const detail::abstract_snapshot_row_writer& ) {
+   EOS_THROW(snapshot_exception, "Sectioned snapshot rows must be written through write_section");
+}
+
+void sectioned_snapshot_writer::write_end_section( ) {
+   EOS_THROW(snapshot_exception, "Sectioned snapshot rows must be written through write_section");
+}
+
+void sectioned_snapshot_writer::finalize() {
+   write_completed_sections(0);
+
+   // write the offset table
+   uint64_t table_pos = snapshot.tellp() - header_pos;
+   auto table = fc::raw::pack(sections);
+   snapshot.write(table.data(), table.size());
+
+   auto restore = snapshot.tellp();
+   snapshot.seekp(header_pos + std::streamoff(sizeof(ostream_snapshot_writer::magic_number) + sizeof(sectioned_snapshot_version)));
+   snapshot.write((char*)&table_pos, sizeof(table_pos));
+   snapshot.seekp(restore);
+}
+
+sectioned_snapshot_reader::sectioned_snapshot_reader(std::istream& snapshot, size_t num_threads)
+:snapshot(snapshot)
+,header_pos(snapshot.tellg())
+,table_pos(0)
+,window(std::max<size_t>(num_threads, 1) * 2)
+,next_prefetch(0)
+,num_rows(0)
+,cur_row(0)
+,thread_pool("snapr", std::max<size_t>(num_threads, 1))
+{
+   auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg(),ex=snapshot.exceptions()](){
+      this->snapshot.seekg(pos);
+      this->snapshot.exceptions(ex);
+   });
+
+   snapshot.exceptions(std::istream::failbit|std::istream::eofbit);
+
+   try {
+      EOS_ASSERT(is_sectioned_snapshot(snapshot), snapshot_exception,
+                 "Binary snapshot is not a sectioned snapshot of version ${v}", ("v", sectioned_snapshot_version));
+
+      snapshot.seekg(header_pos + std::streamoff(sizeof(ostream_snapshot_writer::magic_number) + sizeof(sectioned_snapshot_version)));
+      snapshot.read((char*)&table_pos, sizeof(table_pos));
+      EOS_ASSERT(table_pos != std::numeric_limits<uint64_t>::max(), snapshot_exception,
+                 "Sectioned snapshot was not finalized");
+
+      snapshot.seekg(0, std::ios::end);
+      uint64_t end_pos = snapshot.tellg() - header_pos;
+      EOS_ASSERT(table_pos >= sectioned_header_size && table_pos <= end_pos, snapshot_exception,
+                 "Sectioned snapshot offset table is out of range");
+
+      std::vector<char> table(end_pos - table_pos);
+      snapshot.seekg(header_pos + std::streamoff(table_pos));
+      snapshot.read(table.data(), table.size());
+      sections = fc::raw::unpack<std::vector<detail::sectioned_snapshot_entry>>(table);
+   } catch( const fc::exception& ) {
+      throw;
+   } catch( const std::exception& e ) {
+      snapshot_exception fce(FC_LOG_MESSAGE( warn, "Sectioned snapshot threw IO exception (${what})",("what",e.what())));
+      throw fce;
+   }
+
+   for (size_t i = 0; i < sections.size(); ++i) {
+      section_index.emplace(sections[i].name, i);
+   }
+}
+
+bool sectioned_snapshot_reader::is_sectioned_snapshot( std::istream& snapshot ) {
+   auto restore_pos = fc::make_scoped_exit([&snapshot,pos=snapshot.tellg()](){
+      snapshot.clear();
+      snapshot.seekg(pos);
+   });
+
+   auto totem = ostream_snapshot_writer::magic_number;
+   auto version = sectioned_snapshot_version;
+   snapshot.read((char*)&totem, sizeof(totem));
+   snapshot.read((char*)&version, sizeof(version));
+   return snapshot && totem == ostream_snapshot_writer::magic_number && version == sectioned_snapshot_version;
+}
+
+void sectioned_snapshot_reader::validate() const {
+   EOS_ASSERT(section_index.size() == sections.size(), snapshot_exception,
+              "Sectioned snapshot has duplicate section names");
+
+   for (const auto& s : sections) {
+      EOS_ASSERT(s.offset >= sectioned_header_size && s.size <= table_pos && s.offset <= table_pos - s.size, snapshot_exception,
+                 "Sectioned snapshot section ${n} is out of range", ("n", s.name));
+   }
+}
+
+bool sectioned_snapshot_reader::has_section( const string& section_name ) {
+   return section_index.count(section_name) > 0;
+}
+
+std::vector<char> sectioned_snapshot_reader::load_section( size_t index ) {
+   const auto& entry = sections.at(index);
+   std::vector<char> data(entry.size);
+   {
+      std::lock_guard<std::mutex> g(snapshot_mtx);
+      snapshot.clear();
+      snapshot.seekg(header_pos + std::streamoff(entry.offset));
+      snapshot.read(data.data(), data.size());
+      EOS_ASSERT(snapshot.good(), snapshot_exception, "Unable to read snapshot section ${n}", ("n", entry.name));
+   }
+
+   EOS_ASSERT(fc::sha256::hash(data.data(), data.size()) == entry.checksum, snapshot_exception,
+              "Sectioned snapshot section ${n} does not match its checksum", ("n", entry.name));
+   return data;
+}
+
+void sectioned_snapshot_reader::prefetch() {
+   while (prefetched.size() < window && next_prefetch < sections.size()) {
+      auto index = next_prefetch++;
+      prefetched.emplace(index, async_thread_pool(thread_pool.get_executor(), [this, index]() {
+         return load_section(index);
+      }));
+   }
+}
+
+void sectioned_snapshot_reader::set_section( const string& section_name ) {
+   auto itr = section_index.find(section_name);
+   EOS_ASSERT(itr != section_index.end(), snapshot_exception, "Binary snapshot has no section named ${n}", ("n", section_name));
+   auto index = itr->second;
+
+   // sections that were skipped over are no longer worth holding
+   prefetched.erase(prefetched.begin(), prefetched.lower_bound(index));
+
+   auto pf = prefetched.find(index);
+   if (pf != prefetched.end()) {
+      cur_data = pf->second.get();
+      prefetched.erase(pf);
+   } else {
+      cur_data = load_section(index);
+      next_prefetch = std::max(next_prefetch, index + 1);
+   }
+   prefetch();
+
+   cur_stream.emplace(cur_data.data(), cur_data.size());
+   num_rows = sections[index].row_count;
+   cur_row = 0;
+}
+
+bool sectioned_snapshot_reader::read_row( detail::abstract_snapshot_row_reader& row_reader ) {
+   row_reader.provide(*cur_stream);
+   return ++cur_row < num_rows;
+}
+
+bool sectioned_snapshot_reader::empty ( ) {
+   return num_rows == 0;
+}
+
+void sectioned_snapshot_reader::clear_section() {
+   cur_stream.reset();
+   cur_data.clear();
+   num_rows = 0;
+   cur_row = 0;
+}
+
+}}
@@ -0,0 +1,81 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/chain/trx_block_index.hpp>
+
+namespace eosio { namespace chain {
+
+   trx_block_index::trx_block_index( const fc::path& blocks_dir )
+   :index( blocks_dir, file_name )
+   {
+      thread_pool.emplace( "trxidx", 1 );
+   }
+
+   trx_block_index::~trx_block_index() {
+      try {
+         close();
+      } FC_LOG_AND_DROP()
+   }
+
+   uint64_t trx_block_index::id_prefix( const transaction_id_type& id ) {
+      uint64_t prefix = 0;
+      const auto* bytes = reinterpret_cast<const unsigned char*>( id.data() );
+      for( size_t i = 0; i < sizeof(prefix); ++i )
+         prefix = (prefix << 8) | bytes[i];
+      return prefix;
+   }
+
+   void trx_block_index::add_block( const signed_block& b ) {
+      const uint32_t block_num = b.block_num();
+      if( block_num < next_block_num() )
+         return;
+      for( const auto& receipt : b.transactions ) {
+         const auto& id = receipt.trx.contains<transaction_id_type>() ? receipt.trx.get<transaction_id_type>()
+                                                                      : receipt.trx.get<packed_transaction>().id();
+         index.insert( entry{ id_prefix( id ), block_num, 0 } );
+      }
+      index.set_covered_position( block_num + 1 );
+
+      if( thread_pool && index.memtable_full() && !flushing.exchange( true ) ) {
+         boost::asio::post( thread_pool->get_executor(), [this]() {
+            try {
+               index.flush();
+            } FC_LOG_AND_DROP()
+            flushing = false;
+         } );
+      }
+   }
+
+   uint32_t trx_block_index::next_block_num()const {
+      return index.inserted_position();
+   }
+
+   vector<uint32_t> trx_block_index::find( const transaction_id_type& id, size_t prefix_size, size_t max_blocks )const {
+      prefix_size = std::min( prefix_size, sizeof(uint64_t) );
+      const uint64_t prefix = id_prefix( id );
+      const uint64_t mask = prefix_size == 0 ? 0 : ~uint64_t(0) << (8 * (sizeof(uint64_t) - prefix_size));
+      const entry lo{ prefix & mask, 0, 0 };
+      const entry hi{ prefix | ~mask, std::numeric_limits<uint32_t>::max(), 0 };
+
+      vector<uint32_t> result;
+      for( const auto& e : index.range( lo, hi, max_blocks ) )
+         result.push_back( e.block_num );
+      std::sort( result.begin(), result.end() );
+      result.erase( std::unique( result.begin(), result.end() ), result.end() );
+      return result;
+   }
+
+   void trx_block_index::close() {
+      if( !thread_pool )
+         return;
+      thread_pool->stop();
+      thread_pool.reset();
+      index.flush();
+   }
+
+   void trx_block_index::remove( const fc::path& blocks_dir ) {
+      index_type::remove_files( blocks_dir, file_name );
+   }
+
+} } /// eosio::chain
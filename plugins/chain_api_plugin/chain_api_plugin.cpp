@@ -4,6 +4,7 @@
  */
 #include <eosio/chain_api_plugin/chain_api_plugin.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/contract_types.hpp>
 
 #include <fc/io/json.hpp>
 
@@ -12,21 +13,65 @@ namespace eosio {
 static appbase::abstract_plugin& _chain_api_plugin = app().register_plugin<chain_api_plugin>();
 
 using namespace eosio;
+using boost::signals2::scoped_connection;
 
 class chain_api_plugin_impl {
 public:
    chain_api_plugin_impl(controller& db)
       : db(db) {}
 
+   /// response cache key of a request, its parameters in canonical form
+   template<typename Params>
+   static string params_cache_key(const string& body) {
+      return fc::json::to_string( fc::json::from_string( body.empty() ? "{}" : body ).as<Params>() );
+   }
+
+   bool is_irreversible(int code, const fc::variant& response) const {
+      return code == 200 && response["block_num"].as<uint32_t>() <= db.last_irreversible_block_num();
+   }
+
+   /**
+    * Responses with actions decoded by the current ABIs, such as get_block, can change when an ABI
+    * does. A setabi drops those cached and, until it is irreversible, no new ones are cached, as
+    * a fork switch could revert it.
+    */
+   bool abis_are_irreversible() const {
+      return last_setabi_block_num <= db.last_irreversible_block_num();
+   }
+
+   void on_applied_transaction(const chain::transaction_trace_ptr& trace) {
+      for( const auto& at : trace->action_traces ) {
+         if( at.receiver == chain::config::system_account_name && at.act.account == chain::config::system_account_name &&
+             at.act.name == chain::setabi::get_name() ) {
+            last_setabi_block_num = std::max( last_setabi_block_num, db.head_block_num() + 1 );
+            app().get_plugin<http_plugin>().clear_cached_responses( "/v1/chain/get_block" );
+            return;
+         }
+      }
+   }
+
    controller& db;
+   uint32_t    last_setabi_block_num = 0;
+   fc::optional<scoped_connection> applied_transaction_connection;
 };
 
 
 chain_api_plugin::chain_api_plugin(){}
 chain_api_plugin::~chain_api_plugin(){}
 
-void chain_api_plugin::set_program_options(options_description&, options_description&) {}
-void chain_api_plugin::plugin_initialize(const variables_map&) {}
+static bool read_only_api_on_http_threads = false;
+
+void chain_api_plugin::set_program_options(options_description&, options_description& cfg) {
+   cfg.add_options()
+         ("read-only-chain-api-on-http-threads", bpo::bool_switch()->default_value(false),
+          "Call the read only chain API handlers, other than get_block, on the http threads, concurrently with each other "
+          "and with the main thread. They wait only while the main thread is changing the chain state.")
+         ;
+}
+
+void chain_api_plugin::plugin_initialize(const variables_map& options) {
+   read_only_api_on_http_threads = options.at( "read-only-chain-api-on-http-threads" ).as<bool>();
+}
 
 struct async_result_visitor : public fc::visitor<fc::variant> {
    template<typename T>
@@ -48,6 +93,22 @@ struct async_result_visitor : public fc::visitor<fc::variant> {
           } \
        }}
 
+// read only calls hold the controller read lock, so they can be made from an http thread
+#define CALL_READ_ONLY(api_name, api_handle, api_namespace, call_name, http_response_code) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [api_handle, &db = my->db](string, string body, url_response_callback cb) mutable { \
+          api_handle.validate(); \
+          try { \
+             if (body.empty()) body = "{}"; \
+             auto params = fc::json::from_string(body).as<api_namespace::call_name ## _params>(); \
+             auto lock = db.read_lock(); \
+             fc::variant result( api_handle.call_name(params) ); \
+             cb(http_response_code, std::move(result)); \
+          } catch (...) { \
+             http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+          } \
+       }}
+
 #define CALL_ASYNC(api_name, api_handle, api_namespace, call_name, call_result, http_response_code) \
 {std::string("/v1/" #api_name "/" #call_name), \
    [api_handle](string, string body, url_response_callback cb) mutable { \
@@ -68,7 +129,7 @@ struct async_result_visitor : public fc::visitor<fc::variant> {
    }\
 }
 
-#define CHAIN_RO_CALL(call_name, http_response_code) CALL(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
+#define CHAIN_RO_CALL(call_name, http_response_code) CALL_READ_ONLY(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
 #define CHAIN_RW_CALL(call_name, http_response_code) CALL(chain, rw_api, chain_apis::read_write, call_name, http_response_code)
 #define CHAIN_RO_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, ro_api, chain_apis::read_only, call_name, call_result, http_response_code)
 #define CHAIN_RW_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, rw_api, chain_apis::read_write, call_name, call_result, http_response_code)
@@ -82,12 +143,17 @@ void chain_api_plugin::plugin_startup() {
    auto& _http_plugin = app().get_plugin<http_plugin>();
    ro_api.set_shorten_abi_errors( !_http_plugin.verbose_errors() );
 
+   // get_block reads the block log, which cannot be read from several threads at once
    _http_plugin.add_api({
+      CHAIN_RO_CALL(get_block, 200)
+   });
+
+   api_description ro_calls{
       CHAIN_RO_CALL(get_info, 200l),
       CHAIN_RO_CALL(get_activated_protocol_features, 200),
-      CHAIN_RO_CALL(get_block, 200),
       CHAIN_RO_CALL(get_block_header_state, 200),
       CHAIN_RO_CALL(get_account, 200),
+      CHAIN_RO_CALL(get_accounts, 200),
       CHAIN_RO_CALL(get_code, 200),
       CHAIN_RO_CALL(get_code_hash, 200),
       CHAIN_RO_CALL(get_abi, 200),
@@ -95,6 +161,7 @@ void chain_api_plugin::plugin_startup() {
       CHAIN_RO_CALL(get_raw_abi, 200),
       CHAIN_RO_CALL(get_table_rows, 200),
       CHAIN_RO_CALL(get_table_by_scope, 200),
+      CHAIN_RO_CALL(export_table_rows, 200),
       CHAIN_RO_CALL(get_currency_balance, 200),
       CHAIN_RO_CALL(get_currency_stats, 200),
       CHAIN_RO_CALL(get_producers, 200),
@@ -104,13 +171,61 @@ void chain_api_plugin::plugin_startup() {
       CHAIN_RO_CALL(abi_bin_to_json, 200),
       CHAIN_RO_CALL(get_required_keys, 200),
       CHAIN_RO_CALL(get_transaction_id, 200),
+      CHAIN_RO_CALL(get_accounts_by_authorizers, 200),
+      CHAIN_RO_CALL(get_batch, 200)
+   };
+   if( read_only_api_on_http_threads ) {
+      _http_plugin.add_http_thread_api( ro_calls );
+   } else {
+      _http_plugin.add_api( ro_calls );
+   }
+
+   _http_plugin.add_api({
       CHAIN_RW_CALL_ASYNC(push_block, chain_apis::read_write::push_block_results, 202),
       CHAIN_RW_CALL_ASYNC(push_transaction, chain_apis::read_write::push_transaction_results, 202),
       CHAIN_RW_CALL_ASYNC(push_transactions, chain_apis::read_write::push_transactions_results, 202),
       CHAIN_RW_CALL_ASYNC(send_transaction, chain_apis::read_write::send_transaction_results, 202)
    });
+
+   // blocks and contracts that can no longer change are served from the http_plugin response cache
+   _http_plugin.add_response_cache_policy( "/v1/chain/get_block", {
+      &chain_api_plugin_impl::params_cache_key<chain_apis::read_only::get_block_params>,
+      [my = my.get()](int code, const fc::variant& response) {
+         return my->abis_are_irreversible() && my->is_irreversible( code, response );
+      }
+   });
+   _http_plugin.add_response_cache_policy( "/v1/chain/get_block_header_state", {
+      &chain_api_plugin_impl::params_cache_key<chain_apis::read_only::get_block_header_state_params>,
+      [my = my.get()](int code, const fc::variant& response) {
+         return my->is_irreversible( code, response );
+      }
+   });
+   // only requests naming the expected hashes are cached, the call fails if they do not match
+   _http_plugin.add_response_cache_policy( "/v1/chain/get_abi", {
+      [](const string& body) -> string {
+         auto params = fc::json::from_string( body.empty() ? "{}" : body ).as<chain_apis::read_only::get_abi_params>();
+         if( !params.abi_hash ) return {};
+         return fc::json::to_string( params );
+      },
+      [](int code, const fc::variant&) { return code == 200; }
+   });
+   _http_plugin.add_response_cache_policy( "/v1/chain/get_code", {
+      [](const string& body) -> string {
+         auto params = fc::json::from_string( body.empty() ? "{}" : body ).as<chain_apis::read_only::get_code_params>();
+         if( !params.code_hash || !params.abi_hash ) return {};
+         return fc::json::to_string( params );
+      },
+      [](int code, const fc::variant&) { return code == 200; }
+   });
+
+   my->applied_transaction_connection.emplace(
+         my->db.applied_transaction.connect( [my = my.get()]( std::tuple<const chain::transaction_trace_ptr&, const chain::signed_transaction&> t ) {
+            my->on_applied_transaction( std::get<0>(t) );
+         } ));
 }
 
-void chain_api_plugin::plugin_shutdown() {}
+void chain_api_plugin::plugin_shutdown() {
+   if( my ) my->applied_transaction_connection.reset();
+}
 
 }
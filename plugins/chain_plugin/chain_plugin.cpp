@@ -15,6 +15,7 @@
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/generated_transaction_object.hpp>
 #include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/trx_block_index.hpp>
 
 #include <eosio/chain/eosio_contract.hpp>
 
@@ -164,6 +165,13 @@ public:
    fc::optional<vm_type>            wasm_runtime;
    fc::microseconds                 abi_serializer_max_time_ms;
    fc::optional<bfs::path>          snapshot_path;
+   fc::optional<trx_block_index>    trx_index;
+   bool                             trx_index_catching_up = false; ///< irreversible blocks are added by catch_up_trx_index, not as they arrive
+   uint32_t                         trx_index_next_block = 0;      ///< next block for catch_up_trx_index
+   bool                             authorizer_index = false;
+   bool                             table_scope_index = false;
+   std::shared_ptr<chain_apis::table_scope_index> table_scopes;
+   std::shared_ptr<chain_apis::system_rows_cache> system_rows = std::make_shared<chain_apis::system_rows_cache>();
 
 
    // retained references to channels for easy publication
@@ -193,6 +201,11 @@ public:
    fc::optional<scoped_connection>                                   accepted_transaction_connection;
    fc::optional<scoped_connection>                                   applied_transaction_connection;
 
+   /// blocks added to the transaction index per main thread task while catching up
+   static constexpr uint32_t trx_index_catch_up_batch = 1000;
+
+   /// add the next batch of irreversible blocks missing from the transaction index, then post itself until it reaches lib
+   void catch_up_trx_index();
 };
 
 chain_plugin::chain_plugin()
@@ -209,6 +222,25 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
    cfg.add_options()
          ("blocks-dir", bpo::value<bfs::path>()->default_value("blocks"),
           "the location of the blocks directory (absolute path or relative to application data dir)")
+         ("blocks-log-stride", bpo::value<uint32_t>()->default_value(0),
+          "split the block log into a new file every time this many blocks have been written (0 to keep a single blocks.log)")
+         ("max-retained-block-files", bpo::value<uint32_t>()->default_value(10),
+          "the maximum number of split block log files to keep in blocks-retained-dir")
+         ("blocks-retained-dir", bpo::value<bfs::path>()->default_value(""),
+          "the location of split block log files (absolute path or relative to blocks dir); empty means the blocks dir itself")
+         ("blocks-archive-dir", bpo::value<bfs::path>()->default_value("archive"),
+          "the location split block log files are moved to once there are more than max-retained-block-files of them "
+          "(absolute path or relative to blocks dir); if empty, such files are deleted")
+         ("trx-block-index", bpo::bool_switch()->default_value(false),
+          "maintain an index from transaction id to block number in the blocks dir as blocks become irreversible, "
+          "used by get_transaction when a transaction is not in the history")
+         ("key-account-index", bpo::bool_switch()->default_value(false),
+          "keep an in memory index of the permissions controlled by each public key and account, "
+          "used by get_accounts_by_authorizers; it is built from the chain state at startup")
+         ("table-scope-index", bpo::bool_switch()->default_value(false),
+          "keep an in memory index of the contract tables by code, table and scope, used by get_table_by_scope "
+          "and export_table_rows to find the scopes of a table without walking the other tables of the contract; "
+          "it is built from the chain state at startup")
          ("protocol-features-dir", bpo::value<bfs::path>()->default_value("protocol_features"),
           "the location of the protocol_features directory (absolute path or relative to application config dir)")
          ("checkpoint", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
@@ -552,6 +584,12 @@ protocol_feature_set initialize_protocol_features( const fc::path& p, bool popul
    return pfs;
 }
 
+static snapshot_reader_ptr make_snapshot_reader( std::istream& snapshot, uint16_t thread_pool_size ) {
+   if( sectioned_snapshot_reader::is_sectioned_snapshot( snapshot ) )
+      return std::make_shared<sectioned_snapshot_reader>( snapshot, thread_pool_size );
+   return std::make_shared<istream_snapshot_reader>( snapshot );
+}
+
 void chain_plugin::plugin_initialize(const variables_map& options) {
    ilog("initializing chain plugin");
 
@@ -639,6 +677,10 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
          my->abi_serializer_max_time_ms = fc::microseconds(options.at("abi-serializer-max-time-ms").as<uint32_t>() * 1000);
 
       my->chain_config->blocks_dir = my->blocks_dir;
+      my->chain_config->blocks_log_split.stride             = options.at( "blocks-log-stride" ).as<uint32_t>();
+      my->chain_config->blocks_log_split.max_retained_files = options.at( "max-retained-block-files" ).as<uint32_t>();
+      my->chain_config->blocks_log_split.retained_dir       = options.at( "blocks-retained-dir" ).as<bfs::path>();
+      my->chain_config->blocks_log_split.archive_dir        = options.at( "blocks-archive-dir" ).as<bfs::path>();
       my->chain_config->state_dir = app().data_dir() / config::default_state_dir_name;
       my->chain_config->read_only = my->readonly;
 
@@ -791,7 +833,7 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 
          // recover genesis information from the snapshot
          auto infile = std::ifstream(my->snapshot_path->generic_string(), (std::ios::in | std::ios::binary));
-         auto reader = std::make_shared<istream_snapshot_reader>(infile);
+         auto reader = make_snapshot_reader(infile, my->chain_config->thread_pool_size);
          reader->validate();
          reader->read_section<genesis_state>([this]( auto &section ){
             section.read_row(my->chain_config->genesis);
@@ -897,6 +939,13 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       my->chain.emplace( *my->chain_config, std::move(pfs) );
       my->chain_id.emplace( my->chain->get_chain_id());
 
+      if( options.at( "trx-block-index" ).as<bool>() ) {
+         my->trx_index.emplace( my->blocks_dir );
+      }
+
+      my->authorizer_index = options.at( "key-account-index" ).as<bool>();
+      my->table_scope_index = options.at( "table-scope-index" ).as<bool>();
+
       // set up method providers
       my->get_block_by_number_provider = app().get_method<methods::get_block_by_number>().register_provider(
             [this]( uint32_t block_num ) -> signed_block_ptr {
@@ -941,6 +990,8 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       } );
 
       my->irreversible_block_connection = my->chain->irreversible_block.connect( [this]( const block_state_ptr& blk ) {
+         if( my->trx_index && !my->trx_index_catching_up )
+            my->trx_index->add_block( *blk->block );
          my->irreversible_block_channel.publish( priority::low, blk );
       } );
 
@@ -959,13 +1010,34 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 
 }
 
+void chain_plugin_impl::catch_up_trx_index() {
+   if( !trx_index || !chain || app().is_quiting() )
+      return;
+   // lib moves on while catching up, its blocks are picked up here until the index reaches it
+   const uint32_t lib_num = chain->last_irreversible_block_num();
+   const uint32_t batch_end = std::min<uint64_t>( lib_num, uint64_t(trx_index_next_block) + trx_index_catch_up_batch - 1 );
+   for( ; trx_index_next_block <= batch_end; ++trx_index_next_block ) {
+      if( auto b = chain->fetch_block_by_number( trx_index_next_block ) )
+         trx_index->add_block( *b );
+   }
+   if( trx_index_next_block > lib_num ) {
+      trx_index_catching_up = false;
+      ilog( "transaction index caught up at block ${n}", ("n", lib_num) );
+      return;
+   }
+   // yield to block and transaction processing between batches, the index is resumed from next_block_num() after a restart
+   app().post( priority::lowest, [this]() {
+      catch_up_trx_index();
+   } );
+}
+
 void chain_plugin::plugin_startup()
 { try {
    try {
       auto shutdown = [](){ return app().is_quiting(); };
       if (my->snapshot_path) {
          auto infile = std::ifstream(my->snapshot_path->generic_string(), (std::ios::in | std::ios::binary));
-         auto reader = std::make_shared<istream_snapshot_reader>(infile);
+         auto reader = make_snapshot_reader(infile, my->chain_config->thread_pool_size);
          my->chain->startup(shutdown, reader);
          infile.close();
       } else {
@@ -985,6 +1057,33 @@ void chain_plugin::plugin_startup()
    ilog("Blockchain started; head block is #${num}, genesis timestamp is ${ts}",
         ("num", my->chain->head_block_num())("ts", (std::string)my->chain_config->genesis.initial_timestamp));
 
+   if( my->authorizer_index ) {
+      my->chain->get_mutable_authorization_manager().enable_authorizer_index();
+      ilog( "key and account index of permissions built" );
+   }
+
+   if( my->table_scope_index ) {
+      my->table_scopes = std::make_shared<chain_apis::table_scope_index>( *my->chain );
+      ilog( "code, table and scope index of contract tables built" );
+   }
+
+   if( my->trx_index ) {
+      // catch up on irreversible blocks accepted while the index was not maintained
+      const auto lib_num = my->chain->last_irreversible_block_num();
+      const auto block_num = my->trx_index->next_block_num();
+      if( block_num > lib_num + 1 ) {
+         wlog( "transaction index is ahead of the irreversible blocks (${n} > ${lib}), it may point at blocks that are not in blocks.log",
+               ("n", block_num)("lib", lib_num) );
+      }
+      if( block_num <= lib_num ) {
+         ilog( "indexing transactions of blocks ${b} through ${lib} in the background; eosio-blocklog --rebuild-trx-index does this offline",
+               ("b", block_num)("lib", lib_num) );
+         my->trx_index_catching_up = true;
+         my->trx_index_next_block = block_num;
+         my->catch_up_trx_index();
+      }
+   }
+
    my->chain_config.reset();
 } FC_CAPTURE_AND_RETHROW() }
 
@@ -995,9 +1094,12 @@ void chain_plugin::plugin_shutdown() {
    my->irreversible_block_connection.reset();
    my->accepted_transaction_connection.reset();
    my->applied_transaction_connection.reset();
+   my->table_scopes.reset();
    if(app().is_quiting())
       my->chain->get_wasm_interface().indicate_shutting_down();
    my->chain.reset();
+   if( my->trx_index )
+      my->trx_index->close();
 }
 
 chain_apis::read_write::read_write(controller& db, const fc::microseconds& abi_serializer_max_time)
@@ -1235,10 +1337,18 @@ chain::chain_id_type chain_plugin::get_chain_id()const {
    return *my->chain_id;
 }
 
+const trx_block_index* chain_plugin::get_trx_block_index() const {
+   return my->trx_index ? &*my->trx_index : nullptr;
+}
+
 fc::microseconds chain_plugin::get_abi_serializer_max_time() const {
    return my->abi_serializer_max_time_ms;
 }
 
+chain_apis::read_only chain_plugin::get_read_only_api() const {
+   return chain_apis::read_only( chain(), get_abi_serializer_max_time(), my->system_rows, my->table_scopes );
+}
+
 void chain_plugin::log_guard_exception(const chain::guard_exception&e ) const {
    if (e.code() == chain::database_guard_exception::code_value) {
       elog("Database has reached an unsafe level of usage, shutting down to avoid corrupting the database.  "
@@ -1456,6 +1566,24 @@ double convert_to_type(const string& str, const string& desc) {
    return val;
 }
 
+string read_only::encode_cursor( const table_rows_cursor& c ) {
+   const auto packed = fc::raw::pack( c );
+   return fc::to_hex( packed.data(), packed.size() );
+}
+
+read_only::table_rows_cursor read_only::decode_cursor( const read_only::get_table_rows_params& p, int64_t table_id, uint64_t index, bool reverse ) {
+   table_rows_cursor c;
+   try {
+      bytes packed( p.cursor->size() / 2 );
+      EOS_ASSERT( fc::from_hex( *p.cursor, packed.data(), packed.size() ) == packed.size(), chain::contract_table_query_exception, "Invalid cursor" );
+      c = fc::raw::unpack<table_rows_cursor>( packed );
+   } EOS_RETHROW_EXCEPTIONS( chain::contract_table_query_exception, "Invalid cursor ${c}", ("c", *p.cursor) )
+   // a table erased and created again gets a new id, so a cursor does not outlive its table
+   EOS_ASSERT( c.table_id == table_id && c.index == index && c.reverse == reverse, chain::contract_table_query_exception,
+               "Cursor was not returned for this table, index and direction, or the table was erased since" );
+   return c;
+}
+
 abi_def get_abi( const controller& db, const name& account ) {
    const auto &d = db.db();
    const account_object *code_accnt = d.find<account_object, by_name>(account);
@@ -1465,6 +1593,27 @@ abi_def get_abi( const controller& db, const name& account ) {
    return abi;
 }
 
+std::shared_ptr<read_only::contract_abi> read_only::get_contract_abi( const name& account, bool with_serializer )const {
+   std::shared_ptr<contract_abi> contract;
+   if( abi_cache ) {
+      auto& cached = (*abi_cache)[account];
+      if( !cached )
+         cached = std::make_shared<contract_abi>( contract_abi{ eosio::chain_apis::get_abi( db, account ) } );
+      contract = cached;
+   } else {
+      contract = std::make_shared<contract_abi>( contract_abi{ eosio::chain_apis::get_abi( db, account ) } );
+   }
+   if( with_serializer )
+      get_abi_serializer( *contract );
+   return contract;
+}
+
+const abi_serializer& read_only::get_abi_serializer( contract_abi& contract )const {
+   if( !contract.serializer )
+      contract.serializer.emplace( contract.abi, abi_serializer_max_time );
+   return *contract.serializer;
+}
+
 string get_table_type( const abi_def& abi, const name& table_name ) {
    for( const auto& t : abi.tables ) {
       if( t.name == table_name ){
@@ -1475,7 +1624,8 @@ string get_table_type( const abi_def& abi, const name& table_name ) {
 }
 
 read_only::get_table_rows_result read_only::get_table_rows( const read_only::get_table_rows_params& p )const {
-   const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
+   const auto contract = get_contract_abi( p.code, p.json && !(p.binary && *p.binary) );
+   const abi_def& abi = contract->abi;
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wstrict-aliasing"
    bool primary = false;
@@ -1484,38 +1634,38 @@ read_only::get_table_rows_result read_only::get_table_rows( const read_only::get
       EOS_ASSERT( p.table == table_with_index, chain::contract_table_query_exception, "Invalid table name ${t}", ( "t", p.table ));
       auto table_type = get_table_type( abi, p.table );
       if( table_type == KEYi64 || p.key_type == "i64" || p.key_type == "name" ) {
-         return get_table_rows_ex<key_value_index>(p,abi);
+         return get_table_rows_ex<key_value_index>(p, *contract);
       }
       EOS_ASSERT( false, chain::contract_table_query_exception,  "Invalid table type ${type}", ("type",table_type)("abi",abi));
    } else {
       EOS_ASSERT( !p.key_type.empty(), chain::contract_table_query_exception, "key type required for non-primary index" );
 
       if (p.key_type == chain_apis::i64 || p.key_type == "name") {
-         return get_table_rows_by_seckey<index64_index, uint64_t>(p, abi, [](uint64_t v)->uint64_t {
+         return get_table_rows_by_seckey<index64_index, uint64_t>(p, *contract, [](uint64_t v)->uint64_t {
             return v;
          });
       }
       else if (p.key_type == chain_apis::i128) {
-         return get_table_rows_by_seckey<index128_index, uint128_t>(p, abi, [](uint128_t v)->uint128_t {
+         return get_table_rows_by_seckey<index128_index, uint128_t>(p, *contract, [](uint128_t v)->uint128_t {
             return v;
          });
       }
       else if (p.key_type == chain_apis::i256) {
          if ( p.encode_type == chain_apis::hex) {
             using  conv = keytype_converter<chain_apis::sha256,chain_apis::hex>;
-            return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+            return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, *contract, conv::function());
          }
          using  conv = keytype_converter<chain_apis::i256>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, *contract, conv::function());
       }
       else if (p.key_type == chain_apis::float64) {
-         return get_table_rows_by_seckey<index_double_index, double>(p, abi, [](double v)->float64_t {
+         return get_table_rows_by_seckey<index_double_index, double>(p, *contract, [](double v)->float64_t {
             float64_t f = *(float64_t *)&v;
             return f;
          });
       }
       else if (p.key_type == chain_apis::float128) {
-         return get_table_rows_by_seckey<index_long_double_index, double>(p, abi, [](double v)->float128_t{
+         return get_table_rows_by_seckey<index_long_double_index, double>(p, *contract, [](double v)->float128_t{
             float64_t f = *(float64_t *)&v;
             float128_t f128;
             f64_to_f128M(f, &f128);
@@ -1524,11 +1674,11 @@ read_only::get_table_rows_result read_only::get_table_rows( const read_only::get
       }
       else if (p.key_type == chain_apis::sha256) {
          using  conv = keytype_converter<chain_apis::sha256,chain_apis::hex>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, *contract, conv::function());
       }
       else if(p.key_type == chain_apis::ripemd160) {
          using  conv = keytype_converter<chain_apis::ripemd160,chain_apis::hex>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, *contract, conv::function());
       }
       EOS_ASSERT(false, chain::contract_table_query_exception,  "Unsupported secondary index type: ${t}", ("t", p.key_type));
    }
@@ -1537,56 +1687,152 @@ read_only::get_table_rows_result read_only::get_table_rows( const read_only::get
 
 read_only::get_table_by_scope_result read_only::get_table_by_scope( const read_only::get_table_by_scope_params& p )const {
    read_only::get_table_by_scope_result result;
-   const auto& d = db.db();
 
-   const auto& idx = d.get_index<chain::table_id_multi_index, chain::by_code_scope_table>();
-   auto lower_bound_lookup_tuple = std::make_tuple( p.code.value, std::numeric_limits<uint64_t>::lowest(), p.table.value );
-   auto upper_bound_lookup_tuple = std::make_tuple( p.code.value, std::numeric_limits<uint64_t>::max(),
-                                                    (p.table.empty() ? std::numeric_limits<uint64_t>::max() : p.table.value) );
+   uint64_t lower_scope = std::numeric_limits<uint64_t>::lowest();
+   uint64_t upper_scope = std::numeric_limits<uint64_t>::max();
 
    if( p.lower_bound.size() ) {
-      uint64_t scope = convert_to_type<uint64_t>(p.lower_bound, "lower_bound scope");
-      std::get<1>(lower_bound_lookup_tuple) = scope;
+      lower_scope = convert_to_type<uint64_t>(p.lower_bound, "lower_bound scope");
    }
 
    if( p.upper_bound.size() ) {
-      uint64_t scope = convert_to_type<uint64_t>(p.upper_bound, "upper_bound scope");
-      std::get<1>(upper_bound_lookup_tuple) = scope;
+      upper_scope = convert_to_type<uint64_t>(p.upper_bound, "upper_bound scope");
    }
 
-   if( upper_bound_lookup_tuple < lower_bound_lookup_tuple )
+   if( upper_scope < lower_scope )
       return result;
 
-   auto walk_table_range = [&]( auto itr, auto end_itr ) {
-      auto cur_time = fc::time_point::now();
-      auto end_time = cur_time + fc::microseconds(1000 * 10); /// 10ms max time
-      for( unsigned int count = 0; cur_time <= end_time && count < p.limit && itr != end_itr; ++itr, cur_time = fc::time_point::now() ) {
-         if( p.table && itr->table != p.table ) continue;
+   const auto end_time = fc::time_point::now() + fc::microseconds(1000 * 10); /// 10ms max time
+   unsigned int count = 0;
+   walk_table_scopes( p.code, p.table, lower_scope, upper_scope, p.reverse && *p.reverse, [&]( const chain::table_id_object& t ) {
+      if( count >= p.limit || fc::time_point::now() > end_time ) {
+         result.more = string(t.scope);
+         return false;
+      }
+      if( p.table && t.table != p.table ) return true;
 
-         result.rows.push_back( {itr->code, itr->scope, itr->table, itr->payer, itr->count} );
+      result.rows.push_back( {t.code, t.scope, t.table, t.payer, t.count} );
+      ++count;
+      return true;
+   } );
 
-         ++count;
-      }
-      if( itr != end_itr ) {
-         result.more = string(itr->scope);
-      }
+   return result;
+}
+
+void read_only::walk_table_scopes( const name& code, const name& table, uint64_t lower_scope, uint64_t upper_scope, bool reverse,
+                                   const std::function<bool( const chain::table_id_object& )>& f )const {
+   if( table_scopes && !table.empty() ) {
+      table_scopes->walk( code, table, lower_scope, upper_scope, reverse, f );
+      return;
+   }
+
+   const auto& idx = db.db().get_index<chain::table_id_multi_index, chain::by_code_scope_table>();
+   auto lower = idx.lower_bound( std::make_tuple( code.value, lower_scope, std::numeric_limits<uint64_t>::lowest() ) );
+   auto upper = idx.upper_bound( std::make_tuple( code.value, upper_scope, std::numeric_limits<uint64_t>::max() ) );
+   auto walk = [&]( auto itr, auto end_itr ) {
+      for( ; itr != end_itr && f( *itr ); ++itr ) {}
    };
+   if( reverse ) {
+      walk( boost::make_reverse_iterator(upper), boost::make_reverse_iterator(lower) );
+   } else {
+      walk( lower, upper );
+   }
+}
+
+read_only::export_table_rows_result read_only::export_table_rows( const read_only::export_table_rows_params& p )const {
+   EOS_ASSERT( p.format == "binary" || p.format == "ndjson", chain::contract_table_query_exception,
+               "Invalid format ${format}, expected binary or ndjson", ("format", p.format) );
+   const bool ndjson = p.format == "ndjson";
+   const size_t max_bytes = std::min( p.max_bytes, max_export_bytes );
 
-   auto lower = idx.lower_bound( lower_bound_lookup_tuple );
-   auto upper = idx.upper_bound( upper_bound_lookup_tuple );
-   if( p.reverse && *p.reverse ) {
-      walk_table_range( boost::make_reverse_iterator(upper), boost::make_reverse_iterator(lower) );
+   read_only::export_table_rows_result result;
+   result.head_block_num = db.head_block_num();
+   const auto& d = db.db();
+
+   std::shared_ptr<contract_abi> contract;
+   string table_type;
+   if( ndjson ) {
+      contract = get_contract_abi( p.code, true );
+      table_type = get_table_type( contract->abi, p.table );
+      result.ndjson.emplace();
    } else {
-      walk_table_range( lower, upper );
+      result.binary_rows.emplace();
+   }
+
+   optional<export_table_rows_cursor> cursor;
+   if( p.cursor && !p.cursor->empty() ) {
+      try {
+         bytes packed( p.cursor->size() / 2 );
+         EOS_ASSERT( fc::from_hex( *p.cursor, packed.data(), packed.size() ) == packed.size(), chain::contract_table_query_exception, "Invalid cursor" );
+         cursor = fc::raw::unpack<export_table_rows_cursor>( packed );
+      } EOS_RETHROW_EXCEPTIONS( chain::contract_table_query_exception, "Invalid cursor ${c}", ("c", *p.cursor) )
    }
 
+   uint64_t lower_scope = cursor ? cursor->scope : std::numeric_limits<uint64_t>::lowest();
+   uint64_t upper_scope = std::numeric_limits<uint64_t>::max();
+   if( p.scope ) {
+      lower_scope = std::max( lower_scope, p.scope->value );
+      upper_scope = p.scope->value;
+   }
+   if( upper_scope < lower_scope )
+      return result;
+
+   const auto& idx = d.get_index<chain::key_value_index, chain::by_scope_primary>();
+
+   const auto end_time = fc::time_point::now() + fc::microseconds(1000 * 10); /// 10ms max time
+   optional<export_table_rows_cursor> last;
+   bool more = false;
+   vector<char> data;
+   walk_table_scopes( p.code, p.table, lower_scope, upper_scope, false, [&]( const chain::table_id_object& t ) {
+      if( t.table != p.table ) return true;
+      // continue strictly after the last row exported
+      uint64_t lower_key = std::numeric_limits<uint64_t>::lowest();
+      if( cursor && t.scope.value == cursor->scope ) {
+         if( cursor->primary_key == std::numeric_limits<uint64_t>::max() )
+            return true;
+         lower_key = cursor->primary_key + 1;
+      }
+
+      auto itr = idx.lower_bound( std::make_tuple( t.id, lower_key ) );
+      auto end_itr = idx.upper_bound( std::make_tuple( t.id, std::numeric_limits<uint64_t>::max() ) );
+      for( ; itr != end_itr; ++itr ) {
+         const size_t size = ndjson ? result.ndjson->size() : result.binary_rows->size();
+         if( result.row_count && (size >= max_bytes || fc::time_point::now() > end_time) ) {
+            more = true;
+            break;
+         }
+
+         if( ndjson ) {
+            copy_inline_row( *itr, data );
+            auto& abis = *contract->serializer;
+            result.ndjson->append( fc::json::to_string( fc::mutable_variant_object()
+                  ("scope", t.scope)
+                  ("primary_key", itr->primary_key)
+                  ("payer", itr->payer)
+                  ("data", abis.binary_to_variant( table_type, data, abi_serializer_max_time, shorten_abi_errors )) ) );
+            result.ndjson->push_back( '\n' );
+         } else {
+            auto& rows = *result.binary_rows;
+            rows.resize( size + sizeof(uint64_t) );
+            memcpy( rows.data() + size, &t.scope.value, sizeof(uint64_t) );
+            append_binary_row( rows, itr->primary_key, itr->payer, itr->value );
+         }
+         ++result.row_count;
+         last = export_table_rows_cursor{ t.scope.value, itr->primary_key };
+      }
+      return !more;
+   } );
+
+   if( more ) {
+      const auto packed = fc::raw::pack( *last );
+      result.next_cursor = fc::to_hex( packed.data(), packed.size() );
+   }
    return result;
 }
 
 vector<asset> read_only::get_currency_balance( const read_only::get_currency_balance_params& p )const {
 
-   const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
-   (void)get_table_type( abi, "accounts" );
+   (void)get_table_type( get_contract_abi( p.code, false )->abi, "accounts" );
 
    vector<asset> results;
    walk_key_value_table(p.code, p.account, N(accounts), [&](const key_value_object& obj){
@@ -1612,8 +1858,7 @@ vector<asset> read_only::get_currency_balance( const read_only::get_currency_bal
 fc::variant read_only::get_currency_stats( const read_only::get_currency_stats_params& p )const {
    fc::mutable_variant_object results;
 
-   const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
-   (void)get_table_type( abi, "stat" );
+   (void)get_table_type( get_contract_abi( p.code, false )->abi, "stat" );
 
    uint64_t scope = ( eosio::chain::string_to_symbol( 0, boost::algorithm::to_upper_copy(p.symbol).c_str() ) >> 8 );
 
@@ -1651,9 +1896,10 @@ fc::variant get_global_row( const database& db, const abi_def& abi, const abi_se
 }
 
 read_only::get_producers_result read_only::get_producers( const read_only::get_producers_params& p ) const try {
-   const abi_def abi = eosio::chain_apis::get_abi(db, config::system_account_name);
+   const auto contract = get_contract_abi(config::system_account_name, false);
+   const abi_def& abi = contract->abi;
    const auto table_type = get_table_type(abi, N(producers));
-   const abi_serializer abis{ abi, abi_serializer_max_time };
+   const abi_serializer& abis = get_abi_serializer(*contract);
    EOS_ASSERT(table_type == KEYi64, chain::contract_table_query_exception, "Invalid table type ${type} for table producers", ("type",table_type));
 
    const auto& d = db.db();
@@ -1831,10 +2077,67 @@ fc::variant read_only::get_block(const read_only::get_block_params& params) cons
                "Invalid Block number or ID, must be greater than 0 and less than 64 characters"
    );
 
+   const string fields = params.fields ? *params.fields : "full";
+   EOS_ASSERT( fields == "full" || fields == "header" || fields == "ids" || fields == "raw", chain::invalid_http_request,
+               "Invalid fields ${fields}, expected full, header, ids or raw", ("fields", fields) );
+
    try {
       block_num = fc::to_uint64(params.block_num_or_id);
    } catch( ... ) {}
 
+   if( fields != "full" ) {
+      vector<char> packed;
+      optional<block_id_type> id;
+      if( block_num.valid() ) {
+         packed = db.fetch_serialized_block_by_number( *block_num );
+      } else {
+         try {
+            id = fc::variant(params.block_num_or_id).as<block_id_type>();
+         } EOS_RETHROW_EXCEPTIONS(chain::block_id_type_exception, "Invalid block ID: ${block_num_or_id}", ("block_num_or_id", params.block_num_or_id))
+         auto state = db.fetch_block_state_by_id( *id );
+         if( state && state->block ) {
+            packed = fc::raw::pack( *state->block );
+         } else {
+            packed = db.fetch_serialized_block_by_number( block_header::num_from_id( *id ) );
+         }
+      }
+
+      EOS_ASSERT( !packed.empty(), unknown_block_exception, "Could not find block: ${block}", ("block", params.block_num_or_id));
+
+      // a packed block is its header followed by its transaction receipts
+      fc::datastream<const char*> ds( packed.data(), packed.size() );
+      signed_block_header header;
+      fc::raw::unpack( ds, header );
+      const auto block_id = header.id();
+      EOS_ASSERT( !id || *id == block_id, unknown_block_exception, "Could not find block: ${block}", ("block", params.block_num_or_id));
+
+      fc::mutable_variant_object result;
+      if( fields == "raw" ) {
+         result( "raw_block", fc::to_hex( packed.data(), packed.size() ) );
+      } else {
+         fc::variant header_output;
+         fc::to_variant( header, header_output );
+         result = fc::mutable_variant_object( header_output.get_object() );
+         if( fields == "ids" ) {
+            vector<transaction_receipt> receipts;
+            fc::raw::unpack( ds, receipts );
+            fc::variants transactions;
+            transactions.reserve( receipts.size() );
+            for( const auto& r : receipts ) {
+               const auto trx_id = r.trx.contains<transaction_id_type>() ? r.trx.get<transaction_id_type>()
+                                                                         : r.trx.get<packed_transaction>().id();
+               transactions.emplace_back( fc::mutable_variant_object( "status", r.status )( "id", trx_id ) );
+            }
+            result( "transactions", std::move( transactions ) );
+         }
+      }
+
+      return result
+              ("id", block_id)
+              ("block_num", header.block_num())
+              ("ref_block_prefix", uint32_t(block_id._hash[1]));
+   }
+
    if( block_num.valid() ) {
       block = db.fetch_block_by_number( *block_num );
    } else {
@@ -2044,6 +2347,12 @@ read_only::get_abi_results read_only::get_abi( const get_abi_params& params )con
    const auto& d = db.db();
    const auto& accnt  = d.get<account_object,by_name>( params.account_name );
 
+   if( params.abi_hash ) {
+      const auto abi_hash = fc::sha256::hash( accnt.abi.data(), accnt.abi.size() );
+      EOS_ASSERT( *params.abi_hash == abi_hash, contract_query_exception,
+                  "ABI hash of ${a} is ${h}, not ${e}", ("a", params.account_name)("h", abi_hash)("e", *params.abi_hash) );
+   }
+
    abi_def abi;
    if( abi_serializer::to_abi(accnt.abi, abi) ) {
       result.abi = std::move(abi);
@@ -2060,6 +2369,13 @@ read_only::get_code_results read_only::get_code( const get_code_params& params )
    const auto& accnt_metadata_obj = d.get<account_metadata_object,by_name>( params.account_name );
 
    EOS_ASSERT( params.code_as_wasm, unsupported_feature, "Returning WAST from get_code is no longer supported" );
+   EOS_ASSERT( !params.code_hash || *params.code_hash == accnt_metadata_obj.code_hash, contract_query_exception,
+               "Code hash of ${a} is ${h}, not ${e}", ("a", params.account_name)("h", accnt_metadata_obj.code_hash)("e", *params.code_hash) );
+   if( params.abi_hash ) {
+      const auto abi_hash = fc::sha256::hash( accnt_obj.abi.data(), accnt_obj.abi.size() );
+      EOS_ASSERT( *params.abi_hash == abi_hash, contract_query_exception,
+                  "ABI hash of ${a} is ${h}, not ${e}", ("a", params.account_name)("h", abi_hash)("e", *params.abi_hash) );
+   }
 
    if( accnt_metadata_obj.code_hash != digest_type() ) {
       const auto& code_obj = d.get<code_object, by_code_hash>(accnt_metadata_obj.code_hash);
@@ -2119,6 +2435,121 @@ read_only::get_raw_abi_results read_only::get_raw_abi( const get_raw_abi_params&
    return result;
 }
 
+std::shared_ptr<const abi_serializer> system_rows_cache::get_serializer( const shared_blob& abi, const fc::microseconds& max_time ) {
+   {
+      std::lock_guard<std::mutex> g( _mtx );
+      if( _serializer && _abi.size() == abi.size() && std::equal( _abi.begin(), _abi.end(), abi.data() ) )
+         return _serializer;
+   }
+   vector<char> abi_data( abi.data(), abi.data() + abi.size() );
+   abi_def abi_d;
+   abi_serializer::to_abi( abi_data, abi_d );
+   auto serializer = std::make_shared<const abi_serializer>( abi_d, max_time );
+
+   std::lock_guard<std::mutex> g( _mtx );
+   _abi = std::move( abi_data );
+   _serializer = serializer;
+   _rows.clear();
+   return serializer;
+}
+
+fc::variant system_rows_cache::decode( const abi_serializer& abis, const type_name& type, account_name account,
+                                       const shared_blob& row, const fc::microseconds& max_time, bool shorten_errors ) {
+   const auto key = std::make_pair( type, account );
+   {
+      std::lock_guard<std::mutex> g( _mtx );
+      auto itr = _rows.find( key );
+      if( itr != _rows.end() && itr->second.data.size() == row.size() &&
+          std::equal( itr->second.data.begin(), itr->second.data.end(), row.data() ) )
+         return itr->second.value;
+   }
+   decoded_row decoded{ vector<char>( row.data(), row.data() + row.size() ) };
+   decoded.value = abis.binary_to_variant( type, decoded.data, max_time, shorten_errors );
+
+   std::lock_guard<std::mutex> g( _mtx );
+   // rows decoded with a serializer the ABI has since replaced are not kept
+   if( &abis == _serializer.get() ) {
+      if( _rows.size() >= _max_rows )
+         _rows.clear();
+      _rows[key] = decoded;
+   }
+   return decoded.value;
+}
+
+table_scope_index::table_scope_index( controller& chain )
+:_chain( chain )
+,_accepted_block_connection( chain.accepted_block.connect( [this]( const block_state_ptr& bsp ) {
+   on_accepted_block( bsp->block_num );
+} ) ) {
+   _next_id = add_tables( 0 );
+   _last_block = chain.head_block_num();
+   if( chain.is_building_block() ) {
+      // the ids of the tables of the block being built may be given out again
+      _next_id = 0;
+   } else {
+      _block_next_id[_last_block] = _next_id;
+   }
+}
+
+uint64_t table_scope_index::add_tables( uint64_t first_id ) {
+   const auto& idx = _chain.db().get_index<chain::table_id_multi_index>();
+   for( auto itr = idx.lower_bound( chain::table_id_object::id_type( first_id ) ); itr != idx.end(); ++itr ) {
+      _tables.emplace( itr->code.value, itr->table.value, itr->scope.value );
+   }
+   return idx.empty() ? first_id : std::max<uint64_t>( first_id, idx.rbegin()->id._id + 1 );
+}
+
+void table_scope_index::on_accepted_block( uint32_t block_num ) {
+   std::unique_lock<std::shared_mutex> g( _mtx );
+   if( block_num <= _last_block ) {
+      // the blocks from block_num on were undone, add the tables from the ids of the block before
+      _block_next_id.erase( _block_next_id.lower_bound( block_num ), _block_next_id.end() );
+      auto itr = _block_next_id.find( block_num - 1 );
+      _next_id = itr != _block_next_id.end() ? itr->second : 0;
+   }
+   _next_id = add_tables( _next_id );
+   _last_block = block_num;
+   _block_next_id[block_num] = _next_id;
+   // a fork switch never undoes the last irreversible block
+   _block_next_id.erase( _block_next_id.begin(), _block_next_id.lower_bound( _chain.last_irreversible_block_num() ) );
+}
+
+void table_scope_index::walk( account_name code, name table, uint64_t lower_scope, uint64_t upper_scope, bool reverse,
+                              const std::function<bool( const chain::table_id_object& )>& f )const {
+   std::shared_lock<std::shared_mutex> g( _mtx );
+   const auto& d = _chain.db();
+
+   // the tables of the block being built, added to _tables only once it is accepted
+   std::set<uint64_t> pending;
+   const auto& ids = d.get_index<chain::table_id_multi_index>();
+   for( auto itr = ids.lower_bound( chain::table_id_object::id_type( _next_id ) ); itr != ids.end(); ++itr ) {
+      if( itr->code == code && itr->table == table && itr->scope.value >= lower_scope && itr->scope.value <= upper_scope )
+         pending.insert( itr->scope.value );
+   }
+
+   auto lower = _tables.lower_bound( std::make_tuple( code.value, table.value, lower_scope ) );
+   auto upper = _tables.upper_bound( std::make_tuple( code.value, table.value, upper_scope ) );
+   auto walk_scopes = [&]( auto itr, auto end_itr, auto p_itr, auto p_end, auto before ) {
+      while( itr != end_itr || p_itr != p_end ) {
+         uint64_t scope = 0;
+         if( p_itr == p_end || (itr != end_itr && !before( *p_itr, std::get<2>( *itr ) )) ) {
+            scope = std::get<2>( *itr++ );
+            if( p_itr != p_end && *p_itr == scope ) ++p_itr;
+         } else {
+            scope = *p_itr++;
+         }
+         const auto* t = d.find<chain::table_id_object, chain::by_code_scope_table>( boost::make_tuple( code, name( scope ), table ) );
+         if( t && !f( *t ) ) return;
+      }
+   };
+   if( reverse ) {
+      walk_scopes( boost::make_reverse_iterator(upper), boost::make_reverse_iterator(lower), pending.rbegin(), pending.rend(),
+                   std::greater<uint64_t>() );
+   } else {
+      walk_scopes( lower, upper, pending.begin(), pending.end(), std::less<uint64_t>() );
+   }
+}
+
 read_only::get_account_results read_only::get_account( const get_account_params& params )const {
    get_account_results result;
    result.account_name = params.account_name;
@@ -2164,9 +2595,30 @@ read_only::get_account_results read_only::get_account( const get_account_params&
 
    const auto& code_account = db.db().get<account_object,by_name>( config::system_account_name );
 
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   if( code_account.abi.size() > 0 ) {
+      std::shared_ptr<const abi_serializer> abis;
+      if( system_rows ) {
+         abis = system_rows->get_serializer( code_account.abi, abi_serializer_max_time );
+      } else {
+         const auto contract = get_contract_abi( config::system_account_name, true );
+         abis = std::shared_ptr<const abi_serializer>( contract, &*contract->serializer );
+      }
+
+      // the row of the account in a system contract table, decoded as type
+      auto system_row = [&]( name scope, name table, const type_name& type ) -> fc::variant {
+         const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, scope, table ));
+         if( t_id == nullptr )
+            return {};
+         const auto &idx = d.get_index<key_value_index, by_scope_primary>();
+         auto it = idx.find(boost::make_tuple( t_id->id, params.account_name ));
+         if( it == idx.end() )
+            return {};
+         if( system_rows )
+            return system_rows->decode( *abis, type, params.account_name, it->value, abi_serializer_max_time, shorten_abi_errors );
+         vector<char> data;
+         copy_inline_row(*it, data);
+         return abis->binary_to_variant( type, data, abi_serializer_max_time, shorten_abi_errors );
+      };
 
       const auto token_code = N(eosio.token);
 
@@ -2190,53 +2642,25 @@ read_only::get_account_results read_only::get_account( const get_account_params&
          }
       }
 
-      t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, params.account_name, N(userres) ));
-      if (t_id != nullptr) {
-         const auto &idx = d.get_index<key_value_index, by_scope_primary>();
-         auto it = idx.find(boost::make_tuple( t_id->id, params.account_name ));
-         if ( it != idx.end() ) {
-            vector<char> data;
-            copy_inline_row(*it, data);
-            result.total_resources = abis.binary_to_variant( "user_resources", data, abi_serializer_max_time, shorten_abi_errors );
-         }
-      }
-
-      t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, params.account_name, N(delband) ));
-      if (t_id != nullptr) {
-         const auto &idx = d.get_index<key_value_index, by_scope_primary>();
-         auto it = idx.find(boost::make_tuple( t_id->id, params.account_name ));
-         if ( it != idx.end() ) {
-            vector<char> data;
-            copy_inline_row(*it, data);
-            result.self_delegated_bandwidth = abis.binary_to_variant( "delegated_bandwidth", data, abi_serializer_max_time, shorten_abi_errors );
-         }
-      }
-
-      t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, params.account_name, N(refunds) ));
-      if (t_id != nullptr) {
-         const auto &idx = d.get_index<key_value_index, by_scope_primary>();
-         auto it = idx.find(boost::make_tuple( t_id->id, params.account_name ));
-         if ( it != idx.end() ) {
-            vector<char> data;
-            copy_inline_row(*it, data);
-            result.refund_request = abis.binary_to_variant( "refund_request", data, abi_serializer_max_time, shorten_abi_errors );
-         }
-      }
-
-      t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, config::system_account_name, N(voters) ));
-      if (t_id != nullptr) {
-         const auto &idx = d.get_index<key_value_index, by_scope_primary>();
-         auto it = idx.find(boost::make_tuple( t_id->id, params.account_name ));
-         if ( it != idx.end() ) {
-            vector<char> data;
-            copy_inline_row(*it, data);
-            result.voter_info = abis.binary_to_variant( "voter_info", data, abi_serializer_max_time, shorten_abi_errors );
-         }
-      }
+      result.total_resources = system_row( params.account_name, N(userres), "user_resources" );
+      result.self_delegated_bandwidth = system_row( params.account_name, N(delband), "delegated_bandwidth" );
+      result.refund_request = system_row( params.account_name, N(refunds), "refund_request" );
+      result.voter_info = system_row( config::system_account_name, N(voters), "voter_info" );
    }
    return result;
 }
 
+vector<read_only::get_account_results> read_only::get_accounts( const get_accounts_params& params )const {
+   EOS_ASSERT( params.account_names.size() <= max_batch_queries, chain::invalid_http_request,
+               "At most ${max} accounts can be requested at once", ("max", max_batch_queries) );
+   vector<get_account_results> results;
+   results.reserve( params.account_names.size() );
+   for( const auto& a : params.account_names ) {
+      results.push_back( get_account( { a, params.expected_core_symbol } ) );
+   }
+   return results;
+}
+
 static variant action_abi_to_variant( const abi_def& abi, type_name action_type ) {
    variant v;
    auto it = std::find_if(abi.structs.begin(), abi.structs.end(), [&](auto& x){return x.name == action_type;});
@@ -2250,9 +2674,10 @@ read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::a
    const auto code_account = db.db().find<account_object,by_name>( params.code );
    EOS_ASSERT(code_account != nullptr, contract_query_exception, "Contract can't be found ${contract}", ("contract", params.code));
 
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account->abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   if( code_account->abi.size() > 0 ) {
+      const auto contract = get_contract_abi( params.code, true );
+      const abi_def& abi = contract->abi;
+      const abi_serializer& abis = *contract->serializer;
       auto action_type = abis.get_action_type(params.action);
       EOS_ASSERT(!action_type.empty(), action_validate_exception, "Unknown action ${action} in contract ${contract}", ("action", params.action)("contract", params.code));
       try {
@@ -2270,9 +2695,9 @@ read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::a
 read_only::abi_bin_to_json_result read_only::abi_bin_to_json( const read_only::abi_bin_to_json_params& params )const {
    abi_bin_to_json_result result;
    const auto& code_account = db.db().get<account_object,by_name>( params.code );
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   if( code_account.abi.size() > 0 ) {
+      const auto contract = get_contract_abi( params.code, true );
+      const abi_serializer& abis = *contract->serializer;
       result.args = abis.binary_to_variant( abis.get_action_type( params.action ), params.binargs, abi_serializer_max_time, shorten_abi_errors );
    } else {
       EOS_ASSERT(false, abi_not_found_exception, "No ABI found for ${contract}", ("contract", params.code));
@@ -2297,6 +2722,93 @@ read_only::get_transaction_id_result read_only::get_transaction_id( const read_o
    return params.id();
 }
 
+read_only::get_accounts_by_authorizers_result
+read_only::get_accounts_by_authorizers( const get_accounts_by_authorizers_params& params )const {
+   const auto& authorization = db.get_authorization_manager();
+   EOS_ASSERT( authorization.has_authorizer_index(), chain::plugin_config_exception,
+               "get_accounts_by_authorizers needs the key-account-index option" );
+
+   get_accounts_by_authorizers_result result;
+   for( const auto& key : params.keys ) {
+      for( const auto* p : authorization.find_permissions_by_key( key ) ) {
+         for( const auto& k : p->auth.keys ) {
+            if( k.key != key ) continue;
+            result.accounts.push_back( { p->owner, p->name, {}, key, k.weight, p->auth.threshold } );
+         }
+      }
+   }
+   for( const auto& account : params.accounts ) {
+      for( const auto* p : authorization.find_permissions_by_account( account ) ) {
+         for( const auto& a : p->auth.accounts ) {
+            if( a.permission.actor != account ) continue;
+            result.accounts.push_back( { p->owner, p->name, a.permission, {}, a.weight, p->auth.threshold } );
+         }
+      }
+   }
+   return result;
+}
+
+namespace {
+   using batch_call = std::function<fc::variant(const read_only&, const fc::variant&)>;
+
+   template<typename Params, typename Result>
+   batch_call make_batch_call( Result (read_only::*call)( const Params& )const ) {
+      return [call]( const read_only& api, const fc::variant& params ) {
+         return fc::variant( (api.*call)( params.is_null() ? Params() : params.as<Params>() ) );
+      };
+   }
+
+   /// the read only calls a get_batch can make; get_block reads the block log, so it is not one of them
+   const std::map<string, batch_call>& batch_calls() {
+      static const std::map<string, batch_call> calls = {
+         { "get_info",                make_batch_call( &read_only::get_info ) },
+         { "get_account",             make_batch_call( &read_only::get_account ) },
+         { "get_accounts",            make_batch_call( &read_only::get_accounts ) },
+         { "get_code_hash",           make_batch_call( &read_only::get_code_hash ) },
+         { "get_abi",                 make_batch_call( &read_only::get_abi ) },
+         { "get_raw_abi",             make_batch_call( &read_only::get_raw_abi ) },
+         { "get_table_rows",          make_batch_call( &read_only::get_table_rows ) },
+         { "get_table_by_scope",      make_batch_call( &read_only::get_table_by_scope ) },
+         { "get_currency_balance",    make_batch_call( &read_only::get_currency_balance ) },
+         { "get_currency_stats",      make_batch_call( &read_only::get_currency_stats ) },
+         { "get_producers",           make_batch_call( &read_only::get_producers ) },
+         { "get_producer_schedule",   make_batch_call( &read_only::get_producer_schedule ) },
+         { "abi_json_to_bin",         make_batch_call( &read_only::abi_json_to_bin ) },
+         { "abi_bin_to_json",         make_batch_call( &read_only::abi_bin_to_json ) },
+         { "get_required_keys",       make_batch_call( &read_only::get_required_keys ) },
+         { "get_accounts_by_authorizers", make_batch_call( &read_only::get_accounts_by_authorizers ) }
+      };
+      return calls;
+   }
+}
+
+read_only::get_batch_result read_only::get_batch( const read_only::get_batch_params& params )const {
+   EOS_ASSERT( params.queries.size() <= max_batch_queries, chain::invalid_http_request,
+               "A batch can have at most ${max} queries", ("max", max_batch_queries) );
+
+   std::map<account_name, std::shared_ptr<contract_abi>> contract_abis;
+   read_only api = *this;
+   api.abi_cache = &contract_abis;
+
+   const auto& calls = batch_calls();
+   get_batch_result result;
+   result.results.reserve( params.queries.size() );
+   for( const auto& q : params.queries ) {
+      try {
+         auto itr = calls.find( q.call );
+         EOS_ASSERT( itr != calls.end(), chain::invalid_http_request, "Unsupported batch call ${call}", ("call", q.call) );
+         result.results.emplace_back( fc::mutable_variant_object( "result", itr->second( api, q.params ) ) );
+      } catch( const fc::exception& e ) {
+         result.results.emplace_back( fc::mutable_variant_object( "error", fc::mutable_variant_object()
+                                         ( "code", e.code() )( "name", e.name() )( "what", e.what() )( "message", e.to_string() ) ) );
+      } catch( const std::exception& e ) {
+         result.results.emplace_back( fc::mutable_variant_object( "error", fc::mutable_variant_object()
+                                         ( "code", int64_t(fc::std_exception_code) )( "name", "exception" )( "what", e.what() ) ) );
+      }
+   }
+   return result;
+}
+
 namespace detail {
    struct ram_market_exchange_state_t {
       asset  ignore1;
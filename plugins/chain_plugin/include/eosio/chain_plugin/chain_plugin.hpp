@@ -18,11 +18,21 @@
 
 #include <boost/container/flat_set.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
+#include <boost/signals2/connection.hpp>
 
 #include <fc/static_variant.hpp>
 
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <tuple>
+
 namespace fc { class variant; }
 
+namespace eosio { namespace chain { class trx_block_index; } }
+
 namespace eosio {
    using chain::controller;
    using std::unique_ptr;
@@ -69,16 +79,88 @@ uint64_t convert_to_type(const string& str, const string& desc);
 template<>
 double convert_to_type(const string& str, const string& desc);
 
+/**
+ * The system contract rows get_account decodes, with their decoded form. A row is decoded again
+ * only once its bytes or the system contract ABI change, so forks need no special care.
+ */
+class system_rows_cache {
+public:
+   explicit system_rows_cache( size_t max_rows = 200000 ) : _max_rows( max_rows ) {}
+
+   /// the serializer of the system contract ABI, set up again only when abi changes
+   std::shared_ptr<const abi_serializer> get_serializer( const chain::shared_blob& abi, const fc::microseconds& max_time );
+
+   /// row of account decoded as type, abis must come from get_serializer
+   fc::variant decode( const abi_serializer& abis, const chain::type_name& type, account_name account,
+                       const chain::shared_blob& row, const fc::microseconds& max_time, bool shorten_errors );
+
+private:
+   struct decoded_row {
+      vector<char> data;
+      fc::variant  value;
+   };
+
+   const size_t                                  _max_rows;
+   std::mutex                                    _mtx;
+   vector<char>                                  _abi;
+   std::shared_ptr<const abi_serializer>         _serializer;
+   std::map<std::pair<chain::type_name, account_name>, decoded_row> _rows;
+};
+
+/**
+ * An in memory index of the contract tables by code, table and scope, so that the scopes of one
+ * table are found without walking the other tables of the contract. It is not part of the chain
+ * state.
+ *
+ * It is built from the table ids at construction. After each accepted block it adds the tables
+ * created since the previous one, which have the ids from there on; a fork switch gives the ids of
+ * the blocks it undoes out again, so the tables are then added from the ids of the block it forks
+ * from. Lookups find the tables of the block being built without adding them, so they only read
+ * the index and may run on several threads at once.
+ *
+ * Undo restores removed tables without going through the index, so entries are never removed. A
+ * lookup instead checks each scope against the chain state.
+ */
+class table_scope_index {
+public:
+   explicit table_scope_index( controller& chain );
+
+   /// calls f with the tables of code named table with a scope from lower_scope to upper_scope, in scope order
+   /// or in reverse, until it returns false
+   void walk( account_name code, name table, uint64_t lower_scope, uint64_t upper_scope, bool reverse,
+              const std::function<bool( const chain::table_id_object& )>& f )const;
+
+private:
+   void on_accepted_block( uint32_t block_num );
+   /// adds the tables with an id of first_id or more, returns the id after the last table
+   uint64_t add_tables( uint64_t first_id );
+
+   using table_key = std::tuple<uint64_t, uint64_t, uint64_t>; ///< code, table, scope
+
+   const controller&                    _chain;
+   mutable std::shared_mutex            _mtx;            ///< guards the members below up to _block_next_id
+   std::set<table_key>                  _tables;
+   uint64_t                             _next_id = 0;    ///< the tables with lower ids are in _tables
+   uint32_t                             _last_block = 0;
+   std::map<uint32_t, uint64_t>         _block_next_id;  ///< _next_id after each reversible block
+   boost::signals2::scoped_connection   _accepted_block_connection;
+};
+
 class read_only {
    const controller& db;
    const fc::microseconds abi_serializer_max_time;
    bool  shorten_abi_errors = true;
+   std::shared_ptr<system_rows_cache> system_rows;
+   std::shared_ptr<table_scope_index> table_scopes;
 
 public:
    static const string KEYi64;
 
-   read_only(const controller& db, const fc::microseconds& abi_serializer_max_time)
-      : db(db), abi_serializer_max_time(abi_serializer_max_time) {}
+   read_only(const controller& db, const fc::microseconds& abi_serializer_max_time,
+             std::shared_ptr<system_rows_cache> system_rows = nullptr,
+             std::shared_ptr<table_scope_index> table_scopes = nullptr)
+      : db(db), abi_serializer_max_time(abi_serializer_max_time), system_rows(std::move(system_rows)),
+        table_scopes(std::move(table_scopes)) {}
 
    void validate() const {}
 
@@ -163,6 +245,13 @@ public:
    };
    get_account_results get_account( const get_account_params& params )const;
 
+   struct get_accounts_params {
+      vector<name>     account_names;
+      optional<symbol> expected_core_symbol;
+   };
+   /// get_account of each account, at most max_batch_queries of them
+   vector<get_account_results> get_accounts( const get_accounts_params& params )const;
+
 
    struct get_code_results {
       name                   account_name;
@@ -175,6 +264,8 @@ public:
    struct get_code_params {
       name account_name;
       bool code_as_wasm = false;
+      optional<fc::sha256>   code_hash; ///< if set, fail unless the account's code has this hash
+      optional<fc::sha256>   abi_hash;  ///< if set, fail unless the account's abi has this hash
    };
 
    struct get_code_hash_results {
@@ -193,6 +284,7 @@ public:
 
    struct get_abi_params {
       name account_name;
+      optional<fc::sha256>   abi_hash;  ///< if set, fail unless the account's abi has this hash
    };
 
    struct get_raw_code_and_abi_results {
@@ -267,8 +359,15 @@ public:
 
    struct get_block_params {
       string block_num_or_id;
+      /// full (the default) with actions decoded by their ABIs, header, ids for the header and transaction ids,
+      /// or raw for the packed block in hex
+      optional<string> fields;
    };
 
+   /**
+    * The block with id, block_num and ref_block_prefix. Other than full, fields are served from the
+    * packed block, which is unpacked only as far as they need and never ABI decoded.
+    */
    fc::variant get_block(const get_block_params& params) const;
 
    struct get_block_header_state_params {
@@ -291,11 +390,25 @@ public:
       string      encode_type{"dec"}; //dec, hex , default=dec
       optional<bool>  reverse;
       optional<bool>  show_payer; // show RAM pyer
+      optional<string> cursor; ///< next_cursor of a previous call with the same parameters, continues after its last row
+      optional<bool>  binary; ///< return the rows in binary_rows, without ABI decoding
     };
 
    struct get_table_rows_result {
       vector<fc::variant> rows; ///< one row per item, either encoded as hex String or JSON object
       bool                more = false; ///< true if last element in data is not the end and sizeof data() < limit
+      optional<string>    next_cursor; ///< set if more, pass as cursor to fetch the following rows
+      /// with binary, the rows one after the other, each as primary key (uint64), payer (name) and the row bytes (varuint32 size + bytes)
+      optional<vector<char>> binary_rows;
+   };
+
+   /// what next_cursor encodes: where the walk of an index stopped
+   struct table_rows_cursor {
+      int64_t       table_id = 0;    ///< id of the table_id_object of the walked index
+      uint64_t      index = 0;       ///< table name with the index position
+      bool          reverse = false;
+      uint64_t      primary_key = 0; ///< of the last row walked
+      vector<char>  secondary_key;   ///< of the last row walked, empty for the primary index
    };
 
    get_table_rows_result get_table_rows( const get_table_rows_params& params )const;
@@ -322,6 +435,40 @@ public:
 
    get_table_by_scope_result get_table_by_scope( const get_table_by_scope_params& params )const;
 
+   struct export_table_rows_params {
+      name             code;
+      name             table;
+      optional<name>   scope; ///< export this scope only, every scope of the table otherwise
+      string           format{"binary"}; ///< binary or ndjson
+      uint32_t         max_bytes = 1024 * 1024; ///< size of a page, at most max_export_bytes
+      optional<string> cursor; ///< next_cursor of a previous call with the same parameters
+   };
+
+   struct export_table_rows_result {
+      uint32_t               head_block_num = 0; ///< the state the page was read from
+      uint32_t               row_count = 0;
+      /// with binary, the rows one after the other, each as scope (name), primary key (uint64), payer (name) and the row bytes (varuint32 size + bytes)
+      optional<vector<char>> binary_rows;
+      /// with ndjson, one {"scope","primary_key","payer","data"} object per line, data decoded by the contract ABI
+      optional<string>       ndjson;
+      optional<string>       next_cursor; ///< set if there are more rows, pass as cursor to fetch them
+   };
+
+   /// where an export stopped: the last row exported
+   struct export_table_rows_cursor {
+      uint64_t scope = 0;
+      uint64_t primary_key = 0;
+   };
+
+   static constexpr uint32_t max_export_bytes = 16 * 1024 * 1024;
+
+   /**
+    * The rows of a table in scope and primary key order, a page at a time. Pages are filled up to
+    * max_bytes without the row limit of get_table_rows, within the same 10ms bound. Each page is read
+    * from one state; the rows of scopes not yet reached can change before the next page is read.
+    */
+   export_table_rows_result export_table_rows( const export_table_rows_params& params )const;
+
    struct get_currency_balance_params {
       name             code;
       name             account;
@@ -382,6 +529,70 @@ public:
 
    get_scheduled_transactions_result get_scheduled_transactions( const get_scheduled_transactions_params& params ) const;
 
+   struct get_accounts_by_authorizers_params {
+      vector<account_name>     accounts; ///< accounts to find the permissions controlled by
+      vector<public_key_type>  keys;     ///< keys to find the permissions controlled by
+   };
+
+   struct authorized_permission {
+      name                              account_name;
+      name                              permission_name;
+      optional<chain::permission_level> authorizing_account; ///< set if found by account
+      optional<public_key_type>         authorizing_key;     ///< set if found by key
+      chain::weight_type                weight = 0;
+      uint32_t                          threshold = 0;
+   };
+
+   struct get_accounts_by_authorizers_result {
+      vector<authorized_permission> accounts;
+   };
+
+   /// the permissions whose authority has one of the keys or a permission of one of the accounts, needs key-account-index
+   get_accounts_by_authorizers_result get_accounts_by_authorizers( const get_accounts_by_authorizers_params& params )const;
+
+   struct get_batch_query {
+      string       call;   ///< a read only call, e.g. "get_table_rows"
+      fc::variant  params; ///< the parameters of call
+   };
+
+   struct get_batch_params {
+      vector<get_batch_query> queries;
+   };
+
+   struct get_batch_result {
+      vector<fc::variant> results; ///< for each query, {"result": ...} or {"error": {"code", "name", "what", "message"}}
+   };
+
+   static constexpr uint32_t max_batch_queries = 100;
+
+   /**
+    * Runs the queries one after the other against the same chain state, each contract's ABI is
+    * unpacked and set up once for the batch. A failed query does not fail the others.
+    */
+   get_batch_result get_batch( const get_batch_params& params ) const;
+
+   /// the ABI of a contract, with its serializer once one is needed
+   struct contract_abi {
+      abi_def                  abi;
+      optional<abi_serializer> serializer;
+   };
+
+   std::shared_ptr<contract_abi> get_contract_abi( const name& account, bool with_serializer ) const;
+   const abi_serializer& get_abi_serializer( contract_abi& contract ) const;
+
+private:
+   /// the contract ABIs set up so far, while a get_batch runs
+   std::map<account_name, std::shared_ptr<contract_abi>>* abi_cache = nullptr;
+
+   /**
+    * Calls f with the tables of code with a scope from lower_scope to upper_scope until it returns false.
+    * With the table scope index and a table, those are the tables named table in scope order. Otherwise
+    * they are all the tables of code in scope and table order, and f skips the ones it does not want.
+    */
+   void walk_table_scopes( const name& code, const name& table, uint64_t lower_scope, uint64_t upper_scope, bool reverse,
+                           const std::function<bool( const chain::table_id_object& )>& f ) const;
+
+public:
    static void copy_inline_row(const chain::key_value_object& obj, vector<char>& data) {
       data.resize( obj.value.size() );
       memcpy( data.data(), obj.value.data(), obj.value.size() );
@@ -408,15 +619,46 @@ public:
 
    static uint64_t get_table_index_name(const read_only::get_table_rows_params& p, bool& primary);
 
+   static string encode_cursor( const table_rows_cursor& c );
+   /// the cursor of p, which must have been returned for a walk of the same index in the same direction
+   static table_rows_cursor decode_cursor( const read_only::get_table_rows_params& p, int64_t table_id, uint64_t index, bool reverse );
+
+   template<typename T>
+   static vector<char> key_to_bytes( const T& k ) {
+      vector<char> b( sizeof(T) );
+      memcpy( b.data(), &k, sizeof(T) );
+      return b;
+   }
+
+   template<typename T>
+   static T key_from_bytes( const vector<char>& b ) {
+      EOS_ASSERT( b.size() == sizeof(T), chain::contract_table_query_exception, "Invalid cursor key" );
+      T k;
+      memcpy( &k, b.data(), sizeof(T) );
+      return k;
+   }
+
+   static void append_binary_row( vector<char>& rows, uint64_t primary_key, name payer, const chain::shared_blob& value ) {
+      const auto pos = rows.size();
+      const fc::unsigned_int size( value.size() );
+      rows.resize( pos + sizeof(primary_key) + sizeof(payer) + fc::raw::pack_size( size ) + value.size() );
+      fc::datastream<char*> ds( rows.data() + pos, rows.size() - pos );
+      fc::raw::pack( ds, primary_key );
+      fc::raw::pack( ds, payer );
+      fc::raw::pack( ds, size );
+      ds.write( value.data(), value.size() );
+   }
+
    template <typename IndexType, typename SecKeyType, typename ConvFn>
-   read_only::get_table_rows_result get_table_rows_by_seckey( const read_only::get_table_rows_params& p, const abi_def& abi, ConvFn conv )const {
+   read_only::get_table_rows_result get_table_rows_by_seckey( const read_only::get_table_rows_params& p, const contract_abi& contract, ConvFn conv )const {
       read_only::get_table_rows_result result;
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer_max_time);
+      const bool binary = p.binary && *p.binary;
+      const bool reverse = p.reverse && *p.reverse;
+      const auto& abis = contract.serializer; // set up if json
       bool primary = false;
       const uint64_t table_with_index = get_table_index_name(p, primary);
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
@@ -458,18 +700,34 @@ public:
          if( upper_bound_lookup_tuple < lower_bound_lookup_tuple )
             return result;
 
+         optional<table_rows_cursor> cursor;
+         if( p.cursor && !p.cursor->empty() )
+            cursor = decode_cursor( p, index_t_id->id._id, table_with_index, reverse );
+
+         if( binary )
+            result.binary_rows.emplace();
+
          auto walk_table_row_range = [&]( auto itr, auto end_itr ) {
             auto cur_time = fc::time_point::now();
             auto end_time = cur_time + fc::microseconds(1000 * 10); /// 10ms max time
             vector<char> data;
+            const secondary_key_type* last_key = nullptr;
+            uint64_t last_primary_key = 0;
             for( unsigned int count = 0; cur_time <= end_time && count < p.limit && itr != end_itr; ++itr, cur_time = fc::time_point::now() ) {
+               last_key = &itr->secondary_key;
+               last_primary_key = itr->primary_key;
                const auto* itr2 = d.find<chain::key_value_object, chain::by_scope_primary>( boost::make_tuple(t_id->id, itr->primary_key) );
                if( itr2 == nullptr ) continue;
+               ++count;
+               if( binary ) {
+                  append_binary_row( *result.binary_rows, itr->primary_key, itr->payer, itr2->value );
+                  continue;
+               }
                copy_inline_row(*itr2, data);
 
                fc::variant data_var;
                if( p.json ) {
-                  data_var = abis.binary_to_variant( abis.get_table_type(p.table), data, abi_serializer_max_time, shorten_abi_errors );
+                  data_var = abis->binary_to_variant( abis->get_table_type(p.table), data, abi_serializer_max_time, shorten_abi_errors );
                } else {
                   data_var = fc::variant( data );
                }
@@ -479,17 +737,37 @@ public:
                } else {
                   result.rows.emplace_back( std::move(data_var) );
                }
-
-               ++count;
             }
             if( itr != end_itr ) {
                result.more = true;
+               if( last_key ) {
+                  result.next_cursor = encode_cursor( { index_t_id->id._id, table_with_index, reverse,
+                                                        last_primary_key, key_to_bytes( *last_key ) } );
+               } else {
+                  result.next_cursor = p.cursor;
+               }
             }
          };
 
          auto lower = secidx.lower_bound( lower_bound_lookup_tuple );
          auto upper = secidx.upper_bound( upper_bound_lookup_tuple );
-         if( p.reverse && *p.reverse ) {
+         if( cursor ) {
+            // continue strictly after the last row walked, within the bounds
+            auto cursor_tuple = std::make_tuple( index_t_id->id._id, key_from_bytes<secondary_key_type>( cursor->secondary_key ),
+                                                 cursor->primary_key );
+            if( reverse ) {
+               if( !(lower_bound_lookup_tuple < cursor_tuple) )
+                  return result;
+               if( !(upper_bound_lookup_tuple < cursor_tuple) )
+                  upper = secidx.lower_bound( cursor_tuple );
+            } else {
+               if( !(cursor_tuple < upper_bound_lookup_tuple) )
+                  return result;
+               if( !(cursor_tuple < lower_bound_lookup_tuple) )
+                  lower = secidx.upper_bound( cursor_tuple );
+            }
+         }
+         if( reverse ) {
             walk_table_row_range( boost::make_reverse_iterator(upper), boost::make_reverse_iterator(lower) );
          } else {
             walk_table_row_range( lower, upper );
@@ -499,14 +777,15 @@ public:
    }
 
    template <typename IndexType>
-   read_only::get_table_rows_result get_table_rows_ex( const read_only::get_table_rows_params& p, const abi_def& abi )const {
+   read_only::get_table_rows_result get_table_rows_ex( const read_only::get_table_rows_params& p, const contract_abi& contract )const {
       read_only::get_table_rows_result result;
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer_max_time);
+      const bool binary = p.binary && *p.binary;
+      const bool reverse = p.reverse && *p.reverse;
+      const auto& abis = contract.serializer; // set up if json
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
       if( t_id != nullptr ) {
          const auto& idx = d.get_index<IndexType, chain::by_scope_primary>();
@@ -533,19 +812,42 @@ public:
             }
          }
 
+         if( p.cursor && !p.cursor->empty() ) {
+            // continue strictly after the last row walked, within the bounds
+            const auto cursor = decode_cursor( p, t_id->id._id, p.table.value, reverse );
+            if( reverse ) {
+               if( cursor.primary_key == std::numeric_limits<uint64_t>::lowest() )
+                  return result;
+               std::get<1>(upper_bound_lookup_tuple) = std::min<uint64_t>( std::get<1>(upper_bound_lookup_tuple), cursor.primary_key - 1 );
+            } else {
+               if( cursor.primary_key == std::numeric_limits<uint64_t>::max() )
+                  return result;
+               std::get<1>(lower_bound_lookup_tuple) = std::max<uint64_t>( std::get<1>(lower_bound_lookup_tuple), cursor.primary_key + 1 );
+            }
+         }
+
          if( upper_bound_lookup_tuple < lower_bound_lookup_tuple  )
             return result;
 
+         if( binary )
+            result.binary_rows.emplace();
+
          auto walk_table_row_range = [&]( auto itr, auto end_itr ) {
             auto cur_time = fc::time_point::now();
             auto end_time = cur_time + fc::microseconds(1000 * 10); /// 10ms max time
             vector<char> data;
+            optional<uint64_t> last_primary_key;
             for( unsigned int count = 0; cur_time <= end_time && count < p.limit && itr != end_itr; ++count, ++itr, cur_time = fc::time_point::now() ) {
+               last_primary_key = itr->primary_key;
+               if( binary ) {
+                  append_binary_row( *result.binary_rows, itr->primary_key, itr->payer, itr->value );
+                  continue;
+               }
                copy_inline_row(*itr, data);
 
                fc::variant data_var;
                if( p.json ) {
-                  data_var = abis.binary_to_variant( abis.get_table_type(p.table), data, abi_serializer_max_time, shorten_abi_errors );
+                  data_var = abis->binary_to_variant( abis->get_table_type(p.table), data, abi_serializer_max_time, shorten_abi_errors );
                } else {
                   data_var = fc::variant( data );
                }
@@ -558,12 +860,17 @@ public:
             }
             if( itr != end_itr ) {
                result.more = true;
+               if( last_primary_key ) {
+                  result.next_cursor = encode_cursor( { t_id->id._id, p.table.value, reverse, *last_primary_key, {} } );
+               } else {
+                  result.next_cursor = p.cursor;
+               }
             }
          };
 
          auto lower = idx.lower_bound( lower_bound_lookup_tuple );
          auto upper = idx.upper_bound( upper_bound_lookup_tuple );
-         if( p.reverse && *p.reverse ) {
+         if( reverse ) {
             walk_table_row_range( boost::make_reverse_iterator(upper), boost::make_reverse_iterator(lower) );
          } else {
             walk_table_row_range( lower, upper );
@@ -683,7 +990,7 @@ public:
    void plugin_startup();
    void plugin_shutdown();
 
-   chain_apis::read_only get_read_only_api() const { return chain_apis::read_only(chain(), get_abi_serializer_max_time()); }
+   chain_apis::read_only get_read_only_api() const;
    chain_apis::read_write get_read_write_api() { return chain_apis::read_write(chain(), get_abi_serializer_max_time()); }
 
    void accept_block( const chain::signed_block_ptr& block );
@@ -714,6 +1021,8 @@ public:
 
    chain::chain_id_type get_chain_id() const;
    fc::microseconds get_abi_serializer_max_time() const;
+   /// the transaction id to block number index, nullptr unless trx-block-index is enabled
+   const chain::trx_block_index* get_trx_block_index() const;
 
    void handle_guard_exception(const chain::guard_exception& e) const;
 
@@ -732,17 +1041,21 @@ FC_REFLECT(eosio::chain_apis::read_only::get_info_results,
 (server_version)(chain_id)(head_block_num)(last_irreversible_block_num)(last_irreversible_block_id)(head_block_id)(head_block_time)(head_block_producer)(virtual_block_cpu_limit)(virtual_block_net_limit)(block_cpu_limit)(block_net_limit)(server_version_string)(fork_db_head_block_num)(fork_db_head_block_id) )
 FC_REFLECT(eosio::chain_apis::read_only::get_activated_protocol_features_params, (lower_bound)(upper_bound)(limit)(search_by_block_num)(reverse) )
 FC_REFLECT(eosio::chain_apis::read_only::get_activated_protocol_features_results, (activated_protocol_features)(more) )
-FC_REFLECT(eosio::chain_apis::read_only::get_block_params, (block_num_or_id))
+FC_REFLECT(eosio::chain_apis::read_only::get_block_params, (block_num_or_id)(fields))
 FC_REFLECT(eosio::chain_apis::read_only::get_block_header_state_params, (block_num_or_id))
 
 FC_REFLECT( eosio::chain_apis::read_write::push_transaction_results, (transaction_id)(processed) )
 
-FC_REFLECT( eosio::chain_apis::read_only::get_table_rows_params, (json)(code)(scope)(table)(table_key)(lower_bound)(upper_bound)(limit)(key_type)(index_position)(encode_type)(reverse)(show_payer) )
-FC_REFLECT( eosio::chain_apis::read_only::get_table_rows_result, (rows)(more) );
+FC_REFLECT( eosio::chain_apis::read_only::get_table_rows_params, (json)(code)(scope)(table)(table_key)(lower_bound)(upper_bound)(limit)(key_type)(index_position)(encode_type)(reverse)(show_payer)(cursor)(binary) )
+FC_REFLECT( eosio::chain_apis::read_only::get_table_rows_result, (rows)(more)(next_cursor)(binary_rows) );
+FC_REFLECT( eosio::chain_apis::read_only::table_rows_cursor, (table_id)(index)(reverse)(primary_key)(secondary_key) );
 
 FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_params, (code)(table)(lower_bound)(upper_bound)(limit)(reverse) )
 FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_result_row, (code)(scope)(table)(payer)(count));
 FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_result, (rows)(more) );
+FC_REFLECT( eosio::chain_apis::read_only::export_table_rows_params, (code)(table)(scope)(format)(max_bytes)(cursor) )
+FC_REFLECT( eosio::chain_apis::read_only::export_table_rows_result, (head_block_num)(row_count)(binary_rows)(ndjson)(next_cursor) )
+FC_REFLECT( eosio::chain_apis::read_only::export_table_rows_cursor, (scope)(primary_key) )
 
 FC_REFLECT( eosio::chain_apis::read_only::get_currency_balance_params, (code)(account)(symbol));
 FC_REFLECT( eosio::chain_apis::read_only::get_currency_stats_params, (code)(symbol));
@@ -766,9 +1079,9 @@ FC_REFLECT( eosio::chain_apis::read_only::get_code_results, (account_name)(code_
 FC_REFLECT( eosio::chain_apis::read_only::get_code_hash_results, (account_name)(code_hash) )
 FC_REFLECT( eosio::chain_apis::read_only::get_abi_results, (account_name)(abi) )
 FC_REFLECT( eosio::chain_apis::read_only::get_account_params, (account_name)(expected_core_symbol) )
-FC_REFLECT( eosio::chain_apis::read_only::get_code_params, (account_name)(code_as_wasm) )
+FC_REFLECT( eosio::chain_apis::read_only::get_code_params, (account_name)(code_as_wasm)(code_hash)(abi_hash) )
 FC_REFLECT( eosio::chain_apis::read_only::get_code_hash_params, (account_name) )
-FC_REFLECT( eosio::chain_apis::read_only::get_abi_params, (account_name) )
+FC_REFLECT( eosio::chain_apis::read_only::get_abi_params, (account_name)(abi_hash) )
 FC_REFLECT( eosio::chain_apis::read_only::get_raw_code_and_abi_params, (account_name) )
 FC_REFLECT( eosio::chain_apis::read_only::get_raw_code_and_abi_results, (account_name)(wasm)(abi) )
 FC_REFLECT( eosio::chain_apis::read_only::get_raw_abi_params, (account_name)(abi_hash) )
@@ -780,3 +1093,11 @@ FC_REFLECT( eosio::chain_apis::read_only::abi_bin_to_json_params, (code)(action)
 FC_REFLECT( eosio::chain_apis::read_only::abi_bin_to_json_result, (args) )
 FC_REFLECT( eosio::chain_apis::read_only::get_required_keys_params, (transaction)(available_keys) )
 FC_REFLECT( eosio::chain_apis::read_only::get_required_keys_result, (required_keys) )
+FC_REFLECT( eosio::chain_apis::read_only::get_accounts_by_authorizers_params, (accounts)(keys) )
+FC_REFLECT( eosio::chain_apis::read_only::authorized_permission,
+            (account_name)(permission_name)(authorizing_account)(authorizing_key)(weight)(threshold) )
+FC_REFLECT( eosio::chain_apis::read_only::get_accounts_by_authorizers_result, (accounts) )
+FC_REFLECT( eosio::chain_apis::read_only::get_accounts_params, (account_names)(expected_core_symbol) )
+FC_REFLECT( eosio::chain_apis::read_only::get_batch_query, (call)(params) )
+FC_REFLECT( eosio::chain_apis::read_only::get_batch_params, (queries) )
+FC_REFLECT( eosio::chain_apis::read_only::get_batch_result, (results) )
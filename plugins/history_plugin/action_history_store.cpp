@@ -0,0 +1,441 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/history_plugin/action_history_store.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/log/logger.hpp>
+
+#include <limits>
+#include <set>
+
+namespace eosio {
+   using namespace chain;
+   namespace bfs = boost::filesystem;
+
+   namespace {
+      const char* const log_file_name        = "actions.log";
+      const char* const reversible_file_name = "reversible.bin";
+
+      constexpr size_t record_overhead = sizeof(uint32_t) + sizeof(uint64_t); ///< size before, position after each entry
+
+      bool has_account( const action_history_store::action& a, account_name account ) {
+         return std::find( a.accounts.begin(), a.accounts.end(), account ) != a.accounts.end();
+      }
+
+      int compare_ids( const transaction_id_type& a, const transaction_id_type& b ) {
+         return memcmp( a.data(), b.data(), a.data_size() );
+      }
+   }
+
+   action_history_store::action_history_store( const bfs::path& dir )
+   : _dir( dir ) {
+      bfs::create_directories( _dir );
+      _account_index = std::make_unique<account_index>( _dir, "accounts" );
+      _trx_index     = std::make_unique<trx_index>( _dir, "transactions" );
+      open_log();
+      load_reversible();
+      _writer.emplace( "hist", 1 );
+   }
+
+   action_history_store::~action_history_store() {
+      try {
+         close();
+      } FC_LOG_AND_DROP()
+   }
+
+   action_history_store::trx_index_entry action_history_store::make_trx_key( const transaction_id_type& id, uint64_t global_sequence ) {
+      trx_index_entry e;
+      memcpy( e.trx_id, id.data(), sizeof(e.trx_id) );
+      e.global_sequence = global_sequence;
+      return e;
+   }
+
+   void action_history_store::open_log() {
+      const auto log_path = _dir / log_file_name;
+      if( !bfs::exists( log_path ) ) {
+         _created = true;
+         std::ofstream create( log_path.generic_string(), std::ios::out | std::ios::binary );
+      }
+      uint64_t size = bfs::file_size( log_path );
+
+      // entries past what both indices have in runs were only in memory, index them again
+      const uint64_t account_covered = _account_index->covered_position();
+      const uint64_t trx_covered     = _trx_index->covered_position();
+      uint64_t pos = std::min( account_covered, trx_covered );
+      EOS_ASSERT( std::max( account_covered, trx_covered ) <= size, plugin_exception,
+                  "${f} is shorter than its indices, remove ${d} to rebuild the history",
+                  ("f", log_path.generic_string())("d", _dir.generic_string()) );
+      {
+         std::ifstream in( log_path.generic_string(), std::ios::in | std::ios::binary );
+         while( pos < size ) {
+            uint32_t entry_size = 0;
+            if( size - pos < record_overhead ) break;
+            in.seekg( pos );
+            in.read( reinterpret_cast<char*>( &entry_size ), sizeof(entry_size) );
+            if( !in || size - pos - record_overhead < entry_size ) break;
+
+            std::vector<char> buf( entry_size );
+            uint64_t trailer = 0;
+            in.read( buf.data(), buf.size() );
+            in.read( reinterpret_cast<char*>( &trailer ), sizeof(trailer) );
+            if( !in || trailer != pos ) break;
+
+            action_log_entry e;
+            try {
+               fc::datastream<const char*> ds( buf.data(), buf.size() );
+               fc::raw::unpack( ds, e );
+            } catch( ... ) {
+               break;
+            }
+            for( const auto& a : e.account_sequences ) {
+               if( pos >= account_covered ) _account_index->insert( { a.account.value, a.sequence, 0, pos } );
+            }
+            if( pos >= trx_covered ) {
+               auto key = make_trx_key( e.trx_id, e.global_sequence );
+               key.position = pos;
+               _trx_index->insert( key );
+            }
+            pos += record_overhead + entry_size;
+            _account_index->set_covered_position( pos );
+            _trx_index->set_covered_position( pos );
+            _account_index->flush_if_full();
+            _trx_index->flush_if_full();
+         }
+      }
+      if( pos < size ) {
+         wlog( "truncating ${f} from ${s} to ${p} bytes, removing an incomplete entry",
+               ("f", log_path.generic_string())("s", size)("p", pos) );
+         bfs::resize_file( log_path, pos );
+         size = pos;
+      }
+      _account_index->set_covered_position( size );
+      _trx_index->set_covered_position( size );
+
+      _log.exceptions( std::fstream::failbit | std::fstream::badbit );
+      _log.open( log_path.generic_string(), std::ios::out | std::ios::binary | std::ios::app );
+      _log_reader.exceptions( std::fstream::failbit | std::fstream::badbit );
+      _log_reader.open( log_path.generic_string(), std::ios::in | std::ios::binary );
+
+      if( size > 0 ) {
+         uint64_t last_pos = 0;
+         _log_reader.seekg( size - sizeof(last_pos) );
+         _log_reader.read( reinterpret_cast<char*>( &last_pos ), sizeof(last_pos) );
+         _last_committed_block = read_entry( last_pos ).block_num;
+      }
+   }
+
+   void action_history_store::load_reversible() {
+      const auto path = _dir / reversible_file_name;
+      if( !bfs::exists( path ) ) return;
+
+      std::vector<char> buf( bfs::file_size( path ) );
+      {
+         std::ifstream in( path.generic_string(), std::ios::in | std::ios::binary );
+         in.read( buf.data(), buf.size() );
+         EOS_ASSERT( in, plugin_exception, "unable to read ${f}", ("f", path.generic_string()) );
+      }
+      uint32_t last_committed_block = 0;
+      std::vector<block> blocks;
+      fc::datastream<const char*> ds( buf.data(), buf.size() );
+      fc::raw::unpack( ds, last_committed_block );
+      fc::raw::unpack( ds, blocks );
+
+      // the log only knows the last block with a recorded action
+      _last_committed_block = std::max( _last_committed_block, last_committed_block );
+      for( auto& b : blocks ) {
+         if( b.block_num > _last_committed_block ) _reversible.push_back( std::move( b ) );
+      }
+      // a crash before the next close must not bring back blocks that were since forked out
+      bfs::remove( path );
+   }
+
+   void action_history_store::save_reversible() {
+      const auto path = _dir / reversible_file_name;
+      auto tmp = path;
+      tmp += ".tmp";
+      {
+         std::lock_guard<std::mutex> g( _mtx );
+         const std::vector<block> blocks( _reversible.begin(), _reversible.end() );
+         std::ofstream out;
+         out.exceptions( std::fstream::failbit | std::fstream::badbit );
+         out.open( tmp.generic_string(), std::ios::out | std::ios::binary | std::ios::trunc );
+         const auto last_committed_block = fc::raw::pack( _last_committed_block );
+         const auto data = fc::raw::pack( blocks );
+         out.write( last_committed_block.data(), last_committed_block.size() );
+         out.write( data.data(), data.size() );
+      }
+      bfs::rename( tmp, path );
+   }
+
+   void action_history_store::add_block( block b ) {
+      std::lock_guard<std::mutex> g( _mtx );
+      if( b.block_num <= _last_committed_block ) return; // replayed
+      while( !_reversible.empty() && _reversible.back().block_num >= b.block_num ) {
+         _reversible.pop_back();
+      }
+      _reversible.push_back( std::move( b ) );
+   }
+
+   void action_history_store::commit( uint32_t irreversible_block_num ) {
+      std::lock_guard<std::mutex> g( _mtx );
+      while( !_reversible.empty() && _reversible.front().block_num <= irreversible_block_num ) {
+         auto& b = _reversible.front();
+         for( auto& a : b.actions ) {
+            auto e = std::make_shared<action_log_entry>();
+            e->global_sequence = a.global_sequence;
+            e->block_num       = b.block_num;
+            e->block_time      = b.block_time;
+            e->trx_id          = a.trx_id;
+            e->packed_action_trace = std::move( a.packed_action_trace );
+            for( auto account : a.accounts ) {
+               auto itr = _next_sequence.find( account );
+               if( itr == _next_sequence.end() ) {
+                  itr = _next_sequence.emplace( account, next_committed_sequence( account ) ).first;
+               }
+               e->account_sequences.push_back( { account, itr->second++ } );
+            }
+            _unwritten.push_back( std::move( e ) );
+         }
+         _last_committed_block = b.block_num;
+         _reversible.pop_front();
+      }
+      _last_committed_block = std::max( _last_committed_block, irreversible_block_num );
+      schedule_write();
+   }
+
+   void action_history_store::close() {
+      if( !_writer ) return;
+      _writer->stop();
+      _writer.reset();
+      {
+         std::lock_guard<std::mutex> g( _mtx );
+         _writing = true;
+      }
+      write_unwritten();
+      _account_index->flush();
+      _trx_index->flush();
+      save_reversible();
+      std::lock_guard<std::mutex> g( _log_mtx );
+      _log.close();
+      _log_reader.close();
+   }
+
+   void action_history_store::schedule_write() {
+      if( _writing || _unwritten.empty() || !_writer ) return;
+      _writing = true;
+      boost::asio::post( _writer->get_executor(), [this]() {
+         try {
+            write_unwritten();
+         } FC_LOG_AND_DROP()
+      } );
+   }
+
+   void action_history_store::write_unwritten() {
+      while( true ) {
+         std::vector<entry_ptr> batch;
+         {
+            std::lock_guard<std::mutex> g( _mtx );
+            if( _unwritten.empty() ) {
+               _writing = false;
+               return;
+            }
+            batch.assign( _unwritten.begin(), _unwritten.end() );
+         }
+
+         std::vector<uint64_t> positions;
+         uint64_t end = 0;
+         {
+            std::lock_guard<std::mutex> g( _log_mtx );
+            for( const auto& e : batch ) {
+               positions.push_back( append_entry( *e ) );
+            }
+            _log.flush();
+            end = _log.tellp();
+         }
+         // the log is written before it is indexed, so an index never points past the end of the log
+         for( size_t i = 0; i < batch.size(); ++i ) {
+            index_entry( *batch[i], positions[i] );
+         }
+         _account_index->set_covered_position( end );
+         _trx_index->set_covered_position( end );
+         _account_index->flush_if_full();
+         _trx_index->flush_if_full();
+
+         std::lock_guard<std::mutex> g( _mtx );
+         _unwritten.erase( _unwritten.begin(), _unwritten.begin() + batch.size() );
+         if( _next_sequence.size() > max_cached_sequences ) trim_next_sequence();
+      }
+   }
+
+   void action_history_store::trim_next_sequence() {
+      // the sequence of an account without unwritten actions is found again in the account index
+      std::set<account_name> unwritten;
+      for( const auto& e : _unwritten ) {
+         for( const auto& a : e->account_sequences ) unwritten.insert( a.account );
+      }
+      for( auto itr = _next_sequence.begin(); itr != _next_sequence.end(); ) {
+         if( unwritten.count( itr->first ) ) ++itr;
+         else itr = _next_sequence.erase( itr );
+      }
+   }
+
+   uint64_t action_history_store::append_entry( const action_log_entry& e ) {
+      const uint64_t pos = _log.tellp();
+      const auto data = fc::raw::pack( e );
+      EOS_ASSERT( data.size() <= std::numeric_limits<uint32_t>::max(), plugin_exception, "history entry too large" );
+      const uint32_t size = data.size();
+      _log.write( reinterpret_cast<const char*>( &size ), sizeof(size) );
+      _log.write( data.data(), data.size() );
+      _log.write( reinterpret_cast<const char*>( &pos ), sizeof(pos) );
+      return pos;
+   }
+
+   void action_history_store::index_entry( const action_log_entry& e, uint64_t position ) {
+      for( const auto& a : e.account_sequences ) {
+         _account_index->insert( { a.account.value, a.sequence, 0, position } );
+      }
+      auto key = make_trx_key( e.trx_id, e.global_sequence );
+      key.position = position;
+      _trx_index->insert( key );
+   }
+
+   action_history_store::action_log_entry action_history_store::read_entry( uint64_t position ) const {
+      std::vector<char> buf;
+      {
+         std::lock_guard<std::mutex> g( _log_mtx );
+         uint32_t size = 0;
+         _log_reader.clear();
+         _log_reader.seekg( position );
+         _log_reader.read( reinterpret_cast<char*>( &size ), sizeof(size) );
+         buf.resize( size );
+         _log_reader.read( buf.data(), buf.size() );
+      }
+      action_log_entry e;
+      fc::datastream<const char*> ds( buf.data(), buf.size() );
+      fc::raw::unpack( ds, e );
+      return e;
+   }
+
+   int32_t action_history_store::next_committed_sequence( account_name account ) const {
+      auto itr = _next_sequence.find( account );
+      if( itr != _next_sequence.end() ) return itr->second;
+      // no unwritten actions, so everything about it is in the account index
+      account_index_entry key{ account.value, std::numeric_limits<int32_t>::max(), 0, 0 };
+      auto last = _account_index->last_at_or_below( key );
+      return last && last->account == account.value ? last->sequence + 1 : 0;
+   }
+
+   uint32_t action_history_store::last_committed_block() const {
+      std::lock_guard<std::mutex> g( _mtx );
+      return _last_committed_block;
+   }
+
+   fc::optional<int32_t> action_history_store::last_account_sequence( account_name account ) const {
+      std::lock_guard<std::mutex> g( _mtx );
+      int32_t next = next_committed_sequence( account );
+      for( const auto& b : _reversible ) {
+         for( const auto& a : b.actions ) {
+            if( has_account( a, account ) ) ++next;
+         }
+      }
+      if( next == 0 ) return {};
+      return next - 1;
+   }
+
+   std::vector<action_history_store::stored_action>
+   action_history_store::get_account_actions( account_name account, int32_t first, int32_t last, size_t max_actions ) const {
+      std::map<int32_t, stored_action> found;
+      auto add = [&]( const action_log_entry& e, int32_t sequence ) {
+         found.emplace( sequence, stored_action{ e.global_sequence, sequence, e.block_num, e.block_time, e.trx_id, e.packed_action_trace } );
+      };
+
+      // memory first: an entry leaves _unwritten only after it is indexed on disk
+      {
+         std::lock_guard<std::mutex> g( _mtx );
+         for( const auto& e : _unwritten ) {
+            for( const auto& a : e->account_sequences ) {
+               if( a.account == account && a.sequence >= first && a.sequence <= last ) add( *e, a.sequence );
+            }
+         }
+         int32_t sequence = next_committed_sequence( account );
+         for( const auto& b : _reversible ) {
+            for( const auto& a : b.actions ) {
+               if( !has_account( a, account ) ) continue;
+               if( sequence >= first && sequence <= last ) {
+                  found.emplace( sequence, stored_action{ a.global_sequence, sequence, b.block_num, b.block_time, a.trx_id, a.packed_action_trace } );
+               }
+               ++sequence;
+            }
+         }
+      }
+
+      const auto on_disk = _account_index->range( { account.value, first, 0, 0 }, { account.value, last, 0, 0 }, max_actions );
+      for( const auto& i : on_disk ) {
+         if( found.count( i.sequence ) ) continue;
+         add( read_entry( i.position ), i.sequence );
+      }
+
+      std::vector<stored_action> result;
+      for( auto& f : found ) {
+         if( result.size() == max_actions ) break;
+         result.push_back( std::move( f.second ) );
+      }
+      return result;
+   }
+
+   fc::optional<transaction_id_type> action_history_store::first_transaction_at_or_above( const transaction_id_type& id ) const {
+      fc::optional<transaction_id_type> result;
+      auto consider = [&]( const transaction_id_type& candidate ) {
+         if( compare_ids( candidate, id ) >= 0 && (!result || compare_ids( candidate, *result ) < 0) ) result = candidate;
+      };
+      {
+         std::lock_guard<std::mutex> g( _mtx );
+         for( const auto& e : _unwritten ) consider( e->trx_id );
+         for( const auto& b : _reversible ) {
+            for( const auto& a : b.actions ) consider( a.trx_id );
+         }
+      }
+      auto on_disk = _trx_index->first_at_or_above( make_trx_key( id, 0 ) );
+      if( on_disk ) {
+         transaction_id_type disk_id;
+         memcpy( disk_id.data(), on_disk->trx_id, sizeof(on_disk->trx_id) );
+         consider( disk_id );
+      }
+      return result;
+   }
+
+   std::vector<action_history_store::stored_action> action_history_store::get_transaction_actions( const transaction_id_type& id ) const {
+      std::map<uint64_t, stored_action> found;
+      {
+         std::lock_guard<std::mutex> g( _mtx );
+         for( const auto& e : _unwritten ) {
+            if( e->trx_id == id ) {
+               found.emplace( e->global_sequence, stored_action{ e->global_sequence, 0, e->block_num, e->block_time, e->trx_id, e->packed_action_trace } );
+            }
+         }
+         for( const auto& b : _reversible ) {
+            for( const auto& a : b.actions ) {
+               if( a.trx_id == id ) {
+                  found.emplace( a.global_sequence, stored_action{ a.global_sequence, 0, b.block_num, b.block_time, a.trx_id, a.packed_action_trace } );
+               }
+            }
+         }
+      }
+
+      const auto on_disk = _trx_index->range( make_trx_key( id, 0 ), make_trx_key( id, std::numeric_limits<uint64_t>::max() ),
+                                              std::numeric_limits<size_t>::max() );
+      for( const auto& i : on_disk ) {
+         if( found.count( i.global_sequence ) ) continue;
+         const auto e = read_entry( i.position );
+         found.emplace( e.global_sequence, stored_action{ e.global_sequence, 0, e.block_num, e.block_time, e.trx_id, e.packed_action_trace } );
+      }
+
+      std::vector<stored_action> result;
+      for( auto& f : found ) result.push_back( std::move( f.second ) );
+      return result;
+   }
+
+} // namespace eosio
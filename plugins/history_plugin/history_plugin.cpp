@@ -1,8 +1,11 @@
 #include <eosio/history_plugin/history_plugin.hpp>
+#include <eosio/history_plugin/action_history_store.hpp>
+#include <eosio/history_plugin/filter_matcher.hpp>
 #include <eosio/history_plugin/account_control_history_object.hpp>
 #include <eosio/history_plugin/public_key_history_object.hpp>
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/trace.hpp>
+#include <eosio/chain/trx_block_index.hpp>
 #include <eosio/chain_plugin/chain_plugin.hpp>
 
 #include <fc/io/json.hpp>
@@ -16,70 +19,6 @@ namespace eosio {
 
    static appbase::abstract_plugin& _history_plugin = app().register_plugin<history_plugin>();
 
-
-   struct account_history_object : public chainbase::object<account_history_object_type, account_history_object>  {
-      OBJECT_CTOR( account_history_object );
-
-      id_type      id;
-      account_name account; ///< the name of the account which has this action in its history
-      uint64_t     action_sequence_num = 0; ///< the sequence number of the relevant action (global)
-      int32_t      account_sequence_num = 0; ///< the sequence number for this account (per-account)
-   };
-
-   struct action_history_object : public chainbase::object<action_history_object_type, action_history_object> {
-
-      OBJECT_CTOR( action_history_object, (packed_action_trace) );
-
-      id_type      id;
-      uint64_t     action_sequence_num; ///< the sequence number of the relevant action
-
-      shared_string        packed_action_trace;
-      uint32_t             block_num;
-      block_timestamp_type block_time;
-      transaction_id_type  trx_id;
-   };
-   using account_history_id_type = account_history_object::id_type;
-   using action_history_id_type  = action_history_object::id_type;
-
-
-   struct by_action_sequence_num;
-   struct by_account_action_seq;
-   struct by_trx_id;
-
-   using action_history_index = chainbase::shared_multi_index_container<
-      action_history_object,
-      indexed_by<
-         ordered_unique<tag<by_id>, member<action_history_object, action_history_object::id_type, &action_history_object::id>>,
-         ordered_unique<tag<by_action_sequence_num>, member<action_history_object, uint64_t, &action_history_object::action_sequence_num>>,
-         ordered_unique<tag<by_trx_id>,
-            composite_key< action_history_object,
-               member<action_history_object, transaction_id_type, &action_history_object::trx_id>,
-               member<action_history_object, uint64_t, &action_history_object::action_sequence_num >
-            >
-         >
-      >
-   >;
-
-   using account_history_index = chainbase::shared_multi_index_container<
-      account_history_object,
-      indexed_by<
-         ordered_unique<tag<by_id>, member<account_history_object, account_history_object::id_type, &account_history_object::id>>,
-         ordered_unique<tag<by_account_action_seq>,
-            composite_key< account_history_object,
-               member<account_history_object, account_name, &account_history_object::account >,
-               member<account_history_object, int32_t, &account_history_object::account_sequence_num >
-            >
-         >
-      >
-   >;
-
-} /// namespace eosio
-
-CHAINBASE_SET_INDEX_TYPE(eosio::account_history_object, eosio::account_history_index)
-CHAINBASE_SET_INDEX_TYPE(eosio::action_history_object, eosio::action_history_index)
-
-namespace eosio {
-
    template<typename MultiIndex, typename LookupType>
    static void remove(chainbase::database& db, const account_name& account_name, const permission_name& permission)
    {
@@ -121,107 +60,20 @@ namespace eosio {
       }
    }
 
-   struct filter_entry {
-      name receiver;
-      name action;
-      name actor;
-
-      std::tuple<name, name, name> key() const {
-         return std::make_tuple(receiver, action, actor);
-      }
-
-      friend bool operator<( const filter_entry& a, const filter_entry& b ) {
-         return a.key() < b.key();
-      }
-   };
-
    class history_plugin_impl {
       public:
          bool bypass_filter = false;
          std::set<filter_entry> filter_on;
          std::set<filter_entry> filter_out;
+         filter_matcher         matcher; ///< compiled from the filters above
          chain_plugin*          chain_plug = nullptr;
+         bfs::path              history_dir;
+         fc::optional<action_history_store> store;
+         std::map<transaction_id_type, vector<action_history_store::action>> cached_actions; ///< of the block being applied
+         vector<action_history_store::action> onblock_actions;
          fc::optional<scoped_connection> applied_transaction_connection;
-
-          bool filter(const action_trace& act) {
-            bool pass_on = false;
-            if (bypass_filter) {
-              pass_on = true;
-            }
-            if (filter_on.find({ act.receiver, 0, 0 }) != filter_on.end()) {
-              pass_on = true;
-            }
-            if (filter_on.find({ act.receiver, act.act.name, 0 }) != filter_on.end()) {
-              pass_on = true;
-            }
-            for (const auto& a : act.act.authorization) {
-              if (filter_on.find({ act.receiver, 0, a.actor }) != filter_on.end()) {
-                pass_on = true;
-              }
-              if (filter_on.find({ act.receiver, act.act.name, a.actor }) != filter_on.end()) {
-                pass_on = true;
-              }
-            }
-
-            if (!pass_on) {  return false;  }
-
-            if (filter_out.find({ act.receiver, 0, 0 }) != filter_out.end()) {
-              return false;
-            }
-            if (filter_out.find({ act.receiver, act.act.name, 0 }) != filter_out.end()) {
-              return false;
-            }
-            for (const auto& a : act.act.authorization) {
-              if (filter_out.find({ act.receiver, 0, a.actor }) != filter_out.end()) {
-                return false;
-              }
-              if (filter_out.find({ act.receiver, act.act.name, a.actor }) != filter_out.end()) {
-                return false;
-              }
-            }
-
-            return true;
-          }
-
-         set<account_name> account_set( const action_trace& act ) {
-            set<account_name> result;
-
-            result.insert( act.receiver );
-            for( const auto& a : act.act.authorization ) {
-               if( bypass_filter ||
-                   filter_on.find({ act.receiver, 0, 0}) != filter_on.end() ||
-                   filter_on.find({ act.receiver, 0, a.actor}) != filter_on.end() ||
-                   filter_on.find({ act.receiver, act.act.name, 0}) != filter_on.end() ||
-                   filter_on.find({ act.receiver, act.act.name, a.actor }) != filter_on.end() ) {
-                 if ((filter_out.find({ act.receiver, 0, 0 }) == filter_out.end()) &&
-                     (filter_out.find({ act.receiver, 0, a.actor }) == filter_out.end()) &&
-                     (filter_out.find({ act.receiver, act.act.name, 0 }) == filter_out.end()) &&
-                     (filter_out.find({ act.receiver, act.act.name, a.actor }) == filter_out.end())) {
-                   result.insert( a.actor );
-                 }
-               }
-            }
-            return result;
-         }
-
-         void record_account_action( account_name n, const action_trace& act ) {
-            auto& chain = chain_plug->chain();
-            chainbase::database& db = const_cast<chainbase::database&>( chain.db() ); // Override read-only access to state DB (highly unrecommended practice!)
-
-            const auto& idx = db.get_index<account_history_index, by_account_action_seq>();
-            auto itr = idx.lower_bound( boost::make_tuple( name(n.value+1), 0 ) );
-
-            uint64_t asn = 0;
-            if( itr != idx.begin() ) --itr;
-            if( itr->account == n )
-               asn = itr->account_sequence_num + 1;
-
-            const auto& a = db.create<account_history_object>( [&]( auto& aho ) {
-              aho.account = n;
-              aho.action_sequence_num = act.receipt->global_sequence;
-              aho.account_sequence_num = asn;
-            });
-         }
+         fc::optional<scoped_connection> accepted_block_connection;
+         fc::optional<scoped_connection> irreversible_block_connection;
 
          void on_system_action( const action_trace& at ) {
             auto& chain = chain_plug->chain();
@@ -250,41 +102,60 @@ namespace eosio {
             }
          }
 
-         void on_action_trace( const action_trace& at ) {
-            if( filter( at ) ) {
+         void on_action_trace( const action_trace& at, vector<action_history_store::action>& actions ) {
+            vector<account_name> accounts;
+            if( matcher.match( at, accounts ) ) {
                //idump((fc::json::to_pretty_string(at)));
-               auto& chain = chain_plug->chain();
-               chainbase::database& db = const_cast<chainbase::database&>( chain.db() ); // Override read-only access to state DB (highly unrecommended practice!)
-
-               db.create<action_history_object>( [&]( auto& aho ) {
-                  auto ps = fc::raw::pack_size( at );
-                  aho.packed_action_trace.resize(ps);
-                  datastream<char*> ds( aho.packed_action_trace.data(), ps );
-                  fc::raw::pack( ds, at );
-                  aho.action_sequence_num = at.receipt->global_sequence;
-                  aho.block_num = chain.head_block_num() + 1;
-                  aho.block_time = chain.pending_block_time();
-                  aho.trx_id     = at.trx_id;
-               });
-
-               auto aset = account_set( at );
-               for( auto a : aset ) {
-                  record_account_action( a, at );
-               }
+               actions.push_back( action_history_store::action{ at.receipt->global_sequence, at.trx_id,
+                                                                std::move( accounts ), fc::raw::pack( at ) } );
             }
             if( at.receiver == chain::config::system_account_name )
                on_system_action( at );
          }
 
+         static bool is_onblock( const transaction_trace_ptr& p ) {
+            if( p->action_traces.size() != 1 )
+               return false;
+            const auto& act = p->action_traces[0].act;
+            if( act.account != chain::config::system_account_name || act.name != N(onblock) ||
+                act.authorization.size() != 1 )
+               return false;
+            const auto& auth = act.authorization[0];
+            return auth.actor == chain::config::system_account_name &&
+                   auth.permission == chain::config::active_name;
+         }
+
          void on_applied_transaction( const transaction_trace_ptr& trace ) {
             if( !trace->receipt || (trace->receipt->status != transaction_receipt_header::executed &&
                   trace->receipt->status != transaction_receipt_header::soft_fail) )
                return;
+            // kept until the block is accepted, a transaction applied again replaces its earlier actions
+            auto& actions = is_onblock( trace ) ? onblock_actions
+                            : cached_actions[trace->failed_dtrx_trace ? trace->failed_dtrx_trace->id : trace->id];
+            actions.clear();
             for( const auto& atrace : trace->action_traces ) {
                if( !atrace.receipt ) continue;
-               on_action_trace( atrace );
+               on_action_trace( atrace, actions );
             }
          }
+
+         void on_accepted_block( const block_state_ptr& bs ) {
+            action_history_store::block b{ bs->block_num, bs->block->timestamp, std::move( onblock_actions ) };
+            for( const auto& r : bs->block->transactions ) {
+               const transaction_id_type& id = r.trx.contains<transaction_id_type>() ? r.trx.get<transaction_id_type>()
+                                                                                      : r.trx.get<packed_transaction>().id();
+               auto itr = cached_actions.find( id );
+               if( itr == cached_actions.end() ) continue; // failed, or none of its actions are tracked
+               std::move( itr->second.begin(), itr->second.end(), std::back_inserter( b.actions ) );
+            }
+            onblock_actions.clear();
+            cached_actions.clear();
+            store->add_block( std::move( b ) );
+         }
+
+         void on_irreversible_block( const block_state_ptr& bs ) {
+            store->commit( bs->block_num );
+         }
    };
 
    history_plugin::history_plugin()
@@ -305,6 +176,12 @@ namespace eosio {
             ("filter-out,F", bpo::value<vector<string>>()->composing(),
              "Do not track actions which match receiver:action:actor. Action and Actor both blank excludes all from Reciever. Actor blank excludes all from reciever:action. Receiver may not be blank.")
             ;
+      cfg.add_options()
+            ("history-dir", bpo::value<bfs::path>()->default_value("history"),
+             "the location of the action history directory (absolute path or relative to application data dir). "
+             "The action history kept in the chain state by earlier versions is not converted, "
+             "replay the chain with an empty history directory to rebuild it")
+            ;
    }
 
    void history_plugin::plugin_initialize(const variables_map& options) {
@@ -314,7 +191,7 @@ namespace eosio {
             for( auto& s : fo ) {
                if( s == "*" || s == "\"*\"" ) {
                   my->bypass_filter = true;
-                  wlog( "--filter-on * enabled. This can fill shared_mem, causing nodeos to stop." );
+                  wlog( "--filter-on * enabled. This can use a lot of disk space in history-dir." );
                   break;
                }
                std::vector<std::string> v;
@@ -338,6 +215,7 @@ namespace eosio {
                my->filter_out.insert( fe );
             }
          }
+         my->matcher = filter_matcher( my->bypass_filter, my->filter_on, my->filter_out );
 
          my->chain_plug = app().find_plugin<chain_plugin>();
          EOS_ASSERT( my->chain_plug, chain::missing_chain_plugin_exception, ""  );
@@ -345,23 +223,47 @@ namespace eosio {
 
          chainbase::database& db = const_cast<chainbase::database&>( chain.db() ); // Override read-only access to state DB (highly unrecommended practice!)
          // TODO: Use separate chainbase database for managing the state of the history_plugin (or remove deprecated history_plugin entirely)
-         db.add_index<account_history_index>();
-         db.add_index<action_history_index>();
          db.add_index<account_control_history_multi_index>();
          db.add_index<public_key_history_multi_index>();
 
+         auto dir_option = options.at( "history-dir" ).as<bfs::path>();
+         if( dir_option.is_relative() )
+            my->history_dir = app().data_dir() / dir_option;
+         else
+            my->history_dir = dir_option;
+         my->store.emplace( my->history_dir );
+
          my->applied_transaction_connection.emplace(
                chain.applied_transaction.connect( [&]( std::tuple<const transaction_trace_ptr&, const signed_transaction&> t ) {
                   my->on_applied_transaction( std::get<0>(t) );
                } ));
+         my->accepted_block_connection.emplace(
+               chain.accepted_block.connect( [&]( const block_state_ptr& bs ) {
+                  my->on_accepted_block( bs );
+               } ));
+         my->irreversible_block_connection.emplace(
+               chain.irreversible_block.connect( [&]( const block_state_ptr& bs ) {
+                  my->on_irreversible_block( bs );
+               } ));
       } FC_LOG_AND_RETHROW()
    }
 
    void history_plugin::plugin_startup() {
+      const auto lib = my->chain_plug->chain().last_irreversible_block_num();
+      if( my->store->created() && my->store->last_committed_block() < lib ) {
+         wlog( "${d} was created at irreversible block ${lib}, get_actions will not return the actions of earlier blocks. "
+               "The action history kept in the chain state by earlier versions is not converted, "
+               "replay the chain with an empty ${d} to rebuild it",
+               ("d", my->history_dir.generic_string())("lib", lib) );
+      }
    }
 
    void history_plugin::plugin_shutdown() {
       my->applied_transaction_connection.reset();
+      my->accepted_block_connection.reset();
+      my->irreversible_block_connection.reset();
+      if( my->store )
+         my->store->close();
    }
 
 
@@ -371,11 +273,8 @@ namespace eosio {
       read_only::get_actions_result read_only::get_actions( const read_only::get_actions_params& params )const {
          edump((params));
         auto& chain = history->chain_plug->chain();
-        const auto& db = chain.db();
         const auto abi_serializer_max_time = history->chain_plug->get_abi_serializer_max_time();
 
-        const auto& idx = db.get_index<account_history_index, by_account_action_seq>();
-
         int32_t start = 0;
         int32_t pos = params.pos ? *params.pos : -1;
         int32_t end = 0;
@@ -383,14 +282,9 @@ namespace eosio {
         auto n = params.account_name;
         idump((pos));
         if( pos == -1 ) {
-            auto itr = idx.lower_bound( boost::make_tuple( name(n.value+1), 0 ) );
-            if( itr == idx.begin() ) {
-               if( itr->account == n )
-                  pos = itr->account_sequence_num+1;
-            } else if( itr != idx.begin() ) --itr;
-
-            if( itr->account == n )
-               pos = itr->account_sequence_num + 1;
+            auto last = history->store->last_account_sequence( n );
+            if( last )
+               pos = *last + 1;
         }
 
         if( pos== -1 ) pos = 0xfffffff;
@@ -407,32 +301,34 @@ namespace eosio {
 
         idump((start)(end));
 
-        auto start_itr = idx.lower_bound( boost::make_tuple( n, start ) );
-        auto end_itr = idx.upper_bound( boost::make_tuple( n, end) );
-
         auto start_time = fc::time_point::now();
         auto end_time = start_time;
 
         get_actions_result result;
         result.last_irreversible_block = chain.last_irreversible_block_num();
-        while( start_itr != end_itr ) {
-           const auto& a = db.get<action_history_object, by_action_sequence_num>( start_itr->action_sequence_num );
-           fc::datastream<const char*> ds( a.packed_action_trace.data(), a.packed_action_trace.size() );
-           action_trace t;
-           fc::raw::unpack( ds, t );
-           result.actions.emplace_back( ordered_action_result{
-                                 start_itr->action_sequence_num,
-                                 start_itr->account_sequence_num,
-                                 a.block_num, a.block_time,
-                                 chain.to_variant_with_abi(t, abi_serializer_max_time)
-                                 });
-
-           end_time = fc::time_point::now();
-           if( end_time - start_time > fc::microseconds(100000) ) {
-              result.time_limit_exceeded_error = true;
-              break;
+        const size_t batch_size = 100;
+        for( int32_t first = start; first <= end; ) {
+           auto actions = history->store->get_account_actions( n, first, end, batch_size );
+           for( const auto& a : actions ) {
+              fc::datastream<const char*> ds( a.packed_action_trace.data(), a.packed_action_trace.size() );
+              action_trace t;
+              fc::raw::unpack( ds, t );
+              result.actions.emplace_back( ordered_action_result{
+                                    a.global_sequence,
+                                    a.account_sequence,
+                                    a.block_num, a.block_time,
+                                    chain.to_variant_with_abi(t, abi_serializer_max_time)
+                                    });
+
+              end_time = fc::time_point::now();
+              if( end_time - start_time > fc::microseconds(100000) ) {
+                 result.time_limit_exceeded_error = true;
+                 return result;
+              }
            }
-           ++start_itr;
+           if( actions.size() < batch_size || actions.back().account_sequence >= end )
+              break;
+           first = actions.back().account_sequence + 1;
         }
         return result;
       }
@@ -461,32 +357,31 @@ namespace eosio {
             return (*(input_id.data() + input_id_size) & 0xF0) == (*(id.data() + input_id_size) & 0xF0);
          };
 
-         const auto& db = chain.db();
-         const auto& idx = db.get_index<action_history_index, by_trx_id>();
-         auto itr = idx.lower_bound( boost::make_tuple( input_id ) );
+         auto history_id = history->store->first_transaction_at_or_above( input_id );
+         vector<action_history_store::stored_action> actions;
+         if( history_id && txn_id_matched(*history_id) )
+            actions = history->store->get_transaction_actions( *history_id );
 
-         bool in_history = (itr != idx.end() && txn_id_matched(itr->trx_id) );
+         bool in_history = !actions.empty();
+         const auto* trx_index = history->chain_plug->get_trx_block_index();
 
-         if( !in_history && !p.block_num_hint ) {
+         if( !in_history && !p.block_num_hint && !trx_index ) {
             EOS_THROW(tx_not_found, "Transaction ${id} not found in history and no block hint was given", ("id",p.id));
          }
 
          get_transaction_result result;
 
          if( in_history ) {
-            result.id         = itr->trx_id;
+            result.id         = *history_id;
             result.last_irreversible_block = chain.last_irreversible_block_num();
-            result.block_num  = itr->block_num;
-            result.block_time = itr->block_time;
+            result.block_num  = actions.front().block_num;
+            result.block_time = actions.front().block_time;
 
-            while( itr != idx.end() && itr->trx_id == result.id ) {
-
-              fc::datastream<const char*> ds( itr->packed_action_trace.data(), itr->packed_action_trace.size() );
+            for( const auto& a : actions ) {
+              fc::datastream<const char*> ds( a.packed_action_trace.data(), a.packed_action_trace.size() );
               action_trace t;
               fc::raw::unpack( ds, t );
               result.traces.emplace_back( chain.to_variant_with_abi(t, abi_serializer_max_time) );
-
-              ++itr;
             }
 
             auto blk = chain.fetch_block_by_number( result.block_num );
@@ -512,9 +407,10 @@ namespace eosio {
                }
             }
          } else {
-            auto blk = chain.fetch_block_by_number(*p.block_num_hint);
-            bool found = false;
-            if (blk) {
+            auto find_in_block = [&]( uint32_t block_num ) {
+               auto blk = chain.fetch_block_by_number(block_num);
+               if (!blk)
+                  return false;
                for (const auto& receipt: blk->transactions) {
                   if (receipt.trx.contains<packed_transaction>()) {
                      auto& pt = receipt.trx.get<packed_transaction>();
@@ -522,32 +418,44 @@ namespace eosio {
                      if( txn_id_matched(id) ) {
                         result.id = id;
                         result.last_irreversible_block = chain.last_irreversible_block_num();
-                        result.block_num = *p.block_num_hint;
+                        result.block_num = block_num;
                         result.block_time = blk->timestamp;
                         fc::mutable_variant_object r("receipt", receipt);
                         r("trx", chain.to_variant_with_abi(pt.get_signed_transaction(), abi_serializer_max_time));
                         result.trx = move(r);
-                        found = true;
-                        break;
+                        return true;
                      }
                   } else {
                      auto& id = receipt.trx.get<transaction_id_type>();
                      if( txn_id_matched(id) ) {
                         result.id = id;
                         result.last_irreversible_block = chain.last_irreversible_block_num();
-                        result.block_num = *p.block_num_hint;
+                        result.block_num = block_num;
                         result.block_time = blk->timestamp;
                         fc::mutable_variant_object r("receipt", receipt);
                         result.trx = move(r);
-                        found = true;
-                        break;
+                        return true;
                      }
                   }
                }
+               return false;
+            };
+
+            bool found = p.block_num_hint && find_in_block(*p.block_num_hint);
+            if (!found && trx_index) {
+               // the index only knows id prefixes, so every candidate block is checked
+               for (auto block_num : trx_index->find(input_id, input_id_length / 2)) {
+                  if (find_in_block(block_num)) {
+                     found = true;
+                     break;
+                  }
+               }
             }
 
             if (!found) {
-               EOS_THROW(tx_not_found, "Transaction ${id} not found in history or in block number ${n}", ("id",p.id)("n", *p.block_num_hint));
+               if (p.block_num_hint)
+                  EOS_THROW(tx_not_found, "Transaction ${id} not found in history or in block number ${n}", ("id",p.id)("n", *p.block_num_hint));
+               EOS_THROW(tx_not_found, "Transaction ${id} not found in history or in the transaction index", ("id",p.id));
             }
          }
 
@@ -0,0 +1,191 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+
+#include <eosio/chain/sorted_run_index.hpp>
+#include <eosio/chain/block_timestamp.hpp>
+#include <eosio/chain/thread_utils.hpp>
+#include <eosio/chain/types.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace eosio {
+
+   /**
+    * Storage for the actions tracked by the history_plugin, kept outside of the chain state.
+    *
+    * Actions of reversible blocks are held in memory. Once a block becomes irreversible its
+    * actions are given their per account sequence numbers and appended, on a background thread,
+    * to actions.log in the history directory:
+    *
+    *   +---------+--------------------------+---------------+---------+--------------------------+---------------+-----
+    *   | size 0  | action_log_entry 0       | position of 0 | size 1  | action_log_entry 1       | position of 1 | ...
+    *   +---------+--------------------------+---------------+---------+--------------------------+---------------+-----
+    *
+    * The log is indexed by (account, account sequence) and by (transaction id, global sequence),
+    * each a sorted_run_index pointing at log positions. Lookups see all three layers, so actions
+    * are visible as soon as their block is accepted.
+    *
+    * The reversible actions are saved to reversible.bin on close and loaded again on open, so
+    * that the blocks which were reversible at shutdown are not lost when they become
+    * irreversible after a restart.
+    *
+    * Earlier versions kept the action history in the chain state. It is not converted: a store
+    * opened on an existing chain starts empty, and replaying the chain with an empty history
+    * directory is the way to fill it with the actions of the blocks before.
+    */
+   class action_history_store {
+   public:
+      /// an action of an accepted block, to be recorded for each of accounts
+      struct action {
+         uint64_t                   global_sequence = 0;
+         chain::transaction_id_type trx_id;
+         std::vector<chain::account_name> accounts;
+         chain::bytes               packed_action_trace;
+      };
+
+      struct block {
+         uint32_t                    block_num = 0;
+         chain::block_timestamp_type block_time;
+         std::vector<action>         actions;
+      };
+
+      struct account_sequence {
+         chain::account_name account;
+         int32_t             sequence = 0;
+      };
+
+      /// an action as written to actions.log
+      struct action_log_entry {
+         uint64_t                      global_sequence = 0;
+         uint32_t                      block_num = 0;
+         chain::block_timestamp_type   block_time;
+         chain::transaction_id_type    trx_id;
+         std::vector<account_sequence> account_sequences;
+         chain::bytes                  packed_action_trace;
+      };
+
+      /// an action returned by a lookup
+      struct stored_action {
+         uint64_t                    global_sequence = 0;
+         int32_t                     account_sequence = 0; ///< only set by get_account_actions
+         uint32_t                    block_num = 0;
+         chain::block_timestamp_type block_time;
+         chain::transaction_id_type  trx_id;
+         chain::bytes                packed_action_trace;
+      };
+
+      explicit action_history_store( const boost::filesystem::path& dir );
+      ~action_history_store();
+
+      action_history_store( const action_history_store& ) = delete;
+      action_history_store& operator=( const action_history_store& ) = delete;
+
+      /// record the actions of an accepted block, replacing those of any block it forks out
+      void add_block( block b );
+
+      /// move the blocks up to irreversible_block_num to disk
+      void commit( uint32_t irreversible_block_num );
+
+      /// write everything to disk and stop the writer thread
+      void close();
+
+      /// true if the history directory had no actions.log when the store was opened
+      bool created() const { return _created; }
+
+      /// the last block whose actions have been moved toward disk
+      uint32_t last_committed_block() const;
+
+      /// sequence number of the last action of account, if it has any
+      fc::optional<int32_t> last_account_sequence( chain::account_name account ) const;
+
+      /// actions of account with account sequence numbers from first to last, at most max_actions of them
+      std::vector<stored_action> get_account_actions( chain::account_name account, int32_t first, int32_t last, size_t max_actions ) const;
+
+      /// the least transaction id with recorded actions that is not less than id
+      fc::optional<chain::transaction_id_type> first_transaction_at_or_above( const chain::transaction_id_type& id ) const;
+
+      /// actions of transaction id in global sequence order
+      std::vector<stored_action> get_transaction_actions( const chain::transaction_id_type& id ) const;
+
+   private:
+      /// next sequences kept in memory before those of accounts that are all on disk are dropped
+      static constexpr size_t max_cached_sequences = 1 << 16;
+
+      struct account_index_entry {
+         uint64_t account = 0;
+         int32_t  sequence = 0;
+         uint32_t pad = 0;
+         uint64_t position = 0;
+      };
+      struct account_index_less {
+         bool operator()( const account_index_entry& a, const account_index_entry& b ) const {
+            return std::tie( a.account, a.sequence ) < std::tie( b.account, b.sequence );
+         }
+      };
+
+      struct trx_index_entry {
+         char     trx_id[32] = {};
+         uint64_t global_sequence = 0;
+         uint64_t position = 0;
+      };
+      struct trx_index_less {
+         bool operator()( const trx_index_entry& a, const trx_index_entry& b ) const {
+            const int c = memcmp( a.trx_id, b.trx_id, sizeof(a.trx_id) );
+            return c < 0 || (c == 0 && a.global_sequence < b.global_sequence);
+         }
+      };
+
+      using account_index = chain::sorted_run_index<account_index_entry, account_index_less>;
+      using trx_index     = chain::sorted_run_index<trx_index_entry, trx_index_less>;
+      using entry_ptr     = std::shared_ptr<const action_log_entry>;
+
+      static trx_index_entry make_trx_key( const chain::transaction_id_type& id, uint64_t global_sequence );
+
+      void open_log();
+      void load_reversible();
+      void save_reversible();
+      void index_entry( const action_log_entry& e, uint64_t position );
+      uint64_t append_entry( const action_log_entry& e );
+      action_log_entry read_entry( uint64_t position ) const;
+      /// next account sequence of account for committed actions; requires _mtx
+      int32_t next_committed_sequence( chain::account_name account ) const;
+      /// drop the next sequences that the account index can answer; requires _mtx
+      void trim_next_sequence();
+      /// start the writer thread on _unwritten unless it is running; requires _mtx
+      void schedule_write();
+      void write_unwritten();
+
+      const boost::filesystem::path      _dir;
+      mutable std::mutex                 _mtx;         ///< guards the members below up to _writing
+      std::deque<block>                  _reversible;
+      std::deque<entry_ptr>              _unwritten;   ///< committed, not yet indexed on disk
+      std::map<chain::account_name, int32_t> _next_sequence; ///< accounts committed recently, at least those in _unwritten
+      uint32_t                           _last_committed_block = 0;
+      bool                               _writing = false;
+      bool                               _created = false;
+
+      mutable std::mutex                 _log_mtx;     ///< guards the log streams
+      std::fstream                       _log;
+      mutable std::ifstream              _log_reader;
+      std::unique_ptr<account_index>     _account_index;
+      std::unique_ptr<trx_index>         _trx_index;
+      fc::optional<chain::named_thread_pool> _writer;
+   };
+
+} // namespace eosio
+
+FC_REFLECT( eosio::action_history_store::action, (global_sequence)(trx_id)(accounts)(packed_action_trace) )
+FC_REFLECT( eosio::action_history_store::block, (block_num)(block_time)(actions) )
+FC_REFLECT( eosio::action_history_store::account_sequence, (account)(sequence) )
+FC_REFLECT( eosio::action_history_store::action_log_entry,
+            (global_sequence)(block_num)(block_time)(trx_id)(account_sequences)(packed_action_trace) )
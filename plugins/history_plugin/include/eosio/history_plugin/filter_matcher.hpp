@@ -0,0 +1,147 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+
+#include <eosio/chain/trace.hpp>
+
+#include <algorithm>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace eosio {
+
+   /// a receiver:action:actor rule of filter-on or filter-out, a blank action or actor matches any
+   struct filter_entry {
+      chain::name receiver;
+      chain::name action;
+      chain::name actor;
+
+      std::tuple<chain::name, chain::name, chain::name> key() const {
+         return std::make_tuple(receiver, action, actor);
+      }
+
+      friend bool operator<( const filter_entry& a, const filter_entry& b ) {
+         return a.key() < b.key();
+      }
+   };
+
+   /**
+    * The filter-on and filter-out rules compiled into hash tables keyed by receiver.
+    *
+    * An action is tracked if a filter-on rule matches it and no filter-out rule does; a rule with
+    * an actor matches if any authorizer of the action is that actor. A tracked action is recorded
+    * for its receiver and for each authorizer that a filter-on rule selects. Receivers without
+    * rules cost one lookup, unless filter-on is "*".
+    */
+   class filter_matcher {
+   public:
+      filter_matcher() = default;
+
+      filter_matcher( bool match_all, const std::set<filter_entry>& filter_on, const std::set<filter_entry>& filter_out )
+      : _match_all( match_all ) {
+         for( const auto& e : filter_on )  rule( e ).on = true;
+         for( const auto& e : filter_out ) rule( e ).out = true;
+      }
+
+      /**
+       * Whether act is tracked. If so, accounts is set to the accounts it is recorded for, the
+       * receiver first.
+       */
+      bool match( const chain::action_trace& act, std::vector<chain::account_name>& accounts ) const {
+         const receiver_rules* rules = nullptr;
+         auto itr = _receivers.find( act.receiver.value );
+         if( itr != _receivers.end() ) {
+            rules = &itr->second;
+         } else if( !_match_all ) {
+            return false;
+         }
+
+         flags base;
+         if( rules ) {
+            base = rules->any;
+            base |= find( rules->actions, act.act.name.value );
+         }
+
+         // the flags of each authorizer, the action wide rules included
+         thread_local std::vector<flags> actor_flags;
+         actor_flags.clear();
+         bool on = _match_all || base.on;
+         bool out = base.out;
+         for( const auto& a : act.act.authorization ) {
+            flags f = base;
+            if( rules ) {
+               f |= find( rules->actors, a.actor.value );
+               f |= find( rules->action_actors, action_actor_key( act.act.name, a.actor ) );
+            }
+            on  = on || f.on;
+            out = out || f.out;
+            actor_flags.push_back( f );
+         }
+         if( !on || out ) return false;
+
+         accounts.clear();
+         accounts.push_back( act.receiver );
+         for( size_t i = 0; i < actor_flags.size(); ++i ) {
+            if( !_match_all && !actor_flags[i].on ) continue;
+            const auto actor = act.act.authorization[i].actor;
+            if( std::find( accounts.begin(), accounts.end(), actor ) == accounts.end() ) accounts.push_back( actor );
+         }
+         return true;
+      }
+
+   private:
+      struct flags {
+         bool on  = false;
+         bool out = false;
+
+         flags& operator|=( const flags& f ) {
+            on  = on || f.on;
+            out = out || f.out;
+            return *this;
+         }
+      };
+
+      struct key_hash {
+         size_t operator()( uint64_t k ) const { return k ^ (k >> 29) ^ (k >> 47); }
+      };
+      struct pair_hash {
+         size_t operator()( const std::pair<uint64_t, uint64_t>& k ) const {
+            return key_hash()( k.first ) * 31 + key_hash()( k.second );
+         }
+      };
+
+      struct receiver_rules {
+         flags                                                          any;           ///< receiver::
+         std::unordered_map<uint64_t, flags, key_hash>                  actions;       ///< receiver:action:
+         std::unordered_map<uint64_t, flags, key_hash>                  actors;        ///< receiver::actor
+         std::unordered_map<std::pair<uint64_t, uint64_t>, flags, pair_hash> action_actors; ///< receiver:action:actor
+      };
+
+      static std::pair<uint64_t, uint64_t> action_actor_key( chain::name action, chain::name actor ) {
+         return { action.value, actor.value };
+      }
+
+      template<typename Map, typename Key>
+      static flags find( const Map& m, const Key& k ) {
+         if( m.empty() ) return {};
+         auto itr = m.find( k );
+         return itr == m.end() ? flags() : itr->second;
+      }
+
+      flags& rule( const filter_entry& e ) {
+         auto& r = _receivers[e.receiver.value];
+         if( !e.action.value && !e.actor.value ) return r.any;
+         if( !e.actor.value ) return r.actions[e.action.value];
+         if( !e.action.value ) return r.actors[e.actor.value];
+         return r.action_actors[action_actor_key( e.action, e.actor )];
+      }
+
+      bool                                                  _match_all = false;
+      std::unordered_map<uint64_t, receiver_rules, key_hash> _receivers;
+   };
+
+} // namespace eosio
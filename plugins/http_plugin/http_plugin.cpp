@@ -4,6 +4,7 @@
  */
 #include <eosio/http_plugin/http_plugin.hpp>
 #include <eosio/http_plugin/local_endpoint.hpp>
+#include <eosio/http_plugin/response_cache.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <eosio/chain/thread_utils.hpp>
 
@@ -135,6 +136,9 @@ namespace eosio {
    class http_plugin_impl {
       public:
          map<string,url_handler>  url_handlers;
+         set<string>              http_thread_handlers; ///< urls whose handlers are called on an http thread
+         map<string,response_cache_policy> response_cache_policies;
+         optional<response_cache> responses; ///< not set when http-response-cache-size-mb is 0
          optional<tcp::endpoint>  listen_endpoint;
          string                   access_control_allow_origin;
          string                   access_control_allow_headers;
@@ -302,17 +306,41 @@ namespace eosio {
                std::string resource = con->get_uri()->get_resource();
                auto handler_itr = url_handlers.find( resource );
                if( handler_itr != url_handlers.end()) {
+                  const response_cache_policy* cache_policy = nullptr;
+                  std::string cache_key = cached_response_key( resource, body, cache_policy );
+                  if( !cache_key.empty() ) {
+                     if( auto cached = responses->get( cache_key ) ) {
+                        con->set_body( cached->body );
+                        con->set_status( websocketpp::http::status_code::value( cached->code ) );
+                        return;
+                     }
+                  }
+
                   con->defer_http_response();
                   bytes_in_flight += body.size();
-                  app().post( appbase::priority::low,
-                              [&ioc = thread_pool->get_executor(), &bytes_in_flight = this->bytes_in_flight, handler_itr,
-                               resource{std::move( resource )}, body{std::move( body )}, con]() {
+                  const bool on_http_thread = http_thread_handlers.count( resource ) > 0;
+                  auto call_handler = [&ioc = thread_pool->get_executor(), &bytes_in_flight = this->bytes_in_flight, handler_itr,
+                                       &responses = this->responses, cache_policy, cache_key{std::move( cache_key )},
+                                       resource{std::move( resource )}, body{std::move( body )}, con]() {
+                     // read before the handler looks at any state, a clear_cached_responses from here on
+                     // keeps this response out of the cache
+                     const uint64_t cache_epoch = cache_policy ? responses->epoch() : 0;
                      try {
                         handler_itr->second( resource, body,
-                              [&ioc, &bytes_in_flight, con]( int code, fc::variant response_body ) {
-                           boost::asio::post( ioc, [response_body{std::move( response_body )}, &bytes_in_flight, con, code]() mutable {
+                              [&ioc, &bytes_in_flight, &responses, cache_policy, cache_key, cache_epoch, con]( int code, fc::variant response_body ) {
+                           bool cache = false;
+                           if( cache_policy ) {
+                              try {
+                                 cache = cache_policy->immutable( code, response_body );
+                              } catch( ... ) {}
+                           }
+                           boost::asio::post( ioc, [response_body{std::move( response_body )}, &bytes_in_flight, &responses,
+                                                    cache, cache_key, cache_epoch, con, code]() mutable {
                               std::string json = fc::json::to_string( response_body );
                               response_body.clear();
+                              if( cache ) {
+                                 responses->put( cache_key, code, json, cache_epoch );
+                              }
                               const size_t json_size = json.size();
                               bytes_in_flight += json_size;
                               con->set_body( std::move( json ) );
@@ -326,7 +354,12 @@ namespace eosio {
                         handle_exception<T>( con );
                         con->send_http_response();
                      }
-                  } );
+                  };
+                  if( on_http_thread ) {
+                     boost::asio::post( thread_pool->get_executor(), std::move( call_handler ) );
+                  } else {
+                     app().post( appbase::priority::low, std::move( call_handler ) );
+                  }
 
                } else {
                   dlog( "404 - not found: ${ep}", ("ep", resource));
@@ -340,6 +373,30 @@ namespace eosio {
             }
          }
 
+         /**
+          * Key the response to a request for resource is cached under, empty if the handler has no
+          * cache policy or the policy does not cache this request. policy is set to the handler's
+          * policy when the key is not empty.
+          */
+         std::string cached_response_key( const std::string& resource, const std::string& body, const response_cache_policy*& policy ) {
+            if( !responses ) return {};
+            auto itr = response_cache_policies.find( resource );
+            if( itr == response_cache_policies.end() ) return {};
+            std::string key;
+            try {
+               key = itr->second.key( body );
+            } catch( ... ) {
+               return {}; // let the handler report the malformed request
+            }
+            if( key.empty() ) return {};
+            policy = &itr->second;
+            return cached_response_prefix( resource ) + key;
+         }
+
+         static std::string cached_response_prefix( const std::string& resource ) {
+            return resource + '\n';
+         }
+
          template<class T>
          void create_server_for_endpoint(const tcp::endpoint& ep, websocketpp::server<detail::asio_with_stub_log<T>>& ws) {
             try {
@@ -443,6 +500,8 @@ namespace eosio {
              "Additionaly acceptable values for the \"Host\" header of incoming HTTP requests, can be specified multiple times.  Includes http/s_server_address by default.")
             ("http-threads", bpo::value<uint16_t>()->default_value( my->thread_pool_size ),
              "Number of worker threads in http thread pool")
+            ("http-response-cache-size-mb", bpo::value<uint32_t>()->default_value(64),
+             "Maximum size in megabytes of the cache of responses to API calls that cannot change, such as get_block for irreversible blocks. 0 disables the cache.")
             ;
    }
 
@@ -523,6 +582,11 @@ namespace eosio {
 
          my->max_bytes_in_flight = options.at( "http-max-bytes-in-flight-mb" ).as<uint32_t>() * 1024 * 1024;
 
+         const size_t response_cache_size = options.at( "http-response-cache-size-mb" ).as<uint32_t>() * size_t(1024 * 1024);
+         if( response_cache_size > 0 ) {
+            my->responses.emplace( response_cache_size );
+         }
+
          //watch out for the returns above when adding new code here
       } FC_LOG_AND_RETHROW()
    }
@@ -619,6 +683,12 @@ namespace eosio {
       if( my->thread_pool ) {
          my->thread_pool->stop();
       }
+
+      if( my->responses ) {
+         ilog( "http response cache: ${n} responses, ${b} bytes, ${h} hits, ${m} misses",
+               ("n", my->responses->size())("b", my->responses->memory_size())
+               ("h", my->responses->hits())("m", my->responses->misses()) );
+      }
    }
 
    void http_plugin::add_handler(const string& url, const url_handler& handler) {
@@ -626,6 +696,25 @@ namespace eosio {
       my->url_handlers.insert(std::make_pair(url,handler));
    }
 
+   void http_plugin::add_http_thread_api(const api_description& api) {
+      for (const auto& call : api) {
+         add_handler(call.first, call.second);
+         my->http_thread_handlers.insert(call.first);
+      }
+   }
+
+   void http_plugin::add_response_cache_policy(const string& url, response_cache_policy policy) {
+      EOS_ASSERT( my->url_handlers.count( url ), chain::plugin_config_exception,
+                  "No handler for ${url} to cache the responses of", ("url", url) );
+      my->response_cache_policies[url] = std::move( policy );
+   }
+
+   void http_plugin::clear_cached_responses(const string& url) {
+      if( my->responses ) {
+         my->responses->erase_prefix( http_plugin_impl::cached_response_prefix( url ) );
+      }
+   }
+
    void http_plugin::handle_exception( const char *api_name, const char *call_name, const string& body, url_response_callback cb ) {
       try {
          try {
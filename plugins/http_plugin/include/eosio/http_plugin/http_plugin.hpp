@@ -40,6 +40,22 @@ namespace eosio {
     */
    using api_description = std::map<string, url_handler>;
 
+   /**
+    * @brief Opt-in caching of the responses of a URL handler
+    *
+    * key is called on an http thread with the request body and returns the key the response is
+    * cached under, or an empty string if the request is not cacheable. A request whose key is
+    * cached is answered without calling the handler.
+    *
+    * immutable is called with the response code and body on the thread that calls the
+    * url_response_callback. Only responses for which it returns true are cached; they must never
+    * change for the same key, as cached responses do not expire.
+    */
+   struct response_cache_policy {
+      std::function<string(const string&)>           key;
+      std::function<bool(int, const fc::variant&)>   immutable;
+   };
+
    struct http_plugin_defaults {
       //If empty, unix socket support will be completely disabled. If not empty,
       // unix socket support is enabled with the given default path (treated relative
@@ -57,7 +73,8 @@ namespace eosio {
     *  called with the response code and body.
     *
     *  The handler will be called from the appbase application io_service
-    *  thread.  The callback can be called from any thread and will
+    *  thread, or from an http thread if it was added with add_http_thread_api.
+    *  The callback can be called from any thread and will
     *  automatically propagate the call to the http thread.
     *
     *  The HTTP service will run in its own thread with its own io_service to
@@ -85,6 +102,14 @@ namespace eosio {
            for (const auto& call : api)
               add_handler(call.first, call.second);
         }
+        /// add an API whose handlers are called on an http thread rather than the application thread;
+        /// they may run concurrently with each other and with the application thread
+        void add_http_thread_api(const api_description& api);
+
+        /// cache the responses of the handler for url, see response_cache_policy
+        void add_response_cache_policy(const string& url, response_cache_policy policy);
+        /// drop the cached responses of the handler for url, after a change to state they were derived from
+        void clear_cached_responses(const string& url);
 
         // standard exception handling for api handlers
         static void handle_exception( const char *api_name, const char *call_name, const string& body, url_response_callback cb );
@@ -0,0 +1,154 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace eosio {
+
+   /**
+    * Thread safe cache of serialized HTTP responses, bounded by memory with least recently used
+    * eviction.
+    *
+    * Only responses that can never change should be stored, there is no expiry. Entries are
+    * shared so a hit can be copied into the connection after the lock is released.
+    *
+    * A response is built, checked and stored on different threads. Whoever builds it reads epoch()
+    * first and passes it to put(), so a response built before an erase_prefix() or clear() is never
+    * stored after it.
+    */
+   class response_cache {
+   public:
+      struct cached_response {
+         int         code = 0;
+         std::string body;
+      };
+      using cached_response_ptr = std::shared_ptr<const cached_response>;
+
+      /// bookkeeping charged to each entry in addition to its key and body
+      static constexpr size_t entry_overhead = 128;
+
+      explicit response_cache( size_t max_bytes ) : _max_bytes( max_bytes ) {}
+
+      response_cache( const response_cache& ) = delete;
+      response_cache& operator=( const response_cache& ) = delete;
+
+      /// the response stored under key, if any
+      cached_response_ptr get( const std::string& key ) {
+         std::lock_guard<std::mutex> g( _mtx );
+         auto itr = _index.find( key );
+         if( itr == _index.end() ) {
+            ++_misses;
+            return cached_response_ptr();
+         }
+         ++_hits;
+         _lru.splice( _lru.begin(), _lru, itr->second );
+         return itr->second->response;
+      }
+
+      /// bumped by every erase_prefix() and clear()
+      uint64_t epoch() const {
+         std::lock_guard<std::mutex> g( _mtx );
+         return _epoch;
+      }
+
+      /**
+       * Store a response, evicting the least recently used ones to stay within max_bytes.
+       * Refused if entries were erased since epoch was read, as the response may derive from
+       * the state they were erased for. Returns true if stored.
+       */
+      bool put( const std::string& key, int code, std::string body, uint64_t epoch ) {
+         const size_t bytes = key.size() + body.size() + entry_overhead;
+         if( bytes > _max_bytes ) return false;
+         auto response = std::make_shared<cached_response>( cached_response{ code, std::move( body ) } );
+
+         std::lock_guard<std::mutex> g( _mtx );
+         if( epoch != _epoch ) return false;
+         auto itr = _index.find( key );
+         if( itr != _index.end() ) {
+            erase( itr->second );
+         }
+         _lru.push_front( entry{ key, bytes, std::move( response ) } );
+         _index.emplace( key, _lru.begin() );
+         _bytes += bytes;
+         while( _bytes > _max_bytes ) {
+            erase( std::prev( _lru.end() ) );
+         }
+         return true;
+      }
+
+      /// remove all entries whose key starts with prefix
+      void erase_prefix( const std::string& prefix ) {
+         std::lock_guard<std::mutex> g( _mtx );
+         ++_epoch;
+         for( auto i = _lru.begin(); i != _lru.end(); ) {
+            auto next = std::next( i );
+            if( i->key.compare( 0, prefix.size(), prefix ) == 0 ) {
+               erase( i );
+            }
+            i = next;
+         }
+      }
+
+      void clear() {
+         std::lock_guard<std::mutex> g( _mtx );
+         ++_epoch;
+         _index.clear();
+         _lru.clear();
+         _bytes = 0;
+      }
+
+      size_t size() const {
+         std::lock_guard<std::mutex> g( _mtx );
+         return _lru.size();
+      }
+
+      /// bytes charged to the cached entries
+      size_t memory_size() const {
+         std::lock_guard<std::mutex> g( _mtx );
+         return _bytes;
+      }
+
+      size_t max_memory_size() const { return _max_bytes; }
+
+      uint64_t hits() const {
+         std::lock_guard<std::mutex> g( _mtx );
+         return _hits;
+      }
+
+      uint64_t misses() const {
+         std::lock_guard<std::mutex> g( _mtx );
+         return _misses;
+      }
+
+   private:
+      struct entry {
+         std::string         key;
+         size_t              bytes = 0;
+         cached_response_ptr response;
+      };
+      using lru_list = std::list<entry>;
+
+      void erase( lru_list::iterator i ) {
+         _bytes -= i->bytes;
+         _index.erase( i->key );
+         _lru.erase( i );
+      }
+
+      const size_t                                         _max_bytes;
+      mutable std::mutex                                   _mtx;
+      lru_list                                             _lru; ///< most recently used first
+      std::unordered_map<std::string, lru_list::iterator>  _index;
+      size_t                                               _bytes = 0;
+      uint64_t                                             _hits = 0;
+      uint64_t                                             _misses = 0;
+      uint64_t                                             _epoch = 0;
+   };
+
+} // namespace eosio
@@ -0,0 +1,129 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/net_plugin/protocol.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/merkle.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+
+namespace eosio {
+
+   /**
+    * A compact_block_message waiting for the transactions that were not in local_txns.
+    */
+   struct pending_compact_block {
+      block_id_type                              block_id;
+      compact_block_message                      msg;
+      vector<std::shared_ptr<vector<char>>>      serialized_trxs; ///< per receipt, from node_transaction_state::serialized_txn
+      vector<uint32_t>                           missing;         ///< ascending receipt indexes not found in local_txns
+      vector<packed_transaction>                 fetched_trxs;    ///< received for missing, in the same order
+
+      /// the rebuilt block, or an empty pointer if it does not match the header's transaction_mroot
+      signed_block_ptr to_block() const {
+         auto b = std::make_shared<signed_block>();
+         static_cast<signed_block_header&>( *b ) = msg.header;
+         b->block_extensions = msg.block_extensions;
+         b->transactions.reserve( msg.receipts.size() );
+
+         auto fetched = fetched_trxs.cbegin();
+         for( size_t i = 0; i < msg.receipts.size(); ++i ) {
+            const auto& r = msg.receipts[i];
+            transaction_receipt receipt;
+            static_cast<transaction_receipt_header&>( receipt ) = r.header;
+            if( !r.packed ) {
+               receipt.trx = r.id;
+            } else if( i < serialized_trxs.size() && serialized_trxs[i] ) {
+               // serialized_txn is a framed net_message, skip the length header and the which
+               const auto& buff = *serialized_trxs[i];
+               EOS_ASSERT( buff.size() > message_header_size, chain::plugin_exception, "invalid serialized transaction" );
+               fc::datastream<const char*> ds( buff.data() + message_header_size, buff.size() - message_header_size );
+               unsigned_int which{};
+               fc::raw::unpack( ds, which );
+               EOS_ASSERT( which == packed_transaction_which, chain::plugin_exception, "invalid serialized transaction" );
+               packed_transaction trx;
+               fc::raw::unpack( ds, trx );
+               receipt.trx = std::move( trx );
+            } else {
+               EOS_ASSERT( fetched != fetched_trxs.cend(), chain::plugin_exception, "missing transaction for compact block" );
+               receipt.trx = *fetched++;
+            }
+            b->transactions.emplace_back( std::move( receipt ) );
+         }
+
+         vector<digest_type> trx_digests;
+         trx_digests.reserve( b->transactions.size() );
+         for( const auto& r : b->transactions ) {
+            trx_digests.emplace_back( r.digest() );
+         }
+         if( merkle( std::move( trx_digests ) ) != b->transaction_mroot ) {
+            return signed_block_ptr();
+         }
+         return b;
+      }
+   };
+
+   /**
+    * The compact blocks of one connection waiting on a block_transactions_message, by block id.
+    *
+    * A peer relays the next compact block without waiting for our get_block_transactions_message
+    * to be answered, so several can be pending at once. At most capacity are kept; add() evicts
+    * the oldest beyond that and returns its id so the caller can request the full block instead.
+    */
+   class pending_compact_blocks {
+   public:
+      explicit pending_compact_blocks( size_t capacity ) : capacity( std::max<size_t>( capacity, 1 ) ) {}
+
+      /// a compact block already pending under the same id is replaced without evicting anything
+      optional<block_id_type> add( pending_compact_block&& p ) {
+         auto id = p.block_id;
+         auto r = pending.emplace( id, pending_compact_block() );
+         r.first->second = std::move( p );
+         if( !r.second ) {
+            return {};
+         }
+         order.push_back( id );
+         if( order.size() <= capacity ) {
+            return {};
+         }
+         block_id_type evicted = order.front();
+         order.pop_front();
+         pending.erase( evicted );
+         return evicted;
+      }
+
+      /// remove and return the compact block pending for id, if any
+      optional<pending_compact_block> take( const block_id_type& id ) {
+         auto i = pending.find( id );
+         if( i == pending.end() ) {
+            return {};
+         }
+         optional<pending_compact_block> p = std::move( i->second );
+         pending.erase( i );
+         order.erase( std::find( order.begin(), order.end(), id ) );
+         return p;
+      }
+
+      bool contains( const block_id_type& id ) const { return pending.count( id ) > 0; }
+      size_t size() const { return pending.size(); }
+      bool empty() const { return pending.empty(); }
+
+      void clear() {
+         pending.clear();
+         order.clear();
+      }
+
+   private:
+      size_t                                       capacity;
+      std::map<block_id_type, pending_compact_block> pending;
+      std::deque<block_id_type>                    order; ///< oldest first
+   };
+
+} // namespace eosio
@@ -0,0 +1,139 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/net_plugin/protocol.hpp>
+#include <eosio/net_plugin/receive_buffer.hpp>
+#include <eosio/chain/transaction_metadata.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/optional.hpp>
+#include <fc/scoped_exit.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <string>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * A message framed and unpacked on a net thread, waiting to be dispatched on the main thread.
+    */
+   struct decoded_message {
+      net_message              msg;        ///< not used for blocks and transactions
+      bool                     known_block = false; ///< a block or compact block that is already known
+      block_id_type            block_id;
+      uint32_t                 block_num = 0;
+      signed_block_ptr         block;
+      transaction_metadata_ptr trx;
+   };
+
+   /**
+    * Unpack the next message_length bytes of buffer, which hold a message without its length prefix.
+    *
+    * Blocks are dropped down to their id and number when known_ids.has_block() knows the id or
+    * known_ids.is_irreversible() the number, and transactions are dropped entirely when expired or when
+    * known_ids.has_transaction() knows them. Throws on a malformed message.
+    */
+   template<typename KnownIds>
+   void decode_next_message( receive_buffer& buffer, uint32_t message_length, const KnownIds& known_ids,
+                             std::vector<decoded_message>& msgs ) {
+      decoded_message m;
+
+      // unpacked straight from the receive buffer unless the message spans segments
+      std::vector<char> scratch;
+      const char* data = buffer.contiguous( message_length, scratch );
+      auto consume = fc::make_scoped_exit( [&buffer, message_length]() {
+         buffer.consume( message_length );
+      } );
+
+      // if next message is a block we already have, only pass along its id
+      fc::datastream<const char*> peek_ds( data, message_length );
+      unsigned_int which{};
+      fc::raw::unpack( peek_ds, which );
+      if( which == signed_block_which || which == compact_block_which ) { // both start with the block header
+         block_header bh;
+         fc::raw::unpack( peek_ds, bh );
+
+         m.block_id = bh.id();
+         m.block_num = bh.block_num();
+         // known_ids only keeps blocks above LIB; one at or below it is in the block log or on a dead fork
+         if( known_ids.has_block( m.block_id ) || known_ids.is_irreversible( m.block_num ) ) {
+            m.known_block = true;
+            msgs.emplace_back( std::move( m ) );
+            return;
+         }
+      }
+
+      fc::datastream<const char*> ds( data, message_length );
+      net_message msg;
+      fc::raw::unpack( ds, msg );
+      if( msg.contains<signed_block>() ) {
+         m.block = std::make_shared<signed_block>( std::move( msg.get<signed_block>() ) );
+      } else if( msg.contains<packed_transaction>() ) {
+         auto ptrx = std::make_shared<packed_transaction>( std::move( msg.get<packed_transaction>() ) );
+         if( ptrx->expiration() < fc::time_point::now() ) {
+            return; // would be rejected by the chain anyway
+         }
+         m.trx = std::make_shared<transaction_metadata>( ptrx );
+         if( known_ids.has_transaction( m.trx->id ) ) {
+            return;
+         }
+      } else {
+         m.msg = std::move( msg );
+      }
+      msgs.emplace_back( std::move( m ) );
+   }
+
+   /**
+    * Frame and unpack the bytes_transferred bytes just read into buffer.
+    *
+    * Every complete message is unpacked with decode_next_message() and appended to msgs. If a message is
+    * incomplete, outstanding_read_bytes is set to the number of bytes still missing from it.
+    * Returns a description of the error if the connection should be closed, an empty string otherwise.
+    */
+   template<typename KnownIds>
+   std::string decode_messages( receive_buffer& buffer, std::size_t bytes_transferred, uint32_t max_message_length,
+                                const KnownIds& known_ids, fc::optional<std::size_t>& outstanding_read_bytes,
+                                std::vector<decoded_message>& msgs ) {
+      outstanding_read_bytes.reset();
+      try {
+         buffer.commit(bytes_transferred);
+         while (buffer.size() > 0) {
+            uint32_t bytes_in_buffer = buffer.size();
+
+            if (bytes_in_buffer < message_header_size) {
+               outstanding_read_bytes.emplace(message_header_size - bytes_in_buffer);
+               break;
+            } else {
+               uint32_t message_length;
+               buffer.peek(&message_length, sizeof(message_length));
+               if(message_length > max_message_length || message_length == 0) {
+                  return "incoming message length unexpected (" + std::to_string(message_length) + ")";
+               }
+
+               auto total_message_bytes = message_length + message_header_size;
+
+               if (bytes_in_buffer >= total_message_bytes) {
+                  buffer.consume(message_header_size);
+                  decode_next_message(buffer, message_length, known_ids, msgs);
+               } else {
+                  // read the rest of the message into the same segment so it can be unpacked in place
+                  buffer.reserve_message(total_message_bytes);
+                  outstanding_read_bytes.emplace(total_message_bytes - bytes_in_buffer);
+                  break;
+               }
+            }
+         }
+      } catch( const fc::exception& e ) {
+         return e.to_detail_string();
+      } catch( const std::exception& e ) {
+         return e.what();
+      } catch( ... ) {
+         return "undefined exception";
+      }
+      return std::string();
+   }
+
+} // namespace eosio
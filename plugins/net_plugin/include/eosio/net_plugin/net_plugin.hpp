@@ -17,6 +17,16 @@ namespace eosio {
       handshake_message last_handshake;
    };
 
+   struct peer_score {
+      string            peer;
+      double            score = 0;            ///< 0 to 100, higher is better
+      double            rtt_ms = 0;
+      double            block_latency_ms = 0; ///< age of broadcast blocks on arrival
+      double            bytes_per_sec = 0;
+      double            rejected_blocks = 0;  ///< decays over time
+      double            timeouts = 0;         ///< decays over time
+   };
+
    class net_plugin : public appbase::plugin<net_plugin>
    {
       public:
@@ -37,6 +47,8 @@ namespace eosio {
         string                       disconnect( const string& endpoint );
         optional<connection_status>  status( const string& endpoint )const;
         vector<connection_status>    connections()const;
+        /// best scored peer first
+        vector<peer_score>           peer_scores()const;
 
         size_t num_peers() const;
       private:
@@ -46,3 +58,4 @@ namespace eosio {
 }
 
 FC_REFLECT( eosio::connection_status, (peer)(connecting)(syncing)(last_handshake) )
+FC_REFLECT( eosio::peer_score, (peer)(score)(rtt_ms)(block_latency_ms)(bytes_per_sec)(rejected_blocks)(timeouts) )
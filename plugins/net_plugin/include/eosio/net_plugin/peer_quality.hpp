@@ -0,0 +1,104 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <fc/time.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * Running measurements of how well a peer serves us, used to prefer the better
+    * peers for sync, fetch retries and block broadcasts. Penalties decay so a peer whose
+    * link recovers is ranked up again.
+    */
+   struct peer_quality {
+      static constexpr double smoothing = 0.2;              ///< weight of a new sample
+      static constexpr int64_t penalty_half_life_us = 300'000'000; ///< 5 minutes
+      static constexpr int64_t rate_window_us = 1'000'000;
+
+      double           rtt_us = 0;            ///< round trip time measured by time_message
+      double           block_latency_us = 0;  ///< age of broadcast blocks when they arrive
+      double           bytes_per_sec = 0;
+      double           rejected_blocks = 0;
+      double           timeouts = 0;
+
+      uint64_t         window_bytes = 0;
+      fc::time_point   window_start = fc::time_point::now();
+      fc::time_point   last_decay = fc::time_point::now();
+
+      static void add_sample( double& avg, double sample ) {
+         avg = avg == 0 ? sample : avg + smoothing * (sample - avg);
+      }
+
+      void add_rtt( double us ) { add_sample( rtt_us, us ); }
+      void add_block_latency( double us ) { add_sample( block_latency_us, std::max( us, 0.0 ) ); }
+
+      void add_bytes( uint64_t bytes, const fc::time_point& now ) {
+         window_bytes += bytes;
+         update_rate( now );
+      }
+
+      void update_rate( const fc::time_point& now ) {
+         auto elapsed = (now - window_start).count();
+         if( elapsed >= rate_window_us ) {
+            add_sample( bytes_per_sec, double(window_bytes) * 1'000'000 / elapsed );
+            window_bytes = 0;
+            window_start = now;
+         }
+      }
+
+      void decay( const fc::time_point& now ) {
+         auto elapsed = (now - last_decay).count();
+         if( elapsed > 0 ) {
+            double factor = std::exp2( -double(elapsed) / penalty_half_life_us );
+            rejected_blocks *= factor;
+            timeouts *= factor;
+            last_decay = now;
+         }
+      }
+
+      void add_rejected_block( const fc::time_point& now ) { decay( now ); rejected_blocks += 1; }
+      void add_timeout( const fc::time_point& now ) { decay( now ); timeouts += 1; }
+
+      /// 0 to 100, higher is better
+      double score( const fc::time_point& now ) {
+         decay( now );
+         update_rate( now );
+         double s = 90; // room for the throughput bonus
+         s -= std::min( rtt_us / 10'000, 20.0 );             // 1 point per 10ms
+         s -= std::min( block_latency_us / 50'000, 20.0 );   // 1 point per 50ms
+         s -= std::min( rejected_blocks * 10, 30.0 );
+         s -= std::min( timeouts * 5, 30.0 );
+         s += std::min( bytes_per_sec / (1024*1024), 10.0 ); // 1 point per MB/s
+         return std::max( std::min( s, 100.0 ), 0.0 );
+      }
+   };
+
+   /**
+    * The connections of conns ordered best score first, each scored once. Ties keep the order
+    * of conns. Too costly to run per relayed transaction, it is meant for block broadcast.
+    */
+   template<typename Range>
+   std::vector<typename Range::value_type> order_by_score( const Range& conns, const fc::time_point& now ) {
+      std::vector<std::pair<double, typename Range::value_type>> scored;
+      scored.reserve( conns.size() );
+      for( const auto& c : conns ) {
+         scored.emplace_back( c->quality.score( now ), c );
+      }
+      std::stable_sort( scored.begin(), scored.end(), []( const auto& a, const auto& b ) { return a.first > b.first; } );
+      std::vector<typename Range::value_type> result;
+      result.reserve( scored.size() );
+      for( auto& sc : scored ) {
+         result.emplace_back( std::move( sc.second ) );
+      }
+      return result;
+   }
+
+} // namespace eosio
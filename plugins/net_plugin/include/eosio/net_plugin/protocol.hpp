@@ -132,6 +132,36 @@ namespace eosio {
       uint32_t end_block;
    };
 
+   /**
+    * A transaction_receipt with the transaction replaced by its id, see compact_block_message
+    */
+   struct compact_receipt {
+      transaction_receipt_header header;
+      transaction_id_type        id;
+      bool                       packed = true; ///< false if the receipt only holds the id of a deferred transaction
+   };
+
+   /**
+    * A signed_block relayed without the packed transactions the receiver most likely already
+    * has from transaction relay. The receiver rebuilds the block from its own copies and asks
+    * for the rest with a get_block_transactions_message.
+    */
+   struct compact_block_message {
+      signed_block_header        header;
+      vector<compact_receipt>    receipts;
+      extensions_type            block_extensions;
+   };
+
+   struct get_block_transactions_message {
+      block_id_type              block_id;
+      vector<uint32_t>           indexes; ///< positions in compact_block_message::receipts
+   };
+
+   struct block_transactions_message {
+      block_id_type              block_id;
+      vector<packed_transaction> trxs; ///< in the order of the requested indexes
+   };
+
    using net_message = static_variant<handshake_message,
                                       chain_size_message,
                                       go_away_message,
@@ -140,7 +170,15 @@ namespace eosio {
                                       request_message,
                                       sync_request_message,
                                       signed_block,         // which = 7
-                                      packed_transaction>;  // which = 8
+                                      packed_transaction,   // which = 8
+                                      compact_block_message,          // which = 9
+                                      get_block_transactions_message, // which = 10
+                                      block_transactions_message>;    // which = 11
+
+   constexpr auto     message_header_size = 4;      // length prefix of every framed net_message
+   constexpr uint32_t signed_block_which = 7;        // see net_message
+   constexpr uint32_t packed_transaction_which = 8;  // see net_message
+   constexpr uint32_t compact_block_which = 9;       // see net_message
 
 } // namespace eosio
 
@@ -159,6 +197,10 @@ FC_REFLECT( eosio::time_message, (org)(rec)(xmt)(dst) )
 FC_REFLECT( eosio::notice_message, (known_trx)(known_blocks) )
 FC_REFLECT( eosio::request_message, (req_trx)(req_blocks) )
 FC_REFLECT( eosio::sync_request_message, (start_block)(end_block) )
+FC_REFLECT( eosio::compact_receipt, (header)(id)(packed) )
+FC_REFLECT( eosio::compact_block_message, (header)(receipts)(block_extensions) )
+FC_REFLECT( eosio::get_block_transactions_message, (block_id)(indexes) )
+FC_REFLECT( eosio::block_transactions_message, (block_id)(trxs) )
 
 /**
  *
@@ -0,0 +1,115 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/exceptions.hpp>
+#include <eosio/net_plugin/protocol.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/core/noncopyable.hpp>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * Outgoing messages of a connection. Buffers are shared_ptrs so a message serialized once,
+    * such as a broadcast block or transaction, is queued by reference on every connection.
+    * Each write gathers up to max_write_batch_size bytes of queued buffers into a single
+    * scatter-gather async_write.
+    */
+   class queued_buffer : boost::noncopyable {
+   public:
+      queued_buffer( uint32_t max_write_queue_size, size_t max_write_batch_size )
+      : _max_write_queue_size( max_write_queue_size ), _max_write_batch_size( max_write_batch_size ) {}
+
+      void clear_write_queue() {
+         _write_queue.clear();
+         _sync_write_queue.clear();
+         _write_queue_size = 0;
+      }
+
+      void clear_out_queue() {
+         _out_queue.clear();
+      }
+
+      uint32_t write_queue_size() const { return _write_queue_size; }
+
+      bool is_out_queue_empty() const { return _out_queue.empty(); }
+
+      bool ready_to_send() const {
+         // if out_queue is not empty then async_write is in progress
+         return ((!_sync_write_queue.empty() || !_write_queue.empty()) && _out_queue.empty());
+      }
+
+      bool add_write_queue( const std::shared_ptr<std::vector<char>>& buff,
+                            go_away_reason close_after_send,
+                            bool to_sync_queue ) {
+         if( to_sync_queue ) {
+            _sync_write_queue.push_back( {buff, close_after_send} );
+         } else {
+            _write_queue.push_back( {buff, close_after_send} );
+         }
+         _write_queue_size += buff->size();
+         if( _write_queue_size > 2 * _max_write_queue_size ) {
+            return false;
+         }
+         return true;
+      }
+
+      /// Move up to max_write_batch_size bytes, and at least one message, to the out queue
+      void fill_out_buffer( std::vector<boost::asio::const_buffer>& bufs ) {
+         size_t out_size = 0;
+         // always send msgs from sync_write_queue first
+         fill_out_buffer( bufs, _sync_write_queue, out_size );
+         if( _sync_write_queue.empty() ) { // postpone real_time write_queue if sync queue is not empty
+            fill_out_buffer( bufs, _write_queue, out_size );
+         }
+         EOS_ASSERT( _write_queue_size == 0 || !_write_queue.empty() || !_sync_write_queue.empty(),
+                     chain::plugin_exception, "write queue size expected to be zero" );
+      }
+
+      /// Reason given in a go_away_message being written, no_reason if the connection stays open
+      go_away_reason out_close_reason() const {
+         for( const auto& m : _out_queue ) {
+            if( m.close_after_send != no_reason )
+               return m.close_after_send;
+         }
+         return no_reason;
+      }
+
+   private:
+      struct queued_write;
+      void fill_out_buffer( std::vector<boost::asio::const_buffer>& bufs,
+                            std::deque<queued_write>& w_queue, size_t& out_size ) {
+         while ( w_queue.size() > 0 ) {
+            auto& m = w_queue.front();
+            if( out_size > 0 && out_size + m.buff->size() > _max_write_batch_size )
+               break;
+            bufs.push_back( boost::asio::buffer( *m.buff ));
+            out_size += m.buff->size();
+            _write_queue_size -= m.buff->size();
+            _out_queue.emplace_back( std::move( m ) );
+            w_queue.pop_front();
+         }
+      }
+
+   private:
+      struct queued_write {
+         std::shared_ptr<std::vector<char>> buff;
+         go_away_reason                     close_after_send = no_reason;
+      };
+
+      const uint32_t _max_write_queue_size;
+      const size_t   _max_write_batch_size;
+      uint32_t _write_queue_size = 0;
+      std::deque<queued_write> _write_queue;
+      std::deque<queued_write> _sync_write_queue; // sync_write_queue will be sent first
+      std::deque<queued_write> _out_queue;
+
+   }; // queued_buffer
+
+} // namespace eosio
@@ -0,0 +1,243 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <boost/asio/buffer.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * Thread safe pool of fixed size chunks shared by the receive_buffers of all connections.
+    *
+    * Released chunks are kept for reuse while the number of free chunks stays below the number
+    * in use (plus min_free), so the pool follows traffic: it grows while many connections are
+    * receiving and gives memory back once they go idle.
+    */
+   class buffer_pool {
+   public:
+      explicit buffer_pool( size_t chunk_size, size_t min_free = 16 )
+      : _chunk_size( chunk_size ), _min_free( min_free ) {}
+
+      ~buffer_pool() {
+         for( char* c : _free ) delete[] c;
+      }
+
+      buffer_pool( const buffer_pool& ) = delete;
+      buffer_pool& operator=( const buffer_pool& ) = delete;
+
+      size_t chunk_size() const { return _chunk_size; }
+
+      char* acquire() {
+         {
+            std::lock_guard<std::mutex> g( _mtx );
+            ++_in_use;
+            if( !_free.empty() ) {
+               char* c = _free.back();
+               _free.pop_back();
+               return c;
+            }
+         }
+         return new char[_chunk_size];
+      }
+
+      void release( char* c ) {
+         std::lock_guard<std::mutex> g( _mtx );
+         --_in_use;
+         _free.push_back( c );
+         while( _free.size() > _in_use + _min_free ) {
+            delete[] _free.back();
+            _free.pop_back();
+         }
+      }
+
+      /// chunks handed out and not yet released
+      size_t in_use() const {
+         std::lock_guard<std::mutex> g( _mtx );
+         return _in_use;
+      }
+
+      /// bytes of all chunks allocated by the pool, in use or free
+      size_t allocated_bytes() const {
+         std::lock_guard<std::mutex> g( _mtx );
+         return (_in_use + _free.size()) * _chunk_size;
+      }
+
+   private:
+      const size_t       _chunk_size;
+      const size_t       _min_free;
+      mutable std::mutex _mtx;
+      size_t             _in_use = 0;
+      std::vector<char*> _free;
+   };
+
+   /**
+    * Receive side of a connection, a queue of segments that are pool chunks or, for a message
+    * larger than a chunk, a single allocation sized to the message.
+    *
+    * Segments are returned as soon as their data is consumed, so an idle connection with no
+    * partial message buffered holds no memory. A message that is expected to arrive over
+    * several reads is given a contiguous segment up front (reserve_message), which lets it be
+    * unpacked in place rather than copied out of the buffer first.
+    *
+    * Not thread safe, only one read may be in flight for a connection.
+    */
+   class receive_buffer {
+   public:
+      explicit receive_buffer( std::shared_ptr<buffer_pool> pool ) : _pool( std::move( pool ) ) {}
+      ~receive_buffer() { reset(); }
+
+      receive_buffer( const receive_buffer& ) = delete;
+      receive_buffer& operator=( const receive_buffer& ) = delete;
+
+      /// Writable space for the next read, at least min_bytes
+      std::vector<boost::asio::mutable_buffer> prepare( size_t min_bytes ) {
+         min_bytes = std::max<size_t>( min_bytes, 1 );
+         size_t writable = 0;
+         for( auto i = first_writable(); i != _segments.end(); ++i ) {
+            writable += i->capacity - i->end;
+         }
+         while( writable < min_bytes ) {
+            add_segment( _pool->chunk_size() );
+            writable += _pool->chunk_size();
+         }
+         std::vector<boost::asio::mutable_buffer> bufs;
+         for( auto i = first_writable(); i != _segments.end(); ++i ) {
+            bufs.emplace_back( i->data + i->end, i->capacity - i->end );
+         }
+         return bufs;
+      }
+
+      /// Mark n bytes of the space returned by prepare as read from the socket
+      void commit( size_t n ) {
+         for( auto i = first_writable(); n > 0 && i != _segments.end(); ++i ) {
+            const size_t w = std::min( n, i->capacity - i->end );
+            i->end += w;
+            _size += w;
+            n -= w;
+         }
+      }
+
+      /// bytes received and not yet consumed
+      size_t size() const { return _size; }
+      bool empty() const { return _size == 0; }
+
+      /// Copy the first n readable bytes to dst without consuming them
+      void peek( void* dst, size_t n ) const {
+         char* out = static_cast<char*>( dst );
+         for( auto i = _segments.begin(); n > 0 && i != _segments.end(); ++i ) {
+            const size_t r = std::min( n, i->end - i->begin );
+            memcpy( out, i->data + i->begin, r );
+            out += r;
+            n -= r;
+         }
+      }
+
+      /**
+       * Pointer to the first n readable bytes, valid until they are consumed. Only when the
+       * bytes span segments are they copied, into scratch.
+       */
+      const char* contiguous( size_t n, std::vector<char>& scratch ) const {
+         const auto& front = _segments.front();
+         if( front.end - front.begin >= n ) {
+            return front.data + front.begin;
+         }
+         scratch.resize( n );
+         peek( scratch.data(), n );
+         return scratch.data();
+      }
+
+      void consume( size_t n ) {
+         _size -= n;
+         while( n > 0 ) {
+            auto& front = _segments.front();
+            const size_t r = std::min( n, front.end - front.begin );
+            front.begin += r;
+            n -= r;
+            if( front.begin == front.capacity || (front.begin == front.end && _segments.size() > 1) ) {
+               release_front();
+            }
+         }
+         if( _size == 0 ) {
+            reset(); // nothing partial buffered, give all segments back
+         }
+      }
+
+      /**
+       * The readable bytes are the start of a message of total_bytes. Move them to a segment
+       * large enough for the whole message, if the current one is not, so the rest of the
+       * message is read in after them.
+       */
+      void reserve_message( size_t total_bytes ) {
+         if( _segments.empty() ) return;
+         const auto& front = _segments.front();
+         if( front.end - front.begin == _size && front.capacity - front.begin >= total_bytes ) {
+            return; // already contiguous with room for the rest
+         }
+         segment s = make_segment( std::max( total_bytes, _pool->chunk_size() ) );
+         peek( s.data, _size );
+         s.end = _size;
+         while( !_segments.empty() ) release_front();
+         _segments.push_back( s );
+      }
+
+      void reset() {
+         while( !_segments.empty() ) release_front();
+         _size = 0;
+      }
+
+      /// bytes held by this buffer
+      size_t capacity() const {
+         size_t c = 0;
+         for( const auto& s : _segments ) c += s.capacity;
+         return c;
+      }
+
+   private:
+      struct segment {
+         char*  data = nullptr;
+         size_t capacity = 0;
+         size_t begin = 0; ///< next byte to consume
+         size_t end = 0;   ///< next byte to write
+      };
+
+      std::deque<segment>::iterator first_writable() {
+         auto i = _segments.begin();
+         while( i != _segments.end() && i->end == i->capacity ) ++i;
+         return i;
+      }
+
+      segment make_segment( size_t capacity ) {
+         segment s;
+         s.capacity = capacity;
+         s.data = capacity == _pool->chunk_size() ? _pool->acquire() : new char[capacity];
+         return s;
+      }
+
+      void add_segment( size_t capacity ) {
+         _segments.push_back( make_segment( capacity ) );
+      }
+
+      void release_front() {
+         auto& s = _segments.front();
+         if( s.capacity == _pool->chunk_size() ) {
+            _pool->release( s.data );
+         } else {
+            delete[] s.data;
+         }
+         _segments.pop_front();
+      }
+
+      std::shared_ptr<buffer_pool> _pool;
+      std::deque<segment>          _segments;
+      size_t                       _size = 0;
+   };
+
+} // namespace eosio
@@ -0,0 +1,95 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <fc/crypto/sha256.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * Approximate set of the most recently inserted ids in a fixed amount of memory.
+    *
+    * Two bloom filters are kept, each sized for half the capacity. Once the current one
+    * holds half the capacity it replaces the previous one, forgetting the oldest entries.
+    * contains() can report false positives at roughly the configured rate, and reports
+    * false negatives only for ids that have rolled out of both generations.
+    *
+    * Only meant for ids that are already cryptographic hashes, the bit positions are taken
+    * straight from the id words mixed with a per-filter random tweak.
+    */
+   class rolling_bloom_filter {
+   public:
+      rolling_bloom_filter( uint32_t capacity, double fp_rate )
+      : generation_size( std::max<uint32_t>( capacity / 2, 1 ) )
+      {
+         const double ln2 = std::log( 2.0 );
+         const double bits = std::ceil( -double(generation_size) * std::log( fp_rate ) / (ln2 * ln2) );
+         num_bits = std::max<uint64_t>( static_cast<uint64_t>( bits ), 64 );
+         num_hashes = std::max<uint32_t>( static_cast<uint32_t>( std::round( bits / generation_size * ln2 ) ), 1 );
+         current.resize( (num_bits + 63) / 64 );
+         previous.resize( current.size() );
+         std::random_device rd;
+         tweak = (uint64_t(rd()) << 32) | rd();
+      }
+
+      void insert( const fc::sha256& id ) {
+         if( contains( current, id ) ) return;
+         if( current_count >= generation_size ) {
+            std::swap( current, previous );
+            std::fill( current.begin(), current.end(), 0 );
+            current_count = 0;
+         }
+         uint64_t h1 = 0, h2 = 0;
+         hashes( id, h1, h2 );
+         for( uint32_t i = 0; i < num_hashes; ++i ) {
+            const uint64_t bit = (h1 + i * h2) % num_bits;
+            current[bit / 64] |= uint64_t(1) << (bit % 64);
+         }
+         ++current_count;
+      }
+
+      bool contains( const fc::sha256& id ) const {
+         return contains( current, id ) || contains( previous, id );
+      }
+
+      void clear() {
+         std::fill( current.begin(), current.end(), 0 );
+         std::fill( previous.begin(), previous.end(), 0 );
+         current_count = 0;
+      }
+
+      /// memory used by the bit arrays
+      size_t memory_size() const { return (current.size() + previous.size()) * sizeof(uint64_t); }
+
+   private:
+      void hashes( const fc::sha256& id, uint64_t& h1, uint64_t& h2 ) const {
+         h1 = id._hash[0] ^ tweak;
+         h2 = (id._hash[1] ^ (tweak << 17 | tweak >> 47)) | 1; // odd, so the probes never collapse onto h1
+      }
+
+      bool contains( const std::vector<uint64_t>& bits, const fc::sha256& id ) const {
+         uint64_t h1 = 0, h2 = 0;
+         hashes( id, h1, h2 );
+         for( uint32_t i = 0; i < num_hashes; ++i ) {
+            const uint64_t bit = (h1 + i * h2) % num_bits;
+            if( !(bits[bit / 64] & (uint64_t(1) << (bit % 64))) ) return false;
+         }
+         return true;
+      }
+
+      uint32_t              generation_size;
+      uint32_t              current_count = 0;
+      uint64_t              num_bits = 0;
+      uint32_t              num_hashes = 0;
+      uint64_t              tweak = 0;
+      std::vector<uint64_t> current;
+      std::vector<uint64_t> previous;
+   };
+
+} // namespace eosio
@@ -0,0 +1,144 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <fc/optional.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <utility>
+
+namespace eosio {
+
+   /**
+    * Book keeping of the block ranges requested from peers during lib catchup.
+    *
+    * Every range in flight is a chunk with the peer it was requested from. The remainder of a
+    * chunk whose peer was closed or timed out is returned and requested again, possibly from a
+    * different peer, so blocks of a range can arrive twice or late. Blocks received past the next
+    * expected block are held, keyed by block number, until the gap in front of them is filled.
+    *
+    * Peer is a pointer like handle compared with ==, Held is whatever is kept for a held block.
+    */
+   template<typename Peer, typename Held>
+   class sync_chunks {
+   public:
+      /// a range of blocks requested from one peer
+      struct chunk {
+         uint32_t start_block = 0;
+         uint32_t end_block = 0;
+         uint32_t last_received = 0;
+         Peer     source;
+      };
+
+      enum class disposition {
+         apply, ///< the next expected block
+         hold,  ///< ahead of the next expected block and requested, keep until the gap is filled
+         drop   ///< already applied or never requested, a duplicate or late block of a reassigned range
+      };
+
+      /// What to do with block blk_num received while next_expected is the next block to apply
+      static disposition classify( uint32_t blk_num, uint32_t next_expected, uint32_t last_requested ) {
+         if( blk_num == next_expected ) {
+            return disposition::apply;
+         }
+         if( blk_num < next_expected || blk_num > last_requested ) {
+            return disposition::drop;
+         }
+         return disposition::hold;
+      }
+
+      /// The first returned range waiting to be requested again
+      fc::optional<std::pair<uint32_t, uint32_t>> first_unassigned() const {
+         if( unassigned.empty() ) {
+            return {};
+         }
+         return *unassigned.begin();
+      }
+
+      /// Assign start to end to source. If start begins the first returned range, that much of it is taken.
+      void assign( uint32_t start, uint32_t end, const Peer& source ) {
+         if( !unassigned.empty() && unassigned.begin()->first == start ) {
+            auto rest_end = unassigned.begin()->second;
+            unassigned.erase( unassigned.begin() );
+            if( end < rest_end ) {
+               unassigned[end + 1] = rest_end;
+            }
+         }
+         chunks[start] = chunk{start, end, start - 1, source};
+      }
+
+      size_t chunk_count( const Peer& c ) const {
+         return std::count_if( chunks.begin(), chunks.end(), [&c]( const auto& ch ) { return ch.second.source == c; } );
+      }
+
+      bool empty() const { return chunks.empty(); }
+
+      /// Record blk_num from c, finishing its chunk at the last block. Blocks of ranges c no longer holds are ignored.
+      void block_received( const Peer& c, uint32_t blk_num ) {
+         auto it = chunks.upper_bound( blk_num );
+         if( it == chunks.begin() ) {
+            return;
+         }
+         --it;
+         auto& ch = it->second;
+         if( ch.source == c && blk_num <= ch.end_block ) {
+            ch.last_received = std::max( ch.last_received, blk_num );
+            if( blk_num == ch.end_block ) {
+               chunks.erase( it );
+            }
+         }
+      }
+
+      /// Drop the chunks of c, the parts not yet received are requested again. Returns true if c had any.
+      bool return_chunks( const Peer& c ) {
+         bool returned = false;
+         for( auto it = chunks.begin(); it != chunks.end(); ) {
+            const auto& ch = it->second;
+            if( !(ch.source == c) ) {
+               ++it;
+               continue;
+            }
+            if( ch.last_received < ch.end_block ) {
+               unassigned[ch.last_received + 1] = ch.end_block;
+            }
+            it = chunks.erase( it );
+            returned = true;
+         }
+         return returned;
+      }
+
+      /// Keep a block until it is next, a second copy of a held block is ignored
+      void hold( uint32_t blk_num, Held h ) {
+         held.emplace( blk_num, std::move( h ) );
+      }
+
+      /// Take the held block next_expected, forgetting any held below it
+      fc::optional<Held> release( uint32_t next_expected ) {
+         held.erase( held.begin(), held.lower_bound( next_expected ) );
+         auto it = held.find( next_expected );
+         if( it == held.end() ) {
+            return {};
+         }
+         fc::optional<Held> h = std::move( it->second );
+         held.erase( it );
+         return h;
+      }
+
+      size_t held_count() const { return held.size(); }
+
+      void clear() {
+         chunks.clear();
+         unassigned.clear();
+         held.clear();
+      }
+
+   private:
+      std::map<uint32_t, chunk>     chunks;     ///< in flight, by start_block
+      std::map<uint32_t, uint32_t>  unassigned; ///< start to end of ranges to request again
+      std::map<uint32_t, Held>      held;       ///< received ahead of the next expected block
+   };
+
+} // namespace eosio
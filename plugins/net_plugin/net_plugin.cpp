@@ -6,6 +6,13 @@
 
 #include <eosio/net_plugin/net_plugin.hpp>
 #include <eosio/net_plugin/protocol.hpp>
+#include <eosio/net_plugin/compact_block.hpp>
+#include <eosio/net_plugin/peer_quality.hpp>
+#include <eosio/net_plugin/queued_buffer.hpp>
+#include <eosio/net_plugin/message_decoder.hpp>
+#include <eosio/net_plugin/sync_chunks.hpp>
+#include <eosio/net_plugin/rolling_bloom_filter.hpp>
+#include <eosio/net_plugin/receive_buffer.hpp>
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <eosio/chain/block.hpp>
@@ -14,7 +21,6 @@
 #include <eosio/producer_plugin/producer_plugin.hpp>
 #include <eosio/chain/contract_types.hpp>
 
-#include <fc/network/message_buffer.hpp>
 #include <fc/network/ip.hpp>
 #include <fc/io/json.hpp>
 #include <fc/io/raw.hpp>
@@ -22,12 +28,17 @@
 #include <fc/log/logger_config.hpp>
 #include <fc/reflect/variant.hpp>
 #include <fc/crypto/rand.hpp>
+#include <fc/scoped_exit.hpp>
 #include <fc/exception/exception.hpp>
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/steady_timer.hpp>
 
+#include <atomic>
+#include <cmath>
+#include <mutex>
+
 using namespace eosio::chain::plugin_interface::compat;
 
 namespace eosio {
@@ -49,6 +60,7 @@ namespace eosio {
 
    class sync_manager;
    class dispatch_manager;
+   class known_ids_cache;
 
    using connection_ptr = std::shared_ptr<connection>;
    using connection_wptr = std::weak_ptr<connection>;
@@ -114,15 +126,22 @@ namespace eosio {
       possible_connections             allowed_connections{None};
 
       connection_ptr find_connection(const string& host)const;
+      /// connections ordered best peer_quality score first, for block broadcast and fetch retries only
+      vector<connection_ptr> connections_by_score()const;
 
       std::set< connection_ptr >       connections;
       bool                             done = false;
       unique_ptr< sync_manager >       sync_master;
       unique_ptr< dispatch_manager >   dispatcher;
+      unique_ptr< known_ids_cache >    known_ids;
 
       unique_ptr<boost::asio::steady_timer> connector_check;
       unique_ptr<boost::asio::steady_timer> transaction_check;
       unique_ptr<boost::asio::steady_timer> keepalive_timer;
+      unique_ptr<boost::asio::steady_timer> trx_announce_timer;
+      bool                                  trx_announce_scheduled = false;
+      boost::asio::steady_timer::duration   trx_announce_interval;
+      bool                                  trx_inventory_relay = false; ///< announce transaction ids rather than pushing transactions
       boost::asio::steady_timer::duration   connector_period;
       boost::asio::steady_timer::duration   txn_exp_period;
       boost::asio::steady_timer::duration   resp_expected_period;
@@ -141,6 +160,7 @@ namespace eosio {
       int                           started_sessions = 0;
 
       node_transaction_index        local_txns;
+      std::shared_ptr<buffer_pool>  recv_buffer_pool; ///< chunks for the receive_buffer of every connection
 
       shared_ptr<tcp::resolver>     resolver;
 
@@ -156,23 +176,15 @@ namespace eosio {
       bool start_session(const connection_ptr& c);
       void start_listen_loop();
       void start_read_message(const connection_ptr& c);
+      /// Read at least minimum_read bytes into the connection's receive_buffer, then decode and dispatch them; runs on the connection's strand
+      void start_async_read(const connection_ptr& c, std::size_t minimum_read);
 
-      /** \brief Process the next message from the pending message buffer
-       *
-       * Process the next message from the pending_message_buffer.
-       * message_length is the already determined length of the data
-       * part of the message that will handle the message.
-       * Returns true is successful. Returns false if an error was
-       * encountered unpacking or processing the message.
-       */
-      bool process_next_message(const connection_ptr& conn, uint32_t message_length);
+      /// Hand a message produced by decode_messages to its handler, called on the main thread
+      void dispatch_message(const connection_ptr& conn, decoded_message& msg);
 
       void close(const connection_ptr& c);
       size_t count_open_sockets() const;
 
-      template<typename VerifierFunc>
-      void send_transaction_to_all( const std::shared_ptr<std::vector<char>>& send_buffer, VerifierFunc verify );
-
       void accepted_block(const block_state_ptr&);
       void transaction_ack(const std::pair<fc::exception_ptr, transaction_metadata_ptr>&);
 
@@ -200,13 +212,31 @@ namespace eosio {
       void handle_message(const connection_ptr& c, const request_message& msg);
       void handle_message(const connection_ptr& c, const sync_request_message& msg);
       void handle_message(const connection_ptr& c, const signed_block& msg) = delete; // signed_block_ptr overload used instead
-      void handle_message(const connection_ptr& c, const signed_block_ptr& msg);
-      void handle_message(const connection_ptr& c, const packed_transaction& msg) = delete; // packed_transaction_ptr overload used instead
-      void handle_message(const connection_ptr& c, const packed_transaction_ptr& msg);
+      void handle_message(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id);
+      /// Apply a block received from c, handle_message holds sync blocks until they can be applied in order
+      void process_block(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id);
+      void handle_message(const connection_ptr& c, const packed_transaction& msg) = delete; // transaction_metadata_ptr overload used instead
+      void handle_message(const connection_ptr& c, const transaction_metadata_ptr& trx);
+      void handle_message(const connection_ptr& c, const compact_block_message& msg);
+      void handle_message(const connection_ptr& c, const get_block_transactions_message& msg);
+      void handle_message(const connection_ptr& c, const block_transactions_message& msg);
+
+      /** \brief Rebuild and accept a compact block once all of its transactions are available
+       *
+       * Falls back to requesting the full block if the rebuilt block does not match
+       * the transaction_mroot of its header.
+       */
+      void accept_compact_block(const connection_ptr& c, const pending_compact_block& pending);
+      /// Ask c for the full block, used when a compact block cannot be completed
+      void request_full_block(const connection_ptr& c, const block_id_type& blk_id);
 
       void start_conn_timer(boost::asio::steady_timer::duration du, std::weak_ptr<connection> from_connection);
       void start_txn_timer();
       void start_monitors();
+      /// Arm trx_announce_timer unless a flush of the pending announcements is already scheduled
+      void schedule_trx_announcements();
+      /// Send each connection its pending_trx_announcements as a notice_message
+      void flush_trx_announcements();
 
       void expire_txns();
       void expire_local_txns();
@@ -290,6 +320,8 @@ namespace eosio {
    constexpr auto     def_send_buffer_size_mb = 4;
    constexpr auto     def_send_buffer_size = 1024*1024*def_send_buffer_size_mb;
    constexpr auto     def_max_write_queue_size = def_send_buffer_size*10;
+   constexpr auto     def_max_write_batch_size = def_send_buffer_size; // bytes gathered into one async_write
+   constexpr auto     def_recv_chunk_size = 32*1024;  // see buffer_pool
    constexpr boost::asio::chrono::milliseconds def_read_delay_for_full_write_queue{100};
    constexpr auto     def_max_reads_in_flight = 1000;
    constexpr auto     def_max_trx_in_progress_size = 100*1024*1024; // 100 MB
@@ -299,10 +331,14 @@ namespace eosio {
    constexpr auto     def_txn_expire_wait = std::chrono::seconds(3);
    constexpr auto     def_resp_expected_wait = std::chrono::seconds(5);
    constexpr auto     def_sync_fetch_span = 100;
-
-   constexpr auto     message_header_size = 4;
-   constexpr uint32_t signed_block_which = 7;        // see protocol net_message
-   constexpr uint32_t packed_transaction_which = 8;  // see protocol net_message
+   constexpr auto     def_sync_peer_chunks = 4;
+   constexpr auto     def_max_pending_compact_blocks = 4; // per connection, waiting on block_transactions_message
+   constexpr auto     def_sync_fetch_window = 2000;
+   constexpr auto     def_trx_announce_interval_ms = 5;
+   constexpr auto     def_known_trxs_capacity = 50000;   // per connection, see rolling_bloom_filter
+   constexpr double   def_known_trxs_fp_rate = 0.001;
+   constexpr auto     def_max_trx_announcement = 4096;   // ids in one notice_message
+   constexpr auto     def_trx_request_timeout_ms = 1000;  // before an announced trx may be requested from another peer
 
    /**
     *  For a while, network version was a 16 bit value equal to the second set of 16 bits
@@ -324,8 +360,11 @@ namespace eosio {
     */
    constexpr uint16_t proto_base = 0;
    constexpr uint16_t proto_explicit_sync = 1;
+   constexpr uint16_t proto_compact_blocks = 2;      // compact_block_message and transaction round trip
+   constexpr uint16_t proto_parallel_sync = 3;       // sync_request_messages are queued rather than replaced
+   constexpr uint16_t proto_trx_inventory = 4;       // transaction ids announced with notice_message and requested
 
-   constexpr uint16_t net_version = proto_explicit_sync;
+   constexpr uint16_t net_version = proto_trx_inventory;
 
    struct transaction_state {
       transaction_id_type id;
@@ -363,6 +402,76 @@ namespace eosio {
          >
       > peer_block_state_index;
 
+   struct known_block_state {
+      block_id_type id;
+      uint32_t      block_num = 0;
+   };
+
+   typedef multi_index_container<
+      known_block_state,
+      indexed_by<
+         ordered_unique< tag<by_id>, member<known_block_state, block_id_type, &known_block_state::id >, sha256_less >,
+         ordered_non_unique< tag<by_block_num>, member<known_block_state, uint32_t, &known_block_state::block_num > >
+         >
+      > known_block_state_index;
+
+   /**
+    * Ids of blocks already accepted and of transactions already handed to the chain.
+    * Written by the main thread and consulted by the net threads, which drop duplicate
+    * blocks and transactions right after decoding instead of posting them to the main thread.
+    * Block ids are only kept above LIB, blocks at or below it are recognized by number.
+    */
+   class known_ids_cache {
+   public:
+      bool has_block( const block_id_type& id ) const {
+         std::lock_guard<std::mutex> g( mtx );
+         return blocks.find( id ) != blocks.end();
+      }
+
+      void add_block( const block_id_type& id, uint32_t block_num ) {
+         std::lock_guard<std::mutex> g( mtx );
+         blocks.insert( known_block_state{id, block_num} );
+      }
+
+      bool is_irreversible( uint32_t block_num ) const {
+         return block_num <= lib_num.load();
+      }
+
+      void set_lib( uint32_t lib ) {
+         lib_num = lib;
+      }
+
+      bool has_transaction( const transaction_id_type& id ) const {
+         std::lock_guard<std::mutex> g( mtx );
+         return trxs.find( id ) != trxs.end();
+      }
+
+      /// @return false if the transaction was already known
+      bool add_transaction( const transaction_id_type& id, const time_point_sec& expires ) {
+         std::lock_guard<std::mutex> g( mtx );
+         return trxs.insert( transaction_state{id, 0, expires} ).second;
+      }
+
+      void remove_transaction( const transaction_id_type& id ) {
+         std::lock_guard<std::mutex> g( mtx );
+         trxs.erase( id );
+      }
+
+      void expire( uint32_t lib, const time_point& now ) {
+         set_lib( lib );
+         std::lock_guard<std::mutex> g( mtx );
+         auto& stale_blk = blocks.get<by_block_num>();
+         stale_blk.erase( stale_blk.lower_bound( 0 ), stale_blk.upper_bound( lib ) );
+         auto& stale_trx = trxs.get<by_expiry>();
+         stale_trx.erase( stale_trx.lower_bound( time_point_sec() ), stale_trx.upper_bound( now ) );
+      }
+
+   private:
+      mutable std::mutex      mtx;
+      known_block_state_index blocks;
+      transaction_state_index trxs;
+      std::atomic<uint32_t>   lib_num{0}; ///< block 0 does not exist, nothing is irreversible until set_lib()
+   };
 
    struct update_block_num {
       uint32_t new_bnum;
@@ -393,86 +502,6 @@ namespace eosio {
       static void populate(handshake_message &hello);
    };
 
-   class queued_buffer : boost::noncopyable {
-   public:
-      void clear_write_queue() {
-         _write_queue.clear();
-         _sync_write_queue.clear();
-         _write_queue_size = 0;
-      }
-
-      void clear_out_queue() {
-         while ( _out_queue.size() > 0 ) {
-            _out_queue.pop_front();
-         }
-      }
-
-      uint32_t write_queue_size() const { return _write_queue_size; }
-
-      bool is_out_queue_empty() const { return _out_queue.empty(); }
-
-      bool ready_to_send() const {
-         // if out_queue is not empty then async_write is in progress
-         return ((!_sync_write_queue.empty() || !_write_queue.empty()) && _out_queue.empty());
-      }
-
-      bool add_write_queue( const std::shared_ptr<vector<char>>& buff,
-                            std::function<void( boost::system::error_code, std::size_t )> callback,
-                            bool to_sync_queue ) {
-         if( to_sync_queue ) {
-            _sync_write_queue.push_back( {buff, callback} );
-         } else {
-            _write_queue.push_back( {buff, callback} );
-         }
-         _write_queue_size += buff->size();
-         if( _write_queue_size > 2 * def_max_write_queue_size ) {
-            return false;
-         }
-         return true;
-      }
-
-      void fill_out_buffer( std::vector<boost::asio::const_buffer>& bufs ) {
-         if( _sync_write_queue.size() > 0 ) { // always send msgs from sync_write_queue first
-            fill_out_buffer( bufs, _sync_write_queue );
-         } else { // postpone real_time write_queue if sync queue is not empty
-            fill_out_buffer( bufs, _write_queue );
-            EOS_ASSERT( _write_queue_size == 0, plugin_exception, "write queue size expected to be zero" );
-         }
-      }
-
-      void out_callback( boost::system::error_code ec, std::size_t w ) {
-         for( auto& m : _out_queue ) {
-            m.callback( ec, w );
-         }
-      }
-
-   private:
-      struct queued_write;
-      void fill_out_buffer( std::vector<boost::asio::const_buffer>& bufs,
-                            deque<queued_write>& w_queue ) {
-         while ( w_queue.size() > 0 ) {
-            auto& m = w_queue.front();
-            bufs.push_back( boost::asio::buffer( *m.buff ));
-            _write_queue_size -= m.buff->size();
-            _out_queue.emplace_back( m );
-            w_queue.pop_front();
-         }
-      }
-
-   private:
-      struct queued_write {
-         std::shared_ptr<vector<char>> buff;
-         std::function<void( boost::system::error_code, std::size_t )> callback;
-      };
-
-      uint32_t _write_queue_size = 0;
-      deque<queued_write> _write_queue;
-      deque<queued_write> _sync_write_queue; // sync_write_queue will be sent first
-      deque<queued_write> _out_queue;
-
-   }; // queued_buffer
-
-
    class connection : public std::enable_shared_from_this<connection> {
    public:
       explicit connection( string endpoint );
@@ -482,13 +511,15 @@ namespace eosio {
       void initialize();
 
       peer_block_state_index  blk_state;
-      transaction_state_index trx_state;
+      rolling_bloom_filter    known_trxs;      // transactions sent to, received from or announced by this peer
+      vector<transaction_id_type> pending_trx_announcements; // see net_plugin_impl::flush_trx_announcements
       optional<sync_state>    peer_requested;  // this peer is requesting info from us
+      deque<sync_state>       queued_sync_requests; // requested while peer_requested is being sent, see proto_parallel_sync
       boost::asio::io_context&                  server_ioc;
-      boost::asio::io_context::strand           strand;
+      boost::asio::io_context::strand           strand; ///< on the net threads, the reads and pending_message_buffer are confined to it
       socket_ptr                                socket;
 
-      fc::message_buffer<1024*1024>    pending_message_buffer;
+      receive_buffer                   pending_message_buffer;
       fc::optional<std::size_t>        outstanding_read_bytes;
 
 
@@ -510,6 +541,8 @@ namespace eosio {
       block_id_type          fork_head;
       uint32_t               fork_head_num = 0;
       optional<request_message> last_req;
+      pending_compact_blocks  pending_compacts; ///< compact blocks waiting on a block_transactions_message
+      peer_quality           quality;
 
       connection_status get_status()const {
          connection_status stat;
@@ -593,7 +626,7 @@ namespace eosio {
       void queue_write(const std::shared_ptr<vector<char>>& buff,
                        bool trigger_send,
                        int priority,
-                       std::function<void(boost::system::error_code, std::size_t)> callback,
+                       go_away_reason close_after_send,
                        bool to_sync_queue = false);
       void do_queue_write(int priority);
 
@@ -632,23 +665,24 @@ namespace eosio {
       msg_handler( net_plugin_impl &imp, const connection_ptr& conn) : impl(imp), c(conn) {}
 
       void operator()( const signed_block& msg ) const {
-         EOS_ASSERT( false, plugin_config_exception, "operator()(signed_block&&) should be called" );
+         EOS_ASSERT( false, plugin_config_exception, "signed_block should be dispatched as a decoded_message" );
       }
       void operator()( signed_block& msg ) const {
-         EOS_ASSERT( false, plugin_config_exception, "operator()(signed_block&&) should be called" );
+         EOS_ASSERT( false, plugin_config_exception, "signed_block should be dispatched as a decoded_message" );
       }
       void operator()( const packed_transaction& msg ) const {
-         EOS_ASSERT( false, plugin_config_exception, "operator()(packed_transaction&&) should be called" );
+         EOS_ASSERT( false, plugin_config_exception, "packed_transaction should be dispatched as a decoded_message" );
       }
       void operator()( packed_transaction& msg ) const {
-         EOS_ASSERT( false, plugin_config_exception, "operator()(packed_transaction&&) should be called" );
+         EOS_ASSERT( false, plugin_config_exception, "packed_transaction should be dispatched as a decoded_message" );
       }
 
+      // blocks and transactions are converted while decoding, see net_plugin_impl::dispatch_message
       void operator()( signed_block&& msg ) const {
-         impl.handle_message( c, std::make_shared<signed_block>( std::move( msg ) ) );
+         EOS_ASSERT( false, plugin_config_exception, "signed_block should be dispatched as a decoded_message" );
       }
       void operator()( packed_transaction&& msg ) const {
-         impl.handle_message( c, std::make_shared<packed_transaction>( std::move( msg ) ) );
+         EOS_ASSERT( false, plugin_config_exception, "packed_transaction should be dispatched as a decoded_message" );
       }
 
       template <typename T>
@@ -658,6 +692,12 @@ namespace eosio {
       }
    };
 
+   struct held_sync_block {
+      connection_ptr   conn;
+      signed_block_ptr block;
+      block_id_type    id;
+   };
+
    class sync_manager {
    private:
       enum stages {
@@ -666,19 +706,27 @@ namespace eosio {
          in_sync
       };
 
+      using fetch_chunks = sync_chunks<connection_ptr, held_sync_block>;
+
       uint32_t       sync_known_lib_num;
       uint32_t       sync_last_requested_num;
       uint32_t       sync_next_expected_num;
       uint32_t       sync_req_span;
-      connection_ptr source;
+      uint32_t       sync_peer_chunks;  ///< chunks in flight per peer
+      uint32_t       sync_fetch_window; ///< blocks requested ahead of sync_next_expected_num
       stages         state;
 
+      fetch_chunks   chunks;            ///< ranges in flight and blocks held ahead of sync_next_expected_num
+
       chain_plugin* chain_plug = nullptr;
 
       constexpr static auto stage_str(stages s);
 
+      connection_ptr select_source(uint32_t start, const connection_ptr& preferred);
+      void chunk_block_received(const connection_ptr& c, uint32_t blk_num);
+
    public:
-      explicit sync_manager(uint32_t span);
+      sync_manager(uint32_t span, uint32_t peer_chunks, uint32_t fetch_window);
       void set_state(stages s);
       bool sync_required();
       void send_handshakes();
@@ -692,12 +740,25 @@ namespace eosio {
       void recv_block(const connection_ptr& c, const block_id_type& blk_id, uint32_t blk_num);
       void recv_handshake(const connection_ptr& c, const handshake_message& msg);
       void recv_notice(const connection_ptr& c, const notice_message& msg);
+
+      /** \brief Hold or drop a sync block that is not the next expected block
+       *
+       * Chunks from different peers arrive out of order, blocks past a gap are kept
+       * until the gap is filled so they can be applied in order. Blocks already applied
+       * or past the requested range, routine once chunks are returned and requested
+       * again, are dropped without closing the peer.
+       * Returns true if the block was held or dropped.
+       */
+      bool hold_block(const connection_ptr& c, const signed_block_ptr& b, const block_id_type& blk_id);
+      /// Take the held block that is next to be applied, if it has arrived
+      bool release_held_block(held_sync_block& hb);
    };
 
    class dispatch_manager {
    public:
       std::multimap<block_id_type, connection_ptr, sha256_less> received_blocks;
       std::multimap<transaction_id_type, connection_ptr, sha256_less> received_transactions;
+      std::map<transaction_id_type, time_point, sha256_less> requested_trxs; ///< announced ids asked for, so only one peer is asked at a time
 
       void bcast_transaction(const transaction_metadata_ptr& trx);
       void rejected_transaction(const transaction_id_type& msg);
@@ -708,6 +769,9 @@ namespace eosio {
       void expire_blocks( uint32_t bnum );
       void recv_transaction(const connection_ptr& conn, const transaction_id_type& id);
       void recv_notice(const connection_ptr& conn, const notice_message& msg, bool generated);
+      /// Request the announced transactions not already known, see proto_trx_inventory
+      void recv_trx_announcement(const connection_ptr& conn, const vector<transaction_id_type>& ids);
+      void expire_trx_requests(const time_point& now);
 
       void retry_fetch(const connection_ptr& conn);
    };
@@ -716,11 +780,13 @@ namespace eosio {
 
    connection::connection( string endpoint )
       : blk_state(),
-        trx_state(),
+        known_trxs( def_known_trxs_capacity, def_known_trxs_fp_rate ),
         peer_requested(),
         server_ioc( my_impl->thread_pool->get_executor() ),
-        strand( app().get_io_service() ),
+        strand( my_impl->thread_pool->get_executor() ),
         socket( std::make_shared<tcp::socket>( my_impl->thread_pool->get_executor() ) ),
+        pending_message_buffer( my_impl->recv_buffer_pool ),
+        buffer_queue( def_max_write_queue_size, def_max_write_batch_size ),
         node_id(),
         last_handshake_recv(),
         last_handshake_sent(),
@@ -734,7 +800,8 @@ namespace eosio {
         no_retry(no_reason),
         fork_head(),
         fork_head_num(0),
-        last_req()
+        last_req(),
+        pending_compacts( def_max_pending_compact_blocks )
    {
       fc_ilog( logger, "created connection to ${n}", ("n", endpoint) );
       initialize();
@@ -742,11 +809,13 @@ namespace eosio {
 
    connection::connection( socket_ptr s )
       : blk_state(),
-        trx_state(),
+        known_trxs( def_known_trxs_capacity, def_known_trxs_fp_rate ),
         peer_requested(),
         server_ioc( my_impl->thread_pool->get_executor() ),
-        strand( app().get_io_service() ),
+        strand( my_impl->thread_pool->get_executor() ),
         socket( s ),
+        pending_message_buffer( my_impl->recv_buffer_pool ),
+        buffer_queue( def_max_write_queue_size, def_max_write_batch_size ),
         node_id(),
         last_handshake_recv(),
         last_handshake_sent(),
@@ -760,7 +829,8 @@ namespace eosio {
         no_retry(no_reason),
         fork_head(),
         fork_head_num(0),
-        last_req()
+        last_req(),
+        pending_compacts( def_max_pending_compact_blocks )
    {
       fc_ilog( logger, "accepted network connection" );
       initialize();
@@ -785,8 +855,11 @@ namespace eosio {
 
    void connection::reset() {
       peer_requested.reset();
+      queued_sync_requests.clear();
+      pending_compacts.clear();
       blk_state.clear();
-      trx_state.clear();
+      known_trxs.clear();
+      pending_trx_announcements.clear();
    }
 
    void connection::flush_queues() {
@@ -822,7 +895,7 @@ namespace eosio {
       for(auto tx = my_impl->local_txns.begin(); tx != my_impl->local_txns.end(); ++tx ){
          const bool found = known_ids.find( tx->id ) != known_ids.cend();
          if( !found ) {
-            queue_write( tx->serialized_txn, true, priority::low, []( boost::system::error_code ec, std::size_t ) {} );
+            queue_write( tx->serialized_txn, true, priority::low, no_reason );
          }
       }
    }
@@ -831,7 +904,7 @@ namespace eosio {
       for(const auto& t : ids) {
          auto tx = my_impl->local_txns.get<by_id>().find(t);
          if( tx != my_impl->local_txns.end() ) {
-            queue_write( tx->serialized_txn, true, priority::low, []( boost::system::error_code ec, std::size_t ) {} );
+            queue_write( tx->serialized_txn, true, priority::low, no_reason );
          }
       }
    }
@@ -941,9 +1014,9 @@ namespace eosio {
    void connection::queue_write(const std::shared_ptr<vector<char>>& buff,
                                 bool trigger_send,
                                 int priority,
-                                std::function<void(boost::system::error_code, std::size_t)> callback,
+                                go_away_reason close_after_send,
                                 bool to_sync_queue) {
-      if( !buffer_queue.add_write_queue( buff, callback, to_sync_queue )) {
+      if( !buffer_queue.add_write_queue( buff, close_after_send, to_sync_queue )) {
          fc_wlog( logger, "write_queue full ${s} bytes, giving up on connection ${p}",
                   ("s", buffer_queue.write_queue_size())("p", peer_name()) );
          my_impl->close( shared_from_this() );
@@ -967,15 +1040,13 @@ namespace eosio {
       buffer_queue.fill_out_buffer( bufs );
 
       boost::asio::async_write(*socket, bufs,
-            boost::asio::bind_executor(strand, [c, priority]( boost::system::error_code ec, std::size_t w ) {
-         app().post(priority, [c, priority, ec, w]() {
+            boost::asio::bind_executor(strand, [c, priority]( boost::system::error_code ec, std::size_t ) {
+         app().post(priority, [c, priority, ec]() {
             try {
                auto conn = c.lock();
                if(!conn)
                   return;
 
-               conn->buffer_queue.out_callback( ec, w );
-
                if(ec) {
                   string pname = conn ? conn->peer_name() : "no connection name";
                   if( ec.value() != boost::asio::error::eof) {
@@ -987,8 +1058,16 @@ namespace eosio {
                   my_impl->close(conn);
                   return;
                }
+               go_away_reason close_after_send = conn->buffer_queue.out_close_reason();
+               if( close_after_send != no_reason ) {
+                  fc_elog( logger, "sent a go away message: ${r}, closing connection to ${p}",
+                           ("r", reason_str(close_after_send))("p", conn->peer_name()) );
+                  my_impl->close(conn);
+                  return;
+               }
                conn->buffer_queue.clear_out_queue();
-               conn->enqueue_sync_block();
+               // queue enough sync blocks that the next write carries a batch of them
+               while( conn->buffer_queue.write_queue_size() < def_max_write_batch_size && conn->enqueue_sync_block() );
                conn->do_queue_write( priority );
             }
             catch(const std::exception &ex) {
@@ -1029,8 +1108,12 @@ namespace eosio {
    }
 
    bool connection::enqueue_sync_block() {
-      if (!peer_requested)
-         return false;
+      if (!peer_requested) {
+         if( queued_sync_requests.empty() )
+            return false;
+         peer_requested = queued_sync_requests.front();
+         queued_sync_requests.pop_front();
+      }
       uint32_t num = ++peer_requested->last;
       bool trigger_send = num == peer_requested->start_block;
       if(num == peer_requested->end_block) {
@@ -1102,6 +1185,21 @@ namespace eosio {
       return create_send_buffer( packed_transaction_which, trx );
    }
 
+   static std::shared_ptr<std::vector<char>> create_compact_send_buffer( const signed_block& b ) {
+      compact_block_message cb;
+      cb.header = b;
+      cb.receipts.reserve( b.transactions.size() );
+      for( const auto& r : b.transactions ) {
+         if( r.trx.contains<packed_transaction>() ) {
+            cb.receipts.emplace_back( compact_receipt{r, r.trx.get<packed_transaction>().id(), true} );
+         } else {
+            cb.receipts.emplace_back( compact_receipt{r, r.trx.get<transaction_id_type>(), false} );
+         }
+      }
+      cb.block_extensions = b.block_extensions;
+      return create_send_buffer( compact_block_which, cb );
+   }
+
    void connection::enqueue_block( const signed_block_ptr& sb, bool trigger_send, bool to_sync_queue) {
       enqueue_buffer( create_send_buffer( sb ), trigger_send, priority::low, no_reason, to_sync_queue);
    }
@@ -1110,22 +1208,7 @@ namespace eosio {
                                     bool trigger_send, int priority, go_away_reason close_after_send,
                                     bool to_sync_queue)
    {
-      connection_wptr weak_this = shared_from_this();
-      queue_write(send_buffer,trigger_send, priority,
-                  [weak_this, close_after_send](boost::system::error_code ec, std::size_t ) {
-                     connection_ptr conn = weak_this.lock();
-                     if (conn) {
-                        if (close_after_send != no_reason) {
-                           fc_elog( logger, "sent a go away message: ${r}, closing connection to ${p}",
-                                    ("r", reason_str(close_after_send))("p", conn->peer_name()) );
-                           my_impl->close(conn);
-                           return;
-                        }
-                     } else {
-                        fc_wlog(logger, "connection expired before enqueued net_message called callback!");
-                     }
-                  },
-                  to_sync_queue);
+      queue_write(send_buffer, trigger_send, priority, close_after_send, to_sync_queue);
    }
 
    void connection::cancel_wait() {
@@ -1167,6 +1250,7 @@ namespace eosio {
 
    void connection::sync_timeout( boost::system::error_code ec ) {
       if( !ec ) {
+         quality.add_timeout( time_point::now() );
          my_impl->sync_master->reassign_fetch(shared_from_this(), benign_other);
       }
       else if( ec == boost::asio::error::operation_aborted) {
@@ -1195,6 +1279,7 @@ namespace eosio {
 
    void connection::fetch_timeout( boost::system::error_code ec ) {
       if( !ec ) {
+         quality.add_timeout( time_point::now() );
          my_impl->dispatcher->retry_fetch(shared_from_this());
       }
       else if( ec == boost::asio::error::operation_aborted ) {
@@ -1229,12 +1314,13 @@ namespace eosio {
 
    //-----------------------------------------------------------
 
-    sync_manager::sync_manager( uint32_t req_span )
+    sync_manager::sync_manager( uint32_t req_span, uint32_t peer_chunks, uint32_t fetch_window )
       :sync_known_lib_num( 0 )
       ,sync_last_requested_num( 0 )
       ,sync_next_expected_num( 1 )
       ,sync_req_span( req_span )
-      ,source()
+      ,sync_peer_chunks( peer_chunks )
+      ,sync_fetch_window( fetch_window )
       ,state(in_sync)
    {
       chain_plug = app().find_plugin<chain_plugin>();
@@ -1256,6 +1342,9 @@ namespace eosio {
       }
       fc_dlog(logger, "old state ${os} becoming ${ns}",("os",stage_str(state))("ns",stage_str(newstate)));
       state = newstate;
+      if( state == in_sync ) {
+         chunks.clear();
+      }
    }
 
    bool sync_manager::is_active(const connection_ptr& c) {
@@ -1269,15 +1358,11 @@ namespace eosio {
    }
 
    void sync_manager::reset_lib_num(const connection_ptr& c) {
-      if(state == in_sync) {
-         source.reset();
-      }
       if( c->current() ) {
          if( c->last_handshake_recv.last_irreversible_block_num > sync_known_lib_num) {
             sync_known_lib_num =c->last_handshake_recv.last_irreversible_block_num;
          }
-      } else if( c == source ) {
-         sync_last_requested_num = 0;
+      } else if( chunks.return_chunks( c ) ) {
          request_next_chunk();
       }
    }
@@ -1290,90 +1375,122 @@ namespace eosio {
               chain_plug->chain().fork_db_pending_head_block_num() < sync_last_requested_num );
    }
 
-   void sync_manager::request_next_chunk( const connection_ptr& conn ) {
-      uint32_t head_block = chain_plug->chain().fork_db_pending_head_block_num();
-
-      if (head_block < sync_last_requested_num && source && source->current()) {
-         fc_ilog(logger, "ignoring request, head is ${h} last req = ${r} source is ${p}",
-                  ("h",head_block)("r",sync_last_requested_num)("p",source->peer_name()));
-         return;
+   connection_ptr sync_manager::select_source( uint32_t start, const connection_ptr& preferred ) {
+      // the least loaded peer whose last irreversible block covers start, the best scored wins ties
+      // unless preferred scores as well
+      auto now = time_point::now();
+      connection_ptr best;
+      size_t best_load = 0;
+      double best_score = 0;
+      for( const auto& c : my_impl->connections ) {
+         if( !c->current() || c->last_handshake_recv.last_irreversible_block_num < start ) {
+            continue;
+         }
+         // peers that predate proto_parallel_sync replace a pending sync request instead of queueing it
+         size_t max_chunks = c->protocol_version >= proto_parallel_sync ? sync_peer_chunks : 1;
+         size_t load = chunks.chunk_count( c );
+         if( load >= max_chunks ) {
+            continue;
+         }
+         double score = c->quality.score( now );
+         if( !best || load < best_load ||
+             (load == best_load && (score > best_score || (score == best_score && c == preferred))) ) {
+            best = c;
+            best_load = load;
+            best_score = score;
+         }
       }
+      return best;
+   }
 
+   void sync_manager::request_next_chunk( const connection_ptr& conn ) {
       /* ----------
-       * next chunk provider selection criteria
-       * a provider is supplied and able to be used, use it.
-       * otherwise select the next available from the list, round-robin style.
+       * ranges returned by slow or closed peers are handed out first, then new ranges
+       * up to sync_fetch_window blocks past the next expected block. Each goes to the
+       * least loaded peer able to provide it, so every peer keeps a few chunks in flight.
        */
-
-      if (conn && conn->current() ) {
-         source = conn;
-      }
-      else {
-         if( my_impl->connections.size() == 0 ) {
-            source.reset();
-         } else if( my_impl->connections.size() == 1 ) {
-            if (!source) {
-               source = *my_impl->connections.begin();
-            }
+      for( ;; ) {
+         uint32_t start = 0;
+         uint32_t end = 0;
+         auto returned = chunks.first_unassigned();
+         if( returned ) {
+            start = returned->first;
+            end = returned->second;
          } else {
-            // init to a linear array search
-            auto cptr = my_impl->connections.begin();
-            auto cend = my_impl->connections.end();
-            // do we remember the previous source?
-            if( source ) {
-               //try to find it in the list
-               cptr = my_impl->connections.find( source );
-               cend = cptr;
-               if( cptr == my_impl->connections.end() ) {
-                  //not there - must have been closed! cend is now connections.end, so just flatten the ring.
-                  source.reset();
-                  cptr = my_impl->connections.begin();
-               } else {
-                  //was found - advance the start to the next. cend is the old source.
-                  if( ++cptr == my_impl->connections.end() && cend != my_impl->connections.end() ) {
-                     cptr = my_impl->connections.begin();
-                  }
-               }
+            start = std::max( sync_last_requested_num + 1, sync_next_expected_num );
+            if( start > sync_known_lib_num || start >= sync_next_expected_num + sync_fetch_window ) {
+               break;
             }
+            end = std::min( start + sync_req_span - 1, sync_known_lib_num );
+         }
 
-            //scan the list of peers looking for another able to provide sync blocks.
-            if( cptr != my_impl->connections.end() ) {
-               auto cstart_it = cptr;
-               do {
-                  //select the first one which is current and break out.
-                  if( (*cptr)->current() ) {
-                     source = *cptr;
-                     break;
-                  }
-                  if( ++cptr == my_impl->connections.end() )
-                     cptr = my_impl->connections.begin();
-               } while( cptr != cstart_it );
-            }
-            // no need to check the result, either source advanced or the whole list was checked and the old source is reused.
+         connection_ptr c = select_source( start, conn );
+         if( !c ) {
+            break;
          }
+         end = std::min( end, c->last_handshake_recv.last_irreversible_block_num );
+         if( !returned ) {
+            sync_last_requested_num = end;
+         }
+
+         fc_ilog(logger, "requesting range ${s} to ${e}, from ${n}",
+                 ("n",c->peer_name())("s",start)("e",end));
+         chunks.assign( start, end, c );
+         c->request_sync_blocks(start, end);
       }
 
       // verify there is an available source
-      if (!source || !source->current() ) {
+      if( chunks.empty() && sync_next_expected_num <= sync_known_lib_num ) {
          fc_elog( logger, "Unable to continue syncing at this time");
          sync_known_lib_num = chain_plug->chain().last_irreversible_block_num();
          sync_last_requested_num = 0;
          set_state(in_sync); // probably not, but we can't do anything else
-         return;
       }
+   }
 
-      if( sync_last_requested_num != sync_known_lib_num ) {
-         uint32_t start = sync_next_expected_num;
-         uint32_t end = start + sync_req_span - 1;
-         if( end > sync_known_lib_num )
-            end = sync_known_lib_num;
-         if( end > 0 && end >= start ) {
-            fc_ilog(logger, "requesting range ${s} to ${e}, from ${n}",
-                    ("n",source->peer_name())("s",start)("e",end));
-            source->request_sync_blocks(start, end);
-            sync_last_requested_num = end;
-         }
+   void sync_manager::chunk_block_received( const connection_ptr& c, uint32_t blk_num ) {
+      chunks.block_received( c, blk_num );
+      if( chunks.chunk_count( c ) > 0 ) {
+         c->sync_wait();
+      } else {
+         c->cancel_wait();
+      }
+   }
+
+   bool sync_manager::hold_block( const connection_ptr& c, const signed_block_ptr& b, const block_id_type& blk_id ) {
+      if( state != lib_catchup ) {
+         return false;
+      }
+      uint32_t blk_num = b->block_num();
+      switch( fetch_chunks::classify( blk_num, sync_next_expected_num, sync_last_requested_num ) ) {
+         case fetch_chunks::disposition::apply:
+            return false;
+         case fetch_chunks::disposition::drop:
+            fc_dlog(logger, "dropping block ${bn} from ${p}, next expected ${ne}, last requested ${lr}",
+                    ("bn",blk_num)("p",c->peer_name())("ne",sync_next_expected_num)("lr",sync_last_requested_num));
+            chunk_block_received( c, blk_num );
+            return true;
+         case fetch_chunks::disposition::hold:
+            break;
       }
+      fc_dlog(logger, "holding block ${bn} from ${p} until ${ne} arrives",
+              ("bn",blk_num)("p",c->peer_name())("ne",sync_next_expected_num));
+      chunks.hold( blk_num, held_sync_block{c, b, blk_id} );
+      chunk_block_received( c, blk_num );
+      request_next_chunk();
+      return true;
+   }
+
+   bool sync_manager::release_held_block( held_sync_block& hb ) {
+      if( state != lib_catchup ) {
+         return false;
+      }
+      auto next = chunks.release( sync_next_expected_num );
+      if( !next ) {
+         return false;
+      }
+      hb = std::move( *next );
+      return true;
    }
 
    void sync_manager::send_handshakes()
@@ -1401,6 +1518,7 @@ namespace eosio {
       if (state == in_sync) {
          set_state(lib_catchup);
          sync_next_expected_num = chain_plug->chain().last_irreversible_block_num() + 1;
+         sync_last_requested_num = 0;
       }
 
       fc_ilog(logger, "Catching up with chain, our last req is ${cc}, theirs is ${t} peer ${p}",
@@ -1413,9 +1531,8 @@ namespace eosio {
       fc_ilog(logger, "reassign_fetch, our last req is ${cc}, next expected is ${ne} peer ${p}",
               ( "cc",sync_last_requested_num)("ne",sync_next_expected_num)("p",c->peer_name()));
 
-      if (c == source) {
+      if( chunks.return_chunks( c ) ) {
          c->cancel_sync(reason);
-         sync_last_requested_num = 0;
          request_next_chunk();
       }
    }
@@ -1547,7 +1664,6 @@ namespace eosio {
       if (state != in_sync ) {
          fc_wlog( logger, "block ${bn} not accepted from ${p}, closing connection", ("bn",blk_num)("p",c->peer_name()) );
          sync_last_requested_num = 0;
-         source.reset();
          my_impl->close(c);
          set_state(in_sync);
          send_handshakes();
@@ -1557,17 +1673,18 @@ namespace eosio {
       fc_dlog(logger, "got block ${bn} from ${p}",("bn",blk_num)("p",c->peer_name()));
       if (state == lib_catchup) {
          if (blk_num != sync_next_expected_num) {
-            fc_wlog( logger, "expected block ${ne} but got ${bn}, closing connection: ${p}",
+            // a duplicate or a late block of a range returned and requested again, see hold_block
+            fc_dlog( logger, "expected block ${ne} but got ${bn} from ${p}, ignoring it",
                      ("ne",sync_next_expected_num)("bn",blk_num)("p",c->peer_name()) );
-            my_impl->close(c);
+            chunk_block_received(c, blk_num);
             return;
          }
          sync_next_expected_num = blk_num + 1;
+         chunk_block_received(c, blk_num);
       }
       if (state == head_catchup) {
          fc_dlog(logger, "sync_manager in head_catchup state");
          set_state(in_sync);
-         source.reset();
 
          block_id_type null_id;
          for (const auto& cp : my_impl->connections) {
@@ -1593,12 +1710,8 @@ namespace eosio {
             set_state(in_sync);
             send_handshakes();
          }
-         else if (blk_num == sync_last_requested_num) {
-            request_next_chunk();
-         }
          else {
-            fc_dlog(logger,"calling sync_wait on connection ${p}",("p",c->peer_name()));
-            c->sync_wait();
+            request_next_chunk();
          }
       }
    }
@@ -1617,7 +1730,8 @@ namespace eosio {
       peer_block_state pbstate{bs->id, bnum};
 
       std::shared_ptr<std::vector<char>> send_buffer;
-      for( auto& cp : my_impl->connections ) {
+      std::shared_ptr<std::vector<char>> compact_buffer;
+      for( auto& cp : my_impl->connections_by_score() ) {
          if( skips.find( cp ) != skips.end() || !cp->current() ) {
             continue;
          }
@@ -1626,6 +1740,14 @@ namespace eosio {
             if( !cp->add_peer_block( pbstate ) ) {
                continue;
             }
+            if( cp->protocol_version >= proto_compact_blocks ) {
+               if( !compact_buffer ) {
+                  compact_buffer = create_compact_send_buffer( *bs->block );
+               }
+               fc_dlog(logger, "bcast compact block ${b} to ${p}", ("b", bnum)("p", cp->peer_name()));
+               cp->enqueue_buffer( compact_buffer, true, priority::high, no_reason );
+               continue;
+            }
             if( !send_buffer ) {
                send_buffer = create_send_buffer( bs->block );
             }
@@ -1691,23 +1813,29 @@ namespace eosio {
       node_transaction_state nts = {id, trx_expiration, 0, buff};
       my_impl->local_txns.insert(std::move(nts));
 
-      my_impl->send_transaction_to_all( buff, [&id, &skips, trx_expiration](const connection_ptr& c) -> bool {
-         if( skips.find(c) != skips.end() || c->syncing ) {
-            return false;
-          }
-          const auto& bs = c->trx_state.find(id);
-          bool unknown = bs == c->trx_state.end();
-          if( unknown ) {
-             c->trx_state.insert(transaction_state({id,0,trx_expiration}));
-             fc_dlog(logger, "sending trx to ${n}", ("n",c->peer_name() ) );
-          }
-          return unknown;
-      });
-
+      bool announce = false;
+      for( auto& c : my_impl->connections ) {
+         if( !c->current() || skips.find(c) != skips.end() || c->known_trxs.contains(id) ) {
+            continue;
+         }
+         c->known_trxs.insert(id);
+         if( my_impl->trx_inventory_relay && c->protocol_version >= proto_trx_inventory ) {
+            c->pending_trx_announcements.push_back(id);
+            announce = true;
+         } else {
+            fc_dlog(logger, "sending trx to ${n}", ("n",c->peer_name() ) );
+            c->enqueue_buffer( buff, true, priority::low, no_reason );
+         }
+      }
+      if( announce ) {
+         my_impl->schedule_trx_announcements();
+      }
    }
 
    void dispatch_manager::recv_transaction(const connection_ptr& c, const transaction_id_type& id) {
       received_transactions.insert(std::make_pair(id, c));
+      requested_trxs.erase(id);
+      c->known_trxs.insert(id);
       if (c &&
           c->last_req &&
           c->last_req->req_trx.mode != none &&
@@ -1722,10 +1850,53 @@ namespace eosio {
 
    void dispatch_manager::rejected_transaction(const transaction_id_type& id) {
       fc_dlog(logger,"not sending rejected transaction ${tid}",("tid",id));
+      my_impl->known_ids->remove_transaction(id);
       auto range = received_transactions.equal_range(id);
       received_transactions.erase(range.first, range.second);
    }
 
+   void dispatch_manager::recv_trx_announcement(const connection_ptr& c, const vector<transaction_id_type>& ids) {
+      const auto now = time_point::now();
+      request_message req;
+      req.req_blocks.mode = none;
+      req.req_trx.mode = normal;
+      for( const auto& id : ids ) {
+         c->known_trxs.insert(id);
+         if( my_impl->local_txns.get<by_id>().find(id) != my_impl->local_txns.end() ||
+             my_impl->known_ids->has_transaction(id) ) {
+            continue;
+         }
+         auto r = requested_trxs.find(id);
+         if( r != requested_trxs.end() && now - r->second < fc::milliseconds(def_trx_request_timeout_ms) ) {
+            continue; // already asked another peer that announced it
+         }
+         requested_trxs[id] = now;
+         req.req_trx.ids.push_back(id);
+      }
+      if( req.req_trx.ids.empty() ) {
+         return;
+      }
+      fc_dlog( logger, "requesting ${n} of ${a} announced trxs from ${p}",
+               ("n", req.req_trx.ids.size())("a", ids.size())("p", c->peer_name()) );
+      req.req_trx.pending = req.req_trx.ids.size();
+      c->enqueue(req);
+      if( !c->last_req ) {
+         // retry_fetch re-requests from another peer that announced the last id
+         c->fetch_wait();
+         c->last_req = std::move(req);
+      }
+   }
+
+   void dispatch_manager::expire_trx_requests(const time_point& now) {
+      for( auto i = requested_trxs.begin(); i != requested_trxs.end(); ) {
+         if( now - i->second >= fc::milliseconds(def_trx_request_timeout_ms) ) {
+            i = requested_trxs.erase(i);
+         } else {
+            ++i;
+         }
+      }
+   }
+
    void dispatch_manager::recv_notice(const connection_ptr& c, const notice_message& msg, bool generated) {
       request_message req;
       req.req_trx.mode = none;
@@ -1796,14 +1967,13 @@ namespace eosio {
                   ("b",modes_str(c->last_req->req_blocks.mode))("t",modes_str(c->last_req->req_trx.mode)));
          return;
       }
-      for (auto& conn : my_impl->connections) {
+      for (auto& conn : my_impl->connections_by_score()) {
          if (conn == c || conn->last_req) {
             continue;
          }
          bool sendit = false;
          if (is_txn) {
-            auto trx = conn->trx_state.get<by_id>().find(tid);
-            sendit = trx != conn->trx_state.end();
+            sendit = conn->known_trxs.contains(tid);
          }
          else {
             sendit = conn->peer_has_block(bid);
@@ -1876,7 +2046,10 @@ namespace eosio {
       auto current_endpoint = *endpoint_itr;
       ++endpoint_itr;
       c->connecting = true;
-      c->pending_message_buffer.reset();
+      boost::asio::post( c->strand, [c]() {
+         c->pending_message_buffer.reset();
+         c->outstanding_read_bytes.reset();
+      } );
       connection_wptr weak_conn = c;
       c->socket->async_connect( current_endpoint, boost::asio::bind_executor( c->strand,
             [weak_conn, endpoint_itr, this]( const boost::system::error_code& err ) {
@@ -1997,23 +2170,6 @@ namespace eosio {
          }
          connection_wptr weak_conn = conn;
 
-         std::size_t minimum_read = conn->outstanding_read_bytes ? *conn->outstanding_read_bytes : message_header_size;
-
-         if (use_socket_read_watermark) {
-            const size_t max_socket_read_watermark = 4096;
-            std::size_t socket_read_watermark = std::min<std::size_t>(minimum_read, max_socket_read_watermark);
-            boost::asio::socket_base::receive_low_watermark read_watermark_opt(socket_read_watermark);
-            conn->socket->set_option(read_watermark_opt);
-         }
-
-         auto completion_handler = [minimum_read](boost::system::error_code ec, std::size_t bytes_transferred) -> std::size_t {
-            if (ec || bytes_transferred >= minimum_read ) {
-               return 0;
-            } else {
-               return minimum_read - bytes_transferred;
-            }
-         };
-
          if( conn->buffer_queue.write_queue_size() > def_max_write_queue_size ||
              conn->reads_in_flight > def_max_reads_in_flight   ||
              conn->trx_in_progress_size > def_max_trx_in_progress_size )
@@ -2047,136 +2203,144 @@ namespace eosio {
          }
 
          ++conn->reads_in_flight;
+         // the receive buffer and outstanding_read_bytes are only touched on the connection's strand
+         boost::asio::post( conn->strand, [this, weak_conn]() {
+            auto conn = weak_conn.lock();
+            if( !conn ) {
+               return;
+            }
+
+            std::size_t minimum_read = conn->outstanding_read_bytes ? *conn->outstanding_read_bytes : message_header_size;
+
+            if (use_socket_read_watermark) {
+               const size_t max_socket_read_watermark = 4096;
+               std::size_t socket_read_watermark = std::min<std::size_t>(minimum_read, max_socket_read_watermark);
+               boost::asio::socket_base::receive_low_watermark read_watermark_opt(socket_read_watermark);
+               boost::system::error_code ec;
+               conn->socket->set_option(read_watermark_opt, ec);
+            }
+
+            if( conn->pending_message_buffer.empty() ) {
+               // nothing partial is buffered, wait for data before taking a chunk from the pool so
+               // idle connections hold no receive buffer
+               conn->socket->async_wait( tcp::socket::wait_read, boost::asio::bind_executor( conn->strand,
+                  [this, weak_conn, minimum_read]( boost::system::error_code ) {
+                     auto conn = weak_conn.lock();
+                     if( !conn ) {
+                        return;
+                     }
+                     start_async_read( conn, minimum_read ); // reports any socket error
+                  } ) );
+            } else {
+               start_async_read( conn, minimum_read );
+            }
+         } );
+      } catch (...) {
+         string pname = conn ? conn->peer_name() : "no connection name";
+         fc_elog( logger, "Undefined exception handling reading ${p}",("p",pname) );
+         close( conn );
+      }
+   }
+
+   void net_plugin_impl::start_async_read(const connection_ptr& conn, std::size_t minimum_read) {
+      auto completion_handler = [minimum_read](boost::system::error_code ec, std::size_t bytes_transferred) -> std::size_t {
+         if (ec || bytes_transferred >= minimum_read ) {
+            return 0;
+         } else {
+            return minimum_read - bytes_transferred;
+         }
+      };
+
+      connection_wptr weak_conn = conn;
+      try {
          boost::asio::async_read(*conn->socket,
-            conn->pending_message_buffer.get_buffer_sequence_for_boost_async_read(), completion_handler,
-            boost::asio::bind_executor( conn->strand,
-            [this,weak_conn]( boost::system::error_code ec, std::size_t bytes_transferred ) {
-            app().post( priority::medium, [this,weak_conn, ec, bytes_transferred]() {
+            conn->pending_message_buffer.prepare( minimum_read ), completion_handler,
+            boost::asio::bind_executor( conn->strand, [this,weak_conn]( boost::system::error_code ec, std::size_t bytes_transferred ) {
+            // runs on the connection's strand, on a net thread, as does everything else that
+            // touches pending_message_buffer or outstanding_read_bytes
+            auto conn = weak_conn.lock();
+            if( !conn ) {
+               return;
+            }
+            auto msgs = std::make_shared<vector<decoded_message>>();
+            string error;
+            if( !ec ) {
+               // blocks and transactions already known are dropped here so they never reach the main thread
+               error = decode_messages( conn->pending_message_buffer, bytes_transferred, def_send_buffer_size*2, *known_ids,
+                                        conn->outstanding_read_bytes, *msgs );
+            }
+
+            app().post( priority::medium, [this, weak_conn, ec, bytes_transferred, msgs{std::move(msgs)}, error{std::move(error)}]() {
                auto conn = weak_conn.lock();
                if (!conn || !conn->socket || !conn->socket->is_open()) {
                   return;
                }
 
                --conn->reads_in_flight;
-               conn->outstanding_read_bytes.reset();
-
-               try {
-                  if( !ec ) {
-                     if (bytes_transferred > conn->pending_message_buffer.bytes_to_write()) {
-                        fc_elog( logger,"async_read_some callback: bytes_transfered = ${bt}, buffer.bytes_to_write = ${btw}",
-                                 ("bt",bytes_transferred)("btw",conn->pending_message_buffer.bytes_to_write()) );
-                     }
-                     EOS_ASSERT(bytes_transferred <= conn->pending_message_buffer.bytes_to_write(), plugin_exception, "");
-                     conn->pending_message_buffer.advance_write_ptr(bytes_transferred);
-                     while (conn->pending_message_buffer.bytes_to_read() > 0) {
-                        uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
-
-                        if (bytes_in_buffer < message_header_size) {
-                           conn->outstanding_read_bytes.emplace(message_header_size - bytes_in_buffer);
-                           break;
-                        } else {
-                           uint32_t message_length;
-                           auto index = conn->pending_message_buffer.read_index();
-                           conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
-                           if(message_length > def_send_buffer_size*2 || message_length == 0) {
-                              boost::system::error_code ec;
-                              fc_elog( logger,"incoming message length unexpected (${i}), from ${p}",
-                                       ("i", message_length)("p",boost::lexical_cast<std::string>(conn->socket->remote_endpoint(ec))) );
-                              close(conn);
-                              return;
-                           }
 
-                           auto total_message_bytes = message_length + message_header_size;
-
-                           if (bytes_in_buffer >= total_message_bytes) {
-                              conn->pending_message_buffer.advance_read_ptr(message_header_size);
-                              if (!process_next_message(conn, message_length)) {
-                                 return;
-                              }
-                           } else {
-                              auto outstanding_message_bytes = total_message_bytes - bytes_in_buffer;
-                              auto available_buffer_bytes = conn->pending_message_buffer.bytes_to_write();
-                              if (outstanding_message_bytes > available_buffer_bytes) {
-                                 conn->pending_message_buffer.add_space( outstanding_message_bytes - available_buffer_bytes );
-                              }
-
-                              conn->outstanding_read_bytes.emplace(outstanding_message_bytes);
-                              break;
-                           }
-                        }
-                     }
-                     start_read_message(conn);
+               if( ec ) {
+                  auto pname = conn->peer_name();
+                  if (ec.value() != boost::asio::error::eof) {
+                     fc_elog( logger, "Error reading message from ${p}: ${m}",("p",pname)( "m", ec.message() ) );
                   } else {
-                     auto pname = conn->peer_name();
-                     if (ec.value() != boost::asio::error::eof) {
-                        fc_elog( logger, "Error reading message from ${p}: ${m}",("p",pname)( "m", ec.message() ) );
-                     } else {
-                        fc_ilog( logger, "Peer ${p} closed connection",("p",pname) );
-                     }
-                     close( conn );
+                     fc_ilog( logger, "Peer ${p} closed connection",("p",pname) );
                   }
-               }
-               catch(const std::exception &ex) {
-                  fc_elog( logger, "Exception in handling read data from ${p}: ${s}",
-                           ("p",conn->peer_name())("s",ex.what()) );
                   close( conn );
+                  return;
                }
-               catch(const fc::exception &ex) {
-                  fc_elog( logger, "Exception in handling read data from ${p}: ${s}",
-                           ("p",conn->peer_name())("s",ex.to_string()) );
-                  close( conn );
+
+               conn->quality.add_bytes( bytes_transferred, time_point::now() );
+               for( auto& m : *msgs ) {
+                  try {
+                     dispatch_message( conn, m );
+                  } catch( const fc::exception& e ) {
+                     fc_elog( logger, "Exception in handling message from ${p}: ${s}",
+                              ("p", conn->peer_name())("s", e.to_detail_string()) );
+                     close( conn );
+                     return;
+                  } catch( const std::exception& e ) {
+                     fc_elog( logger, "Exception in handling message from ${p}: ${s}",
+                              ("p", conn->peer_name())("s", e.what()) );
+                     close( conn );
+                     return;
+                  } catch( ... ) {
+                     fc_elog( logger, "Undefined exception handling message from ${p}", ("p", conn->peer_name()) );
+                     close( conn );
+                     return;
+                  }
                }
-               catch (...) {
-                  fc_elog( logger, "Undefined exception handling the read data from ${p}",( "p",conn->peer_name()) );
+
+               if( !error.empty() ) {
+                  fc_elog( logger, "Exception in handling read data from ${p}: ${s}", ("p",conn->peer_name())("s",error) );
                   close( conn );
+                  return;
                }
+
+               start_read_message( conn );
             });
          }));
       } catch (...) {
-         string pname = conn ? conn->peer_name() : "no connection name";
-         fc_elog( logger, "Undefined exception handling reading ${p}",("p",pname) );
-         close( conn );
+         // may be running on a net thread, close from the main thread
+         app().post( priority::medium, [this, weak_conn]() {
+            auto conn = weak_conn.lock();
+            if( !conn ) return;
+            fc_elog( logger, "Undefined exception handling reading ${p}",("p",conn->peer_name()) );
+            close( conn );
+         });
       }
    }
 
-   bool net_plugin_impl::process_next_message(const connection_ptr& conn, uint32_t message_length) {
-      try {
-         // if next message is a block we already have, exit early
-         auto peek_ds = conn->pending_message_buffer.create_peek_datastream();
-         unsigned_int which{};
-         fc::raw::unpack( peek_ds, which );
-         if( which == signed_block_which ) {
-            block_header bh;
-            fc::raw::unpack( peek_ds, bh );
-
-            controller& cc = chain_plug->chain();
-            block_id_type blk_id = bh.id();
-            uint32_t blk_num = bh.block_num();
-            if( cc.fetch_block_by_id( blk_id ) ) {
-               sync_master->recv_block( conn, blk_id, blk_num );
-               conn->pending_message_buffer.advance_read_ptr( message_length );
-               return true;
-            }
-         }
-
-         auto ds = conn->pending_message_buffer.create_datastream();
-         net_message msg;
-         fc::raw::unpack( ds, msg );
-         msg_handler m( *this, conn );
-         if( msg.contains<signed_block>() ) {
-            m( std::move( msg.get<signed_block>() ) );
-         } else if( msg.contains<packed_transaction>() ) {
-            m( std::move( msg.get<packed_transaction>() ) );
-         } else {
-            msg.visit( m );
-         }
-      } catch( const fc::exception& e ) {
-         fc_elog( logger, "Exception in handling message from ${p}: ${s}",
-                  ("p", conn->peer_name())("s", e.to_detail_string()) );
-         close( conn );
-         return false;
+   void net_plugin_impl::dispatch_message(const connection_ptr& conn, decoded_message& m) {
+      if( m.known_block ) {
+         sync_master->recv_block( conn, m.block_id, m.block_num );
+      } else if( m.block ) {
+         handle_message( conn, m.block, m.block_id );
+      } else if( m.trx ) {
+         handle_message( conn, m.trx );
+      } else {
+         msg_handler h( *this, conn );
+         m.msg.visit( h );
       }
-      return true;
    }
 
    size_t net_plugin_impl::count_open_sockets() const
@@ -2190,15 +2354,6 @@ namespace eosio {
    }
 
 
-   template<typename VerifierFunc>
-   void net_plugin_impl::send_transaction_to_all(const std::shared_ptr<std::vector<char>>& send_buffer, VerifierFunc verify) {
-      for( auto &c : connections) {
-         if( c->current() && verify( c )) {
-            c->enqueue_buffer( send_buffer, true, priority::low, no_reason );
-         }
-      }
-   }
-
    bool net_plugin_impl::is_valid(const handshake_message& msg) {
       // Do some basic validation of an incoming handshake_message, so things
       // that really aren't handshake messages can be quickly discarded without
@@ -2372,6 +2527,11 @@ namespace eosio {
       c->offset = (double(c->rec - c->org) + double(msg.xmt - c->dst)) / 2;
       double NsecPerUsec{1000};
 
+      double rtt = double(msg.dst - msg.org) - double(msg.xmt - msg.rec);
+      if( rtt > 0 ) {
+         c->quality.add_rtt( rtt / NsecPerUsec );
+      }
+
       if(logger.is_enabled(fc::log_level::all))
          logger.log(FC_LOG_MESSAGE(all, "Clock offset is ${o}ns (${us}us)", ("o", c->offset)("us", c->offset/NsecPerUsec)));
       c->org = 0;
@@ -2382,7 +2542,7 @@ namespace eosio {
       // peer tells us about one or more blocks or txns. When done syncing, forward on
       // notices of previously unknown blocks or txns,
       //
-      peer_ilog(c, "received notice_message");
+      peer_dlog(c, "received notice_message");
       c->connecting = false;
       request_message req;
       bool send_req = false;
@@ -2412,7 +2572,13 @@ namespace eosio {
          break;
       }
       case normal: {
-         dispatcher->recv_notice(c, msg, false);
+         if( msg.known_trx.ids.size() > def_max_trx_announcement ) {
+            peer_elog(c, "Invalid notice_message, known_trx.ids.size ${s}, closing", ("s", msg.known_trx.ids.size()));
+            close(c);
+            return;
+         }
+         dispatcher->recv_trx_announcement(c, msg.known_trx.ids);
+         break;
       }
       }
 
@@ -2484,7 +2650,11 @@ namespace eosio {
    void net_plugin_impl::handle_message(const connection_ptr& c, const sync_request_message& msg) {
       if( msg.end_block == 0) {
          c->peer_requested.reset();
+         c->queued_sync_requests.clear();
          c->flush_queues();
+      } else if( c->peer_requested && c->protocol_version >= proto_parallel_sync ) {
+         // peer keeps several chunks in flight, send them in the order requested
+         c->queued_sync_requests.emplace_back( msg.start_block, msg.end_block, msg.start_block-1 );
       } else {
          c->peer_requested = sync_state( msg.start_block,msg.end_block,msg.start_block-1);
          c->enqueue_sync_block();
@@ -2498,7 +2668,7 @@ namespace eosio {
              trx->get_signatures().size() * sizeof(signature_type);
    }
 
-   void net_plugin_impl::handle_message(const connection_ptr& c, const packed_transaction_ptr& trx) {
+   void net_plugin_impl::handle_message(const connection_ptr& c, const transaction_metadata_ptr& ptrx) {
       fc_dlog(logger, "got a packed transaction, cancel wait");
       peer_ilog(c, "received packed_transaction");
       controller& cc = my_impl->chain_plug->chain();
@@ -2511,10 +2681,10 @@ namespace eosio {
          return;
       }
 
-      auto ptrx = std::make_shared<transaction_metadata>( trx );
       const auto& tid = ptrx->id;
 
-      if(local_txns.get<by_id>().find(tid) != local_txns.end()) {
+      if( local_txns.get<by_id>().find(tid) != local_txns.end() ||
+          !known_ids->add_transaction( tid, ptrx->packed_trx->expiration() ) ) {
          fc_dlog(logger, "got a duplicate transaction - dropping");
          return;
       }
@@ -2539,9 +2709,21 @@ namespace eosio {
       });
    }
 
-   void net_plugin_impl::handle_message(const connection_ptr& c, const signed_block_ptr& msg) {
+   void net_plugin_impl::handle_message(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id) {
+      if( sync_master->hold_block( c, msg, blk_id ) ) {
+         return;
+      }
+      process_block( c, msg, blk_id );
+
+      // the block may have filled the gap in front of sync blocks received from other peers
+      held_sync_block hb;
+      while( sync_master->release_held_block( hb ) ) {
+         process_block( hb.conn, hb.block, hb.id );
+      }
+   }
+
+   void net_plugin_impl::process_block(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id) {
       controller &cc = chain_plug->chain();
-      block_id_type blk_id = msg->id();
       uint32_t blk_num = msg->block_num();
       fc_dlog(logger, "canceling wait on ${p}", ("p",c->peer_name()));
       c->cancel_wait();
@@ -2560,6 +2742,9 @@ namespace eosio {
       fc::microseconds age( fc::time_point::now() - msg->timestamp);
       peer_ilog(c, "received signed_block : #${n} block age in secs = ${age}",
               ("n",blk_num)("age",age.to_seconds()));
+      if( !sync_master->is_active(c) ) {
+         c->quality.add_block_latency( age.count() );
+      }
 
       go_away_reason reason = fatal_other;
       try {
@@ -2592,19 +2777,137 @@ namespace eosio {
             if( ltx != local_txns.end()) {
                local_txns.modify( ltx, ubn );
             }
-            auto ctx = c->trx_state.get<by_id>().find(id);
-            if( ctx != c->trx_state.end()) {
-               c->trx_state.modify( ctx, ubn );
-            }
          }
          sync_master->recv_block(c, blk_id, blk_num);
       }
       else {
+         c->quality.add_rejected_block( time_point::now() );
          sync_master->rejected_block(c, blk_num);
          dispatcher->rejected_block( blk_id );
       }
    }
 
+   void net_plugin_impl::handle_message(const connection_ptr& c, const compact_block_message& msg) {
+      block_id_type blk_id = msg.header.id();
+      uint32_t blk_num = msg.header.block_num();
+      peer_dlog(c, "received compact_block #${n} with ${t} transactions", ("n", blk_num)("t", msg.receipts.size()));
+
+      try {
+         controller& cc = chain_plug->chain();
+         if( cc.fetch_block_by_id( blk_id ) ) {
+            c->cancel_wait();
+            sync_master->recv_block( c, blk_id, blk_num );
+            return;
+         }
+      } catch( ... ) {
+         fc_elog( logger, "Caught an unknown exception trying to recall blockID" );
+      }
+
+      pending_compact_block pending;
+      pending.block_id = blk_id;
+      pending.msg = msg;
+      pending.serialized_trxs.resize( msg.receipts.size() );
+      auto& idx = local_txns.get<by_id>();
+      for( uint32_t i = 0; i < msg.receipts.size(); ++i ) {
+         const auto& r = msg.receipts[i];
+         if( !r.packed ) continue;
+         auto ltx = idx.find( r.id );
+         if( ltx != idx.end() ) {
+            pending.serialized_trxs[i] = ltx->serialized_txn;
+         } else {
+            pending.missing.push_back( i );
+         }
+      }
+
+      if( pending.missing.empty() ) {
+         accept_compact_block( c, pending );
+         return;
+      }
+
+      peer_dlog(c, "requesting ${m} of ${t} transactions of compact_block #${n}",
+                ("m", pending.missing.size())("t", msg.receipts.size())("n", blk_num));
+      get_block_transactions_message req;
+      req.block_id = blk_id;
+      req.indexes = pending.missing;
+      auto evicted = c->pending_compacts.add( std::move( pending ) );
+      c->enqueue( req );
+      if( evicted ) {
+         // too many compact blocks waiting on this peer, its transactions for the oldest will be ignored
+         peer_ilog(c, "dropping pending compact block ${id}, requesting full block", ("id", *evicted));
+         request_full_block( c, *evicted );
+      }
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const get_block_transactions_message& msg) {
+      peer_dlog(c, "received get_block_transactions for ${n} transactions", ("n", msg.indexes.size()));
+      signed_block_ptr b;
+      try {
+         b = chain_plug->chain().fetch_block_by_id( msg.block_id );
+      } catch( ... ) {
+         fc_elog( logger, "Caught an unknown exception trying to recall blockID" );
+      }
+
+      if( b ) {
+         block_transactions_message resp;
+         resp.block_id = msg.block_id;
+         resp.trxs.reserve( msg.indexes.size() );
+         for( auto i : msg.indexes ) {
+            if( i >= b->transactions.size() || !b->transactions[i].trx.contains<packed_transaction>() ) {
+               break;
+            }
+            resp.trxs.push_back( b->transactions[i].trx.get<packed_transaction>() );
+         }
+         if( resp.trxs.size() == msg.indexes.size() ) {
+            c->enqueue( resp );
+            return;
+         }
+      }
+      // cannot answer in compact form, send the whole block if it is available
+      c->blk_send( msg.block_id );
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const block_transactions_message& msg) {
+      auto p = c->pending_compacts.take( msg.block_id );
+      if( !p ) {
+         peer_dlog(c, "received block_transactions for a compact block no longer pending");
+         return;
+      }
+      pending_compact_block& pending = *p;
+      if( msg.trxs.size() != pending.missing.size() ) {
+         peer_wlog(c, "block_transactions has ${n} transactions, expected ${e}",
+                   ("n", msg.trxs.size())("e", pending.missing.size()));
+      } else {
+         pending.fetched_trxs = msg.trxs;
+      }
+      accept_compact_block( c, pending );
+   }
+
+   void net_plugin_impl::accept_compact_block(const connection_ptr& c, const pending_compact_block& pending) {
+      signed_block_ptr b;
+      try {
+         b = pending.to_block();
+      } catch( const fc::exception& e ) {
+         peer_wlog(c, "unable to rebuild compact block: ${m}", ("m", e.to_string()));
+      }
+      if( b ) {
+         handle_message( c, b, pending.block_id );
+         return;
+      }
+
+      peer_ilog(c, "compact block ${id} could not be rebuilt, requesting full block", ("id", pending.block_id));
+      request_full_block( c, pending.block_id );
+   }
+
+   void net_plugin_impl::request_full_block(const connection_ptr& c, const block_id_type& blk_id) {
+      request_message req;
+      req.req_blocks.mode = normal;
+      req.req_blocks.ids.push_back( blk_id );
+      req.req_trx.mode = none;
+      c->enqueue( req );
+      c->fetch_wait();
+      c->last_req = std::move( req );
+   }
+
    void net_plugin_impl::start_conn_timer(boost::asio::steady_timer::duration du, std::weak_ptr<connection> from_connection) {
       connector_check->expires_from_now( du);
       connector_check->async_wait( [this, from_connection](boost::system::error_code ec) {
@@ -2655,10 +2958,47 @@ namespace eosio {
    void net_plugin_impl::start_monitors() {
       connector_check.reset(new boost::asio::steady_timer( my_impl->thread_pool->get_executor() ));
       transaction_check.reset(new boost::asio::steady_timer( my_impl->thread_pool->get_executor() ));
+      trx_announce_timer.reset(new boost::asio::steady_timer( my_impl->thread_pool->get_executor() ));
       start_conn_timer(connector_period, std::weak_ptr<connection>());
       start_txn_timer();
    }
 
+   void net_plugin_impl::schedule_trx_announcements() {
+      if( trx_announce_scheduled ) return;
+      trx_announce_scheduled = true;
+      trx_announce_timer->expires_from_now( trx_announce_interval );
+      trx_announce_timer->async_wait( [this]( boost::system::error_code ec ) {
+         app().post( priority::low, [this, ec]() {
+            trx_announce_scheduled = false;
+            if( !ec ) {
+               flush_trx_announcements();
+            }
+         } );
+      } );
+   }
+
+   void net_plugin_impl::flush_trx_announcements() {
+      for( auto& c : connections ) {
+         if( c->pending_trx_announcements.empty() ) continue;
+         if( !c->current() ) {
+            c->pending_trx_announcements.clear();
+            continue;
+         }
+         auto& ids = c->pending_trx_announcements;
+         for( size_t start = 0; start < ids.size(); start += def_max_trx_announcement ) {
+            const size_t end = std::min<size_t>( start + def_max_trx_announcement, ids.size() );
+            notice_message note;
+            note.known_blocks.mode = none;
+            note.known_trx.mode = normal;
+            note.known_trx.pending = end - start;
+            note.known_trx.ids.assign( ids.begin() + start, ids.begin() + end );
+            c->enqueue( note );
+         }
+         fc_dlog( logger, "announced ${n} trxs to ${p}", ("n", ids.size())("p", c->peer_name()) );
+         ids.clear();
+      }
+   }
+
    void net_plugin_impl::expire_txns() {
       start_txn_timer();
 
@@ -2670,11 +3010,9 @@ namespace eosio {
       controller& cc = chain_plug->chain();
       uint32_t lib = cc.last_irreversible_block_num();
       dispatcher->expire_blocks( lib );
+      known_ids->expire( lib, now );
+      dispatcher->expire_trx_requests( now );
       for ( auto &c : connections ) {
-         auto &stale_txn = c->trx_state.get<by_block_num>();
-         stale_txn.erase( stale_txn.lower_bound(1), stale_txn.upper_bound(lib) );
-         auto &stale_txn_e = c->trx_state.get<by_expiry>();
-         stale_txn_e.erase(stale_txn_e.lower_bound(time_point_sec()), stale_txn_e.upper_bound(time_point::now()));
          auto &stale_blk = c->blk_state.get<by_block_num>();
          stale_blk.erase( stale_blk.lower_bound(1), stale_blk.upper_bound(lib) );
       }
@@ -2733,6 +3071,8 @@ namespace eosio {
 
    void net_plugin_impl::accepted_block(const block_state_ptr& block) {
       fc_dlog(logger,"signaled, id = ${id}",("id", block->id));
+      known_ids->add_block(block->id, block->block_num);
+      known_ids->set_lib(chain_plug->chain().last_irreversible_block_num());
       dispatcher->bcast_block(block);
    }
 
@@ -2899,6 +3239,13 @@ namespace eosio {
          ( "net-threads", bpo::value<uint16_t>()->default_value(my->thread_pool_size),
            "Number of worker threads in net_plugin thread pool" )
          ( "sync-fetch-span", bpo::value<uint32_t>()->default_value(def_sync_fetch_span), "number of blocks to retrieve in a chunk from any individual peer during synchronization")
+         ( "sync-peer-chunks", bpo::value<uint32_t>()->default_value(def_sync_peer_chunks), "number of chunks kept in flight to each peer during synchronization")
+         ( "sync-fetch-window", bpo::value<uint32_t>()->default_value(def_sync_fetch_window), "maximum number of blocks requested ahead of the next block to apply during synchronization")
+         ( "p2p-trx-relay", bpo::value<string>()->default_value("push"),
+           "How transactions are relayed to peers that support both modes: 'push' sends every transaction to every peer "
+           "that has not seen it, 'inventory' announces batches of transaction ids and peers request the ones they lack")
+         ( "p2p-trx-announce-interval-ms", bpo::value<uint32_t>()->default_value(def_trx_announce_interval_ms),
+           "milliseconds transaction ids are collected before being announced to a peer, with p2p-trx-relay = inventory")
          ( "use-socket-read-watermark", bpo::value<bool>()->default_value(false), "Enable expirimental socket read watermark optimization")
          ( "peer-log-format", bpo::value<string>()->default_value( "[\"${_name}\" ${_ip}:${_port}]" ),
            "The string used to format peers when logging messages about them.  Variables are escaped with ${<variable name>}.\n"
@@ -2925,8 +3272,22 @@ namespace eosio {
 
          my->network_version_match = options.at( "network-version-match" ).as<bool>();
 
-         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>()));
+         EOS_ASSERT( options.at( "sync-peer-chunks" ).as<uint32_t>() > 0, chain::plugin_config_exception,
+                     "sync-peer-chunks must be greater than 0" );
+         EOS_ASSERT( options.at( "sync-fetch-window" ).as<uint32_t>() > 0, chain::plugin_config_exception,
+                     "sync-fetch-window must be greater than 0" );
+         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>(),
+                                                  options.at( "sync-peer-chunks" ).as<uint32_t>(),
+                                                  options.at( "sync-fetch-window" ).as<uint32_t>() ));
          my->dispatcher.reset( new dispatch_manager );
+         my->known_ids.reset( new known_ids_cache );
+         my->recv_buffer_pool = std::make_shared<buffer_pool>( def_recv_chunk_size );
+
+         const auto& trx_relay = options.at( "p2p-trx-relay" ).as<string>();
+         EOS_ASSERT( trx_relay == "push" || trx_relay == "inventory", chain::plugin_config_exception,
+                     "p2p-trx-relay must be 'push' or 'inventory', not ${m}", ("m", trx_relay) );
+         my->trx_inventory_relay = trx_relay == "inventory";
+         my->trx_announce_interval = std::chrono::milliseconds( options.at( "p2p-trx-announce-interval-ms" ).as<uint32_t>() );
 
          my->connector_period = std::chrono::seconds( options.at( "connection-cleanup-period" ).as<int>());
          my->max_cleanup_time_ms = options.at("max-cleanup-time-msec").as<int>();
@@ -3057,6 +3418,7 @@ namespace eosio {
       {
          cc.accepted_block.connect(  boost::bind(&net_plugin_impl::accepted_block, my.get(), _1));
       }
+      my->known_ids->set_lib( cc.last_irreversible_block_num() );
 
       my->incoming_transaction_ack_subscription = app().get_channel<channels::transaction_ack>().subscribe(boost::bind(&net_plugin_impl::transaction_ack, my.get(), _1));
 
@@ -3086,6 +3448,8 @@ namespace eosio {
             my->transaction_check->cancel();
          if( my->keepalive_timer )
             my->keepalive_timer->cancel();
+         if( my->trx_announce_timer )
+            my->trx_announce_timer->cancel();
 
          my->done = true;
          if( my->acceptor ) {
@@ -3156,6 +3520,22 @@ namespace eosio {
       }
       return result;
    }
+
+   vector<peer_score> net_plugin::peer_scores()const {
+      vector<peer_score> result;
+      result.reserve( my->connections.size() );
+      auto now = time_point::now();
+      for( const auto& c : my->connections_by_score() ) {
+         auto& q = c->quality;
+         result.push_back( peer_score{ c->peer_name(), q.score( now ), q.rtt_us / 1000, q.block_latency_us / 1000,
+                                       q.bytes_per_sec, q.rejected_blocks, q.timeouts } );
+      }
+      return result;
+   }
+
+   vector<connection_ptr> net_plugin_impl::connections_by_score() const {
+      return order_by_score( connections, time_point::now() );
+   }
    connection_ptr net_plugin_impl::find_connection(const string& host )const {
       for( const auto& c : connections )
          if( c->peer_addr == host ) return c;
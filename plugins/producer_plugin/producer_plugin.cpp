@@ -244,6 +244,9 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       // path to write the snapshots to
       bfs::path _snapshots_dir;
 
+      // threads used to write sectioned snapshots, 0 for the single stream format
+      uint16_t _snapshot_threads = 0;
+
 
       void on_block( const block_state_ptr& bsp ) {
          if( bsp->header.timestamp <= _last_signed_block_time ) return;
@@ -630,6 +633,8 @@ void producer_plugin::set_program_options(
           "Number of worker threads in producer thread pool")
          ("snapshots-dir", bpo::value<bfs::path>()->default_value("snapshots"),
           "the location of the snapshots directory (absolute path or relative to application data dir)")
+         ("snapshot-threads", bpo::value<uint16_t>()->default_value(0),
+          "Number of threads used to write snapshots in the sectioned format, 0 writes the single stream format")
          ;
    config_file_options.add(producer_options);
 }
@@ -782,6 +787,8 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
                   "No such directory '${dir}'", ("dir", my->_snapshots_dir.generic_string()) );
    }
 
+   my->_snapshot_threads = options.at( "snapshot-threads" ).as<uint16_t>();
+
    my->_incoming_block_subscription = app().get_channel<incoming::channels::block>().subscribe([this](const signed_block_ptr& block){
       try {
          my->on_incoming_block(block);
@@ -1021,6 +1028,9 @@ void producer_plugin::create_snapshot(producer_plugin::next_function<producer_pl
       return;
    }
 
+   // Written on the main thread at a block boundary, with production stopped. chainbase maps the state
+   // MAP_SHARED in every database-map-mode and has no frozen or private view of it, so a writer on another
+   // thread or in a forked process would see the blocks applied meanwhile.
    auto write_snapshot = [&]( const bfs::path& p ) -> void {
       auto reschedule = fc::make_scoped_exit([this](){
          my->schedule_production_loop();
@@ -1037,9 +1047,15 @@ void producer_plugin::create_snapshot(producer_plugin::next_function<producer_pl
 
       // create the snapshot
       auto snap_out = std::ofstream(p.generic_string(), (std::ios::out | std::ios::binary));
-      auto writer = std::make_shared<ostream_snapshot_writer>(snap_out);
-      chain.write_snapshot(writer);
-      writer->finalize();
+      if( my->_snapshot_threads > 0 ) {
+         auto writer = std::make_shared<sectioned_snapshot_writer>(snap_out, my->_snapshot_threads);
+         chain.write_snapshot(writer);
+         writer->finalize();
+      } else {
+         auto writer = std::make_shared<ostream_snapshot_writer>(snap_out);
+         chain.write_snapshot(writer);
+         writer->finalize();
+      }
       snap_out.flush();
       snap_out.close();
    };
@@ -0,0 +1,239 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+
+#include <eosio/chain/thread_utils.hpp>
+#include <eosio/state_history_plugin/state_history_log.hpp>
+#include <eosio/state_history_plugin/state_history_plugin.hpp>
+
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <zdict.h>
+#include <zstd.h>
+
+namespace eosio {
+
+namespace bio = boost::iostreams;
+inline bytes zlib_compress_bytes(bytes in) {
+   bytes                  out;
+   bio::filtering_ostream comp;
+   comp.push(bio::zlib_compressor(bio::zlib::default_compression));
+   comp.push(bio::back_inserter(out));
+   bio::write(comp, in.data(), in.size());
+   bio::close(comp);
+   return out;
+}
+
+inline bytes zlib_decompress(const bytes& in) {
+   bytes                  out;
+   bio::filtering_ostream decomp;
+   decomp.push(bio::zlib_decompressor());
+   decomp.push(bio::back_inserter(out));
+   bio::write(decomp, in.data(), in.size());
+   bio::close(decomp);
+   return out;
+}
+
+struct zstd_deleter {
+   void operator()(ZSTD_CCtx* p) const { ZSTD_freeCCtx(p); }
+   void operator()(ZSTD_DCtx* p) const { ZSTD_freeDCtx(p); }
+   void operator()(ZSTD_CDict* p) const { ZSTD_freeCDict(p); }
+   void operator()(ZSTD_DDict* p) const { ZSTD_freeDDict(p); }
+};
+
+template <typename T>
+using zstd_ptr = std::unique_ptr<T, zstd_deleter>;
+
+// Per-log zstd state: compression/decompression contexts, dictionaries loaded from the log's *.dict file, and the
+// sample set used to train a new dictionary in the background.
+struct zstd_log_context {
+   int                                      level              = ZSTD_CLEVEL_DEFAULT;
+   uint32_t                                 sample_count       = 0; // 0: never train a dictionary
+   uint32_t                                 dict_size          = 0;
+   uint32_t                                 retrain_blocks     = 0;
+   zstd_ptr<ZSTD_CCtx>                      cctx               = zstd_ptr<ZSTD_CCtx>{ZSTD_createCCtx()};
+   zstd_ptr<ZSTD_DCtx>                      dctx               = zstd_ptr<ZSTD_DCtx>{ZSTD_createDCtx()};
+   zstd_ptr<ZSTD_CDict>                     cdict              = {};
+   uint32_t                                 cdict_id           = 0;
+   std::map<uint32_t, zstd_ptr<ZSTD_DDict>> ddicts             = {};
+   std::vector<bytes>                       samples            = {};
+   size_t                                   sample_bytes       = 0;
+   uint32_t                                 blocks_since_train = 0;
+   std::future<bytes>                       training           = {};
+
+   void use_dictionary(const state_history_log& log, uint32_t id) {
+      auto dict = log.get_dictionary(id);
+      EOS_ASSERT(dict, chain::plugin_exception, "${name}.dict is missing dictionary ${id}",
+                 ("name", log.get_name())("id", id));
+      cdict.reset(ZSTD_createCDict(dict->data(), dict->size(), level));
+      EOS_ASSERT(cdict, chain::plugin_exception, "failed to load dictionary ${id}", ("id", id));
+      cdict_id = id;
+   }
+
+   const ZSTD_DDict* get_ddict(const state_history_log& log, uint32_t id) {
+      auto& ddict = ddicts[id];
+      if (!ddict) {
+         auto dict = log.get_dictionary(id);
+         EOS_ASSERT(dict, chain::plugin_exception, "${name}.dict is missing dictionary ${id}",
+                    ("name", log.get_name())("id", id));
+         ddict.reset(ZSTD_createDDict(dict->data(), dict->size()));
+         EOS_ASSERT(ddict, chain::plugin_exception, "failed to load dictionary ${id}", ("id", id));
+      }
+      return ddict.get();
+   }
+
+   bytes compress(const bytes& in) {
+      bytes  out(ZSTD_compressBound(in.size()));
+      size_t r = cdict ? ZSTD_compress_usingCDict(cctx.get(), out.data(), out.size(), in.data(), in.size(), cdict.get())
+                       : ZSTD_compressCCtx(cctx.get(), out.data(), out.size(), in.data(), in.size(), level);
+      EOS_ASSERT(!ZSTD_isError(r), chain::plugin_exception, "zstd compression failed: ${e}",
+                 ("e", ZSTD_getErrorName(r)));
+      out.resize(r);
+      return out;
+   }
+
+   bytes decompress(const state_history_log& log, uint32_t dictionary_id, const bytes& in) {
+      auto size = ZSTD_getFrameContentSize(in.data(), in.size());
+      EOS_ASSERT(size != ZSTD_CONTENTSIZE_ERROR && size != ZSTD_CONTENTSIZE_UNKNOWN, chain::plugin_exception,
+                 "corrupt zstd entry in ${name}.log", ("name", log.get_name()));
+      bytes  out(size);
+      size_t r = dictionary_id ? ZSTD_decompress_usingDDict(dctx.get(), out.data(), out.size(), in.data(), in.size(),
+                                                            get_ddict(log, dictionary_id))
+                               : ZSTD_decompressDCtx(dctx.get(), out.data(), out.size(), in.data(), in.size());
+      EOS_ASSERT(!ZSTD_isError(r) && r == size, chain::plugin_exception, "corrupt zstd entry in ${name}.log",
+                 ("name", log.get_name()));
+      return out;
+   }
+
+   bool want_samples() const {
+      return sample_count && !training.valid() && (!cdict || (retrain_blocks && blocks_since_train >= retrain_blocks));
+   }
+
+   // collects recent entries; once enough have been gathered a dictionary is trained from them on the thread pool
+   void add_sample(const bytes& in, boost::asio::io_context& thread_pool) {
+      ++blocks_since_train;
+      if (!want_samples() || in.empty())
+         return;
+      samples.push_back(in);
+      sample_bytes += in.size();
+      // zstd recommends roughly 100x the dictionary size in samples
+      if (samples.size() < sample_count && sample_bytes < 100ull * dict_size)
+         return;
+      training = chain::async_thread_pool(thread_pool, [samples = std::move(samples), capacity = dict_size]() {
+         bytes               buffer;
+         std::vector<size_t> sizes;
+         for (auto& s : samples) {
+            buffer.insert(buffer.end(), s.begin(), s.end());
+            sizes.push_back(s.size());
+         }
+         bytes  dict(capacity);
+         size_t r = ZDICT_trainFromBuffer(dict.data(), dict.size(), buffer.data(), sizes.data(), sizes.size());
+         if (ZDICT_isError(r)) {
+            wlog("zstd dictionary training failed: ${e}", ("e", ZDICT_getErrorName(r)));
+            return bytes{};
+         }
+         dict.resize(r);
+         return dict;
+      });
+      samples.clear();
+      sample_bytes = 0;
+   }
+
+   // installs a finished dictionary; new entries are compressed with it
+   void poll_training(state_history_log& log) {
+      if (!training.valid() || training.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+         return;
+      auto dict          = training.get();
+      blocks_since_train = 0;
+      if (dict.empty())
+         return;
+      auto id = ZDICT_getDictID(dict.data(), dict.size());
+      if (!id || log.get_dictionary(id)) {
+         wlog("discarding zstd dictionary with unusable id ${id} for ${name}.log", ("id", id)("name", log.get_name()));
+         return;
+      }
+      ilog("trained zstd dictionary ${id} (${s} bytes) for ${name}.log",
+           ("id", id)("s", dict.size())("name", log.get_name()));
+      log.add_dictionary(id, std::move(dict));
+      use_dictionary(log, id);
+   }
+};
+
+// Reads the payload of the entry for block_num into result, decompressed. If passthrough is non-null, zstd entries
+// are returned still compressed and passthrough describes them; zlib entries are always decompressed.
+inline void read_log_entry(state_history_log& log, zstd_log_context& zstd, uint32_t block_num,
+                           fc::optional<bytes>& result, payload_compression* passthrough = nullptr) {
+   if (block_num < log.begin_block() || block_num >= log.end_block())
+      return;
+   state_history_log_header header;
+   auto&                    stream            = log.get_entry(block_num, header);
+   uint8_t                  entry_compression = (uint8_t)state_history_compression::zlib;
+   uint32_t                 dictionary_id     = 0;
+   if (get_ship_version(header.magic) != ship_zlib_version) {
+      stream.read((char*)&entry_compression, sizeof(entry_compression));
+      stream.read((char*)&dictionary_id, sizeof(dictionary_id));
+   }
+   uint32_t s;
+   stream.read((char*)&s, sizeof(s));
+   bytes compressed(s);
+   if (s)
+      stream.read(compressed.data(), s);
+   if (entry_compression == (uint8_t)state_history_compression::zlib)
+      result = zlib_decompress(compressed);
+   else if (entry_compression == (uint8_t)state_history_compression::zstd) {
+      if (passthrough) {
+         passthrough->compression   = 1;
+         passthrough->dictionary_id = dictionary_id;
+         result                     = std::move(compressed);
+      } else {
+         result = zstd.decompress(log, dictionary_id, compressed);
+      }
+   } else {
+      EOS_ASSERT(false, chain::plugin_exception, "unknown compression ${c} in ${name}.log",
+                 ("c", entry_compression)("name", log.get_name()));
+   }
+}
+
+// Appends data for block_id as a version 0 entry if compression is zlib, otherwise as a version 1 entry compressed
+// with the current dictionary. Samples for the next dictionary are trained on thread_pool, if there is one.
+inline void write_log_entry(state_history_log& log, zstd_log_context& zstd, state_history_compression compression,
+                            const chain::block_id_type& block_id, const chain::block_id_type& prev_id,
+                            const bytes& data, boost::asio::io_context* thread_pool, const char* what) {
+   state_history_log_header header;
+   header.block_id = block_id;
+   bytes    bin;
+   uint32_t dictionary_id = 0;
+   if (compression == state_history_compression::zlib) {
+      bin          = zlib_compress_bytes(data);
+      header.magic = ship_magic(ship_zlib_version);
+   } else {
+      zstd.poll_training(log);
+      bin           = zstd.compress(data);
+      dictionary_id = zstd.cdict_id;
+      header.magic  = ship_magic(ship_current_version);
+      if (thread_pool)
+         zstd.add_sample(data, *thread_pool);
+   }
+   EOS_ASSERT(bin.size() == (uint32_t)bin.size(), chain::plugin_exception, "${w} is too big", ("w", what));
+
+   uint64_t prefix_size = sizeof(uint32_t);
+   if (compression != state_history_compression::zlib)
+      prefix_size += sizeof(uint8_t) + sizeof(uint32_t);
+   header.payload_size = prefix_size + bin.size();
+   log.write_entry(header, prev_id, [&](auto& stream) {
+      if (compression != state_history_compression::zlib) {
+         stream.write((char*)&compression, sizeof(compression));
+         stream.write((char*)&dictionary_id, sizeof(dictionary_id));
+      }
+      uint32_t s = (uint32_t)bin.size();
+      stream.write((char*)&s, sizeof(s));
+      if (!bin.empty())
+         stream.write(bin.data(), bin.size());
+   });
+}
+
+} // namespace eosio
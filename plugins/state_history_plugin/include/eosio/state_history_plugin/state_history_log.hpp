@@ -6,10 +6,13 @@
 
 #include <boost/filesystem.hpp>
 #include <fstream>
+#include <map>
+#include <set>
 #include <stdint.h>
 
 #include <eosio/chain/block_header.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/log_catalog.hpp>
 #include <eosio/chain/types.hpp>
 #include <fc/log/logger.hpp>
 
@@ -29,13 +32,44 @@ namespace eosio {
  * each entry:
  *    state_history_log_header
  *    payload
+ *
+ * version 0 payload:
+ *    uint32_t size
+ *    zlib compressed bytes
+ *
+ * version 1 payload:
+ *    uint8_t  compression (state_history_compression)
+ *    uint32_t dictionary id (0 if no dictionary was used)
+ *    uint32_t size
+ *    compressed bytes
+ *
+ *   *.dict:
+ *   +---------------+-----------------+--------------+-----+---------------+-----------------+--------------+
+ *   | Dictionary id | Dictionary size | Dictionary i | ... | Dictionary id | Dictionary size | Dictionary z |
+ *   +---------------+-----------------+--------------+-----+---------------+-----------------+--------------+
+ *
+ * Version 0 and version 1 entries may be mixed within a single log. Dictionaries are never removed from *.dict
+ * since entries compressed with them may survive a truncation.
+ *
+ * If log_split_config::stride is set, *.log and *.index are moved into the retained directory as
+ * <name>-<first>-<last>.log/.index every time an entry for a multiple of the stride is written (see
+ * chain::log_catalog), which finishes the move and archives old segments on a background thread. The dictionaries
+ * used by a segment's entries are copied to <name>-<first>-<last>.dict, in the same format as *.dict, and are archived
+ * with it. Retained segments are opened on demand; a fork reaching back into the newest segment moves it back into
+ * place as the head log.
  */
 
 inline uint64_t       ship_magic(uint32_t version) { return N(ship) | version; }
 inline bool           is_ship(uint64_t magic) { return (magic & 0xffff'ffff'0000'0000) == N(ship); }
 inline uint32_t       get_ship_version(uint64_t magic) { return magic; }
-inline bool           is_ship_supported_version(uint64_t magic) { return get_ship_version(magic) == 0; }
-static const uint32_t ship_current_version = 0;
+inline bool           is_ship_supported_version(uint64_t magic) { return get_ship_version(magic) <= 1; }
+static const uint32_t ship_zlib_version    = 0;
+static const uint32_t ship_current_version = 1;
+
+enum class state_history_compression : uint8_t {
+   zlib = 0,
+   zstd = 1,
+};
 
 struct state_history_log_header {
    uint64_t             magic        = ship_magic(ship_current_version);
@@ -51,27 +85,79 @@ class state_history_log {
    const char* const    name = "";
    std::string          log_filename;
    std::string          index_filename;
+   std::string          dict_filename;
    std::fstream         log;
    std::fstream         index;
    uint32_t             _begin_block = 0;
    uint32_t             _end_block   = 0;
    chain::block_id_type last_block_id;
 
+   std::map<uint32_t, chain::bytes> dictionaries;
+   uint32_t                         _last_dictionary_id = 0;
+   std::set<uint32_t>               head_dictionary_ids; // used by entries of *.log; copied next to it by split()
+
+   chain::log_split_config split_config;
+   chain::log_catalog      catalog;
+   std::fstream            retained_log;
+   std::fstream            retained_index;
+   uint32_t                retained_begin_block = 0;
+
  public:
-   state_history_log(const char* const name, std::string log_filename, std::string index_filename)
+   state_history_log(const char* const name, std::string log_filename, std::string index_filename,
+                     std::string dict_filename = {}, const chain::log_split_config& split_config = {})
        : name(name)
        , log_filename(std::move(log_filename))
-       , index_filename(std::move(index_filename)) {
+       , index_filename(std::move(index_filename))
+       , dict_filename(std::move(dict_filename))
+       , split_config(split_config) {
       open_log();
       open_index();
+      if (!this->dict_filename.empty())
+         open_dictionaries();
+      if (split_config.stride) {
+         open_catalog();
+         scan_dictionary_ids();
+      }
+   }
+
+   const char* get_name() const { return name; }
+   uint32_t    begin_block() const { return catalog.empty() ? _begin_block : catalog.first_block_num(); }
+   uint32_t    end_block() const { return _end_block; }
+
+   // id of the most recently added dictionary; 0 if there are none
+   uint32_t last_dictionary_id() const { return _last_dictionary_id; }
+
+   const chain::bytes* get_dictionary(uint32_t id) const {
+      auto it = dictionaries.find(id);
+      if (it == dictionaries.end())
+         return nullptr;
+      return &it->second;
    }
 
-   uint32_t begin_block() const { return _begin_block; }
-   uint32_t end_block() const { return _end_block; }
+   void add_dictionary(uint32_t id, chain::bytes dict) {
+      EOS_ASSERT(!dict_filename.empty(), chain::plugin_exception, "${name}.log does not support dictionaries",
+                 ("name", name));
+      EOS_ASSERT(id && !dictionaries.count(id), chain::plugin_exception,
+                 "invalid or duplicate dictionary id ${id} for ${name}.log", ("id", id)("name", name));
+      EOS_ASSERT(dict.size() == (uint32_t)dict.size(), chain::plugin_exception, "dictionary is too big");
+      std::ofstream f(dict_filename, std::ios_base::binary | std::ios_base::out | std::ios_base::app);
+      uint32_t      size = dict.size();
+      f.write((char*)&id, sizeof(id));
+      f.write((char*)&size, sizeof(size));
+      f.write(dict.data(), dict.size());
+      f.flush();
+      EOS_ASSERT(f.good(), chain::plugin_exception, "failed to write ${name}.dict", ("name", name));
+      dictionaries[id]    = std::move(dict);
+      _last_dictionary_id = id;
+   }
 
    void read_header(state_history_log_header& header, bool assert_version = true) {
+      read_header(log, header, assert_version);
+   }
+
+   void read_header(std::fstream& stream, state_history_log_header& header, bool assert_version = true) {
       char bytes[state_history_log_header_serial_size];
-      log.read(bytes, sizeof(bytes));
+      stream.read(bytes, sizeof(bytes));
       fc::datastream<const char*> ds(bytes, sizeof(bytes));
       fc::raw::unpack(ds, header);
       EOS_ASSERT(!ds.remaining(), chain::plugin_exception, "state_history_log_header_serial_size mismatch");
@@ -91,10 +177,10 @@ class state_history_log {
    template <typename F>
    void write_entry(const state_history_log_header& header, const chain::block_id_type& prev_id, F write_payload) {
       auto block_num = chain::block_header::num_from_id(header.block_id);
-      EOS_ASSERT(_begin_block == _end_block || block_num <= _end_block, chain::plugin_exception,
+      EOS_ASSERT(begin_block() == _end_block || block_num <= _end_block, chain::plugin_exception,
                  "missed a block in ${name}.log", ("name", name));
 
-      if (_begin_block != _end_block && block_num > _begin_block) {
+      if (begin_block() != _end_block && block_num > begin_block()) {
          if (block_num == _end_block) {
             EOS_ASSERT(prev_id == last_block_id, chain::plugin_exception, "missed a fork change in ${name}.log",
                        ("name", name));
@@ -116,6 +202,8 @@ class state_history_log {
       EOS_ASSERT(end == pos + state_history_log_header_serial_size + header.payload_size, chain::plugin_exception,
                  "wrote payload with incorrect size to ${name}.log", ("name", name));
       log.write((char*)&pos, sizeof(pos));
+      if (split_config.stride)
+         note_dictionary_id(pos, header);
 
       index.seekg(0, std::ios_base::end);
       index.write((char*)&pos, sizeof(pos));
@@ -123,12 +211,17 @@ class state_history_log {
          _begin_block = block_num;
       _end_block    = block_num + 1;
       last_block_id = header.block_id;
+
+      if (split_config.stride && block_num % split_config.stride == 0)
+         split();
    }
 
    // returns stream positioned at payload
    std::fstream& get_entry(uint32_t block_num, state_history_log_header& header) {
-      EOS_ASSERT(block_num >= _begin_block && block_num < _end_block, chain::plugin_exception,
+      EOS_ASSERT(block_num >= begin_block() && block_num < _end_block, chain::plugin_exception,
                  "read non-existing block in ${name}.log", ("name", name));
+      if (block_num < _begin_block)
+         return get_retained_entry(block_num, header);
       log.seekg(get_pos(block_num));
       read_header(header);
       return log;
@@ -141,6 +234,108 @@ class state_history_log {
    }
 
  private:
+   std::fstream& get_retained_entry(uint32_t block_num, state_history_log_header& header) {
+      auto segment = catalog.find(block_num);
+      EOS_ASSERT(segment, chain::plugin_exception, "read non-existing block in ${name}.log", ("name", name));
+      if (!retained_log.is_open() || retained_begin_block != segment->first_block_num) {
+         close_retained();
+         retained_log.open(segment->log_file.generic_string(), std::ios_base::binary | std::ios_base::in);
+         retained_index.open(segment->index_file.generic_string(), std::ios_base::binary | std::ios_base::in);
+         retained_begin_block = segment->first_block_num;
+      }
+      uint64_t pos;
+      retained_index.seekg((block_num - segment->first_block_num) * sizeof(pos));
+      retained_index.read((char*)&pos, sizeof(pos));
+      retained_log.seekg(pos);
+      read_header(retained_log, header);
+      return retained_log;
+   }
+
+   void close_retained() {
+      if (retained_log.is_open())
+         retained_log.close();
+      if (retained_index.is_open())
+         retained_index.close();
+      retained_begin_block = 0;
+   }
+
+   void open_streams() {
+      log.open(log_filename, std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::app);
+      index.open(index_filename, std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::app);
+   }
+
+   void open_catalog() {
+      catalog.open(fc::path(log_filename).parent_path(), split_config, name);
+      if (catalog.empty())
+         return;
+      if (_begin_block != _end_block && catalog.last_block_num() + 1 != _begin_block) {
+         wlog("retained ${name} segments end at block ${n} but ${name}.log starts at block ${b}; ignoring them",
+              ("name", name)("n", catalog.last_block_num())("b", _begin_block));
+         catalog.clear();
+         return;
+      }
+      // the head log is empty right after a split
+      if (_begin_block == _end_block) {
+         _begin_block = _end_block = catalog.last_block_num() + 1;
+         last_block_id             = get_block_id(catalog.last_block_num());
+      }
+   }
+
+   // records the dictionary used by the entry at pos, if any
+   void note_dictionary_id(uint64_t pos, const state_history_log_header& header) {
+      uint8_t  compression   = 0;
+      uint32_t dictionary_id = 0;
+      if (get_ship_version(header.magic) == ship_zlib_version ||
+          header.payload_size < sizeof(compression) + sizeof(dictionary_id))
+         return;
+      log.seekg(pos + state_history_log_header_serial_size);
+      log.read((char*)&compression, sizeof(compression));
+      log.read((char*)&dictionary_id, sizeof(dictionary_id));
+      if (dictionary_id)
+         head_dictionary_ids.insert(dictionary_id);
+   }
+
+   void scan_dictionary_ids() {
+      head_dictionary_ids.clear();
+      for (uint32_t block_num = _begin_block; block_num < _end_block; ++block_num) {
+         state_history_log_header header;
+         uint64_t                 pos = get_pos(block_num);
+         log.seekg(pos);
+         read_header(header);
+         note_dictionary_id(pos, header);
+      }
+   }
+
+   // writes the dictionaries used by *.log to a file for the catalog to keep with the segment
+   std::string write_segment_dictionaries() {
+      if (head_dictionary_ids.empty())
+         return {};
+      std::string   filename = (fc::path(dict_filename).parent_path() / (std::string(name) + "-segment.dict")).string();
+      std::ofstream f(filename, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+      for (auto id : head_dictionary_ids) {
+         auto dict = get_dictionary(id);
+         EOS_ASSERT(dict, chain::plugin_exception, "${name}.dict is missing dictionary ${id}",
+                    ("name", name)("id", id));
+         uint32_t size = dict->size();
+         f.write((char*)&id, sizeof(id));
+         f.write((char*)&size, sizeof(size));
+         f.write(dict->data(), dict->size());
+      }
+      f.close();
+      EOS_ASSERT(f.good(), chain::plugin_exception, "failed to write ${f}", ("f", filename));
+      return filename;
+   }
+
+   void split() {
+      log.close();
+      index.close();
+      catalog.add(_begin_block, _end_block - 1, log_filename, index_filename, write_segment_dictionaries());
+      head_dictionary_ids.clear();
+      open_streams();
+      ilog("split ${name}.log at block ${b}", ("name", name)("b", _end_block - 1));
+      _begin_block = _end_block;
+   }
+
    bool get_last_block(uint64_t size) {
       state_history_log_header header;
       uint64_t                 suffix;
@@ -221,6 +416,33 @@ class state_history_log {
       }
    }
 
+   void open_dictionaries() {
+      std::fstream f(dict_filename, std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::app);
+      f.seekg(0, std::ios_base::end);
+      uint64_t size = f.tellg();
+      uint64_t pos  = 0;
+      while (pos + 2 * sizeof(uint32_t) <= size) {
+         uint32_t id, dict_size;
+         f.seekg(pos);
+         f.read((char*)&id, sizeof(id));
+         f.read((char*)&dict_size, sizeof(dict_size));
+         if (!id || pos + 2 * sizeof(uint32_t) + dict_size > size)
+            break;
+         chain::bytes dict(dict_size);
+         f.read(dict.data(), dict_size);
+         dictionaries[id]    = std::move(dict);
+         _last_dictionary_id = id;
+         pos += 2 * sizeof(uint32_t) + dict_size;
+      }
+      if (pos != size) {
+         elog("corrupt ${name}.dict; truncating to ${pos} bytes", ("name", name)("pos", pos));
+         f.close();
+         boost::filesystem::resize_file(dict_filename, pos);
+      }
+      if (!dictionaries.empty())
+         ilog("${name}.dict has ${n} dictionaries", ("name", name)("n", dictionaries.size()));
+   }
+
    void open_index() {
       index.open(index_filename, std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::app);
       index.seekg(0, std::ios_base::end);
@@ -268,6 +490,21 @@ class state_history_log {
    }
 
    void truncate(uint32_t block_num) {
+      // a fork which reaches into a retained segment moves that segment back into place as the head log
+      while (!catalog.empty() && block_num <= catalog.last_block_num()) {
+         auto segment = catalog.back();
+         close_retained();
+         log.close();
+         index.close();
+         catalog.pop_back(log_filename, index_filename);
+         open_streams();
+         _begin_block = segment.first_block_num;
+         _end_block   = segment.last_block_num + 1;
+         ilog("fork: restored retained segment ${b}-${e} as ${name}.log",
+              ("b", segment.first_block_num)("e", segment.last_block_num)("name", name));
+         scan_dictionary_ids();
+      }
+
       log.flush();
       index.flush();
       uint64_t num_removed = 0;
@@ -277,7 +514,7 @@ class state_history_log {
          index.seekg(0);
          boost::filesystem::resize_file(log_filename, 0);
          boost::filesystem::resize_file(index_filename, 0);
-         _begin_block = _end_block = 0;
+         _begin_block = _end_block = catalog.empty() ? 0 : catalog.last_block_num() + 1;
       } else {
          num_removed  = _end_block - block_num;
          uint64_t pos = get_pos(block_num);
@@ -116,8 +116,35 @@ struct get_blocks_result_v0 {
    fc::optional<bytes>          deltas;
 };
 
-using state_request = fc::static_variant<get_status_request_v0, get_blocks_request_v0, get_blocks_ack_request_v0>;
-using state_result  = fc::static_variant<get_status_result_v0, get_blocks_result_v0>;
+// Same as get_blocks_request_v0, but the reply is get_blocks_result_v1. If fetch_compressed is set, zstd entries are
+// sent as stored in the log instead of being decompressed by the server.
+struct get_blocks_request_v1 : get_blocks_request_v0 {
+   bool fetch_compressed = false;
+};
+
+struct get_dictionary_request_v0 {
+   uint32_t dictionary_id = 0;
+};
+
+struct payload_compression {
+   uint8_t  compression   = 0; // 0: uncompressed, 1: zstd
+   uint32_t dictionary_id = 0; // 0: no dictionary
+};
+
+struct get_blocks_result_v1 : get_blocks_result_v0 {
+   payload_compression traces_compression = {};
+   payload_compression deltas_compression = {};
+};
+
+struct get_dictionary_result_v0 {
+   uint32_t dictionary_id = 0;
+   bytes    dictionary    = {}; // empty if dictionary_id is unknown
+};
+
+using state_request = fc::static_variant<get_status_request_v0, get_blocks_request_v0, get_blocks_ack_request_v0,
+                                         get_blocks_request_v1, get_dictionary_request_v0>;
+using state_result  = fc::static_variant<get_status_result_v0, get_blocks_result_v0, get_blocks_result_v1,
+                                        get_dictionary_result_v0>;
 
 class state_history_plugin : public plugin<state_history_plugin> {
  public:
@@ -145,4 +172,8 @@ FC_REFLECT_EMPTY(eosio::get_status_request_v0);
 FC_REFLECT(eosio::get_status_result_v0, (head)(last_irreversible)(trace_begin_block)(trace_end_block)(chain_state_begin_block)(chain_state_end_block));
 FC_REFLECT(eosio::get_blocks_request_v0, (start_block_num)(end_block_num)(max_messages_in_flight)(have_positions)(irreversible_only)(fetch_block)(fetch_traces)(fetch_deltas));
 FC_REFLECT(eosio::get_blocks_ack_request_v0, (num_messages));
+FC_REFLECT_DERIVED(eosio::get_blocks_request_v1, (eosio::get_blocks_request_v0), (fetch_compressed));
+FC_REFLECT(eosio::get_dictionary_request_v0, (dictionary_id));
+FC_REFLECT(eosio::payload_compression, (compression)(dictionary_id));
+FC_REFLECT(eosio::get_dictionary_result_v0, (dictionary_id)(dictionary));
 // clang-format on
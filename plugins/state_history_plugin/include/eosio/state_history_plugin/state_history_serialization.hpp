@@ -686,4 +686,12 @@ datastream<ST>& operator<<(datastream<ST>& ds, const eosio::get_blocks_result_v0
    return ds;
 }
 
+template <typename ST>
+datastream<ST>& operator<<(datastream<ST>& ds, const eosio::get_blocks_result_v1& obj) {
+   ds << static_cast<const eosio::get_blocks_result_v0&>(obj);
+   fc::raw::pack(ds, obj.traces_compression);
+   fc::raw::pack(ds, obj.deltas_compression);
+   return ds;
+}
+
 } // namespace fc
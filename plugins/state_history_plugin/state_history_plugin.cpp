@@ -4,6 +4,8 @@
  */
 
 #include <eosio/chain/config.hpp>
+#include <eosio/chain/thread_utils.hpp>
+#include <eosio/state_history_plugin/state_history_compression.hpp>
 #include <eosio/state_history_plugin/state_history_log.hpp>
 #include <eosio/state_history_plugin/state_history_serialization.hpp>
 
@@ -13,9 +15,6 @@
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
-#include <boost/iostreams/device/back_inserter.hpp>
-#include <boost/iostreams/filter/zlib.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
 #include <boost/signals2/connection.hpp>
 
 using tcp    = boost::asio::ip::tcp;
@@ -42,27 +41,6 @@ auto catch_and_log(F f) {
    }
 }
 
-namespace bio = boost::iostreams;
-static bytes zlib_compress_bytes(bytes in) {
-   bytes                  out;
-   bio::filtering_ostream comp;
-   comp.push(bio::zlib_compressor(bio::zlib::default_compression));
-   comp.push(bio::back_inserter(out));
-   bio::write(comp, in.data(), in.size());
-   bio::close(comp);
-   return out;
-}
-
-static bytes zlib_decompress(const bytes& in) {
-   bytes                  out;
-   bio::filtering_ostream decomp;
-   decomp.push(bio::zlib_decompressor());
-   decomp.push(bio::back_inserter(out));
-   bio::write(decomp, in.data(), in.size());
-   bio::close(decomp);
-   return out;
-}
-
 template <typename T>
 bool include_delta(const T& old, const T& curr) {
    return true;
@@ -119,6 +97,10 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    chain_plugin*                                              chain_plug = nullptr;
    fc::optional<state_history_log>                            trace_log;
    fc::optional<state_history_log>                            chain_state_log;
+   fc::optional<zstd_log_context>                             trace_zstd;
+   fc::optional<zstd_log_context>                             chain_state_zstd;
+   state_history_compression                                  compression = state_history_compression::zlib;
+   fc::optional<named_thread_pool>                            training_thread_pool;
    bool                                                       trace_debug_mode = false;
    bool                                                       stopping = false;
    fc::optional<scoped_connection>                            applied_transaction_connection;
@@ -129,17 +111,28 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    std::map<transaction_id_type, augmented_transaction_trace> cached_traces;
    fc::optional<augmented_transaction_trace>                  onblock_trace;
 
-   void get_log_entry(state_history_log& log, uint32_t block_num, fc::optional<bytes>& result) {
-      if (block_num < log.begin_block() || block_num >= log.end_block())
-         return;
-      state_history_log_header header;
-      auto&                    stream = log.get_entry(block_num, header);
-      uint32_t                 s;
-      stream.read((char*)&s, sizeof(s));
-      bytes compressed(s);
-      if (s)
-         stream.read(compressed.data(), s);
-      result = zlib_decompress(compressed);
+   // if passthrough is non-null, zstd entries are returned still compressed and passthrough describes them
+   void get_log_entry(state_history_log& log, zstd_log_context& zstd, uint32_t block_num, fc::optional<bytes>& result,
+                      payload_compression* passthrough = nullptr) {
+      read_log_entry(log, zstd, block_num, result, passthrough);
+   }
+
+   void write_log_entry(state_history_log& log, zstd_log_context& zstd, const block_state_ptr& block_state,
+                        const bytes& data, const char* what) {
+      eosio::write_log_entry(log, zstd, compression, block_state->block->id(), block_state->block->previous, data,
+                             training_thread_pool ? &training_thread_pool->get_executor() : nullptr, what);
+   }
+
+   bytes get_dictionary(uint32_t dictionary_id) {
+      if (trace_log) {
+         if (auto dict = trace_log->get_dictionary(dictionary_id))
+            return *dict;
+      }
+      if (chain_state_log) {
+         if (auto dict = chain_state_log->get_dictionary(dictionary_id))
+            return *dict;
+      }
+      return {};
    }
 
    void get_block(uint32_t block_num, fc::optional<bytes>& result) {
@@ -173,7 +166,8 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       bool                                       sending  = false;
       bool                                       sent_abi = false;
       std::vector<std::vector<char>>             send_queue;
-      fc::optional<get_blocks_request_v0>        current_request;
+      fc::optional<get_blocks_request_v1>        current_request;
+      bool                                       send_results_v1     = false;
       bool                                       need_to_send_update = false;
 
       session(std::shared_ptr<state_history_plugin_impl> plugin)
@@ -258,6 +252,14 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       }
 
       void operator()(get_blocks_request_v0& req) {
+         get_blocks_request_v1 req_v1;
+         static_cast<get_blocks_request_v0&>(req_v1) = req;
+         start_blocks_request(req_v1, false);
+      }
+
+      void operator()(get_blocks_request_v1& req) { start_blocks_request(req, true); }
+
+      void start_blocks_request(get_blocks_request_v1& req, bool results_v1) {
          for (auto& cp : req.have_positions) {
             if (req.start_block_num <= cp.block_num)
                continue;
@@ -267,9 +269,17 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          }
          req.have_positions.clear();
          current_request = req;
+         send_results_v1 = results_v1;
          send_update(true);
       }
 
+      void operator()(get_dictionary_request_v0& req) {
+         get_dictionary_result_v0 result;
+         result.dictionary_id = req.dictionary_id;
+         result.dictionary    = plugin->get_dictionary(req.dictionary_id);
+         send(std::move(result));
+      }
+
       void operator()(get_blocks_ack_request_v0& req) {
          if (!current_request)
             return;
@@ -283,8 +293,24 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          if (!send_queue.empty() || !need_to_send_update || !current_request ||
              !current_request->max_messages_in_flight)
             return;
-         auto&                chain = plugin->chain_plug->chain();
-         get_blocks_result_v0 result;
+         uint32_t current;
+         if (send_results_v1) {
+            get_blocks_result_v1 result;
+            current = fill_blocks_result(result, &result);
+            send(std::move(result));
+         } else {
+            get_blocks_result_v0 result;
+            current = fill_blocks_result(result, nullptr);
+            send(std::move(result));
+         }
+         --current_request->max_messages_in_flight;
+         need_to_send_update = current_request->start_block_num <= current &&
+                               current_request->start_block_num < current_request->end_block_num;
+      }
+
+      // returns the block number the request is currently allowed to reach
+      uint32_t fill_blocks_result(get_blocks_result_v0& result, get_blocks_result_v1* result_v1) {
+         auto& chain              = plugin->chain_plug->chain();
          result.head              = {chain.head_block_num(), chain.head_block_id()};
          result.last_irreversible = {chain.last_irreversible_block_num(), chain.last_irreversible_block_id()};
          uint32_t current =
@@ -293,6 +319,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
              current_request->start_block_num < current_request->end_block_num) {
             auto block_id = plugin->get_block_id(current_request->start_block_num);
             if (block_id) {
+               bool passthrough   = result_v1 && current_request->fetch_compressed;
                result.this_block  = block_position{current_request->start_block_num, *block_id};
                auto prev_block_id = plugin->get_block_id(current_request->start_block_num - 1);
                if (prev_block_id)
@@ -300,16 +327,16 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
                if (current_request->fetch_block)
                   plugin->get_block(current_request->start_block_num, result.block);
                if (current_request->fetch_traces && plugin->trace_log)
-                  plugin->get_log_entry(*plugin->trace_log, current_request->start_block_num, result.traces);
+                  plugin->get_log_entry(*plugin->trace_log, *plugin->trace_zstd, current_request->start_block_num,
+                                        result.traces, passthrough ? &result_v1->traces_compression : nullptr);
                if (current_request->fetch_deltas && plugin->chain_state_log)
-                  plugin->get_log_entry(*plugin->chain_state_log, current_request->start_block_num, result.deltas);
+                  plugin->get_log_entry(*plugin->chain_state_log, *plugin->chain_state_zstd,
+                                        current_request->start_block_num, result.deltas,
+                                        passthrough ? &result_v1->deltas_compression : nullptr);
             }
             ++current_request->start_block_num;
          }
-         send(std::move(result));
-         --current_request->max_messages_in_flight;
-         need_to_send_update = current_request->start_block_num <= current &&
-                               current_request->start_block_num < current_request->end_block_num;
+         return current;
       }
 
       template <typename F>
@@ -452,19 +479,9 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       cached_traces.clear();
       onblock_trace.reset();
 
-      auto& db         = chain_plug->chain().db();
-      auto  traces_bin = zlib_compress_bytes(fc::raw::pack(make_history_context_wrapper(db, trace_debug_mode, traces)));
-      EOS_ASSERT(traces_bin.size() == (uint32_t)traces_bin.size(), plugin_exception, "traces is too big");
-
-      state_history_log_header header{.magic        = ship_magic(ship_current_version),
-                                      .block_id     = block_state->block->id(),
-                                      .payload_size = sizeof(uint32_t) + traces_bin.size()};
-      trace_log->write_entry(header, block_state->block->previous, [&](auto& stream) {
-         uint32_t s = (uint32_t)traces_bin.size();
-         stream.write((char*)&s, sizeof(s));
-         if (!traces_bin.empty())
-            stream.write(traces_bin.data(), traces_bin.size());
-      });
+      auto& db = chain_plug->chain().db();
+      write_log_entry(*trace_log, *trace_zstd, block_state,
+                      fc::raw::pack(make_history_context_wrapper(db, trace_debug_mode, traces)), "traces");
    }
 
    void store_chain_state(const block_state_ptr& block_state) {
@@ -553,17 +570,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       process_table("resource_limits_state", db.get_index<resource_limits::resource_limits_state_index>(), pack_row);
       process_table("resource_limits_config", db.get_index<resource_limits::resource_limits_config_index>(), pack_row);
 
-      auto deltas_bin = zlib_compress_bytes(fc::raw::pack(deltas));
-      EOS_ASSERT(deltas_bin.size() == (uint32_t)deltas_bin.size(), plugin_exception, "deltas is too big");
-      state_history_log_header header{.magic        = ship_magic(ship_current_version),
-                                      .block_id     = block_state->block->id(),
-                                      .payload_size = sizeof(uint32_t) + deltas_bin.size()};
-      chain_state_log->write_entry(header, block_state->block->previous, [&](auto& stream) {
-         uint32_t s = (uint32_t)deltas_bin.size();
-         stream.write((char*)&s, sizeof(s));
-         if (!deltas_bin.empty())
-            stream.write(deltas_bin.data(), deltas_bin.size());
-      });
+      write_log_entry(*chain_state_log, *chain_state_zstd, block_state, fc::raw::pack(deltas), "deltas");
    } // store_chain_state
 };   // state_history_plugin_impl
 
@@ -584,6 +591,27 @@ void state_history_plugin::set_program_options(options_description& cli, options
            "your internal network.");
    options("trace-history-debug-mode", bpo::bool_switch()->default_value(false),
            "enable debug mode for trace history");
+   options("state-history-stride", bpo::value<uint32_t>()->default_value(0),
+           "split the state history logs into new files every time this many blocks have been written "
+           "(0 to keep a single file per log)");
+   options("max-retained-history-files", bpo::value<uint32_t>()->default_value(10),
+           "the maximum number of split state history files to keep in state-history-retained-dir");
+   options("state-history-retained-dir", bpo::value<bfs::path>()->default_value(""),
+           "the location of split state history files (absolute path or relative to state-history-dir); empty means "
+           "state-history-dir itself");
+   options("state-history-archive-dir", bpo::value<bfs::path>()->default_value("archive"),
+           "the location split state history files are moved to once there are more than max-retained-history-files "
+           "of them (absolute path or relative to state-history-dir); if empty, such files are deleted");
+   options("state-history-compression", bpo::value<string>()->default_value("zlib"),
+           "compression used for new state history entries: \"zlib\" (readable by older versions) or \"zstd\"");
+   options("state-history-zstd-level", bpo::value<int>()->default_value(ZSTD_CLEVEL_DEFAULT),
+           "zstd compression level for state history entries");
+   options("state-history-zstd-dictionary-samples", bpo::value<uint32_t>()->default_value(1000),
+           "number of recent entries used to train a zstd dictionary for each log; 0 disables dictionaries");
+   options("state-history-zstd-dictionary-size", bpo::value<uint32_t>()->default_value(112640),
+           "maximum size in bytes of a trained zstd dictionary");
+   options("state-history-zstd-retrain-blocks", bpo::value<uint32_t>()->default_value(0),
+           "train a new zstd dictionary after this many blocks; 0 only trains when a log has no dictionary");
 }
 
 void state_history_plugin::plugin_initialize(const variables_map& options) {
@@ -625,12 +653,44 @@ void state_history_plugin::plugin_initialize(const variables_map& options) {
          my->trace_debug_mode = true;
       }
 
-      if (options.at("trace-history").as<bool>())
+      auto compression = options.at("state-history-compression").as<string>();
+      if (compression == "zstd")
+         my->compression = state_history_compression::zstd;
+      else
+         EOS_ASSERT(compression == "zlib", plugin_config_exception, "unknown state-history-compression: ${c}",
+                    ("c", compression));
+
+      auto init_zstd = [&](fc::optional<zstd_log_context>& zstd, const state_history_log& log) {
+         zstd.emplace();
+         zstd->level          = options.at("state-history-zstd-level").as<int>();
+         zstd->sample_count   = options.at("state-history-zstd-dictionary-samples").as<uint32_t>();
+         zstd->dict_size      = options.at("state-history-zstd-dictionary-size").as<uint32_t>();
+         zstd->retrain_blocks = options.at("state-history-zstd-retrain-blocks").as<uint32_t>();
+         if (my->compression == state_history_compression::zstd && log.last_dictionary_id())
+            zstd->use_dictionary(log, log.last_dictionary_id());
+      };
+
+      chain::log_split_config split_config;
+      split_config.stride             = options.at("state-history-stride").as<uint32_t>();
+      split_config.max_retained_files = options.at("max-retained-history-files").as<uint32_t>();
+      split_config.retained_dir       = options.at("state-history-retained-dir").as<bfs::path>();
+      split_config.archive_dir        = options.at("state-history-archive-dir").as<bfs::path>();
+
+      if (options.at("trace-history").as<bool>()) {
          my->trace_log.emplace("trace_history", (state_history_dir / "trace_history.log").string(),
-                               (state_history_dir / "trace_history.index").string());
-      if (options.at("chain-state-history").as<bool>())
+                               (state_history_dir / "trace_history.index").string(),
+                               (state_history_dir / "trace_history.dict").string(), split_config);
+         init_zstd(my->trace_zstd, *my->trace_log);
+      }
+      if (options.at("chain-state-history").as<bool>()) {
          my->chain_state_log.emplace("chain_state_history", (state_history_dir / "chain_state_history.log").string(),
-                                     (state_history_dir / "chain_state_history.index").string());
+                                     (state_history_dir / "chain_state_history.index").string(),
+                                     (state_history_dir / "chain_state_history.dict").string(), split_config);
+         init_zstd(my->chain_state_zstd, *my->chain_state_log);
+      }
+      if (my->compression == state_history_compression::zstd &&
+          options.at("state-history-zstd-dictionary-samples").as<uint32_t>())
+         my->training_thread_pool.emplace("shipdt", 1);
    }
    FC_LOG_AND_RETHROW()
 } // state_history_plugin::plugin_initialize
@@ -643,6 +703,8 @@ void state_history_plugin::plugin_shutdown() {
    while (!my->sessions.empty())
       my->sessions.begin()->second->close();
    my->stopping = true;
+   if (my->training_thread_pool)
+      my->training_thread_pool->stop();
 }
 
 } // namespace eosio
@@ -48,6 +48,34 @@ extern const char* const state_history_plugin_abi = R"({
                 { "name": "deltas", "type": "bytes?" }
             ]
         },
+        {
+            "name": "get_blocks_request_v1", "base": "get_blocks_request_v0", "fields": [
+                { "name": "fetch_compressed", "type": "bool" }
+            ]
+        },
+        {
+            "name": "get_dictionary_request_v0", "fields": [
+                { "name": "dictionary_id", "type": "uint32" }
+            ]
+        },
+        {
+            "name": "payload_compression", "fields": [
+                { "name": "compression", "type": "uint8" },
+                { "name": "dictionary_id", "type": "uint32" }
+            ]
+        },
+        {
+            "name": "get_blocks_result_v1", "base": "get_blocks_result_v0", "fields": [
+                { "name": "traces_compression", "type": "payload_compression" },
+                { "name": "deltas_compression", "type": "payload_compression" }
+            ]
+        },
+        {
+            "name": "get_dictionary_result_v0", "fields": [
+                { "name": "dictionary_id", "type": "uint32" },
+                { "name": "dictionary", "type": "bytes" }
+            ]
+        },
         {
             "name": "row", "fields": [
                 { "name": "present", "type": "bool" },
@@ -471,8 +499,8 @@ extern const char* const state_history_plugin_abi = R"({
         { "new_type_name": "transaction_id", "type": "checksum256" }
     ],
     "variants": [
-        { "name": "request", "types": ["get_status_request_v0", "get_blocks_request_v0", "get_blocks_ack_request_v0"] },
-        { "name": "result", "types": ["get_status_result_v0", "get_blocks_result_v0"] },
+        { "name": "request", "types": ["get_status_request_v0", "get_blocks_request_v0", "get_blocks_ack_request_v0", "get_blocks_request_v1", "get_dictionary_request_v0"] },
+        { "name": "result", "types": ["get_status_result_v0", "get_blocks_result_v0", "get_blocks_result_v1", "get_dictionary_result_v0"] },
 
         { "name": "action_receipt", "types": ["action_receipt_v0"] },
         { "name": "action_trace", "types": ["action_trace_v0"] },
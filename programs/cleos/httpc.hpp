@@ -115,6 +115,7 @@ namespace eosio { namespace client { namespace http {
    const string net_disconnect = net_func_base + "/disconnect";
    const string net_status = net_func_base + "/status";
    const string net_connections = net_func_base + "/connections";
+   const string net_peer_scores = net_func_base + "/peer_scores";
 
 
    const string wallet_func_base = "/v1/wallet";
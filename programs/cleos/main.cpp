@@ -316,7 +316,7 @@ fc::variant push_transaction( signed_transaction& trx, packed_transaction::compr
       try {
          fc::variant ref_block;
          if (!tx_ref_block_num_or_id.empty()) {
-            ref_block = call(get_block_func, fc::mutable_variant_object("block_num_or_id", tx_ref_block_num_or_id));
+            ref_block = call(get_block_func, fc::mutable_variant_object("block_num_or_id", tx_ref_block_num_or_id)("fields", "header"));
             ref_block_id = ref_block["id"].as<block_id_type>();
          }
       } EOS_RETHROW_EXCEPTIONS(invalid_ref_block_exception, "Invalid reference block num or id: ${block_num_or_id}", ("block_num_or_id", tx_ref_block_num_or_id));
@@ -2485,12 +2485,17 @@ int main( int argc, char** argv ) {
 
    // get block
    string blockArg;
+   string blockFields;
    bool get_bhs = false;
    auto getBlock = get->add_subcommand("block", localized("Retrieve a full block from the blockchain"), false);
    getBlock->add_option("block", blockArg, localized("The number or ID of the block to retrieve"))->required();
    getBlock->add_flag("--header-state", get_bhs, localized("Get block header state from fork database instead") );
-   getBlock->set_callback([&blockArg,&get_bhs] {
+   getBlock->add_option("--fields", blockFields, localized("Parts of the block to retrieve: full (default), header, ids or raw"));
+   getBlock->set_callback([&blockArg,&blockFields,&get_bhs] {
       auto arg = fc::mutable_variant_object("block_num_or_id", blockArg);
+      if( !get_bhs && !blockFields.empty() ) {
+         arg("fields", blockFields);
+      }
       if( get_bhs ) {
          std::cout << fc::json::to_pretty_string(call(get_block_header_state_func, arg)) << std::endl;
       } else {
@@ -2600,6 +2605,7 @@ int main( int argc, char** argv ) {
    string index_position;
    bool reverse = false;
    bool show_payer = false;
+   string cursor;
    auto getTable = get->add_subcommand( "table", localized("Retrieve the contents of a database table"), false);
    getTable->add_option( "account", code, localized("The account who owns the table") )->required();
    getTable->add_option( "scope", scope, localized("The scope within the contract in which the table is found") )->required();
@@ -2620,6 +2626,7 @@ int main( int argc, char** argv ) {
                                     "i256 - supports both 'dec' and 'hex', ripemd160 and sha256 is 'hex' only"));
    getTable->add_flag("-r,--reverse", reverse, localized("Iterate in reverse order"));
    getTable->add_flag("--show-payer", show_payer, localized("show RAM payer"));
+   getTable->add_option( "--cursor", cursor, localized("The next_cursor of a previous call with the same arguments, to fetch the rows after it") );
 
 
    getTable->set_callback([&] {
@@ -2636,6 +2643,7 @@ int main( int argc, char** argv ) {
                          ("encode_type", encode_type)
                          ("reverse", reverse)
                          ("show_payer", show_payer)
+                         ("cursor", cursor)
                          );
 
       std::cout << fc::json::to_pretty_string(result)
@@ -3122,6 +3130,12 @@ int main( int argc, char** argv ) {
       std::cout << fc::json::to_pretty_string(v) << std::endl;
    });
 
+   auto scores = net->add_subcommand("scores", localized("quality scores of all existing peers, best first"), false);
+   scores->set_callback([&] {
+      const auto& v = call(url, net_peer_scores, new_host);
+      std::cout << fc::json::to_pretty_string(v) << std::endl;
+   });
+
 
 
    // Wallet subcommand
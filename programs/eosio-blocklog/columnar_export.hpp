@@ -0,0 +1,253 @@
+/**
+ *  @file
+ *  @copyright defined in eosio/LICENSE.txt
+ */
+#pragma once
+#include <eosio/chain/block_log.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/thread_utils.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/variant_object.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <deque>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Columnar export of the block log. Every column is a separate file in the output directory holding one
+ * little-endian fixed-width value per row, except for "blob" columns whose rows are a uint32_t length followed by
+ * that many bytes. Rows of actions.* refer to rows of transactions.* through actions.trx_index, and rows of
+ * transactions.* to rows of blocks.* through transactions.block_num. schema.json lists the columns and row counts.
+ */
+namespace columnar {
+
+   using namespace eosio::chain;
+   namespace bfs = boost::filesystem;
+
+   struct column {
+      const char*       name;
+      const char*       type;
+      std::vector<char> data;
+
+      template<typename T>
+      void push( const T& v ) {
+         static_assert( std::is_trivially_copyable<T>::value, "fixed-width columns need trivially copyable values" );
+         auto p = reinterpret_cast<const char*>(&v);
+         data.insert( data.end(), p, p + sizeof(v) );
+      }
+
+      void push_raw( const char* p, size_t size ) {
+         data.insert( data.end(), p, p + size );
+      }
+
+      void push_checksum( const fc::sha256& v ) {
+         push_raw( v.data(), v.data_size() );
+      }
+
+      void push_blob( const char* p, uint32_t size ) {
+         push( size );
+         push_raw( p, size );
+      }
+   };
+
+   /// one batch of decoded blocks; batches are decoded concurrently and written in block order
+   struct batch {
+      uint32_t first_block_num     = 0;
+      uint32_t requested_end_block = 0; ///< one past the last block this batch was asked to decode
+      uint32_t end_block_num       = 0; ///< one past the last block found in the log
+      uint64_t num_blocks = 0, num_transactions = 0, num_actions = 0;
+
+      column block_num{"blocks.block_num", "uint32"};
+      column block_timestamp{"blocks.timestamp", "int64 microseconds since epoch"};
+      column block_producer{"blocks.producer", "name (uint64)"};
+      column block_id{"blocks.id", "checksum256"};
+      column block_trx_count{"blocks.transaction_count", "uint32"};
+
+      column trx_block_num{"transactions.block_num", "uint32"};
+      column trx_id{"transactions.id", "checksum256"};
+      column trx_status{"transactions.status", "uint8"};
+      column trx_cpu_usage_us{"transactions.cpu_usage_us", "uint32"};
+      column trx_net_usage_words{"transactions.net_usage_words", "uint32"};
+
+      column act_block_num{"actions.block_num", "uint32"};
+      column act_timestamp{"actions.timestamp", "int64 microseconds since epoch"};
+      column act_trx_index{"actions.trx_index", "uint64 row in transactions.*"};
+      column act_ordinal{"actions.ordinal", "uint32 position within the transaction"};
+      column act_context_free{"actions.context_free", "uint8"};
+      column act_account{"actions.account", "name (uint64)"};
+      column act_name{"actions.name", "name (uint64)"};
+      column act_authorization{"actions.authorization", "blob (packed permission_level[])"};
+      column act_data{"actions.data", "blob"};
+
+      std::vector<column*> columns() {
+         return { &block_num, &block_timestamp, &block_producer, &block_id, &block_trx_count,
+                  &trx_block_num, &trx_id, &trx_status, &trx_cpu_usage_us, &trx_net_usage_words,
+                  &act_block_num, &act_timestamp, &act_trx_index, &act_ordinal, &act_context_free,
+                  &act_account, &act_name, &act_authorization, &act_data };
+      }
+
+      void add_block( const signed_block& b ) {
+         const auto id = b.id();
+         const int64_t ts = b.timestamp.to_time_point().time_since_epoch().count();
+         const uint32_t num = b.block_num();
+         block_num.push( num );
+         block_timestamp.push( ts );
+         block_producer.push( b.producer.value );
+         block_id.push_checksum( id );
+         block_trx_count.push( static_cast<uint32_t>(b.transactions.size()) );
+         ++num_blocks;
+
+         for( const auto& receipt : b.transactions ) {
+            const uint64_t trx_index = num_transactions++;
+            trx_block_num.push( num );
+            trx_status.push( static_cast<uint8_t>(receipt.status.value) );
+            trx_cpu_usage_us.push( receipt.cpu_usage_us );
+            trx_net_usage_words.push( static_cast<uint32_t>(receipt.net_usage_words.value) );
+            if( receipt.trx.contains<transaction_id_type>() ) {
+               trx_id.push_checksum( receipt.trx.get<transaction_id_type>() );
+               continue;
+            }
+            const auto& pt = receipt.trx.get<packed_transaction>();
+            trx_id.push_checksum( pt.id() );
+            const auto& trx = pt.get_transaction();
+            uint32_t ordinal = 0;
+            auto add_action = [&]( const action& a, uint8_t context_free ) {
+               act_block_num.push( num );
+               act_timestamp.push( ts );
+               act_trx_index.push( trx_index );
+               act_ordinal.push( ordinal++ );
+               act_context_free.push( context_free );
+               act_account.push( a.account.value );
+               act_name.push( a.name.value );
+               auto auth = fc::raw::pack( a.authorization );
+               act_authorization.push_blob( auth.data(), auth.size() );
+               act_data.push_blob( a.data.data(), a.data.size() );
+               ++num_actions;
+            };
+            for( const auto& a : trx.context_free_actions )
+               add_action( a, 1 );
+            for( const auto& a : trx.actions )
+               add_action( a, 0 );
+         }
+      }
+
+      // the transactions.* row of a batch's first transaction is only known once all earlier batches are decoded,
+      // so actions.trx_index is relative to the batch until it is written
+      void rebase_trx_index( uint64_t trx_index_base ) {
+         auto p = reinterpret_cast<uint64_t*>( act_trx_index.data.data() );
+         for( uint64_t i = 0; i < num_actions; ++i )
+            p[i] += trx_index_base;
+      }
+   };
+
+   inline batch decode( const bfs::path& blocks_dir, uint32_t first_block_num, uint32_t last_block_num ) {
+      // block_log keeps its own file positions, so each worker thread reads through its own instance
+      static thread_local std::unique_ptr<block_log> log;
+      static thread_local bfs::path                  log_dir;
+      if( !log || log_dir != blocks_dir ) {
+         log.reset();
+         log = std::make_unique<block_log>( blocks_dir );
+         log_dir = blocks_dir;
+      }
+
+      batch result;
+      result.first_block_num = result.end_block_num = first_block_num;
+      result.requested_end_block = last_block_num + 1;
+      for( uint32_t n = first_block_num; n <= last_block_num; ++n ) {
+         auto b = log->read_block_by_num( n );
+         if( !b )
+            break;
+         result.add_block( *b );
+         result.end_block_num = n + 1;
+      }
+      return result;
+   }
+
+
+   struct export_summary {
+      uint64_t num_blocks = 0, num_transactions = 0, num_actions = 0;
+   };
+
+   /// exports blocks first_block through last_block, or to the head of the log, to columnar_dir
+   inline export_summary export_blocks( const bfs::path& blocks_dir, const bfs::path& columnar_dir, uint32_t first_block,
+                                        uint32_t last_block, uint32_t export_threads, uint32_t export_batch_size ) {
+      uint32_t end_block_num;
+      uint32_t block_num;
+      {
+         // opening the log here also repairs the index before the worker threads open their own instances
+         block_log block_logger(blocks_dir);
+         const auto head = block_logger.read_head();
+         EOS_ASSERT( head, block_log_exception, "No blocks found in block log" );
+         block_num = std::max( first_block, block_logger.first_block_num() );
+         end_block_num = std::min<uint64_t>( last_block, head->block_num() ) + 1;
+         ilog( "exporting blocks ${f} through ${l} to ${d}", ("f", block_num)("l", end_block_num - 1)("d", columnar_dir.generic_string()) );
+      }
+
+      bfs::create_directories( columnar_dir );
+      std::map<std::string, std::ofstream> files;
+      std::map<std::string, std::pair<std::string, uint64_t>> schema; // column -> (type, bytes)
+      auto write_batch = [&]( columnar::batch& b ) {
+         for( auto* c : b.columns() ) {
+            auto& f = files[c->name];
+            if( !f.is_open() ) {
+               f.open( (columnar_dir / c->name).generic_string(), std::ios::out | std::ios::binary | std::ios::trunc );
+               EOS_ASSERT( f.good(), block_log_exception, "Unable to open ${f}", ("f", (columnar_dir / c->name).generic_string()) );
+               schema[c->name].first = c->type;
+            }
+            f.write( c->data.data(), c->data.size() );
+            schema[c->name].second += c->data.size();
+         }
+      };
+
+      eosio::chain::named_thread_pool pool( "export", std::max<uint32_t>( export_threads, 1 ) );
+      std::deque<std::future<columnar::batch>> pending;
+      const size_t max_pending = 2 * std::max<uint32_t>( export_threads, 1 );
+      const uint32_t batch_size = std::max<uint32_t>( export_batch_size, 1 );
+      uint64_t num_blocks = 0, num_transactions = 0, num_actions = 0;
+      bool done = false; // set if the log ends before end_block_num
+
+      while( !done && (block_num < end_block_num || !pending.empty()) ) {
+         while( block_num < end_block_num && pending.size() < max_pending ) {
+            const uint32_t last = std::min<uint64_t>( uint64_t(block_num) + batch_size, end_block_num ) - 1;
+            pending.emplace_back( eosio::chain::async_thread_pool( pool.get_executor(), [dir = blocks_dir, block_num, last]() {
+               return columnar::decode( dir, block_num, last );
+            } ) );
+            block_num = last + 1;
+         }
+
+         auto b = pending.front().get();
+         pending.pop_front();
+         b.rebase_trx_index( num_transactions );
+         write_batch( b );
+         num_blocks += b.num_blocks;
+         num_transactions += b.num_transactions;
+         num_actions += b.num_actions;
+         done = b.end_block_num < b.requested_end_block;
+         if( num_blocks % 1000000 < b.num_blocks )
+            ilog( "exported through block ${n}", ("n", b.end_block_num - 1) );
+      }
+      for( auto& p : pending )
+         p.wait();
+      pool.stop();
+
+      fc::mutable_variant_object columns;
+      for( const auto& c : schema )
+         columns( c.first, fc::mutable_variant_object( "type", c.second.first )( "bytes", c.second.second ) );
+      auto summary = fc::mutable_variant_object
+         ( "blocks", num_blocks )
+         ( "transactions", num_transactions )
+         ( "actions", num_actions )
+         ( "columns", std::move(columns) );
+      fc::json::save_to_file( fc::variant(std::move(summary)), columnar_dir / "schema.json", true );
+      ilog( "exported ${b} blocks, ${t} transactions, ${a} actions", ("b", num_blocks)("t", num_transactions)("a", num_actions) );
+      return { num_blocks, num_transactions, num_actions };
+   }
+
+} // namespace columnar
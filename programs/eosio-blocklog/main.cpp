@@ -6,6 +6,9 @@
 #include <eosio/chain/block_log.hpp>
 #include <eosio/chain/config.hpp>
 #include <eosio/chain/reversible_block_object.hpp>
+#include <eosio/chain/trx_block_index.hpp>
+
+#include "columnar_export.hpp"
 
 #include <fc/io/json.hpp>
 #include <fc/filesystem.hpp>
@@ -16,6 +19,8 @@
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/path.hpp>
 
+#include <thread>
+
 using namespace eosio::chain;
 namespace bfs = boost::filesystem;
 namespace bpo = boost::program_options;
@@ -27,17 +32,50 @@ struct blocklog {
    {}
 
    void read_log();
+   void export_columnar();
+   void rebuild_trx_index();
    void set_program_options(options_description& cli);
    void initialize(const variables_map& options);
 
    bfs::path                        blocks_dir;
    bfs::path                        output_file;
+   bfs::path                        columnar_dir;
    uint32_t                         first_block;
    uint32_t                         last_block;
+   uint32_t                         export_threads;
+   uint32_t                         export_batch_size;
    bool                             no_pretty_print;
    bool                             as_json_array;
+   bool                             rebuild_trx_block_index;
 };
 
+void blocklog::export_columnar() {
+   columnar::export_blocks( blocks_dir, columnar_dir, first_block, last_block, export_threads, export_batch_size );
+}
+
+void blocklog::rebuild_trx_index() {
+   block_log block_logger(blocks_dir);
+   const auto head = block_logger.read_head();
+   EOS_ASSERT( head, block_log_exception, "No blocks found in block log" );
+   const uint32_t first_block_num = block_logger.first_block_num();
+   ilog( "indexing transactions of blocks ${f} through ${l} in ${d}",
+         ("f", first_block_num)("l", head->block_num())("d", blocks_dir.generic_string()) );
+
+   trx_block_index::remove( blocks_dir );
+   trx_block_index index( blocks_dir );
+   uint64_t num_transactions = 0;
+   for( uint32_t block_num = first_block_num; block_num <= head->block_num(); ++block_num ) {
+      auto b = block_logger.read_block_by_num( block_num );
+      EOS_ASSERT( b, block_log_exception, "Block ${n} missing from block log", ("n", block_num) );
+      index.add_block( *b );
+      num_transactions += b->transactions.size();
+      if( block_num % 1000000 == 0 )
+         ilog( "indexed through block ${n}", ("n", block_num) );
+   }
+   index.close();
+   ilog( "indexed ${t} transactions of ${b} blocks", ("t", num_transactions)("b", head->block_num() - first_block_num + 1) );
+}
+
 void blocklog::read_log() {
    block_log block_logger(blocks_dir);
    const auto end = block_logger.read_head();
@@ -145,6 +183,16 @@ void blocklog::set_program_options(options_description& cli)
           "Do not pretty print the output.  Useful if piping to jq to improve performance.")
          ("as-json-array", bpo::bool_switch(&as_json_array)->default_value(false),
           "Print out json blocks wrapped in json array (otherwise the output is free-standing json objects).")
+         ("export-columnar", bpo::value<bfs::path>(),
+          "Instead of JSON, export blocks, transactions and actions of irreversible blocks as binary column files into "
+          "this directory (absolute or relative path).")
+         ("export-threads", bpo::value<uint32_t>(&export_threads)->default_value(std::max(1u, std::thread::hardware_concurrency())),
+          "Number of threads decoding blocks for --export-columnar.")
+         ("export-batch-size", bpo::value<uint32_t>(&export_batch_size)->default_value(10000),
+          "Number of consecutive blocks each --export-columnar thread decodes at a time.")
+         ("rebuild-trx-index", bpo::bool_switch(&rebuild_trx_block_index)->default_value(false),
+          "Instead of printing blocks, replace the transaction id to block number index (trx-block-index of nodeos) in "
+          "the blocks directory with one built from the block log.")
          ("help", "Print this help message and exit.")
          ;
 
@@ -158,6 +206,14 @@ void blocklog::initialize(const variables_map& options) {
       else
          blocks_dir = bld;
 
+      if (options.count( "export-columnar" )) {
+         bld = options.at( "export-columnar" ).as<bfs::path>();
+         if( bld.is_relative())
+            columnar_dir = bfs::current_path() / bld;
+         else
+            columnar_dir = bld;
+      }
+
       if (options.count( "output-file" )) {
          bld = options.at( "output-file" ).as<bfs::path>();
          if( bld.is_relative())
@@ -185,7 +241,12 @@ int main(int argc, char** argv)
         return 0;
       }
       blog.initialize(vmap);
-      blog.read_log();
+      if (blog.rebuild_trx_block_index)
+         blog.rebuild_trx_index();
+      else if (!blog.columnar_dir.empty())
+         blog.export_columnar();
+      else
+         blog.read_log();
    } catch( const fc::exception& e ) {
       elog( "${e}", ("e", e.to_detail_string()));
       return -1;
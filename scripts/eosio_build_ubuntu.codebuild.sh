@@ -72,7 +72,7 @@ fi
 DEP_ARRAY=(
 	git llvm-4.0 clang-4.0 libclang-4.0-dev make automake libbz2-dev libssl-dev doxygen graphviz \
 	libgmp3-dev autotools-dev build-essential libicu-dev python2.7 python2.7-dev python3 python3-dev \
-	autoconf libtool curl zlib1g-dev sudo ruby libusb-1.0-0-dev libcurl4-gnutls-dev pkg-config
+	autoconf libtool curl zlib1g-dev libzstd-dev sudo ruby libusb-1.0-0-dev libcurl4-gnutls-dev pkg-config
 )
 COUNT=1
 DISPLAY=""
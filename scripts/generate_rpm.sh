@@ -38,7 +38,7 @@ Version: ${VERSION_NO_SUFFIX}
 License: MIT
 Vendor: ${VENDOR} 
 Source: ${URL} 
-Requires: openssl, gmp, libstdc++, bzip2, libcurl, libusbx
+Requires: openssl, gmp, libstdc++, bzip2, libzstd, libcurl, libusbx
 URL: ${URL} 
 Packager: ${VENDOR} <${EMAIL}>
 Summary: ${DESC}
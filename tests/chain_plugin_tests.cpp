@@ -122,4 +122,50 @@ BOOST_FIXTURE_TEST_CASE( get_block_with_invalid_abi, TESTER ) try {
 
 } FC_LOG_AND_RETHROW() /// get_block_with_invalid_abi
 
+BOOST_FIXTURE_TEST_CASE( get_block_fields, TESTER ) try {
+   produce_blocks(2);
+
+   const auto trx_id = create_account( N(alice) )->id;
+   produce_block();
+   const auto block = control->fetch_block_by_number( control->head_block_num() );
+   BOOST_REQUIRE_EQUAL( 1u, block->transactions.size() );
+
+   chain_apis::read_only plugin(*(this->control), fc::microseconds::maximum());
+   chain_apis::read_only::get_block_params param{std::to_string(block->block_num())};
+   const auto full = plugin.get_block(param);
+
+   param.fields = "header";
+   auto header = plugin.get_block(param);
+   BOOST_REQUIRE_EQUAL( full["id"].as_string(), header["id"].as_string() );
+   BOOST_REQUIRE_EQUAL( full["block_num"].as_uint64(), header["block_num"].as_uint64() );
+   BOOST_REQUIRE_EQUAL( full["ref_block_prefix"].as_uint64(), header["ref_block_prefix"].as_uint64() );
+   BOOST_REQUIRE_EQUAL( full["producer"].as_string(), header["producer"].as_string() );
+   BOOST_REQUIRE( !header.get_object().contains("transactions") );
+
+   // by id, as well as by number
+   param.block_num_or_id = full["id"].as_string();
+   param.fields = "ids";
+   auto ids = plugin.get_block(param);
+   BOOST_REQUIRE_EQUAL( full["id"].as_string(), ids["id"].as_string() );
+   BOOST_REQUIRE_EQUAL( 1u, ids["transactions"].size() );
+   BOOST_REQUIRE_EQUAL( "executed", ids["transactions"][size_t(0)]["status"].as_string() );
+   BOOST_REQUIRE( ids["transactions"][size_t(0)]["id"].as<transaction_id_type>() == trx_id );
+
+   param.fields = "raw";
+   auto raw = plugin.get_block(param);
+   BOOST_REQUIRE_EQUAL( full["block_num"].as_uint64(), raw["block_num"].as_uint64() );
+   const auto packed = fc::raw::pack( *block );
+   BOOST_REQUIRE_EQUAL( fc::to_hex( packed.data(), packed.size() ), raw["raw_block"].as_string() );
+
+   // a block id of the right number but unknown
+   auto bad_id = block->id();
+   bad_id._hash[3] ^= 1;
+   param.block_num_or_id = fc::variant( bad_id ).as_string();
+   BOOST_CHECK_THROW( plugin.get_block(param), unknown_block_exception );
+
+   param.fields = "actions";
+   BOOST_CHECK_THROW( plugin.get_block(param), invalid_http_request );
+
+} FC_LOG_AND_RETHROW() /// get_block_fields
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,179 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/net_plugin/compact_block.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace eosio;
+
+namespace {
+
+   packed_transaction make_trx( uint16_t n ) {
+      signed_transaction t;
+      t.expiration = fc::time_point_sec( 1000000 );
+      t.ref_block_num = n;
+      return packed_transaction( t );
+   }
+
+   /// a block of n packed transactions with one deferred transaction id in the middle
+   signed_block_ptr make_block( uint16_t n, uint32_t previous ) {
+      auto b = std::make_shared<signed_block>();
+      b->previous = block_id_type( fc::sha256::hash( std::to_string( previous ) ) );
+      for( uint16_t i = 0; i < n; ++i ) {
+         if( i == n / 2 ) {
+            transaction_receipt r;
+            r.trx = transaction_id_type( fc::sha256::hash( std::string( "deferred" ) ) );
+            b->transactions.emplace_back( std::move( r ) );
+         }
+         b->transactions.emplace_back( make_trx( i ) );
+      }
+      vector<digest_type> digests;
+      for( const auto& r : b->transactions ) digests.emplace_back( r.digest() );
+      b->transaction_mroot = merkle( std::move( digests ) );
+      return b;
+   }
+
+   compact_block_message make_compact( const signed_block& b ) {
+      compact_block_message cb;
+      cb.header = b;
+      for( const auto& r : b.transactions ) {
+         if( r.trx.contains<packed_transaction>() ) {
+            cb.receipts.emplace_back( compact_receipt{r, r.trx.get<packed_transaction>().id(), true} );
+         } else {
+            cb.receipts.emplace_back( compact_receipt{r, r.trx.get<transaction_id_type>(), false} );
+         }
+      }
+      return cb;
+   }
+
+   /// as net_plugin frames a packed_transaction for node_transaction_state::serialized_txn
+   std::shared_ptr<vector<char>> frame( const packed_transaction& trx ) {
+      const net_message m( trx );
+      const uint32_t payload_size = fc::raw::pack_size( m );
+      auto buf = std::make_shared<vector<char>>( message_header_size + payload_size );
+      fc::datastream<char*> ds( buf->data(), buf->size() );
+      ds.write( reinterpret_cast<const char*>( &payload_size ), message_header_size );
+      fc::raw::pack( ds, m );
+      return buf;
+   }
+
+   /// a pending compact block for b where every third packed transaction is missing locally
+   pending_compact_block make_pending( const signed_block& b ) {
+      pending_compact_block p;
+      p.block_id = b.id();
+      p.msg = make_compact( b );
+      p.serialized_trxs.resize( p.msg.receipts.size() );
+      for( uint32_t i = 0; i < p.msg.receipts.size(); ++i ) {
+         if( !p.msg.receipts[i].packed ) continue;
+         if( i % 3 == 0 ) {
+            p.missing.push_back( i );
+         } else {
+            p.serialized_trxs[i] = frame( b.transactions[i].trx.get<packed_transaction>() );
+         }
+      }
+      return p;
+   }
+
+   vector<packed_transaction> fetch( const signed_block& b, const vector<uint32_t>& indexes ) {
+      vector<packed_transaction> trxs;
+      for( auto i : indexes ) trxs.push_back( b.transactions[i].trx.get<packed_transaction>() );
+      return trxs;
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(compact_block_tests)
+
+BOOST_AUTO_TEST_CASE(rebuild_with_missing_transactions)
+{
+   auto b = make_block( 10, 1 );
+   auto p = make_pending( *b );
+   BOOST_REQUIRE_EQUAL( p.missing.size(), 4u );
+
+   // the missing transactions have not arrived
+   BOOST_CHECK_THROW( p.to_block(), plugin_exception );
+
+   p.fetched_trxs = fetch( *b, p.missing );
+   auto rebuilt = p.to_block();
+   BOOST_REQUIRE( rebuilt );
+   BOOST_CHECK( rebuilt->id() == b->id() );
+   BOOST_CHECK( fc::raw::pack( *rebuilt ) == fc::raw::pack( *b ) );
+
+   // transactions in the wrong order do not match the transaction_mroot
+   std::reverse( p.fetched_trxs.begin(), p.fetched_trxs.end() );
+   BOOST_CHECK( !p.to_block() );
+
+   // nothing missing, all from local transactions
+   auto local = make_pending( *b );
+   for( auto i : local.missing ) local.serialized_trxs[i] = frame( b->transactions[i].trx.get<packed_transaction>() );
+   local.missing.clear();
+   auto from_local = local.to_block();
+   BOOST_REQUIRE( from_local );
+   BOOST_CHECK( from_local->id() == b->id() );
+}
+
+BOOST_AUTO_TEST_CASE(pending_by_block_id)
+{
+   auto b1 = make_block( 6, 1 );
+   auto b2 = make_block( 7, 2 );
+   pending_compact_blocks pending( 4 );
+
+   // a second compact block does not replace the first one
+   BOOST_CHECK( !pending.add( make_pending( *b1 ) ) );
+   BOOST_CHECK( !pending.add( make_pending( *b2 ) ) );
+   BOOST_CHECK_EQUAL( pending.size(), 2u );
+
+   // the transactions for either one complete it, in any order
+   auto p2 = pending.take( b2->id() );
+   BOOST_REQUIRE( p2 );
+   p2->fetched_trxs = fetch( *b2, p2->missing );
+   auto r2 = p2->to_block();
+   BOOST_REQUIRE( r2 );
+   BOOST_CHECK( r2->id() == b2->id() );
+
+   auto p1 = pending.take( b1->id() );
+   BOOST_REQUIRE( p1 );
+   p1->fetched_trxs = fetch( *b1, p1->missing );
+   auto r1 = p1->to_block();
+   BOOST_REQUIRE( r1 );
+   BOOST_CHECK( r1->id() == b1->id() );
+
+   BOOST_CHECK( pending.empty() );
+   BOOST_CHECK( !pending.take( b1->id() ) );
+}
+
+BOOST_AUTO_TEST_CASE(pending_replacement_and_eviction)
+{
+   vector<signed_block_ptr> blocks;
+   for( uint32_t i = 0; i < 4; ++i ) blocks.push_back( make_block( 4, i ) );
+   pending_compact_blocks pending( 2 );
+
+   BOOST_CHECK( !pending.add( make_pending( *blocks[0] ) ) );
+   BOOST_CHECK( !pending.add( make_pending( *blocks[1] ) ) );
+
+   // the same block again replaces its entry without evicting anything
+   BOOST_CHECK( !pending.add( make_pending( *blocks[0] ) ) );
+   BOOST_CHECK_EQUAL( pending.size(), 2u );
+
+   // beyond capacity the oldest is evicted and reported, so its full block can be requested
+   auto evicted = pending.add( make_pending( *blocks[2] ) );
+   BOOST_REQUIRE( evicted );
+   BOOST_CHECK( *evicted == blocks[0]->id() );
+   BOOST_CHECK( !pending.contains( blocks[0]->id() ) );
+   BOOST_CHECK( pending.contains( blocks[1]->id() ) );
+   BOOST_CHECK( pending.contains( blocks[2]->id() ) );
+
+   // taking one makes room again
+   BOOST_CHECK( pending.take( blocks[1]->id() ) );
+   BOOST_CHECK( !pending.add( make_pending( *blocks[3] ) ) );
+   evicted = pending.add( make_pending( *blocks[1] ) );
+   BOOST_REQUIRE( evicted );
+   BOOST_CHECK( *evicted == blocks[2]->id() );
+
+   pending.clear();
+   BOOST_CHECK( pending.empty() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
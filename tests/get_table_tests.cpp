@@ -4,6 +4,8 @@
  */
 #include <boost/test/unit_test.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
 
 #include <eosio/testing/tester.hpp>
 #include <eosio/chain/abi_serializer.hpp>
@@ -23,6 +25,8 @@
 #include <fc/io/json.hpp>
 
 #include <array>
+#include <atomic>
+#include <thread>
 #include <utility>
 
 #ifdef NON_VALIDATING_TEST
@@ -136,8 +140,181 @@ BOOST_FIXTURE_TEST_CASE( get_scope_test, TESTER ) try {
    BOOST_REQUIRE_EQUAL(0u, result.rows.size());
    BOOST_REQUIRE_EQUAL("", result.more);
 
+   // a table filter returns the scopes of that table only
+   param.lower_bound = param.upper_bound = "";
+   param.table = N(stat);
+   param.limit = 10;
+   result = plugin.read_only::get_table_by_scope(param);
+   BOOST_REQUIRE_EQUAL(1u, result.rows.size());
+   BOOST_REQUIRE_EQUAL(name(N(stat)), result.rows[0].table);
+   BOOST_REQUIRE_EQUAL("", result.more);
+
+   param.table = N(accounts);
+   param.limit = 2;
+   param.reverse = true;
+   result = plugin.read_only::get_table_by_scope(param);
+   BOOST_REQUIRE_EQUAL(2u, result.rows.size());
+   BOOST_REQUIRE_EQUAL(name(N(initd)), result.rows[0].scope);
+   BOOST_REQUIRE_EQUAL(name(N(initc)), result.rows[1].scope);
+   BOOST_REQUIRE_EQUAL("initb", result.more);
+
+   // the same with the table scope index
+   eosio::chain_apis::read_only indexed(*(this->control), fc::microseconds::maximum(), nullptr,
+                                        std::make_shared<eosio::chain_apis::table_scope_index>(*(this->control)));
+   result = indexed.read_only::get_table_by_scope(param);
+   BOOST_REQUIRE_EQUAL(2u, result.rows.size());
+   BOOST_REQUIRE_EQUAL(name(N(initd)), result.rows[0].scope);
+   BOOST_REQUIRE_EQUAL(name(N(initc)), result.rows[1].scope);
+   BOOST_REQUIRE_EQUAL("initb", result.more);
+
+   // tables of the block being built are found before and after it is accepted
+   param.limit = 10;
+   param.reverse = false;
+   for (account_name a: {N(inite), N(initf)}) {
+      create_accounts({a});
+      issue_tokens( *this, config::system_account_name, a, eosio::chain::asset::from_string("999.0000 SYS") );
+      result = indexed.read_only::get_table_by_scope(param);
+      BOOST_REQUIRE_EQUAL(plugin.read_only::get_table_by_scope(param).rows.size(), result.rows.size());
+      BOOST_REQUIRE_EQUAL(a, result.rows.back().scope);
+      produce_blocks(1);
+      result = indexed.read_only::get_table_by_scope(param);
+      BOOST_REQUIRE_EQUAL(plugin.read_only::get_table_by_scope(param).rows.size(), result.rows.size());
+      BOOST_REQUIRE_EQUAL(a, result.rows.back().scope);
+   }
+
 } FC_LOG_AND_RETHROW() /// get_scope_test
 
+BOOST_FIXTURE_TEST_CASE( get_scope_concurrent_test, TESTER ) try {
+   produce_blocks(2);
+
+   create_accounts({ N(eosio.token) });
+   std::vector<account_name> accs{N(inita), N(initb), N(initc), N(initd)};
+   create_accounts(accs);
+   produce_block();
+
+   set_code( N(eosio.token), contracts::eosio_token_wasm() );
+   set_abi( N(eosio.token), contracts::eosio_token_abi().data() );
+   produce_blocks(1);
+
+   push_action(N(eosio.token), N(create), N(eosio.token), mutable_variant_object()
+         ("issuer",       "eosio")
+         ("maximum_supply", eosio::chain::asset::from_string("1000000000.0000 SYS")));
+   for (account_name a: accs) {
+      issue_tokens( *this, config::system_account_name, a, eosio::chain::asset::from_string("999.0000 SYS") );
+      // every other table in the block being built
+      if (a == N(initb) || a == N(initd)) produce_blocks(1);
+   }
+
+   eosio::chain_apis::read_only plugin(*(this->control), fc::microseconds::maximum());
+   eosio::chain_apis::read_only indexed(*(this->control), fc::microseconds::maximum(), nullptr,
+                                        std::make_shared<eosio::chain_apis::table_scope_index>(*(this->control)));
+   issue_tokens( *this, config::system_account_name, N(eosio.token), eosio::chain::asset::from_string("1.0000 SYS") );
+
+   // lookups only read the index, so http threads may run them at once
+   for (bool reverse : {false, true}) {
+      eosio::chain_apis::read_only::get_table_by_scope_params param{N(eosio.token), N(accounts), "", "", 100, reverse};
+      const auto expected = fc::json::to_string( plugin.read_only::get_table_by_scope(param) );
+      std::atomic<uint32_t> mismatches{0};
+      std::vector<std::thread> threads;
+      for (int i = 0; i < 4; ++i) {
+         threads.emplace_back( [&]() {
+            for (int j = 0; j < 200; ++j) {
+               auto lock = control->read_lock();
+               if (fc::json::to_string( indexed.read_only::get_table_by_scope(param) ) != expected) ++mismatches;
+            }
+         } );
+      }
+      for (auto& t : threads) t.join();
+      BOOST_REQUIRE_EQUAL(0u, mismatches.load());
+   }
+
+} FC_LOG_AND_RETHROW() /// get_scope_concurrent_test
+
+BOOST_FIXTURE_TEST_CASE( export_table_rows_test, TESTER ) try {
+   produce_blocks(2);
+
+   create_accounts({ N(eosio.token), N(eosio.ram), N(eosio.ramfee), N(eosio.stake),
+      N(eosio.bpay), N(eosio.vpay), N(eosio.saving), N(eosio.names) });
+
+   std::vector<account_name> accs{N(inita), N(initb), N(initc), N(initd)};
+   create_accounts(accs);
+   produce_block();
+
+   set_code( N(eosio.token), contracts::eosio_token_wasm() );
+   set_abi( N(eosio.token), contracts::eosio_token_abi().data() );
+   produce_blocks(1);
+
+   for (auto sym : {"SYS", "AAA"}) {
+      push_action(N(eosio.token), N(create), N(eosio.token), mutable_variant_object()
+            ("issuer",       "eosio")
+            ("maximum_supply", eosio::chain::asset::from_string(std::string("1000000000.0000 ") + sym)));
+      for (account_name a: accs) {
+         issue_tokens( *this, config::system_account_name, a, eosio::chain::asset::from_string(std::string("999.0000 ") + sym) );
+      }
+   }
+   produce_blocks(1);
+
+   eosio::chain_apis::read_only plugin(*(this->control), fc::microseconds::maximum());
+   eosio::chain_apis::read_only::export_table_rows_params param;
+   param.code = N(eosio.token);
+   param.table = N(accounts);
+
+   // every scope in binary, one row per page
+   param.max_bytes = 1;
+   vector<std::pair<name, string>> rows;
+   eosio::chain_apis::read_only::export_table_rows_result result;
+   do {
+      result = plugin.read_only::export_table_rows(param);
+      BOOST_REQUIRE_EQUAL(control->head_block_num(), result.head_block_num);
+      BOOST_REQUIRE_EQUAL(1u, result.row_count);
+      BOOST_REQUIRE(result.binary_rows);
+      BOOST_REQUIRE(!result.ndjson);
+      fc::datastream<const char*> ds(result.binary_rows->data(), result.binary_rows->size());
+      while (ds.remaining()) {
+         name scope;
+         uint64_t primary_key;
+         account_name payer;
+         bytes data;
+         fc::raw::unpack(ds, scope);
+         fc::raw::unpack(ds, primary_key);
+         fc::raw::unpack(ds, payer);
+         fc::raw::unpack(ds, data);
+         auto balance = fc::raw::unpack<asset>(data);
+         BOOST_REQUIRE_EQUAL(balance.get_symbol().to_symbol_code().value, primary_key);
+         rows.emplace_back(scope, balance.to_string());
+      }
+      param.cursor = result.next_cursor;
+   } while (result.next_cursor);
+   // the issuer's scope comes first, then the accounts' scopes in order
+   BOOST_REQUIRE_LE(8u, rows.size());
+   const auto first = rows.size() - 8;
+   BOOST_REQUIRE_EQUAL(name(N(inita)), rows[first].first);
+   BOOST_REQUIRE_EQUAL("999.0000 AAA", rows[first].second);
+   BOOST_REQUIRE_EQUAL("999.0000 SYS", rows[first + 1].second);
+   BOOST_REQUIRE_EQUAL(name(N(initd)), rows[first + 7].first);
+
+   // one scope as ndjson, in a single page
+   param.scope = N(initc);
+   param.format = "ndjson";
+   param.max_bytes = 1024 * 1024;
+   param.cursor.reset();
+   result = plugin.read_only::export_table_rows(param);
+   BOOST_REQUIRE_EQUAL(2u, result.row_count);
+   BOOST_REQUIRE(!result.next_cursor);
+   BOOST_REQUIRE(result.ndjson);
+   vector<string> lines;
+   boost::split(lines, *result.ndjson, boost::is_any_of("\n"));
+   BOOST_REQUIRE_EQUAL(3u, lines.size());
+   BOOST_REQUIRE_EQUAL("", lines[2]);
+   auto row = fc::json::from_string(lines[1]);
+   BOOST_REQUIRE_EQUAL("initc", row["scope"].as_string());
+   BOOST_REQUIRE_EQUAL("999.0000 SYS", row["data"]["balance"].as_string());
+
+   param.format = "csv";
+   BOOST_CHECK_THROW(plugin.read_only::export_table_rows(param), contract_table_query_exception);
+
+} FC_LOG_AND_RETHROW() /// export_table_rows_test
+
 BOOST_FIXTURE_TEST_CASE( get_table_test, TESTER ) try {
    produce_blocks(2);
 
@@ -315,6 +492,77 @@ BOOST_FIXTURE_TEST_CASE( get_table_test, TESTER ) try {
       BOOST_REQUIRE_EQUAL("7777.0000 CCC", result.rows[0]["balance"].as_string());
    }
 
+   // get table: the reverse case continued with the cursor
+   BOOST_REQUIRE(result.next_cursor);
+   p.cursor = result.next_cursor;
+   result = plugin.read_only::get_table_rows(p);
+   BOOST_REQUIRE_EQUAL(1u, result.rows.size());
+   BOOST_REQUIRE_EQUAL(false, result.more);
+   BOOST_REQUIRE(!result.next_cursor);
+   BOOST_REQUIRE_EQUAL("8888.0000 BBB", result.rows[0]["balance"].as_string());
+
+   // a cursor is only valid in the direction it was returned for
+   p.reverse = false;
+   BOOST_CHECK_THROW(plugin.read_only::get_table_rows(p), contract_table_query_exception);
+   p.cursor = "00ff";
+   BOOST_CHECK_THROW(plugin.read_only::get_table_rows(p), contract_table_query_exception);
+
+   // get table: page through all rows with cursors, in binary
+   p.lower_bound = p.upper_bound = "";
+   p.cursor.reset();
+   p.binary = true;
+   vector<string> balances;
+   do {
+      result = plugin.read_only::get_table_rows(p);
+      BOOST_REQUIRE(result.rows.empty());
+      BOOST_REQUIRE(result.binary_rows);
+      fc::datastream<const char*> ds(result.binary_rows->data(), result.binary_rows->size());
+      while (ds.remaining()) {
+         uint64_t primary_key;
+         account_name payer;
+         bytes data;
+         fc::raw::unpack(ds, primary_key);
+         fc::raw::unpack(ds, payer);
+         fc::raw::unpack(ds, data);
+         BOOST_REQUIRE_EQUAL(payer, N(inita));
+         auto balance = fc::raw::unpack<asset>(data);
+         BOOST_REQUIRE_EQUAL(balance.get_symbol().to_symbol_code().value, primary_key);
+         balances.push_back(balance.to_string());
+      }
+      BOOST_REQUIRE_EQUAL(result.more, bool(result.next_cursor));
+      p.cursor = result.next_cursor;
+   } while (result.more);
+   BOOST_REQUIRE_EQUAL(4u, balances.size());
+   BOOST_REQUIRE_EQUAL("9999.0000 AAA", balances[0]);
+   BOOST_REQUIRE_EQUAL("8888.0000 BBB", balances[1]);
+   BOOST_REQUIRE_EQUAL("7777.0000 CCC", balances[2]);
+   BOOST_REQUIRE_EQUAL("10000.0000 SYS", balances[3]);
+
+   // get_batch: queries of several calls, a failed one does not fail the others
+   eosio::chain_apis::read_only::get_batch_params batch;
+   batch.queries.push_back({"get_table_rows", fc::mutable_variant_object()
+                               ("code", "eosio.token")("scope", "initb")("table", "accounts")("json", true)("limit", 2)});
+   batch.queries.push_back({"get_currency_balance", fc::mutable_variant_object()
+                               ("code", "eosio.token")("account", "inita")("symbol", "CCC")});
+   batch.queries.push_back({"get_block", fc::mutable_variant_object()("block_num_or_id", 1)});
+   batch.queries.push_back({"get_table_rows", fc::mutable_variant_object()
+                               ("code", "eosio.token")("scope", "inita")("table", "nosuchtable")("json", true)});
+   batch.queries.push_back({"get_info", fc::variant()});
+   auto batch_result = plugin.read_only::get_batch(batch);
+   BOOST_REQUIRE_EQUAL(5u, batch_result.results.size());
+   const auto& rows = batch_result.results[0]["result"]["rows"].get_array();
+   BOOST_REQUIRE_EQUAL(2u, rows.size());
+   BOOST_REQUIRE_EQUAL("9999.0000 AAA", rows[0]["balance"].as_string());
+   BOOST_REQUIRE_EQUAL(true, batch_result.results[0]["result"]["more"].as_bool());
+   BOOST_REQUIRE_EQUAL("7777.0000 CCC", batch_result.results[1]["result"].get_array().at(0).as_string());
+   BOOST_REQUIRE(batch_result.results[2].get_object().contains("error"));
+   BOOST_REQUIRE_EQUAL(invalid_http_request::code_value, batch_result.results[2]["error"]["code"].as_int64());
+   BOOST_REQUIRE_EQUAL(contract_table_query_exception::code_value, batch_result.results[3]["error"]["code"].as_int64());
+   BOOST_REQUIRE_EQUAL(control->head_block_num(), batch_result.results[4]["result"]["head_block_num"].as<uint32_t>());
+
+   batch.queries.resize(eosio::chain_apis::read_only::max_batch_queries + 1, batch.queries[4]);
+   BOOST_CHECK_THROW(plugin.read_only::get_batch(batch), invalid_http_request);
+
 } FC_LOG_AND_RETHROW()
 
 BOOST_FIXTURE_TEST_CASE( get_table_by_seckey_test, TESTER ) try {
@@ -450,6 +698,91 @@ BOOST_FIXTURE_TEST_CASE( get_table_by_seckey_test, TESTER ) try {
       BOOST_REQUIRE_EQUAL("100000", result.rows[0]["high_bid"].as_string());
    }
 
+   // limit to 1 reverse, continued with cursors
+   vector<string> names;
+   names.push_back(result.rows[0]["newname"].as_string());
+   while (result.more) {
+      BOOST_REQUIRE(result.next_cursor);
+      p.cursor = result.next_cursor;
+      result = plugin.read_only::get_table_rows(p);
+      BOOST_REQUIRE_EQUAL(1u, result.rows.size());
+      names.push_back(result.rows[0]["newname"].as_string());
+   }
+   BOOST_REQUIRE_EQUAL(4u, names.size());
+   BOOST_REQUIRE_EQUAL("org", names[1]);
+   BOOST_REQUIRE_EQUAL("io", names[2]);
+   BOOST_REQUIRE_EQUAL("html", names[3]);
+
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( get_account_cached_test, TESTER ) try {
+   produce_blocks(2);
+
+   create_accounts({ N(eosio.token), N(eosio.ram), N(eosio.ramfee), N(eosio.stake),
+      N(eosio.bpay), N(eosio.vpay), N(eosio.saving), N(eosio.names) });
+
+   std::vector<account_name> accs{N(inita), N(initb)};
+   create_accounts(accs);
+   produce_block();
+
+   set_code( N(eosio.token), contracts::eosio_token_wasm() );
+   set_abi( N(eosio.token), contracts::eosio_token_abi().data() );
+   produce_blocks(1);
+
+   push_action(N(eosio.token), N(create), N(eosio.token), mutable_variant_object()
+         ("issuer",       "eosio")
+         ("maximum_supply", eosio::chain::asset::from_string("1000000000.0000 SYS")));
+   for (account_name a: accs) {
+      issue_tokens( *this, config::system_account_name, a, eosio::chain::asset::from_string("10000.0000 SYS") );
+   }
+   produce_blocks(1);
+
+   set_code( config::system_account_name, contracts::eosio_system_wasm() );
+   set_abi( config::system_account_name, contracts::eosio_system_abi().data() );
+
+   base_tester::push_action(config::system_account_name, N(init),
+                            config::system_account_name,  mutable_variant_object()
+                            ("version", 0)
+                            ("core", CORE_SYM_STR));
+   produce_blocks(1);
+
+   eosio::chain_apis::read_only plugin(*(this->control), fc::microseconds::maximum());
+
+   // a row changed is decoded again
+   auto delegatebw = [this]( const asset& net, const asset& cpu ) {
+      return push_action( N(eosio), N(delegatebw), N(inita), fc::mutable_variant_object()
+                          ("from", "inita")
+                          ("receiver", "inita")
+                          ("stake_net_quantity", net)
+                          ("stake_cpu_quantity", cpu)
+                          ("transfer", false)
+                          );
+   };
+   delegatebw( eosio::chain::asset::from_string("1.0000 SYS"), eosio::chain::asset::from_string("2.0000 SYS") );
+   produce_blocks(1);
+
+   eosio::chain_apis::read_only cached(*(this->control), fc::microseconds::maximum(), std::make_shared<eosio::chain_apis::system_rows_cache>());
+   auto account = cached.get_account({N(inita)});
+   BOOST_REQUIRE_EQUAL("1.0000 SYS", account.total_resources["net_weight"].as_string());
+   BOOST_REQUIRE_EQUAL("2.0000 SYS", account.self_delegated_bandwidth["cpu_weight"].as_string());
+   BOOST_REQUIRE(account.refund_request.is_null());
+   account = cached.get_account({N(inita)});
+   BOOST_REQUIRE_EQUAL("1.0000 SYS", account.total_resources["net_weight"].as_string());
+
+   delegatebw( eosio::chain::asset::from_string("3.0000 SYS"), eosio::chain::asset::from_string("0.0000 SYS") );
+   account = cached.get_account({N(inita)});
+   BOOST_REQUIRE_EQUAL("4.0000 SYS", account.total_resources["net_weight"].as_string());
+   BOOST_REQUIRE_EQUAL("4.0000 SYS", account.self_delegated_bandwidth["net_weight"].as_string());
+   BOOST_REQUIRE_EQUAL(fc::json::to_string(plugin.get_account({N(inita)}).total_resources),
+                       fc::json::to_string(account.total_resources));
+
+   // and in bulk
+   auto accounts = cached.get_accounts({{N(inita), N(initb)}});
+   BOOST_REQUIRE_EQUAL(2u, accounts.size());
+   BOOST_REQUIRE_EQUAL("4.0000 SYS", accounts[0].total_resources["net_weight"].as_string());
+   BOOST_REQUIRE_EQUAL(N(initb), accounts[1].account_name);
+   BOOST_REQUIRE(accounts[1].total_resources.is_null());
+
+} FC_LOG_AND_RETHROW() /// get_account_cached_test
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,228 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/history_plugin/filter_matcher.hpp>
+#include <eosio/chain/block_log.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/time.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+
+using namespace eosio;
+using namespace eosio::chain;
+
+namespace {
+
+   /// the set lookups history_plugin did before filter_matcher, the reference for its results
+   struct set_filter {
+      bool bypass_filter = false;
+      std::set<filter_entry> filter_on;
+      std::set<filter_entry> filter_out;
+
+      bool filter( const action_trace& act ) const {
+         bool pass_on = bypass_filter;
+         if( filter_on.count( { act.receiver, 0, 0 } ) ) pass_on = true;
+         if( filter_on.count( { act.receiver, act.act.name, 0 } ) ) pass_on = true;
+         for( const auto& a : act.act.authorization ) {
+            if( filter_on.count( { act.receiver, 0, a.actor } ) ) pass_on = true;
+            if( filter_on.count( { act.receiver, act.act.name, a.actor } ) ) pass_on = true;
+         }
+         if( !pass_on ) return false;
+
+         if( filter_out.count( { act.receiver, 0, 0 } ) ) return false;
+         if( filter_out.count( { act.receiver, act.act.name, 0 } ) ) return false;
+         for( const auto& a : act.act.authorization ) {
+            if( filter_out.count( { act.receiver, 0, a.actor } ) ) return false;
+            if( filter_out.count( { act.receiver, act.act.name, a.actor } ) ) return false;
+         }
+         return true;
+      }
+
+      std::set<account_name> account_set( const action_trace& act ) const {
+         std::set<account_name> result;
+         result.insert( act.receiver );
+         for( const auto& a : act.act.authorization ) {
+            if( bypass_filter ||
+                filter_on.count( { act.receiver, 0, 0 } ) || filter_on.count( { act.receiver, 0, a.actor } ) ||
+                filter_on.count( { act.receiver, act.act.name, 0 } ) || filter_on.count( { act.receiver, act.act.name, a.actor } ) ) {
+               if( !filter_out.count( { act.receiver, 0, 0 } ) && !filter_out.count( { act.receiver, 0, a.actor } ) &&
+                   !filter_out.count( { act.receiver, act.act.name, 0 } ) && !filter_out.count( { act.receiver, act.act.name, a.actor } ) ) {
+                  result.insert( a.actor );
+               }
+            }
+         }
+         return result;
+      }
+   };
+
+   name account( uint64_t n ) {
+      return name( N(user) + (n << 4) );
+   }
+
+   action_trace make_trace( name receiver, name code, name act_name, const std::vector<name>& actors ) {
+      action_trace t;
+      t.receiver = receiver;
+      t.act.account = code;
+      t.act.name = act_name;
+      for( auto a : actors ) t.act.authorization.push_back( { a, config::active_name } );
+      return t;
+   }
+
+   /**
+    * Traces of the blocks EOSIO_BENCH_FIRST_BLOCK to EOSIO_BENCH_LAST_BLOCK of the block log in
+    * EOSIO_BENCH_BLOCKS_DIR. Blocks do not record notifications, so there is one trace per action,
+    * received by its contract.
+    */
+   std::vector<action_trace> recorded_traces() {
+      std::vector<action_trace> traces;
+      const char* dir = getenv( "EOSIO_BENCH_BLOCKS_DIR" );
+      if( !dir ) return traces;
+      const char* first = getenv( "EOSIO_BENCH_FIRST_BLOCK" );
+      const char* last = getenv( "EOSIO_BENCH_LAST_BLOCK" );
+      block_log log( fc::path( dir ) );
+      const uint32_t first_block = first ? std::stoul( first ) : log.first_block_num();
+      const uint32_t last_block = last ? std::stoul( last ) : first_block + 999;
+      for( uint32_t n = first_block; n <= last_block; ++n ) {
+         auto b = log.read_block_by_num( n );
+         if( !b ) break;
+         for( const auto& r : b->transactions ) {
+            if( !r.trx.contains<packed_transaction>() ) continue;
+            for( const auto& a : r.trx.get<packed_transaction>().get_transaction().actions ) {
+               action_trace t;
+               t.receiver = a.account;
+               t.act = a;
+               traces.push_back( std::move( t ) );
+            }
+         }
+      }
+      return traces;
+   }
+
+   /// a busy block range of token transfers, each with its notifications, and some multisig actions
+   std::vector<action_trace> synthetic_traces() {
+      std::vector<action_trace> traces;
+      uint64_t seed = 1;
+      auto next = [&]() { seed = seed * 6364136223846793005ull + 1442695040888963407ull; return seed >> 33; };
+      for( size_t i = 0; i < 200000; ++i ) {
+         const auto from = account( next() % 5000 );
+         const auto to = account( next() % 5000 );
+         if( i % 10 == 0 ) {
+            const auto contract = account( 5000 + next() % 100 );
+            traces.push_back( make_trace( contract, contract, N(exec), { from, to, account( next() % 5000 ) } ) );
+            continue;
+         }
+         traces.push_back( make_trace( N(eosio.token), N(eosio.token), N(transfer), { from } ) );
+         traces.push_back( make_trace( from, N(eosio.token), N(transfer), { from } ) );
+         traces.push_back( make_trace( to, N(eosio.token), N(transfer), { from } ) );
+      }
+      return traces;
+   }
+
+   /// filter lists of the sizes seen on history nodes of exchanges and explorers
+   set_filter make_filters( bool bypass ) {
+      set_filter f;
+      f.bypass_filter = bypass;
+      for( uint64_t i = 0; i < 2000; ++i ) {
+         const auto a = account( i * 3 );
+         switch( i % 4 ) {
+            case 0: f.filter_on.insert( { a, 0, 0 } ); break;
+            case 1: f.filter_on.insert( { N(eosio.token), N(transfer), a } ); break;
+            case 2: f.filter_on.insert( { a, N(transfer), 0 } ); break;
+            case 3: f.filter_on.insert( { account( 5000 + i % 100 ), 0, a } ); break;
+         }
+      }
+      for( uint64_t i = 0; i < 200; ++i ) {
+         f.filter_out.insert( { account( i * 7 ), 0, 0 } );
+         f.filter_out.insert( { N(eosio.token), N(transfer), account( i * 11 ) } );
+      }
+      return f;
+   }
+
+   void compare( const std::vector<action_trace>& traces, bool bypass ) {
+      const auto reference = make_filters( bypass );
+      const filter_matcher matcher( reference.bypass_filter, reference.filter_on, reference.filter_out );
+
+      // results must match the set lookups
+      size_t tracked = 0;
+      std::vector<account_name> accounts;
+      for( const auto& t : traces ) {
+         const bool expected = reference.filter( t );
+         BOOST_REQUIRE_EQUAL( matcher.match( t, accounts ), expected );
+         if( !expected ) continue;
+         ++tracked;
+         const auto expected_accounts = reference.account_set( t );
+         BOOST_REQUIRE_EQUAL( accounts.size(), expected_accounts.size() );
+         BOOST_REQUIRE( accounts.front() == t.receiver );
+         for( auto a : accounts ) BOOST_REQUIRE( expected_accounts.count( a ) );
+      }
+
+      const size_t rounds = 5;
+      size_t sink = 0;
+      auto start = fc::time_point::now();
+      for( size_t r = 0; r < rounds; ++r ) {
+         for( const auto& t : traces ) {
+            if( reference.filter( t ) ) sink += reference.account_set( t ).size();
+         }
+      }
+      const auto set_time = fc::time_point::now() - start;
+
+      start = fc::time_point::now();
+      for( size_t r = 0; r < rounds; ++r ) {
+         for( const auto& t : traces ) {
+            if( matcher.match( t, accounts ) ) sink -= accounts.size();
+         }
+      }
+      const auto matcher_time = fc::time_point::now() - start;
+      BOOST_CHECK_EQUAL( sink, 0u );
+
+      const double n = double( traces.size() * rounds );
+      BOOST_TEST_MESSAGE( (bypass ? "filter-on *" : "filter lists") << ": " << traces.size() << " traces, " << tracked << " tracked" );
+      BOOST_TEST_MESSAGE( "  std::set lookups: " << set_time.count() * 1000.0 / n << " ns/action" );
+      BOOST_TEST_MESSAGE( "  filter_matcher:   " << matcher_time.count() * 1000.0 / n << " ns/action" );
+   }
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(history_filter_benchmark)
+
+/// filter_matcher against the std::set lookups it replaces, over a recorded block range if one is
+/// given and over synthetic traces otherwise
+BOOST_AUTO_TEST_CASE(filter_replay)
+{ try {
+   auto traces = recorded_traces();
+   if( traces.empty() ) traces = synthetic_traces();
+   compare( traces, false );
+   compare( traces, true );
+} FC_LOG_AND_RETHROW() }
+
+/// wildcards: a blank action or actor matches any
+BOOST_AUTO_TEST_CASE(wildcards)
+{ try {
+   set_filter f;
+   f.filter_on.insert( { N(alice), 0, 0 } );
+   f.filter_on.insert( { N(bob), N(transfer), 0 } );
+   f.filter_on.insert( { N(carol), 0, N(dave) } );
+   f.filter_out.insert( { N(alice), N(spam), 0 } );
+   f.filter_out.insert( { N(carol), 0, N(eve) } );
+   const filter_matcher m( false, f.filter_on, f.filter_out );
+
+   std::vector<account_name> accounts;
+   BOOST_CHECK( m.match( make_trace( N(alice), N(alice), N(anything), { N(dave) } ), accounts ) );
+   BOOST_CHECK_EQUAL( accounts.size(), 2u );
+   BOOST_CHECK( !m.match( make_trace( N(alice), N(alice), N(spam), { N(dave) } ), accounts ) );
+   BOOST_CHECK( m.match( make_trace( N(bob), N(bob), N(transfer), {} ), accounts ) );
+   BOOST_CHECK( !m.match( make_trace( N(bob), N(bob), N(issue), {} ), accounts ) );
+
+   // only the authorizer selected by the rule is recorded
+   BOOST_CHECK( m.match( make_trace( N(carol), N(carol), N(x), { N(dave), N(frank) } ), accounts ) );
+   BOOST_REQUIRE_EQUAL( accounts.size(), 2u );
+   BOOST_CHECK( accounts[1] == N(dave) );
+   BOOST_CHECK( !m.match( make_trace( N(carol), N(carol), N(x), { N(dave), N(eve) } ), accounts ) );
+   BOOST_CHECK( !m.match( make_trace( N(zed), N(zed), N(x), { N(dave) } ), accounts ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
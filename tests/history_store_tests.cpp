@@ -0,0 +1,188 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/history_plugin/action_history_store.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace eosio;
+using namespace eosio::chain;
+
+namespace {
+
+   struct test_entry {
+      uint64_t key = 0;
+      uint64_t value = 0;
+   };
+   struct test_entry_less {
+      bool operator()( const test_entry& a, const test_entry& b ) const { return a.key < b.key; }
+   };
+   using test_index = sorted_run_index<test_entry, test_entry_less>;
+
+   transaction_id_type make_id( uint32_t n ) {
+      return fc::sha256::hash( std::to_string( n ) );
+   }
+
+   /// block_num with one action per transaction, each recorded for both of accounts
+   action_history_store::block make_block( uint32_t block_num, uint64_t& global_sequence, uint32_t transactions,
+                                           const std::vector<account_name>& accounts ) {
+      action_history_store::block b;
+      b.block_num = block_num;
+      b.block_time = block_timestamp_type( block_num );
+      for( uint32_t i = 0; i < transactions; ++i ) {
+         action_history_store::action a;
+         a.global_sequence = global_sequence++;
+         a.trx_id = make_id( block_num * 1000 + i );
+         a.accounts = accounts;
+         a.packed_action_trace = fc::raw::pack( a.global_sequence );
+         b.actions.push_back( std::move( a ) );
+      }
+      return b;
+   }
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(history_store_tests)
+
+/// Lookups merge the memtable with runs, and entries survive a reopen
+BOOST_AUTO_TEST_CASE(sorted_run_index_lookup)
+{ try {
+   fc::temp_directory tempdir;
+   std::map<uint64_t, uint64_t> expected;
+   {
+      test_index idx( tempdir.path(), "test", 16, 4 );
+      for( uint64_t i = 0; i < 1000; ++i ) {
+         const uint64_t key = (i * 7919) % 10007;
+         expected[key] = i;
+         idx.insert( { key, i } );
+         idx.set_covered_position( i + 1 );
+         idx.flush_if_full();
+      }
+      BOOST_CHECK_EQUAL( idx.size(), expected.size() );
+      BOOST_CHECK_LT( idx.run_count(), 1000u / 16 ); // runs were merged
+      idx.flush();
+   }
+
+   test_index idx( tempdir.path(), "test", 16, 4 );
+   BOOST_CHECK_EQUAL( idx.size(), expected.size() );
+   BOOST_CHECK_EQUAL( idx.covered_position(), 1000u );
+   for( uint64_t key = 0; key < 10007; key += 13 ) {
+      auto below = idx.last_at_or_below( { key, 0 } );
+      auto itr = expected.upper_bound( key );
+      if( itr == expected.begin() ) {
+         BOOST_CHECK( !below );
+      } else {
+         --itr;
+         BOOST_REQUIRE( below );
+         BOOST_CHECK_EQUAL( below->key, itr->first );
+         BOOST_CHECK_EQUAL( below->value, itr->second );
+      }
+
+      auto range = idx.range( { key, 0 }, { key + 100, 0 }, 3 );
+      auto e = expected.lower_bound( key );
+      for( const auto& r : range ) {
+         BOOST_REQUIRE( e != expected.end() );
+         BOOST_CHECK_EQUAL( r.key, e->first );
+         ++e;
+      }
+   }
+} FC_LOG_AND_RETHROW() }
+
+/// Account sequences continue across reversible, unwritten and on disk actions, and forks replace blocks
+BOOST_AUTO_TEST_CASE(account_actions)
+{ try {
+   fc::temp_directory tempdir;
+   uint64_t global_sequence = 1;
+   {
+      action_history_store store( tempdir.path() );
+      for( uint32_t n = 2; n <= 11; ++n ) {
+         store.add_block( make_block( n, global_sequence, 3, { N(alice), N(bob) } ) );
+      }
+      store.commit( 6 );
+
+      // a fork replaces block 11
+      uint64_t fork_sequence = global_sequence - 3;
+      store.add_block( make_block( 11, fork_sequence, 1, { N(alice) } ) );
+
+      BOOST_CHECK_EQUAL( *store.last_account_sequence( N(alice) ), 27 );
+      BOOST_CHECK_EQUAL( *store.last_account_sequence( N(bob) ), 26 );
+      BOOST_CHECK( !store.last_account_sequence( N(carol) ) );
+
+      auto actions = store.get_account_actions( N(alice), 10, 20, 100 );
+      BOOST_REQUIRE_EQUAL( actions.size(), 11u );
+      for( size_t i = 0; i < actions.size(); ++i ) {
+         BOOST_CHECK_EQUAL( actions[i].account_sequence, int32_t(10 + i) );
+         BOOST_CHECK_EQUAL( actions[i].global_sequence, 11 + i );
+         BOOST_CHECK_EQUAL( actions[i].block_num, 2 + (10 + i) / 3 );
+      }
+      BOOST_CHECK_EQUAL( store.get_account_actions( N(alice), 0, 100, 5 ).size(), 5u );
+      store.close();
+   }
+
+   // committed and reversible actions are still there after a reopen
+   action_history_store store( tempdir.path() );
+   BOOST_CHECK_EQUAL( *store.last_account_sequence( N(alice) ), 27 );
+   store.commit( 11 );
+   auto actions = store.get_account_actions( N(alice), 0, 100, 100 );
+   BOOST_REQUIRE_EQUAL( actions.size(), 28u );
+   BOOST_CHECK_EQUAL( actions.back().block_num, 11u );
+
+   // blocks up to the last committed one are not recorded again on replay
+   uint64_t replay_sequence = 1;
+   store.add_block( make_block( 2, replay_sequence, 3, { N(alice) } ) );
+   BOOST_CHECK_EQUAL( *store.last_account_sequence( N(alice) ), 27 );
+} FC_LOG_AND_RETHROW() }
+
+/// Account sequences continue after the ones of written accounts are dropped from memory
+BOOST_AUTO_TEST_CASE(many_accounts)
+{ try {
+   fc::temp_directory tempdir;
+   uint64_t global_sequence = 1;
+   std::vector<account_name> accounts;
+   for( uint64_t i = 1; i <= 70000; ++i ) accounts.push_back( account_name( i << 4 ) );
+
+   action_history_store store( tempdir.path() );
+   store.add_block( make_block( 2, global_sequence, 1, accounts ) );
+   store.add_block( make_block( 3, global_sequence, 1, accounts ) );
+   store.commit( 3 );
+   for( uint32_t n = 4; n <= 6; ++n ) {
+      store.add_block( make_block( n, global_sequence, 1, { accounts.front(), accounts.back() } ) );
+      store.commit( n );
+   }
+
+   BOOST_CHECK_EQUAL( *store.last_account_sequence( accounts.front() ), 4 );
+   BOOST_CHECK_EQUAL( *store.last_account_sequence( accounts[1] ), 1 );
+   BOOST_CHECK_EQUAL( *store.last_account_sequence( accounts.back() ), 4 );
+   auto actions = store.get_account_actions( accounts.back(), 0, 100, 100 );
+   BOOST_REQUIRE_EQUAL( actions.size(), 5u );
+   BOOST_CHECK_EQUAL( actions.back().block_num, 6u );
+} FC_LOG_AND_RETHROW() }
+
+/// Transactions are found by id prefix in every layer
+BOOST_AUTO_TEST_CASE(transaction_actions)
+{ try {
+   fc::temp_directory tempdir;
+   uint64_t global_sequence = 1;
+   action_history_store store( tempdir.path() );
+   for( uint32_t n = 2; n <= 5; ++n ) {
+      store.add_block( make_block( n, global_sequence, 2, { N(alice) } ) );
+   }
+   store.commit( 3 );
+
+   for( uint32_t n : { 2000u, 3001u, 5000u } ) {
+      const auto id = make_id( n );
+      auto found = store.first_transaction_at_or_above( id );
+      BOOST_REQUIRE( found );
+      BOOST_CHECK( *found == id );
+      auto actions = store.get_transaction_actions( id );
+      BOOST_REQUIRE_EQUAL( actions.size(), 1u );
+      BOOST_CHECK_EQUAL( actions[0].block_num, n / 1000 );
+   }
+   BOOST_CHECK( store.get_transaction_actions( make_id( 6000 ) ).empty() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
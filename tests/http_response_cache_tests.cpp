@@ -0,0 +1,100 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/http_plugin/response_cache.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using eosio::response_cache;
+
+BOOST_AUTO_TEST_SUITE(http_response_cache_tests)
+
+BOOST_AUTO_TEST_CASE(get_put)
+{
+   response_cache c( 1024*1024 );
+   BOOST_CHECK( !c.get( "a" ) );
+   c.put( "a", 200, "{\"block_num\":1}", c.epoch() );
+   auto r = c.get( "a" );
+   BOOST_REQUIRE( r );
+   BOOST_CHECK_EQUAL( r->code, 200 );
+   BOOST_CHECK_EQUAL( r->body, "{\"block_num\":1}" );
+   BOOST_CHECK_EQUAL( c.hits(), 1u );
+   BOOST_CHECK_EQUAL( c.misses(), 1u );
+
+   // replacing an entry does not charge for it twice
+   c.put( "a", 200, "{\"block_num\":2}", c.epoch() );
+   BOOST_CHECK_EQUAL( c.size(), 1u );
+   BOOST_CHECK_EQUAL( c.memory_size(), 1 + 15 + response_cache::entry_overhead );
+   BOOST_CHECK_EQUAL( c.get( "a" )->body, "{\"block_num\":2}" );
+}
+
+/// The least recently used entries are evicted to stay within the memory bound
+BOOST_AUTO_TEST_CASE(lru_eviction)
+{
+   const std::string body( 1000, 'x' );
+   const size_t entry_size = 2 + body.size() + response_cache::entry_overhead;
+   response_cache c( 3 * entry_size );
+
+   c.put( "k1", 200, body, c.epoch() );
+   c.put( "k2", 200, body, c.epoch() );
+   c.put( "k3", 200, body, c.epoch() );
+   BOOST_CHECK( c.get( "k1" ) ); // k2 is now the least recently used
+   c.put( "k4", 200, body, c.epoch() );
+
+   BOOST_CHECK_EQUAL( c.size(), 3u );
+   BOOST_CHECK_LE( c.memory_size(), c.max_memory_size() );
+   BOOST_CHECK( !c.get( "k2" ) );
+   BOOST_CHECK( c.get( "k1" ) );
+   BOOST_CHECK( c.get( "k3" ) );
+   BOOST_CHECK( c.get( "k4" ) );
+
+   // too large to ever fit
+   c.put( "k5", 200, std::string( 4 * entry_size, 'y' ), c.epoch() );
+   BOOST_CHECK( !c.get( "k5" ) );
+   BOOST_CHECK_EQUAL( c.size(), 3u );
+}
+
+BOOST_AUTO_TEST_CASE(erase_prefix)
+{
+   response_cache c( 1024*1024 );
+   c.put( "/v1/chain/get_block\n1", 200, "b1", c.epoch() );
+   c.put( "/v1/chain/get_block\n2", 200, "b2", c.epoch() );
+   c.put( "/v1/chain/get_block_header_state\n1", 200, "h1", c.epoch() );
+   c.put( "/v1/chain/get_abi\n1", 200, "a1", c.epoch() );
+
+   c.erase_prefix( "/v1/chain/get_block\n" );
+   BOOST_CHECK_EQUAL( c.size(), 2u );
+   BOOST_CHECK( !c.get( "/v1/chain/get_block\n1" ) );
+   BOOST_CHECK( c.get( "/v1/chain/get_block_header_state\n1" ) );
+   BOOST_CHECK( c.get( "/v1/chain/get_abi\n1" ) );
+
+   c.clear();
+   BOOST_CHECK_EQUAL( c.size(), 0u );
+   BOOST_CHECK_EQUAL( c.memory_size(), 0u );
+}
+
+/// A response built before an invalidation is not stored after it
+BOOST_AUTO_TEST_CASE(put_after_erase)
+{
+   response_cache c( 1024*1024 );
+   const uint64_t built = c.epoch();
+   BOOST_CHECK( c.put( "/v1/chain/get_block\n1", 200, "b1", built ) );
+
+   // a setabi drops the cached blocks while the response for block 2 is being serialized
+   const uint64_t building = c.epoch();
+   c.erase_prefix( "/v1/chain/get_block\n" );
+   BOOST_CHECK( !c.put( "/v1/chain/get_block\n2", 200, "b2", building ) );
+   BOOST_CHECK( !c.get( "/v1/chain/get_block\n2" ) );
+   BOOST_CHECK_EQUAL( c.size(), 0u );
+
+   // responses built after it are cached again
+   BOOST_CHECK( c.put( "/v1/chain/get_block\n2", 200, "b2", c.epoch() ) );
+   BOOST_CHECK( c.get( "/v1/chain/get_block\n2" ) );
+
+   const uint64_t before_clear = c.epoch();
+   c.clear();
+   BOOST_CHECK( !c.put( "/v1/chain/get_block\n3", 200, "b3", before_clear ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,184 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/net_plugin/message_decoder.hpp>
+
+#include <fc/bitutil.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <set>
+
+using namespace eosio;
+
+namespace {
+
+   constexpr uint32_t max_message_length = 1024*1024;
+
+   struct test_known_ids {
+      uint32_t                                     lib = 0;
+      std::set<block_id_type, sha256_less>         blocks;
+      std::set<transaction_id_type, sha256_less>   trxs;
+
+      bool has_block( const block_id_type& id ) const { return blocks.count( id ) > 0; }
+      bool is_irreversible( uint32_t block_num ) const { return block_num <= lib; }
+      bool has_transaction( const transaction_id_type& id ) const { return trxs.count( id ) > 0; }
+   };
+
+   std::vector<char> frame( const net_message& msg ) {
+      const auto payload = fc::raw::pack( msg );
+      const uint32_t length = payload.size();
+      std::vector<char> framed( message_header_size );
+      memcpy( framed.data(), &length, message_header_size );
+      framed.insert( framed.end(), payload.begin(), payload.end() );
+      return framed;
+   }
+
+   signed_block make_block( uint32_t block_num, char salt = 0 ) {
+      signed_block b;
+      b.previous._hash[0] = fc::endian_reverse_u32( block_num - 1 );
+      b.previous._hash[1] = salt;
+      return b;
+   }
+
+   packed_transaction make_transaction( const fc::microseconds& expires_in, uint16_t n ) {
+      signed_transaction trx;
+      trx.expiration = fc::time_point::now() + expires_in;
+      trx.ref_block_num = n;
+      return packed_transaction( trx );
+   }
+
+   /// what a read of data does: copy it into the buffer, then decode
+   std::string receive( receive_buffer& rb, const std::vector<char>& data, const test_known_ids& known_ids,
+                        fc::optional<std::size_t>& outstanding_read_bytes, std::vector<decoded_message>& msgs ) {
+      size_t n = 0;
+      for( auto& b : rb.prepare( std::max<size_t>( data.size(), 1 ) ) ) {
+         const size_t w = std::min( b.size(), data.size() - n );
+         memcpy( b.data(), data.data() + n, w );
+         n += w;
+         if( n == data.size() ) break;
+      }
+      return decode_messages( rb, n, max_message_length, known_ids, outstanding_read_bytes, msgs );
+   }
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(message_decoder_tests)
+
+/// Messages split across reads are decoded once complete, with the missing byte count reported until then
+BOOST_AUTO_TEST_CASE(framing)
+{ try {
+   auto pool = std::make_shared<buffer_pool>( 64 );
+   receive_buffer rb( pool );
+   test_known_ids known_ids;
+   fc::optional<std::size_t> outstanding;
+   std::vector<decoded_message> msgs;
+
+   time_message tm;
+   tm.org = 1; tm.rec = 2; tm.xmt = 3; tm.dst = 4;
+   auto first  = frame( net_message( tm ) );
+   auto second = frame( net_message( go_away_message( benign_other ) ) );
+   std::vector<char> stream = first;
+   stream.insert( stream.end(), second.begin(), second.end() );
+
+   auto slice = [&stream]( size_t begin, size_t end ) {
+      return std::vector<char>( stream.begin() + begin, stream.begin() + end );
+   };
+
+   // part of the first length prefix
+   BOOST_REQUIRE_EQUAL( receive( rb, slice( 0, 3 ), known_ids, outstanding, msgs ), "" );
+   BOOST_CHECK( msgs.empty() );
+   BOOST_REQUIRE( outstanding );
+   BOOST_CHECK_EQUAL( *outstanding, 1u );
+
+   // the rest of the first message and part of the second
+   const size_t split = first.size() + 5;
+   BOOST_REQUIRE_EQUAL( receive( rb, slice( 3, split ), known_ids, outstanding, msgs ), "" );
+   BOOST_REQUIRE_EQUAL( msgs.size(), 1u );
+   BOOST_REQUIRE( msgs[0].msg.contains<time_message>() );
+   BOOST_CHECK_EQUAL( msgs[0].msg.get<time_message>().xmt, 3 );
+   BOOST_REQUIRE( outstanding );
+   BOOST_CHECK_EQUAL( *outstanding, stream.size() - split );
+
+   BOOST_REQUIRE_EQUAL( receive( rb, slice( split, stream.size() ), known_ids, outstanding, msgs ), "" );
+   BOOST_REQUIRE_EQUAL( msgs.size(), 2u );
+   BOOST_REQUIRE( msgs[1].msg.contains<go_away_message>() );
+   BOOST_CHECK( msgs[1].msg.get<go_away_message>().reason == benign_other );
+   BOOST_CHECK( !outstanding );
+   BOOST_CHECK( rb.empty() );
+
+   // a zero length prefix closes the connection
+   std::vector<char> empty_message( message_header_size, 0 );
+   BOOST_CHECK_NE( receive( rb, empty_message, known_ids, outstanding, msgs ), "" );
+} FC_LOG_AND_RETHROW() }
+
+/// Blocks known by id or at or below LIB are passed on as their id only, other blocks are unpacked
+BOOST_AUTO_TEST_CASE(known_and_irreversible_blocks)
+{ try {
+   auto pool = std::make_shared<buffer_pool>( 1024 );
+   receive_buffer rb( pool );
+   test_known_ids known_ids;
+   known_ids.lib = 10;
+   fc::optional<std::size_t> outstanding;
+   std::vector<decoded_message> msgs;
+
+   const auto irreversible = make_block( 10 );
+   const auto known        = make_block( 11 );
+   const auto fork         = make_block( 11, 1 );
+   const auto reversible   = make_block( 12 );
+   known_ids.blocks.insert( known.id() );
+
+   std::vector<char> stream;
+   for( const auto& b : { irreversible, known, fork, reversible } ) {
+      auto f = frame( net_message( b ) );
+      stream.insert( stream.end(), f.begin(), f.end() );
+   }
+   BOOST_REQUIRE_EQUAL( receive( rb, stream, known_ids, outstanding, msgs ), "" );
+   BOOST_REQUIRE_EQUAL( msgs.size(), 4u );
+
+   BOOST_CHECK( msgs[0].known_block );
+   BOOST_CHECK( !msgs[0].block );
+   BOOST_CHECK_EQUAL( msgs[0].block_num, 10u );
+   BOOST_CHECK( msgs[0].block_id == irreversible.id() );
+
+   BOOST_CHECK( msgs[1].known_block );
+   BOOST_CHECK( msgs[1].block_id == known.id() );
+
+   for( size_t i : { 2, 3 } ) {
+      BOOST_CHECK( !msgs[i].known_block );
+      BOOST_REQUIRE( msgs[i].block );
+      BOOST_CHECK( msgs[i].block->id() == msgs[i].block_id );
+   }
+   BOOST_CHECK( msgs[2].block_id == fork.id() );
+   BOOST_CHECK_EQUAL( msgs[3].block_num, 12u );
+} FC_LOG_AND_RETHROW() }
+
+/// Expired and known transactions are dropped, others arrive with their metadata
+BOOST_AUTO_TEST_CASE(transactions)
+{ try {
+   auto pool = std::make_shared<buffer_pool>( 1024 );
+   receive_buffer rb( pool );
+   test_known_ids known_ids;
+   fc::optional<std::size_t> outstanding;
+   std::vector<decoded_message> msgs;
+
+   const auto expired = make_transaction( fc::seconds( -1 ), 1 );
+   const auto known   = make_transaction( fc::minutes( 1 ), 2 );
+   const auto fresh   = make_transaction( fc::minutes( 1 ), 3 );
+   known_ids.trxs.insert( known.id() );
+
+   std::vector<char> stream;
+   for( const auto& t : { expired, known, fresh } ) {
+      auto f = frame( net_message( t ) );
+      stream.insert( stream.end(), f.begin(), f.end() );
+   }
+   BOOST_REQUIRE_EQUAL( receive( rb, stream, known_ids, outstanding, msgs ), "" );
+   BOOST_REQUIRE_EQUAL( msgs.size(), 1u );
+   BOOST_REQUIRE( msgs[0].trx );
+   BOOST_CHECK( msgs[0].trx->id == fresh.id() );
+   BOOST_CHECK( rb.empty() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
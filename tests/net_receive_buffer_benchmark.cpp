@@ -0,0 +1,112 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/net_plugin/receive_buffer.hpp>
+
+#include <fc/network/message_buffer.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace eosio;
+
+namespace {
+
+   constexpr size_t num_connections = 500;
+   constexpr size_t handshake_size  = 300;   // roughly a packed handshake_message
+   constexpr size_t chunk_size      = 32*1024;
+
+   /// what each idle connection has received, a handshake and nothing since
+   std::vector<char> make_handshake() {
+      std::vector<char> v( handshake_size );
+      for( size_t i = 0; i < v.size(); ++i ) v[i] = char(i);
+      return v;
+   }
+
+   void receive( receive_buffer& rb, const std::vector<char>& data ) {
+      size_t n = 0;
+      for( auto& b : rb.prepare( data.size() ) ) {
+         const size_t w = std::min( b.size(), data.size() - n );
+         memcpy( b.data(), data.data() + n, w );
+         n += w;
+         if( n == data.size() ) break;
+      }
+      rb.commit( n );
+   }
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(net_receive_buffer_benchmark)
+
+/// Receive buffer memory held by idle connections, with a 1MB fc::message_buffer per connection
+/// and with receive_buffers sharing a buffer_pool
+BOOST_AUTO_TEST_CASE(idle_connection_memory)
+{ try {
+   const auto handshake = make_handshake();
+
+   // before: every connection owns at least one 1MB chunk for its lifetime
+   size_t before_bytes = 0;
+   {
+      std::vector<std::unique_ptr<fc::message_buffer<1024*1024>>> buffers;
+      for( size_t i = 0; i < num_connections; ++i ) {
+         buffers.emplace_back( new fc::message_buffer<1024*1024>() );
+         auto& mb = *buffers.back();
+         auto bufs = mb.get_buffer_sequence_for_boost_async_read();
+         memcpy( bufs.front().data(), handshake.data(), handshake.size() );
+         mb.advance_write_ptr( handshake.size() );
+         mb.advance_read_ptr( handshake.size() );
+      }
+      for( const auto& mb : buffers ) before_bytes += mb->total_bytes();
+   }
+
+   // after: chunks come from the pool and go back once the handshake is consumed
+   auto pool = std::make_shared<buffer_pool>( chunk_size );
+   std::vector<std::unique_ptr<receive_buffer>> buffers;
+   for( size_t i = 0; i < num_connections; ++i ) {
+      buffers.emplace_back( new receive_buffer( pool ) );
+      receive( *buffers.back(), handshake );
+   }
+   const size_t burst_bytes = pool->allocated_bytes();
+   BOOST_REQUIRE_EQUAL( pool->in_use(), num_connections );
+
+   for( auto& rb : buffers ) rb->consume( handshake.size() );
+   size_t held_bytes = 0;
+   for( const auto& rb : buffers ) held_bytes += rb->capacity();
+   const size_t after_bytes = pool->allocated_bytes();
+
+   BOOST_REQUIRE_EQUAL( held_bytes, 0u );
+   BOOST_REQUIRE_EQUAL( pool->in_use(), 0u );
+   BOOST_CHECK_LT( after_bytes, before_bytes / 100 );
+
+   BOOST_TEST_MESSAGE( "idle connections: " << num_connections );
+   BOOST_TEST_MESSAGE( "message_buffer<1MB>:         " << before_bytes / 1024 << " KB" );
+   BOOST_TEST_MESSAGE( "receive_buffer, all active:  " << burst_bytes / 1024 << " KB" );
+   BOOST_TEST_MESSAGE( "receive_buffer, idle:        " << after_bytes / 1024 << " KB" );
+} FC_LOG_AND_RETHROW() }
+
+/// A message larger than a chunk that arrives over several reads ends up contiguous
+BOOST_AUTO_TEST_CASE(large_message_contiguous)
+{ try {
+   auto pool = std::make_shared<buffer_pool>( 1024 );
+   receive_buffer rb( pool );
+
+   std::vector<char> msg( 10000 );
+   for( size_t i = 0; i < msg.size(); ++i ) msg[i] = char(i * 7);
+
+   std::vector<char> first( msg.begin(), msg.begin() + 100 );
+   receive( rb, first );
+   rb.reserve_message( msg.size() );
+   std::vector<char> rest( msg.begin() + 100, msg.end() );
+   receive( rb, rest );
+
+   BOOST_REQUIRE_EQUAL( rb.size(), msg.size() );
+   std::vector<char> scratch;
+   const char* data = rb.contiguous( msg.size(), scratch );
+   BOOST_CHECK( scratch.empty() ); // no copy
+   BOOST_CHECK( memcmp( data, msg.data(), msg.size() ) == 0 );
+   rb.consume( msg.size() );
+   BOOST_CHECK_EQUAL( rb.capacity(), 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
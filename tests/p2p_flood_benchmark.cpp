@@ -0,0 +1,222 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/net_plugin/message_decoder.hpp>
+#include <eosio/chain/thread_utils.hpp>
+
+#include <fc/bitutil.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+
+using namespace eosio;
+using namespace eosio::chain;
+
+namespace {
+
+   constexpr size_t   num_peers          = 100;
+   constexpr size_t   trxs_per_peer      = 200;
+   constexpr uint32_t blocks_per_peer    = 4;
+   constexpr size_t   trxs_per_block     = 50;
+   constexpr uint32_t lib_num            = 2;          // the first blocks of every stream are irreversible
+   constexpr size_t   num_net_threads    = 4;
+   constexpr size_t   read_size          = 16*1024;    // bytes delivered by each simulated async_read
+   constexpr uint32_t max_message_length = 8*1024*1024;
+
+   /// what known_ids_cache answers from the net threads, a fixed LIB and nothing seen above it
+   struct flood_known_ids {
+      bool has_block( const block_id_type& ) const { return false; }
+      bool is_irreversible( uint32_t block_num ) const { return block_num <= lib_num; }
+      bool has_transaction( const transaction_id_type& ) const { return false; }
+   };
+
+   packed_transaction make_transaction( const private_key_type& key, const chain_id_type& chain_id, uint32_t n ) {
+      signed_transaction trx;
+      trx.expiration = fc::time_point::now() + fc::minutes( 10 );
+      trx.ref_block_num = n;
+      trx.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}}, N(eosio.token), N(transfer),
+                                fc::raw::pack( n ) );
+      trx.sign( key, chain_id );
+      return packed_transaction( trx );
+   }
+
+   void append_framed( std::vector<char>& stream, const net_message& msg ) {
+      const auto payload = fc::raw::pack( msg );
+      const uint32_t length = payload.size();
+      const char* prefix = reinterpret_cast<const char*>( &length );
+      stream.insert( stream.end(), prefix, prefix + message_header_size );
+      stream.insert( stream.end(), payload.begin(), payload.end() );
+   }
+
+   /// the bytes each peer sends, the same relayed blocks and transactions for every peer
+   std::vector<char> make_peer_stream( size_t& num_messages ) {
+      auto key = private_key_type::regenerate<fc::ecc::private_key_shim>( fc::sha256::hash( std::string( "flood" ) ) );
+      chain_id_type chain_id = fc::sha256::hash( std::string( "chain" ) );
+
+      std::vector<char> stream;
+      num_messages = 0;
+      for( uint32_t b = 1; b <= blocks_per_peer; ++b ) {
+         signed_block blk;
+         blk.previous._hash[0] = fc::endian_reverse_u32( b - 1 );
+         for( uint32_t t = 0; t < trxs_per_block; ++t ) {
+            blk.transactions.emplace_back( make_transaction( key, chain_id, b * trxs_per_block + t ) );
+         }
+         append_framed( stream, net_message( blk ) );
+         ++num_messages;
+      }
+      for( uint32_t t = 0; t < trxs_per_peer; ++t ) {
+         append_framed( stream, net_message( make_transaction( key, chain_id, 1000000 + t ) ) );
+         ++num_messages;
+      }
+      return stream;
+   }
+
+   /// stands in for net_plugin_impl::dispatch_message, the same work for both paths
+   size_t dispatch( const decoded_message& m ) {
+      if( m.known_block ) return m.block_num;
+      if( m.block ) return m.block_id._hash[0] + m.block->transactions.size();
+      if( m.trx ) return m.trx->id._hash[0];
+      return m.msg.which();
+   }
+
+   /**
+    * One connection: a receive_buffer fed by simulated reads of read_size bytes, each read completing on the
+    * connection's strand on the net threads, as start_async_read does.
+    */
+   struct flood_peer {
+      flood_peer( boost::asio::io_context& net_ioc, const std::shared_ptr<buffer_pool>& pool )
+      : strand( net_ioc ), buffer( pool ) {}
+
+      /// copies the next read into the buffer, returns the number of bytes copied
+      size_t read( const std::vector<char>& stream ) {
+         const size_t minimum_read = outstanding_read_bytes ? *outstanding_read_bytes : message_header_size;
+         const size_t n = std::min( std::max( minimum_read, read_size ), stream.size() - offset );
+         size_t copied = 0;
+         for( auto& b : buffer.prepare( n ) ) {
+            const size_t w = std::min( b.size(), n - copied );
+            memcpy( b.data(), stream.data() + offset + copied, w );
+            copied += w;
+            if( copied == n ) break;
+         }
+         offset += copied;
+         return copied;
+      }
+
+      boost::asio::io_context::strand strand;
+      receive_buffer                  buffer;
+      fc::optional<std::size_t>       outstanding_read_bytes;
+      size_t                          offset = 0; ///< into the peer's stream
+   };
+
+   struct flood_result {
+      fc::microseconds main_thread;
+      size_t           dispatched = 0;
+      size_t           checksum = 0;
+   };
+
+   /**
+    * Every peer reads its stream on the net threads. With decode_on_net_threads the reads are decoded on the
+    * peer's strand and only decoded messages are posted to the main thread, otherwise the raw bytes are posted
+    * and decoded there, as before decoding moved to the net threads.
+    */
+   flood_result run_flood( const std::vector<char>& stream, bool decode_on_net_threads ) {
+      flood_result result;
+      flood_known_ids known_ids;
+      boost::asio::io_context main_ioc;
+      auto work = boost::asio::make_work_guard( main_ioc );
+      named_thread_pool net_threads( "net", num_net_threads );
+      auto pool = std::make_shared<buffer_pool>( 32*1024 );
+      std::atomic<size_t> peers_done{0};
+      std::atomic<size_t> decode_errors{0}; ///< Boost.Test checks are not safe on the net threads
+
+      // a handler on the main thread, timed
+      auto on_main = [&]( auto f ) {
+         boost::asio::post( main_ioc, [&, f{std::move(f)}]() mutable {
+            auto start = fc::time_point::now();
+            f();
+            result.main_thread += fc::time_point::now() - start;
+         } );
+      };
+
+      std::vector<std::unique_ptr<flood_peer>> peers;
+      for( size_t p = 0; p < num_peers; ++p )
+         peers.emplace_back( new flood_peer( net_threads.get_executor(), pool ) );
+
+      std::function<void(flood_peer*)> next_read = [&]( flood_peer* peer ) {
+         boost::asio::post( peer->strand, [&, peer]() {
+            const size_t bytes = peer->read( stream );
+            const bool last = peer->offset == stream.size();
+            auto finish = [&, last]() {
+               if( last && ++peers_done == num_peers ) main_ioc.stop();
+            };
+            if( decode_on_net_threads ) {
+               auto msgs = std::make_shared<std::vector<decoded_message>>();
+               auto error = decode_messages( peer->buffer, bytes, max_message_length, known_ids,
+                                             peer->outstanding_read_bytes, *msgs );
+               if( !error.empty() ) ++decode_errors;
+               on_main( [&, msgs, finish]() {
+                  for( const auto& m : *msgs ) {
+                     result.checksum += dispatch( m );
+                     ++result.dispatched;
+                  }
+                  finish();
+               } );
+               if( !last ) next_read( peer );
+            } else {
+               // the next read starts once the main thread has consumed this one
+               on_main( [&, peer, bytes, last, finish]() {
+                  std::vector<decoded_message> msgs;
+                  auto error = decode_messages( peer->buffer, bytes, max_message_length, known_ids,
+                                                peer->outstanding_read_bytes, msgs );
+                  if( !error.empty() ) ++decode_errors;
+                  for( const auto& m : msgs ) {
+                     result.checksum += dispatch( m );
+                     ++result.dispatched;
+                  }
+                  finish();
+                  if( !last ) next_read( peer );
+               } );
+            }
+         } );
+      };
+      for( auto& peer : peers )
+         next_read( peer.get() );
+
+      main_ioc.run();
+      net_threads.stop();
+      BOOST_REQUIRE_EQUAL( decode_errors.load(), 0u );
+      return result;
+   }
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(p2p_flood_benchmark)
+
+/// Main-thread time per message while 100 peers flood blocks and transactions, decoding each read on the main
+/// thread compared with decoding it on the connection's strand with decode_messages and posting the results.
+BOOST_AUTO_TEST_CASE(main_thread_time_per_message)
+{ try {
+   size_t messages_per_peer = 0;
+   const auto stream = make_peer_stream( messages_per_peer );
+   const size_t total = num_peers * messages_per_peer;
+
+   const auto before = run_flood( stream, false );
+   const auto after  = run_flood( stream, true );
+
+   BOOST_REQUIRE_EQUAL( before.dispatched, total );
+   BOOST_REQUIRE_EQUAL( after.dispatched, total );
+   BOOST_REQUIRE_EQUAL( before.checksum, after.checksum );
+
+   BOOST_TEST_MESSAGE( "peers: " << num_peers << ", messages: " << total
+                       << ", irreversible blocks: " << num_peers * lib_num );
+   BOOST_TEST_MESSAGE( "main thread decode: " << double(before.main_thread.count()) / total << " us/msg" );
+   BOOST_TEST_MESSAGE( "strand decode:      " << double(after.main_thread.count()) / total << " us/msg" );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
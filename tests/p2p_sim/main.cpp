@@ -0,0 +1,534 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ *
+ *  p2p_sim: in-process p2p traffic simulator for net_plugin performance work.
+ *
+ *  Runs many peers in one process, connected over loopback tcp and speaking the net_plugin
+ *  wire protocol: framed net_messages, decoded on net threads into a receive_buffer and handled
+ *  on a per-peer strand that stands in for the nodeos main thread. Each peer has a stub chain
+ *  that only records the blocks and transactions it knows, so the numbers reflect relay cost
+ *  alone. Transactions are injected at random peers and peer 0 produces blocks from the ones
+ *  it has seen. Reports propagation latency percentiles, bytes on the wire per delivered message
+ *  and how busy the simulated main threads were.
+ */
+#include <eosio/net_plugin/protocol.hpp>
+#include <eosio/net_plugin/receive_buffer.hpp>
+#include <eosio/net_plugin/rolling_bloom_filter.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+
+using namespace eosio;
+using namespace eosio::chain;
+using boost::asio::ip::tcp;
+namespace bpo = boost::program_options;
+
+namespace {
+
+   using sim_clock = std::chrono::steady_clock;
+
+   constexpr uint32_t message_header_size = 4;
+   constexpr size_t   max_write_batch_size = 4*1024*1024;
+
+   struct sim_config {
+      uint32_t peers = 20;
+      uint32_t degree = 4;               ///< connections opened by each peer
+      uint32_t blocks = 20;
+      uint32_t block_interval_ms = 500;
+      uint32_t trxs_per_block = 100;
+      uint32_t trx_size = 200;           ///< bytes of action data
+      uint32_t latency_ms = 0;           ///< added to every message sent
+      double   loss = 0;                 ///< fraction of messages dropped by the sender
+      bool     inventory = false;        ///< p2p-trx-relay = inventory
+      uint32_t announce_interval_ms = 5;
+      uint16_t net_threads = 2;
+      uint16_t main_threads = 4;
+      uint32_t seed = 1;
+      uint32_t drain_timeout_ms = 30000; ///< limit on waiting for full propagation once all blocks are produced
+   };
+
+   /// propagation bookkeeping shared by all peers
+   struct sim_stats {
+      std::mutex                               mtx;
+      std::map<fc::sha256, sim_clock::time_point> created_at;
+      std::vector<double>                      block_latency_ms;
+      std::vector<double>                      trx_latency_ms;
+      uint32_t                                 blocks_created = 0;
+      uint32_t                                 trxs_created = 0;
+      std::atomic<uint64_t>                    bytes_sent{0};
+      std::atomic<uint64_t>                    messages_sent{0};
+      std::atomic<uint64_t>                    messages_dropped{0};
+
+      void created( const fc::sha256& id, bool block ) {
+         std::lock_guard<std::mutex> g( mtx );
+         created_at[id] = sim_clock::now();
+         ++(block ? blocks_created : trxs_created);
+      }
+
+      /// every block and transaction created has reached every other peer
+      bool complete( uint32_t peers, uint32_t blocks ) {
+         std::lock_guard<std::mutex> g( mtx );
+         return blocks_created == blocks &&
+                block_latency_ms.size() == uint64_t( blocks_created ) * (peers - 1) &&
+                trx_latency_ms.size() == uint64_t( trxs_created ) * (peers - 1);
+      }
+
+      void received( const fc::sha256& id, bool block ) {
+         auto now = sim_clock::now();
+         std::lock_guard<std::mutex> g( mtx );
+         auto i = created_at.find( id );
+         if( i == created_at.end() ) return;
+         double ms = std::chrono::duration<double, std::milli>( now - i->second ).count();
+         (block ? block_latency_ms : trx_latency_ms).push_back( ms );
+      }
+   };
+
+   std::shared_ptr<vector<char>> frame( const net_message& m ) {
+      const uint32_t payload_size = fc::raw::pack_size( m );
+      auto buf = std::make_shared<vector<char>>( message_header_size + payload_size );
+      fc::datastream<char*> ds( buf->data(), buf->size() );
+      ds.write( reinterpret_cast<const char*>( &payload_size ), message_header_size );
+      fc::raw::pack( ds, m );
+      return buf;
+   }
+
+   class sim_peer;
+
+   class sim_connection : public std::enable_shared_from_this<sim_connection> {
+   public:
+      sim_connection( sim_peer& owner, tcp::socket s, std::shared_ptr<buffer_pool> pool )
+      : owner( owner ), socket( std::move( s ) ), rbuf( std::move( pool ) ) {}
+
+      sim_peer&                          owner;
+      tcp::socket                        socket;
+      rolling_bloom_filter               known{ 50000, 0.001 }; ///< blocks and trxs this peer has, as in net_plugin
+      vector<transaction_id_type>        pending_announcements;
+
+      /// read loop, runs on net threads
+      void start_read();
+      /// queue a framed message, called on the owner's strand
+      void send( const std::shared_ptr<vector<char>>& buf );
+
+   private:
+      void do_write();
+
+      receive_buffer                             rbuf;
+      size_t                                     outstanding = message_header_size;
+      std::deque<std::shared_ptr<vector<char>>> queue;
+      vector<std::shared_ptr<vector<char>>>      out;
+   };
+   using sim_connection_ptr = std::shared_ptr<sim_connection>;
+
+   class sim_peer {
+   public:
+      sim_peer( uint32_t id, boost::asio::io_context& main_ioc, const sim_config& cfg, sim_stats& stats )
+      : id( id ), main( main_ioc ), announce_timer( main_ioc ), cfg( cfg ), stats( stats ), rng( cfg.seed + id ) {}
+
+      const uint32_t                     id;
+      boost::asio::io_context::strand    main; ///< stands in for the nodeos main thread
+      vector<sim_connection_ptr>         connections;
+      std::atomic<int64_t>               busy_ns{0};
+
+      /// run f on the simulated main thread, accounting for the time it takes
+      template<typename F>
+      void post( F&& f ) {
+         boost::asio::post( main, [this, f{std::forward<F>( f )}]() mutable {
+            auto start = sim_clock::now();
+            f();
+            busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>( sim_clock::now() - start ).count();
+         } );
+      }
+
+      void handle( const sim_connection_ptr& c, net_message& msg ) {
+         if( msg.contains<packed_transaction>() ) {
+            auto& trx = msg.get<packed_transaction>();
+            auto trx_id = trx.id();
+            c->known.insert( trx_id );
+            accept_transaction( c, trx_id, std::move( trx ) );
+         } else if( msg.contains<signed_block>() ) {
+            auto blk = std::make_shared<signed_block>( std::move( msg.get<signed_block>() ) );
+            auto blk_id = blk->id();
+            c->known.insert( blk_id );
+            accept_block( c, blk_id, blk );
+         } else if( msg.contains<notice_message>() ) {
+            request_announced( c, msg.get<notice_message>().known_trx.ids );
+         } else if( msg.contains<request_message>() ) {
+            for( const auto& tid : msg.get<request_message>().req_trx.ids ) {
+               auto t = trxs.find( tid );
+               if( t != trxs.end() ) send( c, t->second );
+            }
+         }
+      }
+
+      /// c is null for transactions injected at this peer
+      void accept_transaction( const sim_connection_ptr& c, const transaction_id_type& trx_id, packed_transaction trx ) {
+         if( trxs.count( trx_id ) ) return;
+         requested.erase( trx_id );
+         if( c ) stats.received( trx_id, false );
+         auto buf = frame( net_message( trx ) );
+         trxs.emplace( trx_id, buf );
+         if( id == 0 ) pending.emplace_back( std::move( trx ) );
+
+         bool announce = false;
+         for( auto& conn : connections ) {
+            if( conn == c || conn->known.contains( trx_id ) ) continue;
+            conn->known.insert( trx_id );
+            if( cfg.inventory ) {
+               conn->pending_announcements.push_back( trx_id );
+               announce = true;
+            } else {
+               send( conn, buf );
+            }
+         }
+         if( announce ) schedule_announcements();
+      }
+
+      /// c is null for blocks produced at this peer
+      void accept_block( const sim_connection_ptr& c, const block_id_type& blk_id, const signed_block_ptr& blk ) {
+         if( !blocks.insert( blk_id ).second ) return;
+         if( c ) stats.received( blk_id, true );
+         auto buf = frame( net_message( *blk ) );
+         for( auto& conn : connections ) {
+            if( conn == c || conn->known.contains( blk_id ) ) continue;
+            conn->known.insert( blk_id );
+            send( conn, buf );
+         }
+      }
+
+      /// produce a block from the transactions seen so far, peer 0 only
+      void produce_block() {
+         auto blk = std::make_shared<signed_block>();
+         blk->timestamp = block_timestamp_type( fc::time_point::now() );
+         blk->producer = N(eosio);
+         blk->previous = head;
+         const size_t n = std::min<size_t>( pending.size(), cfg.trxs_per_block );
+         for( size_t i = 0; i < n; ++i ) {
+            blk->transactions.emplace_back( pending.front() );
+            pending.pop_front();
+         }
+         head = blk->id();
+         stats.created( head, true );
+         accept_block( nullptr, head, blk );
+      }
+
+   private:
+      void send( const sim_connection_ptr& c, const std::shared_ptr<vector<char>>& buf ) {
+         if( cfg.loss > 0 && std::uniform_real_distribution<double>( 0, 1 )( rng ) < cfg.loss ) {
+            ++stats.messages_dropped;
+            return;
+         }
+         if( cfg.latency_ms == 0 ) {
+            c->send( buf );
+            return;
+         }
+         auto t = std::make_shared<boost::asio::steady_timer>( main.context(), std::chrono::milliseconds( cfg.latency_ms ) );
+         t->async_wait( boost::asio::bind_executor( main, [c, buf, t]( boost::system::error_code ec ) {
+            if( !ec ) c->send( buf );
+         } ) );
+      }
+
+      void request_announced( const sim_connection_ptr& c, const vector<transaction_id_type>& ids ) {
+         const auto now = sim_clock::now();
+         request_message req;
+         req.req_trx.mode = normal;
+         for( const auto& tid : ids ) {
+            c->known.insert( tid );
+            if( trxs.count( tid ) ) continue;
+            auto r = requested.find( tid );
+            if( r != requested.end() && now - r->second < std::chrono::seconds( 1 ) ) continue;
+            requested[tid] = now;
+            req.req_trx.ids.push_back( tid );
+         }
+         if( !req.req_trx.ids.empty() ) {
+            req.req_trx.pending = req.req_trx.ids.size();
+            send( c, frame( net_message( req ) ) );
+         }
+      }
+
+      void schedule_announcements() {
+         if( announce_scheduled ) return;
+         announce_scheduled = true;
+         announce_timer.expires_from_now( std::chrono::milliseconds( cfg.announce_interval_ms ) );
+         announce_timer.async_wait( [this]( boost::system::error_code ec ) {
+            post( [this, ec]() {
+               announce_scheduled = false;
+               if( ec ) return;
+               for( auto& c : connections ) {
+                  if( c->pending_announcements.empty() ) continue;
+                  notice_message note;
+                  note.known_trx.mode = normal;
+                  note.known_trx.pending = c->pending_announcements.size();
+                  note.known_trx.ids = std::move( c->pending_announcements );
+                  c->pending_announcements.clear();
+                  send( c, frame( net_message( note ) ) );
+               }
+            } );
+         } );
+      }
+
+      boost::asio::steady_timer                      announce_timer;
+      bool                                           announce_scheduled = false;
+      const sim_config&                              cfg;
+      sim_stats&                                     stats;
+      std::mt19937                                   rng;
+      std::map<transaction_id_type, std::shared_ptr<vector<char>>> trxs; ///< stub chain, serialized for requests
+      std::set<block_id_type>                        blocks;
+      std::map<transaction_id_type, sim_clock::time_point> requested;
+      std::deque<packed_transaction>                 pending;
+      block_id_type                                  head;
+
+      friend class sim_connection;
+   };
+
+   void sim_connection::start_read() {
+      auto self = shared_from_this();
+      const size_t minimum_read = outstanding;
+      boost::asio::async_read( socket, rbuf.prepare( minimum_read ),
+         [minimum_read]( boost::system::error_code ec, std::size_t n ) -> std::size_t {
+            return (ec || n >= minimum_read) ? 0 : minimum_read - n;
+         },
+         [self]( boost::system::error_code ec, std::size_t n ) {
+            if( ec ) return; // closed at the end of the run
+            auto& rb = self->rbuf;
+            rb.commit( n );
+            auto msgs = std::make_shared<vector<net_message>>();
+            self->outstanding = message_header_size;
+            while( rb.size() >= message_header_size ) {
+               uint32_t len = 0;
+               rb.peek( &len, sizeof( len ) );
+               if( rb.size() < len + message_header_size ) {
+                  rb.reserve_message( len + message_header_size );
+                  self->outstanding = len + message_header_size - rb.size();
+                  break;
+               }
+               rb.consume( message_header_size );
+               vector<char> scratch;
+               fc::datastream<const char*> ds( rb.contiguous( len, scratch ), len );
+               msgs->emplace_back();
+               fc::raw::unpack( ds, msgs->back() );
+               rb.consume( len );
+            }
+            if( rb.size() > 0 && rb.size() < message_header_size ) {
+               self->outstanding = message_header_size - rb.size();
+            }
+            self->owner.post( [self, msgs]() {
+               for( auto& m : *msgs ) self->owner.handle( self, m );
+            } );
+            self->start_read();
+         } );
+   }
+
+   void sim_connection::send( const std::shared_ptr<vector<char>>& buf ) {
+      queue.push_back( buf );
+      if( out.empty() ) do_write();
+   }
+
+   void sim_connection::do_write() {
+      std::vector<boost::asio::const_buffer> bufs;
+      size_t size = 0;
+      while( !queue.empty() && (size == 0 || size + queue.front()->size() <= max_write_batch_size) ) {
+         size += queue.front()->size();
+         bufs.push_back( boost::asio::buffer( *queue.front() ) );
+         out.push_back( std::move( queue.front() ) );
+         queue.pop_front();
+      }
+      if( bufs.empty() ) return;
+      auto self = shared_from_this();
+      boost::asio::async_write( socket, bufs, boost::asio::bind_executor( owner.main,
+         [self]( boost::system::error_code ec, std::size_t n ) {
+            self->owner.stats.bytes_sent += n;
+            self->owner.stats.messages_sent += self->out.size();
+            self->out.clear();
+            if( !ec ) self->do_write();
+         } ) );
+   }
+
+   double percentile( vector<double>& v, double p ) {
+      if( v.empty() ) return 0;
+      std::sort( v.begin(), v.end() );
+      return v[std::min<size_t>( v.size() - 1, static_cast<size_t>( p * v.size() ) )];
+   }
+
+   packed_transaction make_transaction( uint64_t nonce, uint32_t size ) {
+      signed_transaction trx;
+      trx.expiration = fc::time_point::now() + fc::hours( 1 );
+      bytes data( std::max<uint32_t>( size, sizeof( nonce ) ) );
+      memcpy( data.data(), &nonce, sizeof( nonce ) );
+      trx.actions.emplace_back( vector<permission_level>{{N(sim), config::active_name}}, N(sim), N(transfer), data );
+      return packed_transaction( trx );
+   }
+
+   int run( const sim_config& cfg ) {
+      sim_stats stats;
+      boost::asio::io_context net_ioc;
+      boost::asio::io_context main_ioc;
+      auto net_work = boost::asio::make_work_guard( net_ioc );
+      auto main_work = boost::asio::make_work_guard( main_ioc );
+      auto pool = std::make_shared<buffer_pool>( 32*1024 );
+
+      vector<std::unique_ptr<sim_peer>> peers;
+      vector<std::unique_ptr<tcp::acceptor>> acceptors;
+      for( uint32_t i = 0; i < cfg.peers; ++i ) {
+         peers.emplace_back( new sim_peer( i, main_ioc, cfg, stats ) );
+         acceptors.emplace_back( new tcp::acceptor( net_ioc, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) ) );
+      }
+
+      // a ring keeps the network connected, the rest of each peer's connections are random
+      std::mt19937 rng( cfg.seed );
+      std::set<std::pair<uint32_t, uint32_t>> edges;
+      for( uint32_t i = 0; i < cfg.peers && cfg.peers > 1; ++i ) {
+         const uint32_t j = (i + 1) % cfg.peers;
+         edges.emplace( std::min( i, j ), std::max( i, j ) );
+         for( uint32_t k = 1; k < cfg.degree && cfg.peers > 2; ++k ) {
+            const uint32_t r = rng() % cfg.peers;
+            if( r != i ) edges.emplace( std::min( i, r ), std::max( i, r ) );
+         }
+      }
+      for( const auto& e : edges ) {
+         tcp::socket a( net_ioc ), b( net_ioc );
+         a.connect( acceptors[e.second]->local_endpoint() );
+         acceptors[e.second]->accept( b );
+         a.set_option( tcp::no_delay( true ) );
+         b.set_option( tcp::no_delay( true ) );
+         peers[e.first]->connections.emplace_back( std::make_shared<sim_connection>( *peers[e.first], std::move( a ), pool ) );
+         peers[e.second]->connections.emplace_back( std::make_shared<sim_connection>( *peers[e.second], std::move( b ), pool ) );
+      }
+      for( auto& p : peers ) {
+         for( auto& c : p->connections ) c->start_read();
+      }
+
+      vector<std::thread> threads;
+      for( uint16_t i = 0; i < cfg.net_threads; ++i ) threads.emplace_back( [&]() { net_ioc.run(); } );
+      for( uint16_t i = 0; i < cfg.main_threads; ++i ) threads.emplace_back( [&]() { main_ioc.run(); } );
+
+      // inject transactions at random peers, produce blocks on peer 0
+      const auto start = sim_clock::now();
+      const auto block_interval = std::chrono::milliseconds( cfg.block_interval_ms );
+      const uint32_t ticks_per_block = 10;
+      uint64_t nonce = 0;
+      for( uint32_t b = 0; b < cfg.blocks; ++b ) {
+         for( uint32_t t = 0; t < ticks_per_block; ++t ) {
+            const uint32_t injected = cfg.trxs_per_block * (t + 1) / ticks_per_block - cfg.trxs_per_block * t / ticks_per_block;
+            for( uint32_t k = 0; k < injected; ++k ) {
+               auto trx = make_transaction( ++nonce, cfg.trx_size );
+               auto trx_id = trx.id();
+               auto& p = *peers[rng() % cfg.peers];
+               stats.created( trx_id, false );
+               p.post( [&p, trx_id, trx{std::move( trx )}]() mutable {
+                  p.accept_transaction( nullptr, trx_id, std::move( trx ) );
+               } );
+            }
+            std::this_thread::sleep_until( start + block_interval * b + block_interval * (t + 1) / ticks_per_block );
+         }
+         peers[0]->post( [&]() { peers[0]->produce_block(); } );
+      }
+      const auto produced = sim_clock::now();
+      // without loss wait for full propagation, bounded by drain_timeout_ms. With loss it may never
+      // complete, give the retries a fixed time instead.
+      const auto drain = cfg.loss == 0 ? std::chrono::milliseconds( cfg.drain_timeout_ms )
+                                       : std::max<std::chrono::milliseconds>( std::chrono::seconds( 1 ), std::chrono::milliseconds( cfg.latency_ms * 20 ) );
+      while( !(cfg.loss == 0 && stats.complete( cfg.peers, cfg.blocks )) && sim_clock::now() < produced + drain ) {
+         std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+      }
+      const auto wall = std::chrono::duration<double>( produced - start ).count();
+
+      net_ioc.stop();
+      main_ioc.stop();
+      for( auto& t : threads ) t.join();
+
+      std::lock_guard<std::mutex> g( stats.mtx );
+      const uint64_t expected_blocks = uint64_t( stats.blocks_created ) * (cfg.peers - 1);
+      const uint64_t expected_trxs = uint64_t( stats.trxs_created ) * (cfg.peers - 1);
+      const uint64_t delivered = stats.block_latency_ms.size() + stats.trx_latency_ms.size();
+      double busy_avg = 0, busy_max = 0;
+      for( auto& p : peers ) {
+         double busy = p->busy_ns.load() / 1e9 / wall;
+         busy_avg += busy / peers.size();
+         busy_max = std::max( busy_max, busy );
+      }
+
+      std::cout << "peers " << cfg.peers << ", connections " << edges.size() << ", relay " << (cfg.inventory ? "inventory" : "push")
+                << ", latency " << cfg.latency_ms << "ms, loss " << cfg.loss * 100 << "%\n";
+      auto report = [&]( const char* what, vector<double>& v, uint64_t expected ) {
+         std::cout << what << ": delivered " << v.size() << "/" << expected
+                   << ", latency ms p50 " << percentile( v, 0.5 ) << " p90 " << percentile( v, 0.9 )
+                   << " p99 " << percentile( v, 0.99 ) << " max " << percentile( v, 1.0 ) << "\n";
+      };
+      report( "blocks", stats.block_latency_ms, expected_blocks );
+      report( "trxs  ", stats.trx_latency_ms, expected_trxs );
+      const uint64_t bytes_sent = stats.bytes_sent.load();
+      std::cout << "wire: " << bytes_sent << " bytes in " << stats.messages_sent.load() << " messages ("
+                << stats.messages_dropped.load() << " dropped), " << (delivered ? bytes_sent / delivered : 0)
+                << " bytes per delivered block or trx\n";
+      std::cout << "main thread utilization: avg " << busy_avg * 100 << "%, max " << busy_max * 100 << "%\n";
+
+      // without loss every peer has to receive everything
+      if( cfg.loss == 0 && delivered != expected_blocks + expected_trxs ) {
+         std::cerr << "incomplete propagation\n";
+         return 1;
+      }
+      return 0;
+   }
+
+} // anonymous namespace
+
+int main( int argc, char** argv ) {
+   try {
+      sim_config cfg;
+      string relay;
+      bpo::options_description opts( "p2p_sim options" );
+      opts.add_options()
+         ( "help,h", "print this help" )
+         ( "peers", bpo::value<uint32_t>( &cfg.peers )->default_value( cfg.peers ), "number of simulated peers" )
+         ( "degree", bpo::value<uint32_t>( &cfg.degree )->default_value( cfg.degree ), "connections opened by each peer" )
+         ( "blocks", bpo::value<uint32_t>( &cfg.blocks )->default_value( cfg.blocks ), "blocks produced by peer 0" )
+         ( "block-interval-ms", bpo::value<uint32_t>( &cfg.block_interval_ms )->default_value( cfg.block_interval_ms ), "milliseconds between blocks" )
+         ( "trxs-per-block", bpo::value<uint32_t>( &cfg.trxs_per_block )->default_value( cfg.trxs_per_block ), "transactions injected per block interval" )
+         ( "trx-size", bpo::value<uint32_t>( &cfg.trx_size )->default_value( cfg.trx_size ), "bytes of action data per transaction" )
+         ( "latency-ms", bpo::value<uint32_t>( &cfg.latency_ms )->default_value( cfg.latency_ms ), "added to every message sent" )
+         ( "loss", bpo::value<double>( &cfg.loss )->default_value( cfg.loss ), "fraction of messages dropped, 0 to 1" )
+         ( "relay", bpo::value<string>( &relay )->default_value( "push" ), "transaction relay, 'push' or 'inventory'" )
+         ( "announce-interval-ms", bpo::value<uint32_t>( &cfg.announce_interval_ms )->default_value( cfg.announce_interval_ms ), "inventory announcement batching" )
+         ( "net-threads", bpo::value<uint16_t>( &cfg.net_threads )->default_value( cfg.net_threads ), "threads reading and writing sockets" )
+         ( "main-threads", bpo::value<uint16_t>( &cfg.main_threads )->default_value( cfg.main_threads ), "threads running the per-peer main strands" )
+         ( "seed", bpo::value<uint32_t>( &cfg.seed )->default_value( cfg.seed ), "random seed for topology, injection and loss" )
+         ( "drain-timeout-ms", bpo::value<uint32_t>( &cfg.drain_timeout_ms )->default_value( cfg.drain_timeout_ms ), "without loss, longest wait for full propagation after the last block" );
+      bpo::variables_map vmap;
+      bpo::store( bpo::parse_command_line( argc, argv, opts ), vmap );
+      bpo::notify( vmap );
+      if( vmap.count( "help" ) ) {
+         std::cout << opts << "\n";
+         return 0;
+      }
+      if( relay != "push" && relay != "inventory" ) {
+         std::cerr << "relay must be 'push' or 'inventory'\n";
+         return 1;
+      }
+      cfg.inventory = relay == "inventory";
+      if( cfg.peers < 2 || cfg.net_threads == 0 || cfg.main_threads == 0 || cfg.loss < 0 || cfg.loss > 1 ) {
+         std::cerr << "need at least 2 peers, 1 net and main thread, and loss between 0 and 1\n";
+         return 1;
+      }
+      return run( cfg );
+   } catch( const fc::exception& e ) {
+      std::cerr << e.to_detail_string() << "\n";
+   } catch( const std::exception& e ) {
+      std::cerr << e.what() << "\n";
+   }
+   return 1;
+}
@@ -0,0 +1,110 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/net_plugin/peer_quality.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <set>
+
+using eosio::peer_quality;
+using fc::time_point;
+using fc::microseconds;
+
+namespace {
+
+   struct test_peer {
+      int          n = 0;
+      peer_quality quality;
+   };
+   using test_peer_ptr = std::shared_ptr<test_peer>;
+
+   test_peer_ptr make_peer( int n ) {
+      auto p = std::make_shared<test_peer>();
+      p->n = n;
+      return p;
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(peer_quality_tests)
+
+BOOST_AUTO_TEST_CASE(score_measurements)
+{
+   auto now = time_point::now();
+   peer_quality q;
+   BOOST_CHECK_EQUAL( q.score( now ), 90 );
+
+   // the first sample is taken as is, later ones are smoothed
+   q.add_rtt( 50'000 );
+   BOOST_CHECK_EQUAL( q.rtt_us, 50'000 );
+   q.add_rtt( 100'000 );
+   BOOST_CHECK_CLOSE( q.rtt_us, 60'000, 0.001 );
+   BOOST_CHECK_CLOSE( q.score( now ), 84, 0.001 ); // 1 point per 10ms
+
+   // each penalty is capped
+   peer_quality slow;
+   slow.add_rtt( 10'000'000 );
+   slow.add_block_latency( 10'000'000 );
+   BOOST_CHECK_CLOSE( slow.score( now ), 50, 0.001 );
+
+   // throughput is measured over whole windows
+   peer_quality fast;
+   fast.window_start = now;
+   fast.add_bytes( 4*1024*1024, now + microseconds( 500'000 ) );
+   BOOST_CHECK_EQUAL( fast.bytes_per_sec, 0 );
+   fast.add_bytes( 4*1024*1024, now + microseconds( 1'000'000 ) );
+   BOOST_CHECK_CLOSE( fast.bytes_per_sec, 8*1024*1024, 0.001 );
+   fast.last_decay = now + microseconds( 1'000'000 );
+   BOOST_CHECK_CLOSE( fast.score( now + microseconds( 1'000'000 ) ), 98, 0.001 );
+}
+
+BOOST_AUTO_TEST_CASE(penalties_decay)
+{
+   auto now = time_point::now();
+   peer_quality q;
+   q.last_decay = now;
+   q.add_rejected_block( now );
+   q.add_timeout( now );
+   BOOST_CHECK_CLOSE( q.score( now ), 75, 0.001 );
+
+   // half the penalty is left after one half life
+   auto later = now + microseconds( peer_quality::penalty_half_life_us );
+   BOOST_CHECK_CLOSE( q.rejected_blocks, 1, 0.001 );
+   BOOST_CHECK_CLOSE( q.score( later ), 82.5, 0.001 );
+   BOOST_CHECK_CLOSE( q.rejected_blocks, 0.5, 0.001 );
+   BOOST_CHECK_CLOSE( q.timeouts, 0.5, 0.001 );
+}
+
+BOOST_AUTO_TEST_CASE(order_by_score)
+{
+   auto now = time_point::now();
+   std::vector<test_peer_ptr> peers;
+   for( int i = 0; i < 5; ++i ) {
+      peers.push_back( make_peer( i ) );
+      peers.back()->quality.last_decay = now;
+      peers.back()->quality.window_start = now;
+   }
+   peers[0]->quality.add_rtt( 200'000 );             // 70
+   peers[1]->quality.add_rejected_block( now );      // 80
+   peers[3]->quality.add_rtt( 20'000 );              // 88
+   // peers[2] and peers[4] are unmeasured, 90
+
+   auto ordered = eosio::order_by_score( peers, now );
+   BOOST_REQUIRE_EQUAL( ordered.size(), peers.size() );
+   std::vector<int> order;
+   for( const auto& p : ordered ) order.push_back( p->n );
+   // equal scores keep their order
+   BOOST_CHECK( (order == std::vector<int>{ 2, 4, 3, 1, 0 }) );
+
+   // any range of pointers, such as net_plugin's std::set of connections
+   std::set<test_peer_ptr> as_set( peers.begin(), peers.end() );
+   auto from_set = eosio::order_by_score( as_set, now );
+   BOOST_REQUIRE_EQUAL( from_set.size(), peers.size() );
+   BOOST_CHECK_EQUAL( from_set.back()->n, 0 );
+   BOOST_CHECK_EQUAL( from_set[2]->n, 3 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
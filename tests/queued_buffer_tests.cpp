@@ -0,0 +1,144 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/net_plugin/queued_buffer.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace eosio;
+
+namespace {
+
+   constexpr uint32_t max_write_queue_size = 1000;
+   constexpr size_t   max_write_batch_size = 100;
+
+   std::shared_ptr<std::vector<char>> make_buffer( size_t size, char c = 'x' ) {
+      return std::make_shared<std::vector<char>>( size, c );
+   }
+
+   size_t total_size( const std::vector<boost::asio::const_buffer>& bufs ) {
+      size_t size = 0;
+      for( const auto& b : bufs )
+         size += boost::asio::buffer_size( b );
+      return size;
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(queued_buffer_tests)
+
+/// A write gathers queued messages until the next one would take it past the batch size
+BOOST_AUTO_TEST_CASE(batch_cut_off)
+{
+   queued_buffer q( max_write_queue_size, max_write_batch_size );
+   for( int i = 0; i < 7; ++i )
+      BOOST_REQUIRE( q.add_write_queue( make_buffer( 30 ), no_reason, false ) );
+   BOOST_CHECK_EQUAL( q.write_queue_size(), 210u );
+   BOOST_CHECK( q.ready_to_send() );
+
+   std::vector<boost::asio::const_buffer> bufs;
+   q.fill_out_buffer( bufs );
+   BOOST_CHECK_EQUAL( bufs.size(), 3u ); // a fourth would make 120 bytes
+   BOOST_CHECK_EQUAL( total_size( bufs ), 90u );
+   BOOST_CHECK_EQUAL( q.write_queue_size(), 120u );
+   // nothing more goes out until the write completes
+   BOOST_CHECK( !q.ready_to_send() );
+   BOOST_CHECK( !q.is_out_queue_empty() );
+
+   q.clear_out_queue();
+   BOOST_CHECK( q.ready_to_send() );
+   bufs.clear();
+   q.fill_out_buffer( bufs );
+   BOOST_CHECK_EQUAL( bufs.size(), 3u );
+
+   // exactly the batch size still fits
+   q.clear_out_queue();
+   q.add_write_queue( make_buffer( 70 ), no_reason, false );
+   bufs.clear();
+   q.fill_out_buffer( bufs );
+   BOOST_CHECK_EQUAL( bufs.size(), 2u );
+   BOOST_CHECK_EQUAL( total_size( bufs ), max_write_batch_size );
+   BOOST_CHECK_EQUAL( q.write_queue_size(), 0u );
+}
+
+/// The sync queue is drained before any real time message is sent
+BOOST_AUTO_TEST_CASE(sync_queue_first)
+{
+   queued_buffer q( max_write_queue_size, max_write_batch_size );
+   q.add_write_queue( make_buffer( 10, 'r' ), no_reason, false );
+   q.add_write_queue( make_buffer( 60, 's' ), no_reason, true );
+   q.add_write_queue( make_buffer( 60, 's' ), no_reason, true );
+
+   std::vector<boost::asio::const_buffer> bufs;
+   q.fill_out_buffer( bufs );
+   BOOST_REQUIRE_EQUAL( bufs.size(), 1u );
+   BOOST_CHECK_EQUAL( *boost::asio::buffer_cast<const char*>( bufs[0] ), 's' );
+
+   q.clear_out_queue();
+   bufs.clear();
+   q.fill_out_buffer( bufs );
+   BOOST_REQUIRE_EQUAL( bufs.size(), 2u );
+   BOOST_CHECK_EQUAL( *boost::asio::buffer_cast<const char*>( bufs[0] ), 's' );
+   BOOST_CHECK_EQUAL( *boost::asio::buffer_cast<const char*>( bufs[1] ), 'r' );
+}
+
+/// A message larger than the batch size is written, on its own
+BOOST_AUTO_TEST_CASE(oversized_message)
+{
+   queued_buffer q( max_write_queue_size, max_write_batch_size );
+   q.add_write_queue( make_buffer( 10 ), no_reason, false );
+   q.add_write_queue( make_buffer( 250 ), no_reason, false );
+   q.add_write_queue( make_buffer( 10 ), no_reason, false );
+
+   std::vector<boost::asio::const_buffer> bufs;
+   q.fill_out_buffer( bufs );
+   BOOST_CHECK_EQUAL( total_size( bufs ), 10u );
+
+   q.clear_out_queue();
+   bufs.clear();
+   q.fill_out_buffer( bufs );
+   BOOST_REQUIRE_EQUAL( bufs.size(), 1u );
+   BOOST_CHECK_EQUAL( total_size( bufs ), 250u );
+
+   q.clear_out_queue();
+   bufs.clear();
+   q.fill_out_buffer( bufs );
+   BOOST_CHECK_EQUAL( total_size( bufs ), 10u );
+   BOOST_CHECK_EQUAL( q.write_queue_size(), 0u );
+}
+
+/// A queue past twice its limit asks for the connection to be closed
+BOOST_AUTO_TEST_CASE(write_queue_limit)
+{
+   queued_buffer q( max_write_queue_size, max_write_batch_size );
+   BOOST_CHECK( q.add_write_queue( make_buffer( 2 * max_write_queue_size ), no_reason, false ) );
+   BOOST_CHECK( !q.add_write_queue( make_buffer( 1 ), no_reason, false ) );
+   q.clear_write_queue();
+   BOOST_CHECK_EQUAL( q.write_queue_size(), 0u );
+   BOOST_CHECK( !q.ready_to_send() );
+}
+
+/// The go_away reason queued with a message, rather than a callback, tells the writer to close once it is sent
+BOOST_AUTO_TEST_CASE(close_after_send)
+{
+   queued_buffer q( max_write_queue_size, max_write_batch_size );
+   q.add_write_queue( make_buffer( 10 ), no_reason, false );
+   q.add_write_queue( make_buffer( 10 ), benign_other, false );
+   q.add_write_queue( make_buffer( 90 ), no_reason, false );
+
+   std::vector<boost::asio::const_buffer> bufs;
+   q.fill_out_buffer( bufs );
+   BOOST_CHECK_EQUAL( bufs.size(), 2u );
+   BOOST_CHECK( q.out_close_reason() == benign_other );
+
+   // the remaining message keeps the connection open
+   q.clear_out_queue();
+   BOOST_CHECK( q.out_close_reason() == no_reason );
+   bufs.clear();
+   q.fill_out_buffer( bufs );
+   BOOST_CHECK_EQUAL( bufs.size(), 1u );
+   BOOST_CHECK( q.out_close_reason() == no_reason );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
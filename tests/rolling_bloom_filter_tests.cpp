@@ -0,0 +1,52 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/net_plugin/rolling_bloom_filter.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+using eosio::rolling_bloom_filter;
+
+namespace {
+   fc::sha256 make_id( uint32_t n ) { return fc::sha256::hash( std::to_string( n ) ); }
+}
+
+BOOST_AUTO_TEST_SUITE(rolling_bloom_filter_tests)
+
+BOOST_AUTO_TEST_CASE(insert_contains_clear)
+{
+   rolling_bloom_filter f( 1000, 0.001 );
+   for( uint32_t i = 0; i < 500; ++i ) f.insert( make_id( i ) );
+   for( uint32_t i = 0; i < 500; ++i ) BOOST_REQUIRE( f.contains( make_id( i ) ) );
+
+   uint32_t false_positives = 0;
+   for( uint32_t i = 1000000; i < 1010000; ++i ) {
+      if( f.contains( make_id( i ) ) ) ++false_positives;
+   }
+   BOOST_CHECK_LT( false_positives, 50u ); // 0.1% expected, allow 5x
+
+   f.clear();
+   for( uint32_t i = 0; i < 500; ++i ) BOOST_CHECK( !f.contains( make_id( i ) ) );
+}
+
+/// The most recent half capacity is always remembered, older entries roll out
+BOOST_AUTO_TEST_CASE(rolls_over)
+{
+   rolling_bloom_filter f( 1000, 0.001 );
+   for( uint32_t i = 0; i < 5000; ++i ) {
+      f.insert( make_id( i ) );
+      for( uint32_t j = (i < 499 ? 0 : i - 499); j <= i; j += 97 ) {
+         BOOST_REQUIRE( f.contains( make_id( j ) ) );
+      }
+   }
+   uint32_t remembered = 0;
+   for( uint32_t i = 0; i < 1000; ++i ) {
+      if( f.contains( make_id( i ) ) ) ++remembered;
+   }
+   BOOST_CHECK_LT( remembered, 10u );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
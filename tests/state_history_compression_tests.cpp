@@ -0,0 +1,271 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/state_history_plugin/state_history_compression.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace eosio;
+using namespace eosio::chain;
+
+namespace {
+
+   /// a few transfers which look alike from block to block, as traces and deltas do
+   bytes make_payload( uint32_t n ) {
+      std::string s;
+      uint64_t    seed = n * 6364136223846793005ull + 1442695040888963407ull;
+      for( uint32_t i = 0; i < 20; ++i ) {
+         seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+         s += "{\"from\":\"account" + std::to_string( (seed >> 33) % 97 ) + "\",\"to\":\"eosio.token\",\"quantity\":\"" +
+              std::to_string( (seed >> 17) % 100000 ) + ".0000 EOS\",\"memo\":\"block " + std::to_string( n ) + "\"}";
+      }
+      return bytes( s.begin(), s.end() );
+   }
+
+   block_id_type make_block_id( uint32_t block_num ) {
+      block_id_type id = fc::sha256::hash( std::to_string( block_num ) );
+      id._hash[0] = ( id._hash[0] & 0xffffffff00000000 ) | fc::endian_reverse_u32( block_num );
+      return id;
+   }
+
+   struct log_files {
+      fc::temp_directory dir;
+      std::string        log   = ( dir.path() / "test.log" ).string();
+      std::string        index = ( dir.path() / "test.index" ).string();
+      std::string        dict  = ( dir.path() / "test.dict" ).string();
+   };
+
+   void write_entry( state_history_log& log, zstd_log_context& zstd, state_history_compression compression,
+                     uint32_t block_num, std::map<uint32_t, bytes>& written, named_thread_pool* pool = nullptr ) {
+      written[block_num] = make_payload( block_num );
+      write_log_entry( log, zstd, compression, make_block_id( block_num ), make_block_id( block_num - 1 ),
+                       written[block_num], pool ? &pool->get_executor() : nullptr, "test" );
+   }
+
+   uint32_t entry_version( state_history_log& log, uint32_t block_num ) {
+      state_history_log_header header;
+      log.get_entry( block_num, header );
+      return get_ship_version( header.magic );
+   }
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(state_history_compression_tests)
+
+/// Payloads survive zstd with and without a trained dictionary, and the dictionary is found through the log
+BOOST_AUTO_TEST_CASE(zstd_round_trip)
+{ try {
+   log_files files;
+   state_history_log log( "test", files.log, files.index, files.dict );
+
+   zstd_log_context plain;
+   auto data = make_payload( 1 );
+   auto compressed = plain.compress( data );
+   BOOST_CHECK_LT( compressed.size(), data.size() );
+   BOOST_CHECK_EQUAL( ZSTD_getDictID_fromFrame( compressed.data(), compressed.size() ), 0u );
+   BOOST_CHECK( zstd_log_context().decompress( log, 0, compressed ) == data );
+
+   zstd_log_context trained;
+   trained.sample_count = 200;
+   trained.dict_size    = 4096;
+   named_thread_pool pool( "test", 1 );
+   for( uint32_t i = 0; i < 200 && !trained.training.valid(); ++i )
+      trained.add_sample( make_payload( i ), pool.get_executor() );
+   BOOST_REQUIRE( trained.training.valid() );
+   trained.training.wait();
+   trained.poll_training( log );
+   BOOST_REQUIRE( trained.cdict );
+   const auto id = trained.cdict_id;
+   BOOST_CHECK_NE( id, 0u );
+   BOOST_CHECK_EQUAL( log.last_dictionary_id(), id );
+
+   data = make_payload( 1000 );
+   auto with_dict = trained.compress( data );
+   BOOST_CHECK_EQUAL( ZSTD_getDictID_fromFrame( with_dict.data(), with_dict.size() ), id );
+   BOOST_CHECK_LT( with_dict.size(), plain.compress( data ).size() );
+
+   // a reader loads the dictionary from *.dict on first use
+   zstd_log_context reader;
+   BOOST_CHECK( reader.decompress( log, id, with_dict ) == data );
+   BOOST_CHECK_EQUAL( reader.ddicts.size(), 1u );
+   BOOST_CHECK_THROW( reader.decompress( log, 0, with_dict ), plugin_exception );
+   BOOST_CHECK_THROW( reader.decompress( log, id + 1, with_dict ), plugin_exception );
+
+   // and so does a writer after a restart
+   state_history_log reopened( "test", files.log + ".2", files.index + ".2", files.dict );
+   zstd_log_context writer;
+   writer.use_dictionary( reopened, reopened.last_dictionary_id() );
+   BOOST_CHECK( reader.decompress( reopened, id, writer.compress( data ) ) == data );
+} FC_LOG_AND_RETHROW() }
+
+/// zlib (version 0) and zstd (version 1) entries, with and without a dictionary, are read back from one log
+BOOST_AUTO_TEST_CASE(mixed_versions)
+{ try {
+   log_files                 files;
+   std::map<uint32_t, bytes> written;
+   uint32_t                  dictionary_id = 0;
+   {
+      state_history_log log( "test", files.log, files.index, files.dict );
+      zstd_log_context  zstd;
+      zstd.sample_count = 60;
+      zstd.dict_size    = 2048;
+      named_thread_pool pool( "test", 1 );
+
+      for( uint32_t n = 1; n <= 10; ++n )
+         write_entry( log, zstd, state_history_compression::zlib, n, written );
+      for( uint32_t n = 11; n <= 80; ++n )
+         write_entry( log, zstd, state_history_compression::zstd, n, written, &pool );
+      BOOST_REQUIRE( zstd.training.valid() );
+      zstd.training.wait();
+      // the dictionary is installed by the next write
+      for( uint32_t n = 81; n <= 90; ++n )
+         write_entry( log, zstd, state_history_compression::zstd, n, written, &pool );
+      for( uint32_t n = 91; n <= 95; ++n )
+         write_entry( log, zstd, state_history_compression::zlib, n, written );
+      dictionary_id = zstd.cdict_id;
+      BOOST_REQUIRE_NE( dictionary_id, 0u );
+   }
+
+   state_history_log log( "test", files.log, files.index, files.dict );
+   zstd_log_context  zstd;
+   BOOST_REQUIRE_EQUAL( log.begin_block(), 1u );
+   BOOST_REQUIRE_EQUAL( log.end_block(), 96u );
+   for( uint32_t n = 1; n <= 95; ++n ) {
+      const bool zlib = n <= 10 || n > 90;
+      BOOST_CHECK_EQUAL( entry_version( log, n ), zlib ? ship_zlib_version : ship_current_version );
+
+      fc::optional<bytes> payload;
+      read_log_entry( log, zstd, n, payload );
+      BOOST_REQUIRE( payload );
+      BOOST_CHECK( *payload == written[n] );
+
+      payload_compression passthrough;
+      read_log_entry( log, zstd, n, payload, &passthrough );
+      BOOST_CHECK_EQUAL( passthrough.compression, zlib ? 0 : 1 );
+      BOOST_CHECK_EQUAL( passthrough.dictionary_id, n > 80 && !zlib ? dictionary_id : 0u );
+   }
+
+   fc::optional<bytes> payload;
+   read_log_entry( log, zstd, 96, payload );
+   BOOST_CHECK( !payload );
+} FC_LOG_AND_RETHROW() }
+
+/// A *.dict cut short by a crash loses only its last dictionary
+BOOST_AUTO_TEST_CASE(truncated_dictionaries)
+{ try {
+   log_files files;
+   {
+      state_history_log log( "test", files.log, files.index, files.dict );
+      log.add_dictionary( 7, bytes( 100, 'a' ) );
+      log.add_dictionary( 9, bytes( 200, 'b' ) );
+   }
+   const uint64_t first_record = 2 * sizeof(uint32_t) + 100;
+   boost::filesystem::resize_file( files.dict, boost::filesystem::file_size( files.dict ) - 50 );
+   {
+      state_history_log log( "test", files.log, files.index, files.dict );
+      BOOST_REQUIRE( log.get_dictionary( 7 ) );
+      BOOST_CHECK( *log.get_dictionary( 7 ) == bytes( 100, 'a' ) );
+      BOOST_CHECK( !log.get_dictionary( 9 ) );
+      BOOST_CHECK_EQUAL( log.last_dictionary_id(), 7u );
+      BOOST_CHECK_EQUAL( boost::filesystem::file_size( files.dict ), first_record );
+      log.add_dictionary( 9, bytes( 200, 'c' ) );
+   }
+
+   // a record header cut in half
+   boost::filesystem::resize_file( files.dict, boost::filesystem::file_size( files.dict ) + 3 );
+   state_history_log log( "test", files.log, files.index, files.dict );
+   BOOST_REQUIRE( log.get_dictionary( 9 ) );
+   BOOST_CHECK( *log.get_dictionary( 9 ) == bytes( 200, 'c' ) );
+   BOOST_CHECK_EQUAL( log.last_dictionary_id(), 9u );
+   BOOST_CHECK_EQUAL( boost::filesystem::file_size( files.dict ), first_record + 2 * sizeof(uint32_t) + 200 );
+} FC_LOG_AND_RETHROW() }
+
+/// get_blocks_request_v0 clients get the same payloads whether the entries were stored with zlib or zstd, while
+/// get_blocks_request_v1 clients asking for compressed entries get zstd entries as stored
+BOOST_AUTO_TEST_CASE(legacy_client_payloads)
+{ try {
+   log_files                 files;
+   std::map<uint32_t, bytes> written;
+   state_history_log         log( "test", files.log, files.index, files.dict );
+   zstd_log_context          zstd;
+   write_entry( log, zstd, state_history_compression::zlib, 1, written );
+   write_entry( log, zstd, state_history_compression::zstd, 2, written );
+
+   for( uint32_t n = 1; n <= 2; ++n ) {
+      fc::optional<bytes> payload;
+      read_log_entry( log, zstd, n, payload );
+      BOOST_REQUIRE( payload );
+      BOOST_CHECK( *payload == written[n] );
+   }
+
+   fc::optional<bytes> payload;
+   payload_compression passthrough;
+   read_log_entry( log, zstd, 1, payload, &passthrough );
+   BOOST_CHECK_EQUAL( passthrough.compression, 0 );
+   BOOST_CHECK( *payload == written[1] );
+
+   read_log_entry( log, zstd, 2, payload, &passthrough );
+   BOOST_CHECK_EQUAL( passthrough.compression, 1 );
+   BOOST_CHECK_EQUAL( passthrough.dictionary_id, 0u );
+   BOOST_CHECK( *payload != written[2] );
+   BOOST_CHECK( zstd.decompress( log, 0, *payload ) == written[2] );
+} FC_LOG_AND_RETHROW() }
+
+/// A segment is archived with the dictionaries its entries use
+BOOST_AUTO_TEST_CASE(segment_dictionaries)
+{ try {
+   log_files        files;
+   log_split_config cfg;
+   cfg.stride             = 5;
+   cfg.max_retained_files = 1;
+   cfg.retained_dir       = "retained";
+   cfg.archive_dir        = "cold";
+
+   std::map<uint32_t, bytes> written;
+   {
+      state_history_log log( "test", files.log, files.index, files.dict, cfg );
+      zstd_log_context  zstd;
+      log.add_dictionary( 42, make_payload( 0 ) );
+      log.add_dictionary( 43, make_payload( 1 ) );
+      zstd.use_dictionary( log, 42 );
+      for( uint32_t n = 1; n <= 4; ++n )
+         write_entry( log, zstd, state_history_compression::zlib, n, written );
+      write_entry( log, zstd, state_history_compression::zstd, 5, written );
+      for( uint32_t n = 6; n <= 11; ++n )
+         write_entry( log, zstd, state_history_compression::zlib, n, written );
+
+      fc::optional<bytes> payload;
+      zstd_log_context    reader;
+      read_log_entry( log, reader, 5, payload );
+      BOOST_CHECK( !payload ); // archived
+      read_log_entry( log, reader, 6, payload );
+      BOOST_REQUIRE( payload );
+      BOOST_CHECK( *payload == written[6] );
+   }
+
+   // only dictionary 42 was used by blocks 1-5, and blocks 6-10 need none
+   const auto cold = files.dir.path() / "cold";
+   BOOST_CHECK( fc::exists( cold / "test-1-5.log" ) );
+   BOOST_REQUIRE( fc::exists( cold / "test-1-5.dict" ) );
+   BOOST_CHECK( fc::exists( files.dir.path() / "retained" / "test-6-10.log" ) );
+   BOOST_CHECK( !fc::exists( files.dir.path() / "retained" / "test-6-10.dict" ) );
+   BOOST_CHECK( !fc::exists( files.dir.path() / "test-segment.dict" ) );
+
+   // the archived segment can be read on its own
+   state_history_log archived( "test", ( cold / "test-1-5.log" ).string(), ( cold / "test-1-5.index" ).string(),
+                               ( cold / "test-1-5.dict" ).string() );
+   BOOST_CHECK( archived.get_dictionary( 42 ) );
+   BOOST_CHECK( !archived.get_dictionary( 43 ) );
+   zstd_log_context    reader;
+   fc::optional<bytes> payload;
+   read_log_entry( archived, reader, 5, payload );
+   BOOST_REQUIRE( payload );
+   BOOST_CHECK( *payload == written[5] );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,179 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/net_plugin/sync_chunks.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <string>
+
+using peer_ptr = std::shared_ptr<std::string>;
+using chunks_t = eosio::sync_chunks<peer_ptr, uint32_t>; // held blocks are their own block number
+using disposition = chunks_t::disposition;
+
+namespace {
+
+   /// what sync_manager does with a received block, returns the blocks applied in order
+   std::vector<uint32_t> receive( chunks_t& chunks, const peer_ptr& from, uint32_t blk_num,
+                                  uint32_t& next_expected, uint32_t last_requested ) {
+      std::vector<uint32_t> applied;
+      switch( chunks_t::classify( blk_num, next_expected, last_requested ) ) {
+         case disposition::drop:
+            chunks.block_received( from, blk_num );
+            return applied;
+         case disposition::hold:
+            chunks.hold( blk_num, blk_num );
+            chunks.block_received( from, blk_num );
+            return applied;
+         case disposition::apply:
+            break;
+      }
+      applied.push_back( blk_num );
+      next_expected = blk_num + 1;
+      chunks.block_received( from, blk_num );
+      while( auto held = chunks.release( next_expected ) ) {
+         applied.push_back( *held );
+         next_expected = *held + 1;
+      }
+      return applied;
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(sync_chunks_tests)
+
+BOOST_AUTO_TEST_CASE(classify_blocks)
+{
+   BOOST_CHECK( chunks_t::classify( 10, 10, 100 ) == disposition::apply );
+   BOOST_CHECK( chunks_t::classify( 11, 10, 100 ) == disposition::hold );
+   BOOST_CHECK( chunks_t::classify( 100, 10, 100 ) == disposition::hold );
+   // already applied, or past anything requested
+   BOOST_CHECK( chunks_t::classify( 9, 10, 100 ) == disposition::drop );
+   BOOST_CHECK( chunks_t::classify( 101, 10, 100 ) == disposition::drop );
+}
+
+BOOST_AUTO_TEST_CASE(out_of_order_chunks)
+{
+   auto a = std::make_shared<std::string>( "a" );
+   auto b = std::make_shared<std::string>( "b" );
+   chunks_t chunks;
+   uint32_t next_expected = 1;
+   const uint32_t last_requested = 20;
+   chunks.assign( 1, 10, a );
+   chunks.assign( 11, 20, b );
+   BOOST_CHECK_EQUAL( chunks.chunk_count( a ), 1u );
+   BOOST_CHECK_EQUAL( chunks.chunk_count( b ), 1u );
+
+   // b's chunk arrives first and is held
+   for( uint32_t n = 11; n <= 20; ++n ) {
+      BOOST_CHECK( receive( chunks, b, n, next_expected, last_requested ).empty() );
+   }
+   BOOST_CHECK_EQUAL( chunks.chunk_count( b ), 0u );
+   BOOST_CHECK_EQUAL( chunks.held_count(), 10u );
+   BOOST_CHECK_EQUAL( next_expected, 1u );
+
+   // a's chunk fills the gap, the last block releases everything held
+   for( uint32_t n = 1; n < 10; ++n ) {
+      BOOST_CHECK( receive( chunks, a, n, next_expected, last_requested ) == std::vector<uint32_t>{ n } );
+   }
+   auto applied = receive( chunks, a, 10, next_expected, last_requested );
+   BOOST_CHECK_EQUAL( applied.size(), 11u );
+   BOOST_CHECK_EQUAL( applied.front(), 10u );
+   BOOST_CHECK_EQUAL( applied.back(), 20u );
+   BOOST_CHECK_EQUAL( next_expected, 21u );
+   BOOST_CHECK( chunks.empty() );
+   BOOST_CHECK_EQUAL( chunks.held_count(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE(reassigned_chunks)
+{
+   auto a = std::make_shared<std::string>( "a" );
+   auto b = std::make_shared<std::string>( "b" );
+   auto c = std::make_shared<std::string>( "c" );
+   chunks_t chunks;
+   uint32_t next_expected = 1;
+   const uint32_t last_requested = 30;
+   chunks.assign( 1, 10, a );
+   chunks.assign( 11, 20, b );
+   chunks.assign( 21, 30, c );
+
+   // b delivers part of its chunk, then times out and its chunk is returned
+   for( uint32_t n = 11; n <= 14; ++n ) {
+      receive( chunks, b, n, next_expected, last_requested );
+   }
+   BOOST_CHECK( chunks.return_chunks( b ) );
+   BOOST_CHECK( !chunks.return_chunks( b ) );
+   auto rest = chunks.first_unassigned();
+   BOOST_REQUIRE( rest );
+   BOOST_CHECK_EQUAL( rest->first, 15u );
+   BOOST_CHECK_EQUAL( rest->second, 20u );
+
+   // requested again from c, in two parts
+   chunks.assign( 15, 17, c );
+   rest = chunks.first_unassigned();
+   BOOST_REQUIRE( rest );
+   BOOST_CHECK_EQUAL( rest->first, 18u );
+   BOOST_CHECK_EQUAL( rest->second, 20u );
+   chunks.assign( 18, 20, c );
+   BOOST_CHECK( !chunks.first_unassigned() );
+   BOOST_CHECK_EQUAL( chunks.chunk_count( c ), 3u );
+
+   // b's late blocks still arrive, they are held once and do not touch c's chunks
+   receive( chunks, b, 15, next_expected, last_requested );
+   receive( chunks, b, 16, next_expected, last_requested );
+   BOOST_CHECK_EQUAL( chunks.chunk_count( c ), 3u );
+
+   // c sends its ranges, including the blocks b already delivered late
+   for( uint32_t n = 15; n <= 30; ++n ) {
+      BOOST_CHECK( receive( chunks, c, n, next_expected, last_requested ).empty() );
+   }
+   BOOST_CHECK_EQUAL( chunks.chunk_count( c ), 0u );
+   BOOST_CHECK_EQUAL( chunks.held_count(), 20u );
+
+   // a completes, everything is applied once and in order
+   std::vector<uint32_t> applied;
+   for( uint32_t n = 1; n <= 10; ++n ) {
+      auto r = receive( chunks, a, n, next_expected, last_requested );
+      applied.insert( applied.end(), r.begin(), r.end() );
+   }
+   BOOST_REQUIRE_EQUAL( applied.size(), 30u );
+   for( uint32_t i = 0; i < applied.size(); ++i ) {
+      BOOST_CHECK_EQUAL( applied[i], i + 1 );
+   }
+   BOOST_CHECK( chunks.empty() );
+
+   // duplicates of applied blocks and blocks never requested are dropped
+   BOOST_CHECK( receive( chunks, b, 17, next_expected, last_requested ).empty() );
+   BOOST_CHECK( receive( chunks, c, 31, next_expected, last_requested ).empty() );
+   BOOST_CHECK_EQUAL( chunks.held_count(), 0u );
+   BOOST_CHECK_EQUAL( next_expected, 31u );
+}
+
+BOOST_AUTO_TEST_CASE(returned_after_partial_delivery)
+{
+   auto a = std::make_shared<std::string>( "a" );
+   chunks_t chunks;
+   chunks.assign( 1, 10, a );
+   chunks.block_received( a, 1 );
+   chunks.block_received( a, 2 );
+   // a block outside a's chunk is ignored
+   chunks.block_received( a, 50 );
+   BOOST_CHECK( chunks.return_chunks( a ) );
+   auto rest = chunks.first_unassigned();
+   BOOST_REQUIRE( rest );
+   BOOST_CHECK_EQUAL( rest->first, 3u );
+   BOOST_CHECK_EQUAL( rest->second, 10u );
+
+   // a finished chunk returns nothing to request
+   chunks.clear();
+   chunks.assign( 1, 2, a );
+   chunks.block_received( a, 1 );
+   chunks.block_received( a, 2 );
+   BOOST_CHECK( chunks.empty() );
+   BOOST_CHECK( !chunks.return_chunks( a ) );
+   BOOST_CHECK( !chunks.first_unassigned() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
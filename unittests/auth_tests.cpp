@@ -332,6 +332,52 @@ try {
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( authorizer_index ) { try {
+   TESTER chain;
+   chain.create_account("alice");
+   auto& authorization = chain.control->get_mutable_authorization_manager();
+   BOOST_CHECK_THROW( authorization.find_permissions_by_key( chain.get_public_key("alice", "active") ), unsupported_feature );
+   authorization.enable_authorizer_index();
+   chain.create_account("bob");
+   chain.produce_block();
+
+   auto names = []( const vector<const permission_object*>& perms ) {
+      vector<permission_level> result;
+      for( const auto* p : perms ) result.push_back( {p->owner, p->name} );
+      std::sort( result.begin(), result.end() );
+      return result;
+   };
+   using levels = vector<permission_level>;
+
+   // built from the chain state, and kept up to date
+   BOOST_CHECK( (names( authorization.find_permissions_by_key( chain.get_public_key("alice", "active") ) )
+                == levels{permission_level{N(alice), config::active_name}}) );
+   BOOST_CHECK( (names( authorization.find_permissions_by_key( chain.get_public_key("bob", "owner") ) )
+                == levels{permission_level{N(bob), config::owner_name}}) );
+
+   const auto shared_key = chain.get_public_key("shared", "active");
+   chain.set_authority( N(alice), N(spending), authority(shared_key), config::active_name );
+   chain.set_authority( N(bob), config::active_name,
+                        authority(1, {key_weight{shared_key, 1}}, {permission_level_weight{{N(alice), config::active_name}, 1}}),
+                        config::owner_name );
+   chain.produce_block();
+   BOOST_CHECK( (names( authorization.find_permissions_by_key( shared_key ) )
+                == levels{permission_level{N(alice), N(spending)}, permission_level{N(bob), config::active_name}}) );
+   BOOST_CHECK( names( authorization.find_permissions_by_key( chain.get_public_key("bob", "active") ) ).empty() );
+   BOOST_CHECK( (names( authorization.find_permissions_by_account( N(alice) ) ) == levels{permission_level{N(bob), config::active_name}}) );
+
+   // changes undone without going through authorization_manager
+   chain.delete_authority( N(alice), N(spending) );
+   chain.set_authority( N(bob), config::active_name, authority(chain.get_public_key("bob", "active")), config::owner_name );
+   BOOST_CHECK( names( authorization.find_permissions_by_key( shared_key ) ).empty() );
+   BOOST_CHECK( names( authorization.find_permissions_by_account( N(alice) ) ).empty() );
+   chain.control->abort_block();
+   BOOST_CHECK( (names( authorization.find_permissions_by_key( shared_key ) )
+                == levels{permission_level{N(alice), N(spending)}, permission_level{N(bob), config::active_name}}) );
+   BOOST_CHECK( (names( authorization.find_permissions_by_account( N(alice) ) ) == levels{permission_level{N(bob), config::active_name}}) );
+   BOOST_CHECK( names( authorization.find_permissions_by_key( chain.get_public_key("bob", "active") ) ).empty() );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( any_auth ) { try {
    TESTER chain;
    chain.create_accounts( {"alice","bob"} );
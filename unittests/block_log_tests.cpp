@@ -0,0 +1,198 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/block_log.hpp>
+#include <eosio/chain/trx_block_index.hpp>
+#include <fc/filesystem.hpp>
+
+#include <fstream>
+
+using namespace eosio;
+using namespace chain;
+
+namespace {
+   void append_blocks( block_log& blog, signed_block_ptr& prev, uint32_t last_block_num ) {
+      while( !prev || prev->block_num() < last_block_num ) {
+         auto b = std::make_shared<signed_block>();
+         if( prev )
+            b->previous = prev->id();
+         blog.append( b );
+         prev = b;
+      }
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(block_log_tests)
+
+BOOST_AUTO_TEST_CASE(split_and_prune)
+{
+   fc::temp_directory tempdir;
+   log_split_config cfg;
+   cfg.stride = 10;
+   cfg.max_retained_files = 2;
+   cfg.archive_dir = fc::path();
+
+   signed_block_ptr prev;
+   {
+      block_log blog( tempdir.path(), cfg );
+      blog.reset( genesis_state(), signed_block_ptr(), 1 );
+      append_blocks( blog, prev, 35 );
+
+      // blocks 1-10 were deleted, 11-20 and 21-30 are retained, 31-35 are in blocks.log
+      BOOST_CHECK_EQUAL( blog.first_block_num(), 11u );
+      BOOST_CHECK_EQUAL( blog.head()->block_num(), 35u );
+      BOOST_CHECK( !blog.read_block_by_num( 5 ) );
+      BOOST_CHECK_EQUAL( blog.read_block_by_num( 15 )->block_num(), 15u );
+      BOOST_CHECK_EQUAL( blog.read_block_by_num( 30 )->block_num(), 30u );
+      BOOST_CHECK_EQUAL( blog.read_block_by_num( 31 )->block_num(), 31u );
+
+      append_blocks( blog, prev, 40 );
+   }
+
+   // segments are deleted in the background; closing the log waits for that
+   BOOST_CHECK( !fc::exists( tempdir.path() / "blocks-1-10.log" ) );
+   BOOST_CHECK( !fc::exists( tempdir.path() / "blocks-11-20.log" ) );
+   BOOST_CHECK( fc::exists( tempdir.path() / "blocks-21-30.log" ) );
+   BOOST_CHECK( fc::exists( tempdir.path() / "blocks-31-40.index" ) );
+
+   // reopening right after a split finds the head in the newest retained segment
+   block_log blog( tempdir.path(), cfg );
+   BOOST_CHECK_EQUAL( blog.first_block_num(), 21u );
+   BOOST_REQUIRE( blog.head() );
+   BOOST_CHECK_EQUAL( blog.head()->block_num(), 40u );
+   BOOST_CHECK( blog.head()->id() == prev->id() );
+   BOOST_CHECK_EQUAL( blog.read_block_by_num( 25 )->block_num(), 25u );
+
+   append_blocks( blog, prev, 41 );
+   BOOST_CHECK_EQUAL( blog.read_block_by_num( 41 )->block_num(), 41u );
+   BOOST_CHECK_EQUAL( blog.read_block_by_num( 39 )->block_num(), 39u );
+}
+
+BOOST_AUTO_TEST_CASE(serialized_blocks)
+{
+   fc::temp_directory tempdir;
+   log_split_config cfg;
+   cfg.stride = 10;
+
+   signed_block_ptr prev;
+   block_log blog( tempdir.path(), cfg );
+   blog.reset( genesis_state(), signed_block_ptr(), 1 );
+   append_blocks( blog, prev, 20 );
+
+   // right after a split the head is the last block of a retained segment
+   auto check = [&]( uint32_t block_num ) {
+      auto packed = blog.read_serialized_block_by_num( block_num );
+      BOOST_REQUIRE( packed == fc::raw::pack( *blog.read_block_by_num( block_num ) ) );
+   };
+   check( 1 );
+   check( 10 );
+   check( 20 );
+
+   append_blocks( blog, prev, 25 );
+   check( 15 );
+   check( 21 );
+   check( 25 );
+   BOOST_CHECK( blog.read_serialized_block_by_num( 26 ).empty() );
+}
+
+BOOST_AUTO_TEST_CASE(archive_segments)
+{
+   fc::temp_directory tempdir;
+   log_split_config cfg;
+   cfg.stride = 5;
+   cfg.max_retained_files = 1;
+   cfg.retained_dir = "retained";
+   cfg.archive_dir = tempdir.path() / "cold";
+
+   signed_block_ptr prev;
+   {
+      block_log blog( tempdir.path() / "blocks", cfg );
+      blog.reset( genesis_state(), signed_block_ptr(), 1 );
+      append_blocks( blog, prev, 12 );
+
+      // readable wherever the background move has got to
+      BOOST_CHECK_EQUAL( blog.first_block_num(), 6u );
+      BOOST_CHECK_EQUAL( blog.read_block_by_num( 7 )->block_num(), 7u );
+   }
+
+   BOOST_CHECK( fc::exists( tempdir.path() / "cold" / "blocks-1-5.log" ) );
+   BOOST_CHECK( fc::exists( tempdir.path() / "cold" / "blocks-1-5.index" ) );
+   BOOST_CHECK( fc::exists( tempdir.path() / "blocks" / "retained" / "blocks-6-10.log" ) );
+   BOOST_CHECK( !fc::exists( tempdir.path() / "blocks" / "blocks-6-10.log" ) );
+}
+
+BOOST_AUTO_TEST_CASE(staged_segments)
+{
+   fc::temp_directory tempdir;
+   log_split_config cfg;
+   cfg.retained_dir = "retained";
+
+   // a segment renamed into the log directory by add() whose move was cut short
+   for( const char* f : { "blocks-1-5.log", "blocks-1-5.index" } ) {
+      std::ofstream out( ( tempdir.path() / f ).generic_string() );
+      out << f;
+   }
+
+   log_catalog catalog;
+   catalog.open( tempdir.path(), cfg, "blocks" );
+   BOOST_REQUIRE( catalog.find( 3 ) );
+   catalog.wait();
+   BOOST_CHECK( catalog.find( 3 )->log_file == tempdir.path() / "retained" / "blocks-1-5.log" );
+   BOOST_CHECK( catalog.find( 3 )->index_file == tempdir.path() / "retained" / "blocks-1-5.index" );
+   BOOST_CHECK( !fc::exists( tempdir.path() / "blocks-1-5.log" ) );
+   BOOST_CHECK( !fc::exists( tempdir.path() / "blocks-1-5.index" ) );
+
+   // and one moved again after a crash which left both copies
+   for( const char* f : { "blocks-1-5.log", "blocks-1-5.index" } ) {
+      std::ofstream out( ( tempdir.path() / f ).generic_string() );
+      out << f;
+   }
+   catalog.open( tempdir.path(), cfg, "blocks" );
+   catalog.wait();
+   BOOST_CHECK_EQUAL( catalog.size(), 1u );
+   BOOST_CHECK( !fc::exists( tempdir.path() / "blocks-1-5.log" ) );
+   BOOST_CHECK( fc::exists( tempdir.path() / "retained" / "blocks-1-5.log" ) );
+}
+
+BOOST_AUTO_TEST_CASE(trx_index)
+{
+   fc::temp_directory tempdir;
+   auto trx_id = []( uint32_t block_num, uint32_t i ) { return fc::sha256::hash( std::to_string( block_num * 100 + i ) ); };
+
+   // found in memory before the index is closed and in its run after
+   signed_block_ptr prev;
+   {
+      trx_block_index index( tempdir.path() );
+      while( !prev || prev->block_num() < 200 ) {
+         auto b = std::make_shared<signed_block>();
+         if( prev )
+            b->previous = prev->id();
+         for( uint32_t i = 0; i < 3; ++i )
+            b->transactions.emplace_back( trx_id( b->block_num(), i ) );
+         index.add_block( *b );
+         prev = b;
+      }
+      BOOST_CHECK_EQUAL( index.next_block_num(), 201u );
+      auto found = index.find( trx_id( 150, 2 ) );
+      BOOST_REQUIRE_EQUAL( found.size(), 1u );
+      BOOST_CHECK_EQUAL( found[0], 150u );
+   }
+
+   trx_block_index index( tempdir.path() );
+   BOOST_CHECK_EQUAL( index.next_block_num(), 201u );
+   index.add_block( *prev ); // already indexed, ignored
+   for( uint32_t block_num = 1; block_num <= 200; block_num += 7 ) {
+      auto found = index.find( trx_id( block_num, block_num % 3 ) );
+      BOOST_REQUIRE_EQUAL( found.size(), 1u );
+      BOOST_CHECK_EQUAL( found[0], block_num );
+
+      // a 4 byte prefix, as given to get_transaction, also finds it
+      auto by_prefix = index.find( trx_id( block_num, block_num % 3 ), 4 );
+      BOOST_CHECK( std::find( by_prefix.begin(), by_prefix.end(), block_num ) != by_prefix.end() );
+   }
+   BOOST_CHECK( index.find( trx_id( 201, 0 ) ).empty() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,210 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <boost/test/unit_test.hpp>
+#include <columnar_export.hpp>
+#include <fc/filesystem.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace eosio;
+using namespace chain;
+
+namespace {
+
+   struct expected_log {
+      std::vector<uint32_t>            trx_block_num;
+      std::vector<transaction_id_type> trx_id;
+      std::vector<uint64_t>            act_trx_index; ///< the transactions.* row of every action, in export order
+      std::vector<uint8_t>             act_context_free;
+      std::vector<uint32_t>            act_ordinal;
+   };
+
+   /**
+    * Blocks 1 through last_block_num, block n holding n % 3 packed transactions of one context free and two
+    * regular actions, and every even block a deferred transaction known only by its id
+    */
+   expected_log write_log( const fc::path& dir, uint32_t last_block_num ) {
+      expected_log expected;
+      block_log blog( dir );
+      blog.reset( genesis_state(), signed_block_ptr(), 1 );
+      signed_block_ptr prev;
+      uint16_t trx_num = 0;
+      for( uint32_t n = 1; n <= last_block_num; ++n ) {
+         auto b = std::make_shared<signed_block>();
+         if( prev )
+            b->previous = prev->id();
+         for( uint32_t i = 0; i < n % 3; ++i ) {
+            signed_transaction t;
+            t.expiration = fc::time_point_sec( 1000000 );
+            t.ref_block_num = ++trx_num;
+            t.context_free_actions.emplace_back( vector<permission_level>{}, N(cfa), N(nop), bytes{} );
+            for( int a = 0; a < 2; ++a )
+               t.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}}, N(eosio.token),
+                                       N(transfer), bytes( a + 1, 'd' ) );
+            packed_transaction pt( t );
+            expected.trx_block_num.push_back( n );
+            expected.trx_id.push_back( pt.id() );
+            for( uint32_t a = 0; a < 3; ++a ) {
+               expected.act_trx_index.push_back( expected.trx_id.size() - 1 );
+               expected.act_context_free.push_back( a == 0 );
+               expected.act_ordinal.push_back( a );
+            }
+            b->transactions.emplace_back( std::move( pt ) );
+         }
+         if( n % 2 == 0 ) {
+            transaction_receipt r;
+            r.trx = transaction_id_type( fc::sha256::hash( std::to_string( n ) ) );
+            expected.trx_block_num.push_back( n );
+            expected.trx_id.push_back( r.trx.get<transaction_id_type>() );
+            b->transactions.emplace_back( std::move( r ) );
+         }
+         blog.append( b );
+         prev = b;
+      }
+      return expected;
+   }
+
+   template<typename T>
+   std::vector<T> read_column( const fc::path& file ) {
+      std::vector<char> data( fc::file_size( file ) );
+      std::ifstream f( file.generic_string(), std::ios::binary );
+      f.read( data.data(), data.size() );
+      BOOST_REQUIRE_EQUAL( data.size() % sizeof(T), 0u );
+      std::vector<T> result( data.size() / sizeof(T) );
+      memcpy( result.data(), data.data(), data.size() );
+      return result;
+   }
+
+   std::vector<fc::sha256> read_checksums( const fc::path& file ) {
+      auto raw = read_column<char>( file );
+      BOOST_REQUIRE_EQUAL( raw.size() % 32, 0u );
+      std::vector<fc::sha256> result;
+      for( size_t i = 0; i < raw.size(); i += 32 )
+         result.emplace_back( raw.data() + i, 32 );
+      return result;
+   }
+
+   /// schema.json agrees with the row counts and with the size of every column file
+   void check_schema( const fc::path& dir, const columnar::export_summary& s ) {
+      auto schema = fc::json::from_file( dir / "schema.json" ).get_object();
+      BOOST_CHECK_EQUAL( schema["blocks"].as_uint64(), s.num_blocks );
+      BOOST_CHECK_EQUAL( schema["transactions"].as_uint64(), s.num_transactions );
+      BOOST_CHECK_EQUAL( schema["actions"].as_uint64(), s.num_actions );
+      const auto& columns = schema["columns"].get_object();
+      BOOST_CHECK_EQUAL( columns.size(), columnar::batch().columns().size() );
+      for( const auto& c : columns ) {
+         BOOST_REQUIRE( fc::exists( dir / c.key() ) );
+         BOOST_CHECK_EQUAL( c.value()["bytes"].as_uint64(), fc::file_size( dir / c.key() ) );
+      }
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(columnar_export_tests)
+
+/// Four batches decoded on two threads give the same rows as the blocks, with actions pointing at their transactions
+BOOST_AUTO_TEST_CASE(export_batches)
+{ try {
+   fc::temp_directory blocks_dir;
+   fc::temp_directory out_dir;
+   const auto expected = write_log( blocks_dir.path(), 10 );
+
+   // the last block is past the head of the log
+   auto s = columnar::export_blocks( blocks_dir.path(), out_dir.path(), 0, 1000, 2, 3 );
+   BOOST_CHECK_EQUAL( s.num_blocks, 10u );
+   BOOST_CHECK_EQUAL( s.num_transactions, expected.trx_id.size() );
+   BOOST_CHECK_EQUAL( s.num_actions, expected.act_trx_index.size() );
+   check_schema( out_dir.path(), s );
+
+   const auto& dir = out_dir.path();
+   auto block_num = read_column<uint32_t>( dir / "blocks.block_num" );
+   BOOST_REQUIRE_EQUAL( block_num.size(), 10u );
+   for( uint32_t i = 0; i < 10; ++i )
+      BOOST_CHECK_EQUAL( block_num[i], i + 1 );
+   auto trx_count = read_column<uint32_t>( dir / "blocks.transaction_count" );
+   BOOST_CHECK_EQUAL( trx_count[3], 1u + 1u ); // block 4
+   BOOST_CHECK_EQUAL( trx_count[4], 2u );      // block 5
+
+   auto trx_block_num = read_column<uint32_t>( dir / "transactions.block_num" );
+   auto trx_id = read_checksums( dir / "transactions.id" );
+   BOOST_CHECK( trx_block_num == expected.trx_block_num );
+   BOOST_REQUIRE( trx_id == expected.trx_id );
+
+   auto act_trx_index = read_column<uint64_t>( dir / "actions.trx_index" );
+   auto act_block_num = read_column<uint32_t>( dir / "actions.block_num" );
+   BOOST_CHECK( act_trx_index == expected.act_trx_index );
+   BOOST_CHECK( read_column<uint8_t>( dir / "actions.context_free" ) == expected.act_context_free );
+   BOOST_CHECK( read_column<uint32_t>( dir / "actions.ordinal" ) == expected.act_ordinal );
+   BOOST_REQUIRE_EQUAL( act_block_num.size(), act_trx_index.size() );
+   for( size_t i = 0; i < act_trx_index.size(); ++i ) {
+      BOOST_REQUIRE_LT( act_trx_index[i], trx_id.size() );
+      BOOST_CHECK_EQUAL( act_block_num[i], trx_block_num[act_trx_index[i]] );
+   }
+} FC_LOG_AND_RETHROW() }
+
+/// A range starting mid log numbers its transactions from the first exported one
+BOOST_AUTO_TEST_CASE(export_range)
+{ try {
+   fc::temp_directory blocks_dir;
+   fc::temp_directory out_dir;
+   const auto expected = write_log( blocks_dir.path(), 10 );
+
+   auto s = columnar::export_blocks( blocks_dir.path(), out_dir.path(), 4, 8, 3, 2 );
+   BOOST_CHECK_EQUAL( s.num_blocks, 5u );
+   check_schema( out_dir.path(), s );
+
+   // transactions of blocks 1-3 are not exported
+   const auto first_trx = std::find( expected.trx_block_num.begin(), expected.trx_block_num.end(), 4u ) -
+                          expected.trx_block_num.begin();
+   auto trx_id = read_checksums( out_dir.path() / "transactions.id" );
+   BOOST_REQUIRE_EQUAL( trx_id.size(), s.num_transactions );
+   auto act_trx_index = read_column<uint64_t>( out_dir.path() / "actions.trx_index" );
+   BOOST_REQUIRE_EQUAL( act_trx_index.size(), s.num_actions );
+   for( size_t i = 0; i < act_trx_index.size(); ++i ) {
+      BOOST_REQUIRE_LT( act_trx_index[i], trx_id.size() );
+      BOOST_CHECK( trx_id[act_trx_index[i]] == expected.trx_id[first_trx + act_trx_index[i]] );
+   }
+} FC_LOG_AND_RETHROW() }
+
+/// A batch reaching past the end of the log stops there, and its actions are rebased onto earlier batches
+BOOST_AUTO_TEST_CASE(decode_batch)
+{ try {
+   fc::temp_directory blocks_dir;
+   const auto expected = write_log( blocks_dir.path(), 10 );
+
+   auto b = columnar::decode( blocks_dir.path(), 8, 20 );
+   BOOST_CHECK_EQUAL( b.first_block_num, 8u );
+   BOOST_CHECK_EQUAL( b.end_block_num, 11u );
+   BOOST_CHECK_EQUAL( b.requested_end_block, 21u );
+   BOOST_CHECK_EQUAL( b.num_blocks, 3u );
+
+   b = columnar::decode( blocks_dir.path(), 4, 6 );
+   BOOST_CHECK_EQUAL( b.end_block_num, b.requested_end_block );
+   BOOST_REQUIRE_GT( b.num_actions, 0u );
+   const auto first_trx = std::find( expected.trx_block_num.begin(), expected.trx_block_num.end(), 4u ) -
+                          expected.trx_block_num.begin();
+   auto index_at = [&]( uint64_t i ) {
+      uint64_t v;
+      memcpy( &v, b.act_trx_index.data.data() + i * sizeof(v), sizeof(v) );
+      return v;
+   };
+   BOOST_CHECK_EQUAL( index_at( 0 ), 0u ); // relative to the batch until rebased
+   b.rebase_trx_index( first_trx );
+   for( uint64_t i = 0; i < b.num_actions; ++i ) {
+      auto trx_index = index_at( i );
+      BOOST_REQUIRE_LT( trx_index, expected.trx_block_num.size() );
+      BOOST_CHECK_GE( expected.trx_block_num[trx_index], 4u );
+      BOOST_CHECK_LE( expected.trx_block_num[trx_index], 6u );
+   }
+
+   // another log read on the same thread is opened anew
+   fc::temp_directory other_dir;
+   write_log( other_dir.path(), 3 );
+   b = columnar::decode( other_dir.path(), 1, 10 );
+   BOOST_CHECK_EQUAL( b.end_block_num, 4u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
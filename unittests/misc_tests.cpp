@@ -1124,6 +1124,45 @@ BOOST_AUTO_TEST_CASE(stable_priority_queue_test) {
   } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE(writer_priority_shared_mutex_test) {
+  try {
+     writer_priority_shared_mutex mtx;
+     std::atomic<bool> done{false};
+     std::atomic<uint64_t> reads{0};
+     std::atomic<uint64_t> torn{0};
+     uint64_t a = 0, b = 0;
+
+     // readers never see a half finished write
+     std::vector<std::thread> readers;
+     for( int i = 0; i < 4; ++i ) {
+        readers.emplace_back( [&]() {
+           while( !done ) {
+              std::shared_lock<writer_priority_shared_mutex> g( mtx );
+              if( a != b ) ++torn;
+              ++reads;
+           }
+        } );
+     }
+
+     while( reads == 0 ) std::this_thread::yield();
+
+     // the writer is not starved by the readers, and may lock again while holding the lock
+     for( int i = 0; i < 10000; ++i ) {
+        std::unique_lock<writer_priority_shared_mutex> g( mtx );
+        ++a;
+        std::unique_lock<writer_priority_shared_mutex> g2( mtx );
+        ++b;
+     }
+     done = true;
+     for( auto& t : readers ) t.join();
+
+     BOOST_CHECK_EQUAL( a, 10000u );
+     BOOST_CHECK_EQUAL( b, 10000u );
+     BOOST_CHECK_EQUAL( torn.load(), 0u );
+     BOOST_CHECK_GT( reads.load(), 0u );
+
+  } FC_LOG_AND_RETHROW()
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -147,9 +147,52 @@ struct buffered_snapshot_suite {
 
 };
 
+struct sectioned_snapshot_suite {
+   using writer_t = sectioned_snapshot_writer;
+   using reader_t = sectioned_snapshot_reader;
+   using write_storage_t = std::ostringstream;
+   using snapshot_t = std::string;
+   using read_storage_t = std::istringstream;
+
+   struct writer : public writer_t {
+      writer( const std::shared_ptr<write_storage_t>& storage )
+      :writer_t(*storage, 2, 1) // one row per chunk, to split contract tables across chunks
+      ,storage(storage)
+      {
+
+      }
+
+      std::shared_ptr<write_storage_t> storage;
+   };
+
+   struct reader : public reader_t {
+      explicit reader(const std::shared_ptr<read_storage_t>& storage)
+      :reader_t(*storage, 2)
+      ,storage(storage)
+      {}
+
+      std::shared_ptr<read_storage_t> storage;
+   };
+
+
+   static auto get_writer() {
+      return std::make_shared<writer>(std::make_shared<write_storage_t>());
+   }
+
+   static auto finalize(const std::shared_ptr<writer>& w) {
+      w->finalize();
+      return w->storage->str();
+   }
+
+   static auto get_reader( const snapshot_t& buffer) {
+      return std::make_shared<reader>(std::make_shared<read_storage_t>(buffer));
+   }
+
+};
+
 BOOST_AUTO_TEST_SUITE(snapshot_tests)
 
-using snapshot_suites = boost::mpl::list<variant_snapshot_suite, buffered_snapshot_suite>;
+using snapshot_suites = boost::mpl::list<variant_snapshot_suite, buffered_snapshot_suite, sectioned_snapshot_suite>;
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(test_exhaustive_snapshot, SNAPSHOT_SUITE, snapshot_suites)
 {